@@ -27,6 +27,10 @@ const char *to_str(NodeType type) {
             return "VARIABLE";
         case NodeType::STRING:
             return "STRING";
+        case NodeType::ADD:
+            return "ADD";
+        case NodeType::EXTERNAL_OBJECT:
+            return "EXTERNAL_OBJECT";
     }
     return "???";
 }
@@ -19,6 +19,8 @@ enum class NodeType {
     OBJECT,
     VARIABLE,
     STRING,
+    ADD,
+    EXTERNAL_OBJECT,
 };
 
 const char *to_str(NodeType type);
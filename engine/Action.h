@@ -0,0 +1,37 @@
+//
+// Created by roel on 10/19/26.
+//
+
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "Resources.h"
+
+/*
+ * A single unit of work for the executor: a command line that reads the
+ * input files and produces the output files.
+ */
+struct Action {
+    std::string id;
+    std::vector<std::string> command;
+    std::vector<std::string> inputs;
+    std::vector<std::string> outputs;
+
+    // File in which the command writes the inputs it discovered, if not empty
+    std::string depfile;
+
+    Resources resources;
+
+    // Command of the persistent worker the action is sent to, a prefix of the
+    // command, or empty to run the command as a process of its own
+    std::vector<std::string> worker;
+
+    [[nodiscard]] std::string description() const {
+        if (!outputs.empty()) return outputs.front();
+        if (!command.empty()) return command.front();
+        return id;
+    }
+};
@@ -0,0 +1,251 @@
+//
+// Created by roel on 10/19/26.
+//
+
+#include "ActionCache.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <unistd.h>
+
+#include "RemoteProtocol.h"
+#include "util/Hasher.h"
+#include "hash/FileHasher.h"
+
+ActionCache::ActionCache(std::string dir_) :
+        dir(std::move(dir_)),
+        file_states(nullptr),
+        remote(nullptr),
+        temp_counter(0),
+        remote_restores(0) {}
+
+ActionCache::ActionCache(std::string dir_, FileStateDb &file_states_) :
+        dir(std::move(dir_)),
+        file_states(&file_states_),
+        remote(nullptr),
+        temp_counter(0),
+        remote_restores(0) {}
+
+ActionCache::ActionCache(std::string dir_, FileStateDb &file_states_, HttpCache &remote_) :
+        dir(std::move(dir_)),
+        file_states(&file_states_),
+        remote(&remote_),
+        temp_counter(0),
+        remote_restores(0) {}
+
+const std::string &ActionCache::get_dir() const {
+    return dir;
+}
+
+unsigned int ActionCache::remote_count() const {
+    return remote_restores;
+}
+
+std::optional<Digest> ActionCache::key(const Action &action, const std::vector<std::string> &environment) const {
+    Hasher hasher;
+    for (const auto *strings: {&action.command, &environment, &action.outputs}) {
+        hasher.add(static_cast<uint64_t>(strings->size()));
+        for (const std::string &str: *strings) {
+            hasher.add(str);
+        }
+    }
+
+    hasher.add(static_cast<uint64_t>(action.inputs.size()));
+    for (const std::string &input: action.inputs) {
+        const std::optional<Digest> digest = hash(input);
+        if (!digest) return std::nullopt;
+        hasher.add(input);
+        hasher.add(*digest);
+    }
+    return hasher.digest();
+}
+
+std::optional<Digest> ActionCache::hash(const std::string &path) const {
+    return file_states ? file_states->hash(path) : FileHasher::hash_file(path);
+}
+
+std::string ActionCache::blob_path(const std::string &digest) const {
+    return dir + "/blobs/" + digest;
+}
+
+std::string ActionCache::entry_path(const Digest &key) const {
+    return dir + "/actions/" + key.to_string();
+}
+
+std::string ActionCache::temp_path() const {
+    std::ostringstream path;
+    path << dir << "/tmp/" << getpid() << "-" << std::this_thread::get_id() << "-" << temp_counter++;
+    return path.str();
+}
+
+bool ActionCache::write_file(const std::string &path, const std::string &content) const {
+    const std::string temp = temp_path();
+    {
+        std::ofstream stream(temp, std::ios::binary | std::ios::trunc);
+        if (!stream.write(content.data(), static_cast<std::streamsize>(content.size()))) return false;
+    }
+    std::error_code error;
+    std::filesystem::rename(temp, path, error);
+    if (error) std::filesystem::remove(temp, error);
+    return !error;
+}
+
+bool ActionCache::create_dirs() const {
+    std::error_code error;
+    for (const char *sub_dir: {"/blobs", "/actions", "/tmp"}) {
+        std::filesystem::create_directories(dir + sub_dir, error);
+        if (error) return false;
+    }
+    return true;
+}
+
+bool ActionCache::store_blob(const std::string &path, Digest &digest) const {
+    const std::optional<Digest> file_digest = hash(path);
+    if (!file_digest) return false;
+    digest = *file_digest;
+
+    const std::string target = blob_path(digest.to_string());
+    std::error_code error;
+    if (std::filesystem::exists(target, error)) return true;
+
+    const std::string temp = temp_path();
+    std::filesystem::copy_file(path, temp, std::filesystem::copy_options::overwrite_existing, error);
+    if (!error) std::filesystem::rename(temp, target, error);
+    if (error) std::filesystem::remove(temp, error);
+    return !error;
+}
+
+bool ActionCache::store_blob_content(const std::string &content, Digest &digest) const {
+    digest = Hasher().add(content.data(), content.size()).digest();
+    const std::string target = blob_path(digest.to_string());
+    std::error_code error;
+    if (std::filesystem::exists(target, error)) return true;
+    return write_file(target, content);
+}
+
+bool ActionCache::store(const Digest &key, const Action &action, const std::string &output) {
+    if (!create_dirs()) return false;
+
+    // One blob digest per line: the console output, followed by the outputs
+    std::string entry;
+    std::vector<std::pair<std::string, std::string>> blobs;
+    Digest digest;
+    if (!store_blob_content(output, digest)) return false;
+    entry += digest.to_string() + "\n";
+    blobs.emplace_back(digest.to_string(), blob_path(digest.to_string()));
+
+    for (const std::string &path: action.outputs) {
+        if (!store_blob(path, digest)) return false;
+        std::error_code error;
+        const auto perms = std::filesystem::status(path, error).permissions();
+        const bool executable = (perms & std::filesystem::perms::owner_exec) != std::filesystem::perms::none;
+        entry += digest.to_string() + (executable ? " x\n" : "\n");
+        blobs.emplace_back(digest.to_string(), blob_path(digest.to_string()));
+    }
+    if (!write_file(entry_path(key), entry)) return false;
+
+    if (remote) remote->upload(key, std::move(entry), std::move(blobs));
+    return true;
+}
+
+std::optional<std::vector<ActionCache::Blob>> ActionCache::parse_entry(const std::string &entry,
+                                                                       size_t output_count) {
+    std::vector<Blob> blobs;
+    std::istringstream stream(entry);
+    std::string line;
+    while (std::getline(stream, line)) {
+        const size_t space = line.find(' ');
+        Blob blob{line.substr(0, space), space != std::string::npos && line.substr(space + 1) == "x"};
+        // Entries of the remote cache name files, so must not name others
+        if (!is_digest(blob.digest)) return std::nullopt;
+        blobs.push_back(std::move(blob));
+    }
+    if (blobs.size() != output_count + 1) return std::nullopt;
+    return blobs;
+}
+
+std::optional<std::vector<ActionCache::Blob>> ActionCache::read_entry(const Digest &key, size_t output_count) const {
+    std::ifstream stream(entry_path(key));
+    if (!stream) return std::nullopt;
+    const std::string entry((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+
+    std::optional<std::vector<Blob>> blobs = parse_entry(entry, output_count);
+    if (!blobs) return std::nullopt;
+    std::error_code error;
+    for (const Blob &blob: *blobs) {
+        if (!std::filesystem::exists(blob_path(blob.digest), error)) return std::nullopt;
+    }
+    return blobs;
+}
+
+std::optional<std::vector<ActionCache::Blob>> ActionCache::fetch_entry(const Digest &key,
+                                                                       size_t output_count) const {
+    const std::optional<std::string> entry = remote->get_entry(key);
+    if (!entry) return std::nullopt;
+    std::optional<std::vector<Blob>> blobs = parse_entry(*entry, output_count);
+    if (!blobs || !create_dirs()) return std::nullopt;
+
+    std::vector<std::string> missing;
+    std::error_code error;
+    for (const Blob &blob: *blobs) {
+        if (!std::filesystem::exists(blob_path(blob.digest), error) &&
+            std::find(missing.begin(), missing.end(), blob.digest) == missing.end()) {
+            missing.push_back(blob.digest);
+        }
+    }
+
+    const std::vector<std::optional<std::string>> contents = remote->get_blobs(missing);
+    for (size_t i = 0; i < missing.size(); i++) {
+        if (!contents[i] || !write_file(blob_path(missing[i]), *contents[i])) return std::nullopt;
+    }
+    // After its blobs, so that the next build restores it from here
+    if (!write_file(entry_path(key), *entry)) return std::nullopt;
+    return blobs;
+}
+
+bool ActionCache::restore(const Digest &key, const Action &action, std::string &output) const {
+    std::optional<std::vector<Blob>> blobs = read_entry(key, action.outputs.size());
+    const bool fetched = !blobs && remote;
+    if (fetched) blobs = fetch_entry(key, action.outputs.size());
+    if (!blobs) return false;
+
+    std::error_code error;
+    for (size_t i = 0; i < action.outputs.size(); i++) {
+        const Blob &blob = (*blobs)[i + 1];
+        const std::filesystem::path path(action.outputs[i]);
+        std::filesystem::create_directories(path.parent_path(), error);
+        if (error) return false;
+        std::filesystem::copy_file(blob_path(blob.digest), path, std::filesystem::copy_options::overwrite_existing,
+                                   error);
+        if (error) return false;
+        if (blob.executable) {
+            std::filesystem::permissions(path, std::filesystem::perms::owner_exec |
+                                               std::filesystem::perms::group_exec |
+                                               std::filesystem::perms::others_exec,
+                                         std::filesystem::perm_options::add, error);
+            if (error) return false;
+        }
+    }
+
+    std::ifstream output_stream(blob_path(blobs->front().digest), std::ios::binary);
+    output.assign(std::istreambuf_iterator<char>(output_stream), std::istreambuf_iterator<char>());
+    if (fetched) remote_restores++;
+    return true;
+}
+
+bool ActionCache::store_contents(const Digest &key, const std::string &contents) {
+    return store(key, Action(), contents);
+}
+
+std::optional<std::string> ActionCache::restore_contents(const Digest &key) const {
+    std::optional<std::vector<Blob>> blobs = read_entry(key, 0);
+    if (!blobs && remote) blobs = fetch_entry(key, 0);
+    if (!blobs) return std::nullopt;
+
+    std::ifstream stream(blob_path(blobs->front().digest), std::ios::binary);
+    if (!stream) return std::nullopt;
+    return std::string((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+}
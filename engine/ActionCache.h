@@ -0,0 +1,139 @@
+//
+// Created by roel on 10/19/26.
+//
+
+
+#pragma once
+
+#include <string>
+#include <optional>
+#include <vector>
+#include <atomic>
+
+#include "util/Digest.h"
+#include "Action.h"
+#include "FileStateDb.h"
+#include "HttpCache.h"
+
+/*
+ * On-disk cache of the outputs of actions, below a directory of its own:
+ *
+ *     blobs/<digest>      content addressed output files
+ *     actions/<key>       the blob digests of the outputs of an action
+ *
+ * The key of an action is a hash of its command line, environment and the
+ * contents of its inputs, so checking out an earlier revision of the sources
+ * restores earlier outputs instead of running the actions again. Files are
+ * written to a temporary name and renamed in place, so concurrent builds and
+ * interrupted builds never leave partial entries behind.
+ *
+ * An entry has a line for the console output and for every output, with the
+ * digest of its blob and " x" if the output is executable.
+ *
+ * With a remote cache, actions that are not in this cache are looked up in
+ * the remote cache, and what is found is added to this cache. Stored actions
+ * are uploaded to it. Keys only contain the paths of inputs as they are
+ * given, so actions with relative paths share their outputs between
+ * checkouts in other directories and on other machines.
+ */
+class ActionCache {
+public:
+    explicit ActionCache(std::string dir);
+
+    /*
+     * Looks up the digests of inputs and outputs in the file state database,
+     * instead of reading them every time.
+     */
+    ActionCache(std::string dir, FileStateDb &file_states);
+
+    ActionCache(std::string dir, FileStateDb &file_states, HttpCache &remote);
+
+    /*
+     * Returns the cache key of an action, or nothing if one of its inputs
+     * cannot be read.
+     */
+    [[nodiscard]] std::optional<Digest> key(const Action &action, const std::vector<std::string> &environment) const;
+
+    /*
+     * Returns the digest of the contents of a file, or nothing if it cannot
+     * be read.
+     */
+    [[nodiscard]] std::optional<Digest> hash(const std::string &path) const;
+
+    /*
+     * Copies the cached outputs of an action to their paths. Returns false
+     * if the action is not (completely) in the cache.
+     */
+    bool restore(const Digest &key, const Action &action, std::string &output) const;
+
+    /*
+     * Stores the outputs of an action that ran successfully. Returns false if
+     * an output is missing or the cache cannot be written.
+     */
+    bool store(const Digest &key, const Action &action, const std::string &output);
+
+    /*
+     * Stores contents that are not the outputs of an action, such as the
+     * inputs it discovered, under a key of their own. Returns false if the
+     * cache cannot be written.
+     */
+    bool store_contents(const Digest &key, const std::string &contents);
+
+    /*
+     * Returns the contents stored under a key, or nothing if they are not in
+     * the cache.
+     */
+    [[nodiscard]] std::optional<std::string> restore_contents(const Digest &key) const;
+
+    [[nodiscard]] const std::string &get_dir() const;
+
+    /*
+     * The number of actions restored from the remote cache.
+     */
+    [[nodiscard]] unsigned int remote_count() const;
+
+private:
+    struct Blob {
+        std::string digest;
+        bool executable;
+    };
+
+    const std::string dir;
+    FileStateDb *file_states;
+    HttpCache *remote;
+    mutable std::atomic<unsigned int> temp_counter;
+    mutable std::atomic<unsigned int> remote_restores;
+
+    [[nodiscard]] std::string blob_path(const std::string &digest) const;
+
+    [[nodiscard]] std::string entry_path(const Digest &key) const;
+
+    [[nodiscard]] std::string temp_path() const;
+
+    bool store_blob(const std::string &path, Digest &digest) const;
+
+    bool store_blob_content(const std::string &content, Digest &digest) const;
+
+    bool write_file(const std::string &path, const std::string &content) const;
+
+    bool create_dirs() const;
+
+    /*
+     * Returns the blobs of an entry, or nothing if it does not have one for
+     * the console output and for every output.
+     */
+    static std::optional<std::vector<Blob>> parse_entry(const std::string &entry, size_t output_count);
+
+    /*
+     * Returns the blobs of an entry in this cache, or nothing if it is not
+     * (completely) in this cache.
+     */
+    [[nodiscard]] std::optional<std::vector<Blob>> read_entry(const Digest &key, size_t output_count) const;
+
+    /*
+     * Adds an entry and its blobs from the remote cache to this cache, and
+     * returns its blobs. Returns nothing if the remote cache does not have
+     * them.
+     */
+    [[nodiscard]] std::optional<std::vector<Blob>> fetch_entry(const Digest &key, size_t output_count) const;
+};
@@ -0,0 +1,294 @@
+//
+// Created by roel on 10/19/26.
+//
+
+#include "ActionCallHandler.h"
+
+#include <list>
+#include <algorithm>
+
+#include "util/Hasher.h"
+#include "Resources.h"
+
+ActionCallHandler::ActionCallHandler(ObjectStore &object_store_, std::string output_dir_) :
+        object_store(object_store_),
+        output_dir(std::move(output_dir_)),
+        listener(nullptr) {}
+
+/*
+ * Flattens (nested lists of) strings and actions into a list of strings, where
+ * an action is replaced by the paths of its outputs.
+ */
+static void flatten(const Object &object,
+                    std::list<std::string> &strings,
+                    std::list<std::reference_wrapper<const Object>> &dependencies) {
+    if (dynamic_cast<const ActionObject *>(&object)) {
+        dependencies.emplace_back(object);
+        for (const Object &output: object.attr("outputs").entries()) {
+            strings.push_back(output.get_string());
+        }
+        return;
+    }
+
+    try {
+        strings.push_back(object.get_string());
+        return;
+    } catch (const ObjectIsNotAString &) {
+        // try list
+    }
+
+    auto entry_stream = object.stream();
+    while (const Object *entry = entry_stream->next()) {
+        flatten(*entry, strings, dependencies);
+    }
+}
+
+static bool is_valid_output_name(const std::string &name) {
+    if (name.empty() || name.front() == '/') return false;
+    size_t start = 0;
+    while (start <= name.size()) {
+        size_t end = name.find('/', start);
+        if (end == std::string::npos) end = name.size();
+        const std::string part = name.substr(start, end - start);
+        if (part.empty() || part == "." || part == "..") return false;
+        start = end + 1;
+    }
+    return true;
+}
+
+/*
+ * Replaces "$in" and "$out" inside a string with the space separated paths.
+ */
+static std::string expand(const std::string &str,
+                          const std::list<std::string> &inputs,
+                          const std::list<std::string> &outputs) {
+    std::string expanded;
+    size_t pos = 0;
+    while (pos < str.size()) {
+        const std::list<std::string> *paths = nullptr;
+        size_t length = 0;
+        if (str.compare(pos, 3, "$in") == 0) {
+            paths = &inputs;
+            length = 3;
+        } else if (str.compare(pos, 4, "$out") == 0) {
+            paths = &outputs;
+            length = 4;
+        }
+
+        if (!paths) {
+            expanded += str[pos++];
+            continue;
+        }
+        for (auto it = paths->begin(); it != paths->end(); it++) {
+            if (it != paths->begin()) expanded += ' ';
+            expanded += *it;
+        }
+        pos += length;
+    }
+    return expanded;
+}
+
+CallResult ActionCallHandler::call(const CallArgList &arguments) const {
+    CallResult result;
+
+    std::list<std::string> command;
+    std::list<std::string> inputs;
+    std::list<std::string> output_names;
+    std::list<std::reference_wrapper<const Object>> dependencies;
+
+    try {
+        const CallArg &arg = arguments.arg("command");
+        try {
+            flatten(arg.object(), command, dependencies);
+        } catch (const std::runtime_error &) {
+            result.add_arg_error(arg, "Command must be a list of strings and actions");
+        }
+    } catch (const MissingKeywordArgument &) {
+        result.add_call_error("Missing argument 'command'");
+    }
+
+    for (const std::string keyword: {"inputs", "outputs"}) {
+        try {
+            const CallArg &arg = arguments.arg(keyword);
+            try {
+                flatten(arg.object(), keyword == "inputs" ? inputs : output_names, dependencies);
+            } catch (const std::runtime_error &) {
+                result.add_arg_error(arg, "'" + keyword + "' must be a list of strings and actions");
+            }
+        } catch (const MissingKeywordArgument &) {
+            // optional
+        }
+    }
+
+    bool gcc_deps = false;
+    try {
+        const CallArg &arg = arguments.arg("deps");
+        try {
+            if (arg.object().get_string() != "gcc") {
+                result.add_arg_error(arg, "Unknown deps format '" + arg.object().get_string() + "'");
+            }
+            gcc_deps = true;
+        } catch (const ObjectIsNotAString &) {
+            result.add_arg_error(arg, "'deps' must be a string");
+        }
+    } catch (const MissingKeywordArgument &) {
+        // optional
+    }
+
+    std::unordered_map<std::string, const Object &> resources;
+    try {
+        const CallArg &arg = arguments.arg("pool");
+        bool valid = false;
+        try {
+            const Object &pool = arg.object();
+            valid = !pool.attr("name").get_string().empty() && parse_count(pool.attr("depth").get_string());
+        } catch (const std::runtime_error &) {
+            // not a pool
+        }
+        if (valid) {
+            resources.emplace("pool", arg.object());
+        } else {
+            result.add_arg_error(arg, "'pool' must be a pool created by pool()");
+        }
+    } catch (const MissingKeywordArgument &) {
+        // optional
+    }
+
+    for (const std::string keyword: {"memory", "cpus"}) {
+        try {
+            const CallArg &arg = arguments.arg(keyword);
+            try {
+                const std::string &value = arg.object().get_string();
+                if (keyword == "memory" ? !parse_size(value) : !parse_count(value)) {
+                    result.add_arg_error(arg, "Invalid '" + keyword + "' value '" + value + "'");
+                }
+                resources.emplace(keyword, arg.object());
+            } catch (const ObjectIsNotAString &) {
+                result.add_arg_error(arg, "'" + keyword + "' must be a string");
+            }
+        } catch (const MissingKeywordArgument &) {
+            // optional
+        }
+    }
+
+    std::list<std::string> worker;
+    try {
+        const CallArg &arg = arguments.arg("worker");
+        try {
+            flatten(arg.object(), worker, dependencies);
+            if (worker.empty() || worker.size() > command.size() ||
+                !std::equal(worker.begin(), worker.end(), command.begin())) {
+                result.add_arg_error(arg, "'worker' must be the first arguments of the command");
+            }
+            std::list<std::reference_wrapper<const Object>> worker_objects;
+            for (const std::string &str: worker) {
+                worker_objects.emplace_back(object_store.create_string(str));
+            }
+            resources.emplace("worker", object_store.create_list(worker_objects));
+        } catch (const std::runtime_error &) {
+            result.add_arg_error(arg, "'worker' must be a list of strings and actions");
+        }
+    } catch (const MissingKeywordArgument &) {
+        // optional
+    }
+
+    for (const std::string &name: output_names) {
+        if (!is_valid_output_name(name)) {
+            result.add_call_error("Invalid output name '" + name + "'");
+        }
+    }
+
+    if (command.empty()) {
+        result.add_call_error("Command is empty");
+    }
+
+    if (!result.success()) return result;
+
+    // Outputs of actions used in the command are inputs as well
+    for (const Object &dependency: dependencies) {
+        for (const Object &output: dependency.attr("outputs").entries()) {
+            inputs.push_back(output.get_string());
+        }
+    }
+    inputs.sort();
+    inputs.unique();
+
+    Hasher hasher;
+    for (const auto *strings: {&command, &inputs, &output_names}) {
+        hasher.add(static_cast<uint64_t>(strings->size()));
+        for (const std::string &str: *strings) {
+            hasher.add(str);
+        }
+    }
+    hasher.add(static_cast<uint64_t>(gcc_deps));
+    const std::string action_dir = output_dir + "/" + hasher.digest().to_string();
+
+    std::list<std::reference_wrapper<const Object>> output_objects;
+    std::list<std::string> output_paths;
+    for (const std::string &name: output_names) {
+        output_paths.push_back(action_dir + "/" + name);
+        output_objects.emplace_back(object_store.create_string(output_paths.back()));
+    }
+
+    std::list<std::reference_wrapper<const Object>> command_objects;
+    for (const std::string &str: command) {
+        const std::list<std::string> *expansion = nullptr;
+        if (str == "$in") expansion = &inputs;
+        if (str == "$out") expansion = &output_paths;
+
+        if (!expansion) {
+            command_objects.emplace_back(object_store.create_string(expand(str, inputs, output_paths)));
+            continue;
+        }
+        for (const std::string &path: *expansion) {
+            command_objects.emplace_back(object_store.create_string(path));
+        }
+    }
+
+    // Let the compiler write the headers it includes
+    const Object *depfile = &NullObject::get_instance();
+    if (gcc_deps) {
+        depfile = &object_store.create_string(action_dir + ".d");
+        for (const char *arg: {"-MD", "-MF"}) {
+            command_objects.emplace_back(object_store.create_string(arg));
+        }
+        command_objects.emplace_back(*depfile);
+    }
+
+    std::list<std::reference_wrapper<const Object>> input_objects;
+    for (const std::string &path: inputs) {
+        input_objects.emplace_back(object_store.create_string(path));
+    }
+
+    const Object &action = object_store.create_action(
+            object_store.create_list(command_objects),
+            object_store.create_list(input_objects),
+            object_store.create_list(output_objects),
+            object_store.create_list(dependencies),
+            *depfile,
+            object_store.create_struct(resources)
+    );
+    if (listener) {
+        listener->action_created(action);
+    }
+    result.set_return_value(action);
+    return result;
+}
+
+bool ActionCallHandler::operator==(const CallHandler &rhs) const {
+    return this == &rhs;
+}
+
+bool ActionCallHandler::is_pure() const {
+    return true;
+}
+
+void ActionCallHandler::reused(const Object &result) const {
+    if (listener) {
+        listener->action_created(result);
+    }
+}
+
+void ActionCallHandler::set_listener(ActionListener *listener_) {
+    listener = listener_;
+}
@@ -0,0 +1,69 @@
+//
+// Created by roel on 10/19/26.
+//
+
+
+#pragma once
+
+#include <string>
+
+#include "interpreter/Object.h"
+
+/*
+ * Is told about every action the action() builtin creates, as it is created,
+ * also when the interpreter reuses it from the call cache. Its dependencies
+ * have been created before, so actions arrive in dependency order.
+ */
+class ActionListener {
+public:
+    virtual ~ActionListener() = default;
+
+    virtual void action_created(const Object &action) = 0;
+};
+
+/*
+ * Implements the action() builtin:
+ *
+ *     action(command=["gcc" "-c" "$in" "-o" "$out"] inputs=["main.cpp"] outputs=["main.o"])
+ *
+ * Inputs are paths of source files or actions, of which the outputs are used.
+ * Actions may also be used directly in the command. Outputs are file names
+ * which are placed in a directory of their own below the output directory,
+ * so they never clash with the outputs of other actions. In the command "$in"
+ * and "$out" expand to all input and output paths: as separate arguments if
+ * they are an argument of their own, space separated otherwise.
+ *
+ * With deps="gcc" the command is extended with '-MD -MF <depfile>', so a gcc
+ * compatible compiler writes the headers it read to the depfile.
+ *
+ * The executor only starts an action while the resources it declares are
+ * available: pool= a pool created by pool(), memory= the memory it uses (for
+ * example "8G") and cpus= the number of cores it keeps busy (default "1").
+ *
+ * With worker= a list of the first arguments of the command, those start a
+ * persistent worker to which the remaining arguments are sent (see
+ * WorkerPool), instead of a process for every action.
+ */
+class ActionCallHandler : public CallHandler {
+public:
+    ActionCallHandler(ObjectStore &object_store, std::string output_dir);
+
+    [[nodiscard]] CallResult call(const CallArgList &arguments) const override;
+
+    [[nodiscard]] bool operator==(const CallHandler &rhs) const override;
+
+    [[nodiscard]] bool is_pure() const override;
+
+    void reused(const Object &result) const override;
+
+    /*
+     * Passes the actions created from now on to the listener, or to none if
+     * it is nullptr.
+     */
+    void set_listener(ActionListener *listener);
+
+private:
+    ObjectStore &object_store;
+    const std::string output_dir;
+    ActionListener *listener;
+};
@@ -0,0 +1,173 @@
+//
+// Created by roel on 10/19/26.
+//
+
+#include "ActionGraph.h"
+#include "util/Hasher.h"
+
+#include <algorithm>
+
+ActionGraph::ActionGraph() :
+        _nodes(),
+        action_index(),
+        digest_index(),
+        _merged(0),
+        visited() {}
+
+void ActionGraph::add_target(const Object &target) {
+    visit(target);
+}
+
+const std::vector<ActionGraph::Node> &ActionGraph::nodes() const {
+    return _nodes;
+}
+
+const ActionGraph::Node &ActionGraph::node(size_t index) const {
+    return _nodes.at(index);
+}
+
+size_t ActionGraph::size() const {
+    return _nodes.size();
+}
+
+size_t ActionGraph::merged() const {
+    return _merged;
+}
+
+void ActionGraph::visit(const Object &object) {
+    if (!visited.insert(&object).second) return;
+
+    if (dynamic_cast<const ActionObject *>(&object)) {
+        add_action(object);
+        return;
+    }
+
+    if (NullObject::is_null(object)) return;
+
+    try {
+        for (const auto &[id, value]: object.attributes()) {
+            visit(value);
+        }
+        return;
+    } catch (const ObjectIsNotAStruct &) {
+        // try list
+    }
+
+    try {
+        auto entry_stream = object.stream();
+        while (const Object *entry = entry_stream->next()) {
+            visit(*entry);
+        }
+    } catch (const ObjectIsNotAList &) {
+        // strings and functions do not lead to actions
+    }
+}
+
+static std::vector<std::string> to_strings(const Object &list) {
+    std::vector<std::string> strings;
+    for (const Object &entry: list.entries()) {
+        strings.push_back(entry.get_string());
+    }
+    return strings;
+}
+
+static Resources to_resources(const Object &resources) {
+    Resources result;
+    for (const auto &[name, value]: resources.attributes()) {
+        if (name == "pool") {
+            result.pool = value.get().attr("name").get_string();
+            result.pool_depth = parse_count(value.get().attr("depth").get_string()).value_or(1);
+        } else if (name == "memory") {
+            result.memory = parse_size(value.get().get_string()).value_or(0);
+        } else if (name == "cpus") {
+            result.cpus = parse_count(value.get().get_string()).value_or(1);
+        }
+    }
+    return result;
+}
+
+static std::vector<std::string> to_worker(const Object &action) {
+    if (const auto *worker = action.attr("resources").attributes().find("worker")) {
+        return to_strings(worker->get());
+    }
+    return {};
+}
+
+/*
+ * The digest of the attributes that determine the outputs. Resources and
+ * workers only affect how an action runs, so actions that differ in nothing
+ * else write the same files and must be a single node.
+ */
+static Digest merge_key(const Object &action) {
+    Hasher hasher;
+    for (const char *id: {"command", "inputs", "outputs", "dependencies", "depfile"}) {
+        hasher.add(action.attr(id).digest());
+    }
+    return hasher.digest();
+}
+
+size_t ActionGraph::add_action(const Object &action) {
+    auto it = action_index.find(&action);
+    if (it != action_index.end()) return it->second;
+
+    const Digest digest = merge_key(action);
+    auto digest_it = digest_index.find(digest);
+    if (digest_it != digest_index.end()) {
+        merge(_nodes[digest_it->second], action);
+        _merged++;
+        action_index.emplace(&action, digest_it->second);
+        return digest_it->second;
+    }
+
+    std::vector<size_t> dependencies;
+    for (const Object &dependency: action.attr("dependencies").entries()) {
+        if (!dynamic_cast<const ActionObject *>(&dependency)) {
+            throw ActionIsNotValid("Dependency of an action is not an action");
+        }
+        dependencies.push_back(add_action(dependency));
+    }
+    std::sort(dependencies.begin(), dependencies.end());
+    dependencies.erase(std::unique(dependencies.begin(), dependencies.end()), dependencies.end());
+
+    const size_t index = _nodes.size();
+    Node &node = _nodes.emplace_back();
+    node.action.id = digest.to_string();
+    node.action.command = to_strings(action.attr("command"));
+    node.action.inputs = to_strings(action.attr("inputs"));
+    node.action.outputs = to_strings(action.attr("outputs"));
+    if (!NullObject::is_null(action.attr("depfile"))) {
+        node.action.depfile = action.attr("depfile").get_string();
+    }
+    node.action.resources = to_resources(action.attr("resources"));
+    node.action.worker = to_worker(action);
+    node.dependencies = dependencies;
+
+    for (size_t dependency: dependencies) {
+        _nodes[dependency].dependents.push_back(index);
+    }
+
+    action_index.emplace(&action, index);
+    digest_index.emplace(digest, index);
+    return index;
+}
+
+void ActionGraph::merge(Node &node, const Object &action) {
+    const Resources resources = to_resources(action.attr("resources"));
+    Resources &merged = node.action.resources;
+    if (merged.pool.empty()) {
+        merged.pool = resources.pool;
+        merged.pool_depth = resources.pool_depth;
+    } else if (!resources.pool.empty() && resources.pool != merged.pool) {
+        throw ActionIsNotValid("Identical actions in different pools '" + merged.pool + "' and '" +
+                               resources.pool + "'");
+    }
+    merged.memory = std::max(merged.memory, resources.memory);
+    merged.cpus = std::max(merged.cpus, resources.cpus);
+
+    const std::vector<std::string> worker = to_worker(action);
+    if (node.action.worker.empty()) {
+        node.action.worker = worker;
+    } else if (!worker.empty() && worker != node.action.worker) {
+        throw ActionIsNotValid("Identical actions with different workers");
+    }
+}
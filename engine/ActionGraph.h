@@ -0,0 +1,78 @@
+//
+// Created by roel on 10/19/26.
+//
+
+
+#pragma once
+
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "interpreter/Object.h"
+#include "Action.h"
+
+/*
+ * Directed acyclic graph of the actions reachable from one or more target
+ * objects. Nodes are stored in dependency order: every node comes after the
+ * nodes it depends on.
+ *
+ * Identical actions are merged into a single node, even if they are different
+ * objects, for example because they were created by different units. As the
+ * outputs of an action are derived from its command and inputs, all consumers
+ * then use the same outputs. Actions that differ only in their resources or
+ * worker write the same outputs as well, so they are merged too. The node
+ * then reserves the most memory and cpus any of them declares, and runs in
+ * the pool and with the worker that one of them declares. Merging actions
+ * that declare different pools or workers is an error.
+ */
+class ActionGraph {
+public:
+    struct Node {
+        Action action;
+        std::vector<size_t> dependencies;
+        std::vector<size_t> dependents;
+    };
+
+    ActionGraph();
+
+    /*
+     * Adds all actions reachable from the target: the target itself if it is
+     * an action, and all actions in the lists and struct attributes it refers
+     * to.
+     */
+    void add_target(const Object &target);
+
+    [[nodiscard]] const std::vector<Node> &nodes() const;
+
+    [[nodiscard]] const Node &node(size_t index) const;
+
+    [[nodiscard]] size_t size() const;
+
+    /*
+     * The number of actions that were merged into an identical node.
+     */
+    [[nodiscard]] size_t merged() const;
+
+private:
+    std::vector<Node> _nodes;
+    std::unordered_map<const Object *, size_t> action_index;
+    std::unordered_map<Digest, size_t> digest_index;
+    size_t _merged;
+    std::unordered_set<const Object *> visited;
+
+    void visit(const Object &object);
+
+    size_t add_action(const Object &action);
+
+    /*
+     * Merges the resources and worker of an action into an identical node.
+     */
+    void merge(Node &node, const Object &action);
+};
+
+class ActionIsNotValid : public std::runtime_error {
+public:
+    explicit ActionIsNotValid(const std::string &message) :
+            std::runtime_error(message) {}
+};
@@ -0,0 +1,40 @@
+//
+// Created by roel on 10/19/26.
+//
+
+
+#pragma once
+
+#include <string>
+#include <chrono>
+#include <optional>
+
+#include "Action.h"
+
+/*
+ * Runs a single action to completion. Called concurrently from the threads of
+ * the executor.
+ */
+class ActionRunner {
+public:
+    virtual ~ActionRunner() = default;
+
+    struct Result {
+        int exit_code = 0;
+        std::string output;
+
+        // The outputs were restored instead of produced by running the command
+        bool cached = false;
+
+        // Nothing ran or was restored, the outputs were already up to date
+        bool up_to_date = false;
+
+        // How long the action took, if it ran before its result was asked for
+        // (see SpeculativeActionRunner)
+        std::optional<std::chrono::microseconds> ran_for;
+
+        [[nodiscard]] bool success() const { return exit_code == 0; }
+    };
+
+    virtual Result run(const Action &action) = 0;
+};
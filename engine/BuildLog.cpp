@@ -0,0 +1,100 @@
+//
+// Created by roel on 10/19/26.
+//
+
+#include "BuildLog.h"
+
+#include <cstring>
+#include <cstdint>
+#include <fstream>
+
+#include "util/BinaryFile.h"
+#include "util/Socket.h"
+
+static constexpr char magic[8] = {'M', 'K', 'R', 'B', 'L', 'O', 'G', '1'};
+
+static void append_digest(std::string &buffer, const Digest &digest) {
+    const uint64_t words[2] = {digest.high(), digest.low()};
+    buffer.append(reinterpret_cast<const char *>(words), sizeof(words));
+}
+
+static bool read_digest(const std::string &content, size_t &pos, Digest &digest) {
+    uint64_t words[2];
+    if (!read_bytes(content, pos, words, sizeof(words))) return false;
+    digest = Digest(words[0], words[1]);
+    return true;
+}
+
+BuildLog::BuildLog(std::string path_) :
+        path(std::move(path_)),
+        mutex(),
+        entries(),
+        changed(false) {
+    load();
+}
+
+void BuildLog::load() {
+    std::ifstream stream(path, std::ios::binary);
+    if (!stream) return;
+    const std::string content((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+    if (content.size() < sizeof(magic) || memcmp(content.data(), magic, sizeof(magic)) != 0) return;
+
+    size_t pos = sizeof(magic);
+    while (pos < content.size()) {
+        uint32_t id_length, output_count;
+        if (!read_bytes(content, pos, &id_length, sizeof(id_length)) || content.size() - pos < id_length) break;
+        std::string id = content.substr(pos, id_length);
+        pos += id_length;
+
+        Entry entry;
+        if (!read_digest(content, pos, entry.key) || !read_bytes(content, pos, &output_count, sizeof(output_count))) {
+            break;
+        }
+        bool valid = true;
+        for (uint32_t i = 0; i < output_count && valid; i++) {
+            valid = read_digest(content, pos, entry.outputs.emplace_back());
+        }
+        if (!valid) break;
+        entries.insert_or_assign(std::move(id), std::move(entry));
+    }
+}
+
+std::optional<BuildLog::Entry> BuildLog::get(const std::string &id) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = entries.find(id);
+    if (it == entries.end()) return std::nullopt;
+    return it->second;
+}
+
+void BuildLog::record(const std::string &id, Entry entry) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = entries.find(id);
+    if (it != entries.end() && it->second.key == entry.key && it->second.outputs == entry.outputs) return;
+    entries.insert_or_assign(id, std::move(entry));
+    changed = true;
+}
+
+bool BuildLog::save() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!changed) return true;
+
+    std::string buffer(magic, sizeof(magic));
+    for (const auto &[id, entry]: entries) {
+        append_u32(buffer, static_cast<uint32_t>(id.size()));
+        buffer += id;
+        append_digest(buffer, entry.key);
+        append_u32(buffer, static_cast<uint32_t>(entry.outputs.size()));
+        for (const Digest &digest: entry.outputs) {
+            append_digest(buffer, digest);
+        }
+    }
+
+    if (!write_file_atomically(path, buffer)) return false;
+    changed = false;
+    return true;
+}
+
+size_t BuildLog::size() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return entries.size();
+}
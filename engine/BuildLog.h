@@ -0,0 +1,65 @@
+//
+// Created by roel on 10/19/26.
+//
+
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <optional>
+#include <unordered_map>
+#include <mutex>
+
+#include "util/Digest.h"
+
+/*
+ * Remembers for every action the cache key it was last built with and the
+ * digests of the outputs it produced. An action of which the key did not
+ * change and of which the outputs are still on disk is up to date: when a
+ * rebuilt action produces byte-identical outputs, the keys of the actions
+ * depending on it stay the same, and those are not run again (early cutoff).
+ *
+ * The file is a magic followed by one record per action:
+ *
+ *     u32 id length, id, key, u32 output count, output digests
+ *
+ * Entries recorded during a build are kept in memory until save(), which
+ * writes a new file next to the old one and renames it in place.
+ */
+class BuildLog {
+public:
+    struct Entry {
+        Digest key;
+        std::vector<Digest> outputs;
+    };
+
+    explicit BuildLog(std::string path);
+
+    /*
+     * Returns the entry of an action, by its id, or nothing if it was never
+     * built. Safe to call concurrently.
+     */
+    [[nodiscard]] std::optional<Entry> get(const std::string &id) const;
+
+    /*
+     * Safe to call concurrently.
+     */
+    void record(const std::string &id, Entry entry);
+
+    /*
+     * Writes all entries. Returns false if the file could not be written.
+     */
+    bool save();
+
+    [[nodiscard]] size_t size() const;
+
+private:
+    const std::string path;
+
+    mutable std::mutex mutex;
+    std::unordered_map<std::string, Entry> entries;
+    bool changed;
+
+    void load();
+};
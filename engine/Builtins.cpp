@@ -0,0 +1,19 @@
+//
+// Created by roel on 10/19/26.
+//
+
+#include "Builtins.h"
+
+Builtins::Builtins(ObjectStore &object_store_, std::string output_dir) :
+        object_store(object_store_),
+        action_handler(object_store_, std::move(output_dir)),
+        pool_handler(object_store_) {}
+
+void Builtins::install(Scope &scope) {
+    scope.put("action", object_store.create_function(action_handler));
+    scope.put("pool", object_store.create_function(pool_handler));
+}
+
+void Builtins::set_action_listener(ActionListener *listener) {
+    action_handler.set_listener(listener);
+}
@@ -0,0 +1,32 @@
+//
+// Created by roel on 10/19/26.
+//
+
+
+#pragma once
+
+#include <string>
+
+#include "interpreter/Scope.h"
+#include "ActionCallHandler.h"
+#include "PoolCallHandler.h"
+
+/*
+ * Owns the handlers of the builtin functions and puts them in a scope.
+ */
+class Builtins {
+public:
+    Builtins(ObjectStore &object_store, std::string output_dir);
+
+    void install(Scope &scope);
+
+    /*
+     * See ActionCallHandler::set_listener().
+     */
+    void set_action_listener(ActionListener *listener);
+
+private:
+    ObjectStore &object_store;
+    ActionCallHandler action_handler;
+    PoolCallHandler pool_handler;
+};
@@ -0,0 +1,170 @@
+//
+// Created by roel on 10/19/26.
+//
+
+#include "CachingActionRunner.h"
+#include "Depfile.h"
+#include "util/Hasher.h"
+
+#include <fstream>
+#include <sstream>
+
+CachingActionRunner::CachingActionRunner(ActionRunner &runner_, ActionCache &cache_,
+                                         std::vector<std::string> environment_) :
+        runner(runner_),
+        cache(cache_),
+        environment(std::move(environment_)),
+        deps_log(nullptr),
+        build_log(nullptr) {}
+
+CachingActionRunner::CachingActionRunner(ActionRunner &runner_, ActionCache &cache_,
+                                         std::vector<std::string> environment_, DepsLog &deps_log_) :
+        runner(runner_),
+        cache(cache_),
+        environment(std::move(environment_)),
+        deps_log(&deps_log_),
+        build_log(nullptr) {}
+
+CachingActionRunner::CachingActionRunner(ActionRunner &runner_, ActionCache &cache_,
+                                         std::vector<std::string> environment_, DepsLog &deps_log_,
+                                         BuildLog &build_log_) :
+        runner(runner_),
+        cache(cache_),
+        environment(std::move(environment_)),
+        deps_log(&deps_log_),
+        build_log(&build_log_) {}
+
+Action CachingActionRunner::cached_action(const Action &action, const std::vector<std::string> &discovered) const {
+    Action cached = action;
+    if (!action.depfile.empty()) {
+        cached.outputs.push_back(action.depfile);
+        cached.inputs.insert(cached.inputs.end(), discovered.begin(), discovered.end());
+    }
+    return cached;
+}
+
+std::optional<Digest> CachingActionRunner::discovered_key(const Action &action) const {
+    const std::optional<Digest> key = cache.key(cached_action(action, {}), environment);
+    if (!key) return std::nullopt;
+    return Hasher().add(*key).add(std::string("discovered inputs")).digest();
+}
+
+std::vector<std::string> CachingActionRunner::cached_discovered(const Action &action) const {
+    const std::optional<Digest> key = discovered_key(action);
+    const std::optional<std::string> list = key ? cache.restore_contents(*key) : std::nullopt;
+    if (!list) return {};
+
+    std::vector<std::string> discovered;
+    std::istringstream stream(*list);
+    std::string path;
+    while (std::getline(stream, path)) {
+        discovered.push_back(path);
+    }
+    return discovered;
+}
+
+void CachingActionRunner::store_discovered(const Action &action, const std::vector<std::string> &discovered) {
+    const std::optional<Digest> key = discovered_key(action);
+    if (!key) return;
+
+    std::string list;
+    for (const std::string &path: discovered) {
+        list += path + "\n";
+    }
+    cache.store_contents(*key, list);
+}
+
+bool CachingActionRunner::is_up_to_date(const Digest &key, const Action &action) const {
+    if (!build_log || action.id.empty()) return false;
+
+    const std::optional<BuildLog::Entry> entry = build_log->get(action.id);
+    if (!entry || entry->key != key || entry->outputs.size() != action.outputs.size()) return false;
+
+    for (size_t i = 0; i < action.outputs.size(); i++) {
+        if (cache.hash(action.outputs[i]) != entry->outputs[i]) return false;
+    }
+    return true;
+}
+
+void CachingActionRunner::record_outputs(const Digest &key, const Action &action) {
+    if (!build_log || action.id.empty()) return;
+
+    BuildLog::Entry entry{key, {}};
+    for (const std::string &output: action.outputs) {
+        const std::optional<Digest> digest = cache.hash(output);
+        if (!digest) return;
+        entry.outputs.push_back(*digest);
+    }
+    build_log->record(action.id, std::move(entry));
+}
+
+bool CachingActionRunner::record_deps(const Action &action, std::vector<std::string> &discovered,
+                                      std::string &error) {
+    std::ifstream stream(action.depfile);
+    if (!stream) {
+        error = "Depfile '" + action.depfile + "' was not written\n";
+        return false;
+    }
+    const std::string content((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+
+    try {
+        discovered = parse_depfile(content);
+    } catch (const DepfileError &e) {
+        error = "Cannot parse depfile '" + action.depfile + "': " + e.what() + "\n";
+        return false;
+    }
+
+    if (deps_log) deps_log->record(action.depfile, discovered);
+    return true;
+}
+
+ActionRunner::Result CachingActionRunner::run(const Action &action) {
+    std::vector<std::string> discovered;
+    if (deps_log && !action.depfile.empty()) {
+        const std::optional<std::vector<std::string>> logged = deps_log->get(action.depfile);
+        discovered = logged ? *logged : cached_discovered(action);
+    }
+
+    // Missing inputs (such as a removed header) leave the key empty, and make
+    // the action run
+    const Action keyed_action = cached_action(action, discovered);
+    const std::optional<Digest> key = cache.key(keyed_action, environment);
+
+    Result result;
+    if (key && is_up_to_date(*key, keyed_action)) {
+        result.up_to_date = true;
+        return result;
+    }
+
+    if (key && cache.restore(*key, keyed_action, result.output)) {
+        result.cached = true;
+        if (!action.depfile.empty()) {
+            std::string error;
+            record_deps(action, discovered, error);
+        }
+        record_outputs(*key, keyed_action);
+        return result;
+    }
+
+    result = runner.run(action);
+    if (!result.success()) return result;
+
+    if (!action.depfile.empty()) {
+        std::string error;
+        if (!record_deps(action, discovered, error)) {
+            result.exit_code = 1;
+            result.output += error;
+            return result;
+        }
+        store_discovered(action, discovered);
+    }
+
+    // Store under the key with the inputs the action actually read
+    const Action stored_action = cached_action(action, discovered);
+    const std::optional<Digest> stored_key = cache.key(stored_action, environment);
+    if (stored_key) {
+        cache.store(*stored_key, stored_action, result.output);
+        record_outputs(*stored_key, stored_action);
+    }
+    return result;
+}
@@ -0,0 +1,70 @@
+//
+// Created by roel on 10/19/26.
+//
+
+
+#pragma once
+
+#include <vector>
+#include <string>
+
+#include "ActionRunner.h"
+#include "ActionCache.h"
+#include "DepsLog.h"
+#include "BuildLog.h"
+
+/*
+ * Restores the outputs of actions from an ActionCache, and only runs actions
+ * on the wrapped runner if they are not in the cache.
+ *
+ * The depfile of an action is cached as one of its outputs. The inputs it
+ * lists are recorded in the deps log and are part of the key of the action
+ * the next time, so changing a header only runs the actions that read it.
+ * The inputs are also cached under the key of the action without them, so
+ * that checkouts without a deps log (such as new clones with a remote cache)
+ * find the actions that other checkouts stored.
+ *
+ * With a build log, an action of which the key and the outputs did not change
+ * since it was last built is not restored or run at all.
+ */
+class CachingActionRunner : public ActionRunner {
+public:
+    CachingActionRunner(ActionRunner &runner, ActionCache &cache, std::vector<std::string> environment);
+
+    CachingActionRunner(ActionRunner &runner, ActionCache &cache, std::vector<std::string> environment,
+                        DepsLog &deps_log);
+
+    CachingActionRunner(ActionRunner &runner, ActionCache &cache, std::vector<std::string> environment,
+                        DepsLog &deps_log, BuildLog &build_log);
+
+    Result run(const Action &action) override;
+
+private:
+    ActionRunner &runner;
+    ActionCache &cache;
+    const std::vector<std::string> environment;
+    DepsLog *deps_log;
+    BuildLog *build_log;
+
+    /*
+     * Returns the action as it is known to the cache: with the depfile as an
+     * output and the inputs it listed as inputs.
+     */
+    [[nodiscard]] Action cached_action(const Action &action, const std::vector<std::string> &discovered) const;
+
+    /*
+     * The key of the inputs an action listed in its depfile, which does not
+     * depend on them.
+     */
+    [[nodiscard]] std::optional<Digest> discovered_key(const Action &action) const;
+
+    [[nodiscard]] std::vector<std::string> cached_discovered(const Action &action) const;
+
+    void store_discovered(const Action &action, const std::vector<std::string> &discovered);
+
+    [[nodiscard]] bool is_up_to_date(const Digest &key, const Action &action) const;
+
+    void record_outputs(const Digest &key, const Action &action);
+
+    bool record_deps(const Action &action, std::vector<std::string> &discovered, std::string &error);
+};
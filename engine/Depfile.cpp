@@ -0,0 +1,67 @@
+//
+// Created by roel on 10/19/26.
+//
+
+#include "Depfile.h"
+
+#include <unordered_set>
+
+std::vector<std::string> parse_depfile(const std::string &content) {
+    std::vector<std::string> prerequisites;
+    std::unordered_set<std::string> seen;
+
+    bool in_prerequisites = false;
+    bool has_target = false;
+    std::string word;
+
+    auto end_word = [&]() {
+        if (word.empty()) return;
+        if (!in_prerequisites) {
+            has_target = true;
+        } else if (seen.insert(word).second) {
+            prerequisites.push_back(word);
+        }
+        word.clear();
+    };
+
+    for (size_t i = 0; i < content.size(); i++) {
+        const char ch = content[i];
+        const char next = i + 1 < content.size() ? content[i + 1] : '\0';
+
+        if (ch == '\\' && (next == '\n' || (next == '\r' && i + 2 < content.size() && content[i + 2] == '\n'))) {
+            // line continuation
+            end_word();
+            i += next == '\r' ? 2 : 1;
+        } else if (ch == '\\' && (next == ' ' || next == '#' || next == '\\')) {
+            word += next;
+            i++;
+        } else if (ch == '$' && next == '$') {
+            word += '$';
+            i++;
+        } else if (ch == ' ' || ch == '\t' || ch == '\r') {
+            end_word();
+        } else if (ch == '\n') {
+            end_word();
+            if (has_target && !in_prerequisites) {
+                throw DepfileError("Depfile target without ':'");
+            }
+            in_prerequisites = false;
+            has_target = false;
+        } else if (ch == ':' && !in_prerequisites && (next == ' ' || next == '\t' || next == '\n' ||
+                                                      next == '\r' || next == '\0')) {
+            end_word();
+            if (!has_target) {
+                throw DepfileError("Depfile rule without target");
+            }
+            in_prerequisites = true;
+        } else {
+            word += ch;
+        }
+    }
+
+    end_word();
+    if (has_target && !in_prerequisites) {
+        throw DepfileError("Depfile target without ':'");
+    }
+    return prerequisites;
+}
@@ -0,0 +1,23 @@
+//
+// Created by roel on 10/19/26.
+//
+
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <stdexcept>
+
+/*
+ * Parses a depfile as written by gcc and clang with -MD: make rules of which
+ * the prerequisites are the files the compiler read. Returns the
+ * prerequisites of all rules, without duplicates, in order of appearance.
+ */
+std::vector<std::string> parse_depfile(const std::string &content);
+
+class DepfileError : public std::runtime_error {
+public:
+    explicit DepfileError(const std::string &message) :
+            std::runtime_error(message) {}
+};
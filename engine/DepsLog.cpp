@@ -0,0 +1,280 @@
+//
+// Created by roel on 10/19/26.
+//
+
+#include "DepsLog.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "util/Socket.h"
+
+static constexpr char magic[8] = {'M', 'K', 'R', 'D', 'E', 'P', 'S', '1'};
+
+enum RecordType : uint32_t {
+    PATH = 0,
+    DEPS = 1,
+};
+
+// The size of a record is stored in the upper bits of its header
+static constexpr uint32_t type_bits = 1;
+
+// Rewrite the log when it holds more than this many replaced deps records
+static constexpr size_t min_records_to_rewrite = 1000;
+
+static uint32_t load_u32(const char *bytes) {
+    uint32_t value;
+    memcpy(&value, bytes, sizeof(value));
+    return value;
+}
+
+/*
+ * Holds an exclusive flock on the lock file while in scope. Without a lock
+ * file it does nothing, so that a log in a directory that cannot be written
+ * can still be read.
+ */
+class LogLock {
+public:
+    explicit LogLock(int fd_) :
+            fd(fd_) {
+        while (fd >= 0 && flock(fd, LOCK_EX) != 0 && errno == EINTR) {}
+    }
+
+    LogLock(const LogLock &) = delete;
+
+    LogLock &operator=(const LogLock &) = delete;
+
+    ~LogLock() {
+        if (fd >= 0) flock(fd, LOCK_UN);
+    }
+
+private:
+    const int fd;
+};
+
+DepsLog::DepsLog(std::string path_) :
+        path(std::move(path_)),
+        paths(),
+        path_ids(),
+        deps(),
+        deps_records(0),
+        inode(0),
+        read_size(0),
+        mutex(),
+        file(nullptr),
+        lock_fd(open((path + ".lock").c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644)) {
+    LogLock lock(lock_fd);
+    read_records();
+    if (deps_records > min_records_to_rewrite && deps_records > 2 * deps.size()) {
+        rewrite();
+    }
+}
+
+DepsLog::~DepsLog() {
+    if (file) fclose(file);
+    if (lock_fd >= 0) close(lock_fd);
+}
+
+void DepsLog::reset() {
+    if (file) {
+        fclose(file);
+        file = nullptr;
+    }
+    paths.clear();
+    path_ids.clear();
+    deps.clear();
+    deps_records = 0;
+    inode = 0;
+    read_size = 0;
+}
+
+void DepsLog::read_records() {
+    const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    struct stat st{};
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        if (fd >= 0) close(fd);
+        reset();
+        return;
+    }
+
+    // Rewritten by another process, which numbered the paths anew
+    const size_t size = static_cast<size_t>(st.st_size);
+    if (st.st_ino != inode || size < read_size) {
+        reset();
+    }
+    if (size == read_size) {
+        close(fd);
+        return;
+    }
+    void *address = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (address == MAP_FAILED) return;
+
+    const char *data = static_cast<const char *>(address);
+    size_t valid_size = read_size;
+
+    if (read_size > 0 || (size >= sizeof(magic) && memcmp(data, magic, sizeof(magic)) == 0)) {
+        size_t pos = std::max(read_size, sizeof(magic));
+        valid_size = pos;
+
+        while (pos + sizeof(uint32_t) <= size) {
+            const uint32_t header = load_u32(data + pos);
+            const uint32_t record_size = header >> type_bits;
+            const uint32_t type = header & ((1u << type_bits) - 1);
+            const char *record = data + pos + sizeof(uint32_t);
+            if (record_size % 4 != 0 || pos + sizeof(uint32_t) + record_size > size) break;
+
+            if (type == PATH) {
+                std::string file_path(record, strnlen(record, record_size));
+                path_ids.emplace(file_path, paths.size());
+                paths.push_back(std::move(file_path));
+            } else {
+                if (record_size < 4) break;
+                bool valid = true;
+                std::vector<std::string> inputs;
+                const uint32_t depfile_id = load_u32(record);
+                for (size_t offset = 4; offset < record_size; offset += 4) {
+                    const uint32_t id = load_u32(record + offset);
+                    if (id >= paths.size()) valid = false;
+                    if (valid) inputs.push_back(paths[id]);
+                }
+                if (!valid || depfile_id >= paths.size()) break;
+                deps.insert_or_assign(paths[depfile_id], std::move(inputs));
+                deps_records++;
+            }
+
+            pos += sizeof(uint32_t) + record_size;
+            valid_size = pos;
+        }
+    }
+    munmap(address, size);
+    inode = st.st_ino;
+    read_size = valid_size;
+
+    if (valid_size != size) {
+        // Interrupted while appending, or not a log at all: drop the rest
+        if (valid_size == 0) {
+            unlink(path.c_str());
+            inode = 0;
+        } else if (truncate(path.c_str(), static_cast<off_t>(valid_size)) != 0) {
+            rewrite();
+        }
+    }
+}
+
+bool DepsLog::open_for_append() {
+    if (file) return true;
+
+    file = fopen(path.c_str(), "ab");
+    if (!file) return false;
+    if (ftell(file) == 0) {
+        fwrite(magic, sizeof(magic), 1, file);
+        read_size = sizeof(magic);
+    }
+    struct stat st{};
+    if (fstat(fileno(file), &st) == 0) inode = st.st_ino;
+    return fflush(file) == 0;
+}
+
+void DepsLog::append_path(std::string &buffer, const std::string &file_path) {
+    if (path_ids.contains(file_path)) return;
+
+    std::string padded = file_path;
+    padded.resize((file_path.size() + 4) & ~size_t(3), '\0');
+    append_u32(buffer, static_cast<uint32_t>(padded.size()) << type_bits | PATH);
+    buffer += padded;
+
+    path_ids.emplace(file_path, paths.size());
+    paths.push_back(file_path);
+}
+
+void DepsLog::append_deps(std::string &buffer, const std::string &depfile, const std::vector<std::string> &inputs) {
+    append_path(buffer, depfile);
+    for (const std::string &input: inputs) {
+        append_path(buffer, input);
+    }
+
+    append_u32(buffer, static_cast<uint32_t>(4 * (inputs.size() + 1)) << type_bits | DEPS);
+    append_u32(buffer, path_ids.at(depfile));
+    for (const std::string &input: inputs) {
+        append_u32(buffer, path_ids.at(input));
+    }
+    deps_records++;
+}
+
+bool DepsLog::rewrite() {
+    if (file) {
+        fclose(file);
+        file = nullptr;
+    }
+
+    const auto old_deps = std::move(deps);
+    paths.clear();
+    path_ids.clear();
+    deps.clear();
+    deps_records = 0;
+
+    std::string buffer(magic, sizeof(magic));
+    for (const auto &[depfile, inputs]: old_deps) {
+        append_deps(buffer, depfile, inputs);
+        deps.emplace(depfile, inputs);
+    }
+
+    // Until written, the next read starts over from what is on disk
+    inode = 0;
+    read_size = 0;
+
+    const std::string temp = path + ".tmp";
+    FILE *temp_file = fopen(temp.c_str(), "wb");
+    if (!temp_file) return false;
+    const bool written = fwrite(buffer.data(), 1, buffer.size(), temp_file) == buffer.size();
+    struct stat st{};
+    if (fclose(temp_file) != 0 || !written || stat(temp.c_str(), &st) != 0 ||
+        rename(temp.c_str(), path.c_str()) != 0) {
+        unlink(temp.c_str());
+        return false;
+    }
+    inode = st.st_ino;
+    read_size = buffer.size();
+    return true;
+}
+
+std::optional<std::vector<std::string>> DepsLog::get(const std::string &depfile) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = deps.find(depfile);
+    if (it == deps.end()) return std::nullopt;
+    return it->second;
+}
+
+bool DepsLog::record(const std::string &depfile, const std::vector<std::string> &inputs) {
+    std::lock_guard<std::mutex> lock(mutex);
+    LogLock log_lock(lock_fd);
+    read_records();
+
+    auto it = deps.find(depfile);
+    if (it != deps.end() && it->second == inputs) return true;
+
+    std::string buffer;
+    append_deps(buffer, depfile, inputs);
+    deps.insert_or_assign(depfile, inputs);
+
+    // One write per record, so a crash leaves at most one partial record
+    if (open_for_append() && fwrite(buffer.data(), 1, buffer.size(), file) == buffer.size() && fflush(file) == 0) {
+        read_size += buffer.size();
+        return true;
+    }
+
+    // The log no longer matches the paths numbered in memory
+    return rewrite();
+}
+
+size_t DepsLog::size() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return deps.size();
+}
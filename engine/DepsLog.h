@@ -0,0 +1,93 @@
+//
+// Created by roel on 10/19/26.
+//
+
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <optional>
+#include <unordered_map>
+#include <mutex>
+#include <cstdint>
+#include <cstdio>
+#include <sys/types.h>
+
+/*
+ * Append-only binary log of the inputs that actions discovered (from their
+ * depfiles), loaded at startup with a single mmap.
+ *
+ * The file starts with a magic and consists of records with a 4 byte header
+ * holding the size of the record and its type:
+ *
+ *     path   the bytes of a path, zero padded to 4 bytes; paths are numbered
+ *            in order of appearance
+ *     deps   the number of the path of a depfile, followed by the numbers of
+ *            the paths it lists
+ *
+ * Later deps records of a depfile replace earlier ones. A record cut short by
+ * an interrupted build is discarded when loading. When most records are
+ * replaced ones the log is rewritten.
+ *
+ * Processes that share the log hold an flock on PATH.lock while they load or
+ * append. Before appending they read what the others appended, so that all
+ * of them number the paths the same.
+ */
+class DepsLog {
+public:
+    explicit DepsLog(std::string path);
+
+    DepsLog(const DepsLog &) = delete;
+
+    DepsLog &operator=(const DepsLog &) = delete;
+
+    ~DepsLog();
+
+    /*
+     * Returns the inputs last recorded for a depfile, or nothing if none are
+     * known.
+     */
+    [[nodiscard]] std::optional<std::vector<std::string>> get(const std::string &depfile) const;
+
+    /*
+     * Records the inputs a depfile listed, and appends them to the log if they
+     * changed. Returns false if the log cannot be written. Safe to call
+     * concurrently.
+     */
+    bool record(const std::string &depfile, const std::vector<std::string> &inputs);
+
+    [[nodiscard]] size_t size() const;
+
+private:
+    const std::string path;
+
+    std::vector<std::string> paths;
+    std::unordered_map<std::string, uint32_t> path_ids;
+    std::unordered_map<std::string, std::vector<std::string>> deps;
+    size_t deps_records;
+
+    // The file the records were read from, and how much of it
+    ino_t inode;
+    size_t read_size;
+
+    mutable std::mutex mutex;
+    FILE *file;
+    int lock_fd;
+
+    /*
+     * Reads the records appended since the last read, all of them if the log
+     * was replaced. Must be called with the lock held.
+     */
+    void read_records();
+
+    void reset();
+
+    bool rewrite();
+
+    bool open_for_append();
+
+    void append_path(std::string &buffer, const std::string &file_path);
+
+    void append_deps(std::string &buffer, const std::string &depfile, const std::vector<std::string> &inputs);
+};
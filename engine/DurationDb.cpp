@@ -0,0 +1,86 @@
+//
+// Created by roel on 10/19/26.
+//
+
+#include "DurationDb.h"
+
+#include <cstring>
+#include <cstdint>
+#include <fstream>
+
+#include "util/BinaryFile.h"
+
+static constexpr char magic[8] = {'M', 'K', 'R', 'D', 'U', 'R', 'S', '1'};
+
+DurationDb::DurationDb(std::string path_) :
+        path(std::move(path_)),
+        mutex(),
+        durations(),
+        changed(false) {
+    load();
+}
+
+void DurationDb::load() {
+    std::ifstream stream(path, std::ios::binary);
+    if (!stream) return;
+    const std::string content((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+    if (content.size() < sizeof(magic) || memcmp(content.data(), magic, sizeof(magic)) != 0) return;
+
+    size_t pos = sizeof(magic);
+    while (pos < content.size()) {
+        uint32_t id_length;
+        if (!read_bytes(content, pos, &id_length, sizeof(id_length)) || content.size() - pos < id_length) break;
+        std::string id = content.substr(pos, id_length);
+        pos += id_length;
+
+        uint64_t microseconds;
+        if (!read_bytes(content, pos, &microseconds, sizeof(microseconds))) break;
+        durations.insert_or_assign(std::move(id), Duration(microseconds));
+    }
+}
+
+std::optional<DurationDb::Duration> DurationDb::get(const std::string &id) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = durations.find(id);
+    if (it == durations.end()) return std::nullopt;
+    return it->second;
+}
+
+void DurationDb::record(const std::string &id, Duration duration) {
+    std::lock_guard<std::mutex> lock(mutex);
+    durations.insert_or_assign(id, duration);
+    changed = true;
+}
+
+std::optional<DurationDb::Duration> DurationDb::mean() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (durations.empty()) return std::nullopt;
+    Duration total(0);
+    for (const auto &[id, duration]: durations) {
+        total += duration;
+    }
+    return total / durations.size();
+}
+
+bool DurationDb::save() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!changed) return true;
+
+    std::string buffer(magic, sizeof(magic));
+    for (const auto &[id, duration]: durations) {
+        const uint32_t id_length = static_cast<uint32_t>(id.size());
+        const uint64_t microseconds = static_cast<uint64_t>(duration.count());
+        buffer.append(reinterpret_cast<const char *>(&id_length), sizeof(id_length));
+        buffer += id;
+        buffer.append(reinterpret_cast<const char *>(&microseconds), sizeof(microseconds));
+    }
+
+    if (!write_file_atomically(path, buffer)) return false;
+    changed = false;
+    return true;
+}
+
+size_t DurationDb::size() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return durations.size();
+}
@@ -0,0 +1,62 @@
+//
+// Created by roel on 10/19/26.
+//
+
+
+#pragma once
+
+#include <string>
+#include <optional>
+#include <unordered_map>
+#include <mutex>
+#include <chrono>
+
+/*
+ * Persistent map of the ids of actions to how long they took the last time
+ * they ran, which the executor uses to start the actions on the longest path
+ * through the graph first.
+ *
+ * The file is a magic followed by one record per action:
+ *
+ *     u32 id length, id, u64 duration in microseconds
+ *
+ * Durations recorded during a build are kept in memory until save(), which
+ * writes a new file next to the old one and renames it in place.
+ */
+class DurationDb {
+public:
+    using Duration = std::chrono::microseconds;
+
+    explicit DurationDb(std::string path);
+
+    /*
+     * Safe to call concurrently.
+     */
+    [[nodiscard]] std::optional<Duration> get(const std::string &id) const;
+
+    /*
+     * Safe to call concurrently.
+     */
+    void record(const std::string &id, Duration duration);
+
+    /*
+     * The mean of all known durations, or nothing if there are none.
+     */
+    [[nodiscard]] std::optional<Duration> mean() const;
+
+    /*
+     * Writes all durations. Returns false if the file could not be written.
+     */
+    bool save();
+
+    [[nodiscard]] size_t size() const;
+
+private:
+    const std::string path;
+
+    mutable std::mutex mutex;
+    std::unordered_map<std::string, Duration> durations;
+    bool changed;
+
+    void load();
+};
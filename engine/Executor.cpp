@@ -0,0 +1,197 @@
+//
+// Created by roel on 10/19/26.
+//
+
+#include "Executor.h"
+#include "util/WorkStealingPool.h"
+
+#include <atomic>
+#include <mutex>
+#include <memory>
+#include <optional>
+#include <set>
+#include <unordered_map>
+
+using Duration = DurationDb::Duration;
+
+static const char *status_prefix(const ActionRunner::Result &result) {
+    if (!result.success()) return "FAILED: ";
+    if (result.up_to_date) return "up to date: ";
+    if (result.cached) return "cached: ";
+    return "";
+}
+
+/*
+ * Returns for every node the longest path from its start to the end of the
+ * build, given the duration of every node.
+ */
+static std::vector<Duration> longest_paths(const ActionGraph &graph, const std::vector<Duration> &durations) {
+    std::vector<Duration> paths(graph.size());
+    for (size_t i = graph.size(); i-- > 0;) {
+        Duration longest_dependent(0);
+        for (size_t dependent: graph.node(i).dependents) {
+            longest_dependent = std::max(longest_dependent, paths[dependent]);
+        }
+        paths[i] = durations[i] + longest_dependent;
+    }
+    return paths;
+}
+
+Executor::Executor(ActionRunner &runner_, Options options_) :
+        runner(runner_),
+        options(options_),
+        durations(nullptr) {}
+
+Executor::Executor(ActionRunner &runner_, Options options_, DurationDb &durations_) :
+        runner(runner_),
+        options(options_),
+        durations(&durations_) {}
+
+std::vector<Duration> Executor::remaining_paths(const ActionGraph &graph) const {
+    // Actions that never ran are assumed to take as long as the average one
+    const Duration unknown = (durations ? durations->mean() : std::nullopt).value_or(Duration(1));
+
+    std::vector<Duration> estimates(graph.size(), unknown);
+    if (durations) {
+        for (size_t i = 0; i < graph.size(); i++) {
+            estimates[i] = durations->get(graph.node(i).action.id).value_or(unknown);
+        }
+    }
+    return longest_paths(graph, estimates);
+}
+
+Executor::Result Executor::execute(const ActionGraph &graph) {
+    const auto start = std::chrono::steady_clock::now();
+    const size_t count = graph.size();
+    Result result;
+
+    auto remaining_dependencies = std::make_unique<std::atomic<size_t>[]>(count);
+    for (size_t i = 0; i < count; i++) {
+        remaining_dependencies[i] = graph.node(i).dependencies.size();
+    }
+
+    // Ready nodes by the longest remaining path, and then by their order in
+    // the graph
+    const std::vector<Duration> priorities = remaining_paths(graph);
+    auto compare = [&priorities](size_t lhs, size_t rhs) {
+        if (priorities[lhs] != priorities[rhs]) return priorities[lhs] > priorities[rhs];
+        return lhs < rhs;
+    };
+    std::set<size_t, decltype(compare)> ready(compare);
+
+    // What the running actions use, guarded by the same mutex as ready
+    std::mutex scheduler_mutex;
+    unsigned int running = 0;
+    unsigned int cpus_used = 0;
+    uint64_t memory_used = 0;
+    std::unordered_map<std::string, unsigned int> pools_used;
+
+    auto fits = [&](const Resources &resources) {
+        if (running == 0) return true;
+        if (running >= options.jobs) return false;
+        if (!resources.pool.empty() && pools_used[resources.pool] >= resources.pool_depth) return false;
+        if (options.cpus && cpus_used + resources.cpus > options.cpus) return false;
+        if (options.memory && memory_used + resources.memory > options.memory) return false;
+        return true;
+    };
+
+    std::vector<Duration> actual_durations(count, Duration(0));
+    std::mutex result_mutex;
+    std::atomic<bool> stopped = false;
+    unsigned int finished = 0;
+
+    WorkStealingPool pool(options.jobs);
+
+    std::function<void(size_t)> run;
+
+    // Starts the ready nodes that fit, highest priority first. Nodes that do
+    // not fit are passed over, so smaller ones can use what is left.
+    auto dispatch = [&] {
+        for (auto it = ready.begin(); it != ready.end() && running < options.jobs && !stopped;) {
+            const size_t index = *it;
+            const Resources &resources = graph.node(index).action.resources;
+            if (!fits(resources)) {
+                ++it;
+                continue;
+            }
+            it = ready.erase(it);
+            running++;
+            cpus_used += resources.cpus;
+            memory_used += resources.memory;
+            if (!resources.pool.empty()) pools_used[resources.pool]++;
+            pool.submit([&run, index] { run(index); });
+        }
+    };
+
+    run = [&](size_t index) {
+        const ActionGraph::Node &node = graph.node(index);
+        std::optional<Jobserver::Token> token;
+        if (options.jobserver) token = options.jobserver->acquire();
+
+        const auto action_start = std::chrono::steady_clock::now();
+        const ActionRunner::Result run_result = runner.run(node.action);
+        const auto duration = std::chrono::duration_cast<Duration>(std::chrono::steady_clock::now() - action_start);
+        if (token) options.jobserver->release(*token);
+
+        {
+            std::lock_guard<std::mutex> lock(result_mutex);
+            finished++;
+            actual_durations[index] = duration;
+            if (run_result.success()) {
+                result.succeeded++;
+                if (run_result.cached) result.cached++;
+                if (run_result.up_to_date) result.up_to_date++;
+            } else {
+                result.failed++;
+            }
+
+            if (options.status) {
+                fprintf(options.status, "[%u/%zu] %s%s\n", finished, count, status_prefix(run_result),
+                        node.action.description().c_str());
+                fputs(run_result.output.c_str(), options.status);
+                fflush(options.status);
+            }
+        }
+
+        // Restoring from a cache says nothing about how long running takes
+        if (durations && run_result.success() && !run_result.cached && !run_result.up_to_date) {
+            durations->record(node.action.id, run_result.ran_for.value_or(duration));
+        }
+
+        if (!run_result.success() && !options.keep_going) stopped = true;
+
+        std::lock_guard<std::mutex> lock(scheduler_mutex);
+        const Resources &resources = node.action.resources;
+        running--;
+        cpus_used -= resources.cpus;
+        memory_used -= resources.memory;
+        if (!resources.pool.empty()) pools_used[resources.pool]--;
+
+        if (run_result.success()) {
+            for (size_t dependent: node.dependents) {
+                if (--remaining_dependencies[dependent] == 0) {
+                    ready.insert(dependent);
+                }
+            }
+        }
+        dispatch();
+    };
+
+    {
+        std::lock_guard<std::mutex> lock(scheduler_mutex);
+        for (size_t i = 0; i < count; i++) {
+            if (graph.node(i).dependencies.empty()) {
+                ready.insert(i);
+            }
+        }
+        dispatch();
+    }
+    pool.wait();
+
+    result.skipped = static_cast<unsigned int>(count) - result.succeeded - result.failed;
+    result.wall_time = std::chrono::duration_cast<Duration>(std::chrono::steady_clock::now() - start);
+    for (const Duration &path: longest_paths(graph, actual_durations)) {
+        result.critical_path = std::max(result.critical_path, path);
+    }
+    return result;
+}
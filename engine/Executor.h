@@ -0,0 +1,89 @@
+//
+// Created by roel on 10/19/26.
+//
+
+
+#pragma once
+
+#include <cstdio>
+#include <chrono>
+#include <cstdint>
+
+#include "ActionGraph.h"
+#include "ActionRunner.h"
+#include "DurationDb.h"
+#include "Jobserver.h"
+
+/*
+ * Runs the actions of an ActionGraph on a work stealing thread pool. An action
+ * is started as soon as all actions it depends on have finished successfully.
+ *
+ * Of the actions that are ready, the one with the longest path to the end of
+ * the build is started first, so long chains of actions do not start late.
+ * The length of a path is estimated from how long its actions took before,
+ * if a duration database is given.
+ *
+ * Actions are only started while the pools they are in are not full and the
+ * memory and cores they declare fit in the budgets. An action that does not
+ * fit in the budgets on its own is started once nothing else runs.
+ */
+class Executor {
+public:
+    struct Options {
+        unsigned int jobs = 1;
+
+        // Budgets for the sum of the resources of the running actions, 0 for
+        // no limit
+        unsigned int cpus = 0;
+        uint64_t memory = 0;
+
+        // Keep starting actions that do not depend on a failed action
+        bool keep_going = false;
+
+        // Progress and the output of failed actions is written here, if set
+        FILE *status = nullptr;
+
+        // Every running action holds a token of this jobserver, if set
+        Jobserver *jobserver = nullptr;
+    };
+
+    struct Result {
+        unsigned int succeeded = 0;
+        unsigned int failed = 0;
+        unsigned int skipped = 0;
+
+        // Succeeded actions of which the outputs were restored from a cache
+        unsigned int cached = 0;
+
+        // Succeeded actions of which the outputs were already up to date,
+        // because their inputs did not change
+        unsigned int up_to_date = 0;
+
+        // How long the build took, and the longest path through the actions
+        // that finished: no number of jobs builds faster than that
+        std::chrono::microseconds wall_time{0};
+        std::chrono::microseconds critical_path{0};
+
+        [[nodiscard]] bool success() const { return failed == 0 && skipped == 0; }
+    };
+
+    Executor(ActionRunner &runner, Options options);
+
+    /*
+     * Records how long every action that ran took in the duration database.
+     */
+    Executor(ActionRunner &runner, Options options, DurationDb &durations);
+
+    Result execute(const ActionGraph &graph);
+
+private:
+    ActionRunner &runner;
+    const Options options;
+    DurationDb *durations;
+
+    /*
+     * Returns for every node the estimated length of the longest path from
+     * the start of that node to the end of the build.
+     */
+    [[nodiscard]] std::vector<DurationDb::Duration> remaining_paths(const ActionGraph &graph) const;
+};
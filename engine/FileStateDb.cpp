@@ -0,0 +1,239 @@
+//
+// Created by roel on 10/19/26.
+//
+
+#include "FileStateDb.h"
+
+#include <algorithm>
+#include <cstring>
+#include <ctime>
+#include <map>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "hash/FileHasher.h"
+#include "util/BinaryFile.h"
+
+static constexpr char magic[8] = {'M', 'K', 'R', 'F', 'S', 'D', 'B', '1'};
+
+// Files modified this recently may change again within the resolution of
+// the file system timestamps, so their state is not remembered
+static constexpr int64_t racy_window_ns = 2'000'000'000;
+
+struct FileStateDb::Header {
+    char magic[8];
+    uint64_t record_count;
+    uint64_t paths_size;
+};
+
+struct FileStateDb::Record {
+    uint64_t path_offset;
+    uint64_t path_length;
+    uint64_t inode;
+    uint64_t size;
+    int64_t mtime_ns;
+    int64_t ctime_ns;
+    uint64_t digest_high;
+    uint64_t digest_low;
+};
+
+static int64_t to_ns(const struct timespec &time) {
+    return static_cast<int64_t>(time.tv_sec) * 1'000'000'000 + time.tv_nsec;
+}
+
+static std::optional<FileStateDb::State> stat_file(const std::string &file) {
+    struct stat st{};
+    if (stat(file.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) return std::nullopt;
+
+    FileStateDb::State state;
+    state.inode = st.st_ino;
+    state.size = static_cast<uint64_t>(st.st_size);
+    state.mtime_ns = to_ns(st.st_mtim);
+    state.ctime_ns = to_ns(st.st_ctim);
+    return state;
+}
+
+static int64_t now_ns() {
+    struct timespec now{};
+    clock_gettime(CLOCK_REALTIME, &now);
+    return to_ns(now);
+}
+
+FileStateDb::FileStateDb(std::string path_) :
+        path(std::move(path_)),
+        hasher(nullptr),
+        mapped(nullptr),
+        mapped_size(0),
+        records(nullptr),
+        record_count(0),
+        paths(nullptr),
+        mutex(),
+        updates(),
+        hashed(0) {
+    load();
+}
+
+FileStateDb::FileStateDb(std::string path_, FileHasher &hasher_) :
+        path(std::move(path_)),
+        hasher(&hasher_),
+        mapped(nullptr),
+        mapped_size(0),
+        records(nullptr),
+        record_count(0),
+        paths(nullptr),
+        mutex(),
+        updates(),
+        hashed(0) {
+    load();
+}
+
+FileStateDb::~FileStateDb() {
+    if (mapped) munmap(const_cast<char *>(mapped), mapped_size);
+}
+
+void FileStateDb::load() {
+    const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return;
+
+    struct stat st{};
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(Header)) {
+        close(fd);
+        return;
+    }
+
+    void *address = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (address == MAP_FAILED) return;
+
+    mapped = static_cast<const char *>(address);
+    mapped_size = static_cast<size_t>(st.st_size);
+
+    Header header{};
+    memcpy(&header, mapped, sizeof(header));
+    const size_t tables_size = mapped_size - sizeof(Header);
+    if (memcmp(header.magic, magic, sizeof(magic)) == 0 && header.record_count <= tables_size / sizeof(Record) &&
+        header.paths_size == tables_size - header.record_count * sizeof(Record)) {
+        records = reinterpret_cast<const Record *>(mapped + sizeof(Header));
+        record_count = header.record_count;
+        paths = mapped + sizeof(Header) + record_count * sizeof(Record);
+        if (check_records(header.paths_size)) return;
+    }
+
+    // Not written by this version, or damaged, start over
+    munmap(address, mapped_size);
+    mapped = nullptr;
+    mapped_size = 0;
+    records = nullptr;
+    record_count = 0;
+    paths = nullptr;
+}
+
+bool FileStateDb::check_records(uint64_t paths_size) const {
+    for (uint64_t i = 0; i < record_count; i++) {
+        const Record &record = records[i];
+        if (record.path_offset > paths_size || record.path_length > paths_size - record.path_offset) return false;
+        if (i > 0 && record_path(records[i - 1]) >= record_path(record)) return false;
+    }
+    return true;
+}
+
+std::string_view FileStateDb::record_path(const Record &record) const {
+    return {paths + record.path_offset, record.path_length};
+}
+
+const FileStateDb::Record *FileStateDb::find_record(const std::string &file) const {
+    const Record *end = records + record_count;
+    const Record *it = std::lower_bound(records, end, file, [this](const Record &record, const std::string &key) {
+        return record_path(record) < key;
+    });
+    if (it == end || record_path(*it) != file) return nullptr;
+    return it;
+}
+
+std::optional<Digest> FileStateDb::hash(const std::string &file) {
+    const std::optional<State> state = stat_file(file);
+    if (!state) return std::nullopt;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = updates.find(file);
+        if (it != updates.end() && it->second.first == *state) {
+            return it->second.second;
+        }
+    }
+
+    const Record *record = find_record(file);
+    if (record && record->inode == state->inode && record->size == state->size &&
+        record->mtime_ns == state->mtime_ns && record->ctime_ns == state->ctime_ns) {
+        return Digest(record->digest_high, record->digest_low);
+    }
+
+    const std::optional<Digest> digest = hasher ? hasher->hash(file) : FileHasher::hash_file(file);
+    if (!digest) return std::nullopt;
+    hashed++;
+
+    // Check the state did not change while reading
+    if (stat_file(file) != state) return digest;
+
+    if (now_ns() - state->mtime_ns >= racy_window_ns) {
+        std::lock_guard<std::mutex> lock(mutex);
+        updates.insert_or_assign(file, std::make_pair(*state, *digest));
+    }
+    return digest;
+}
+
+bool FileStateDb::save() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (updates.empty()) return true;
+
+    // Merge the updates into the existing records, in path order
+    std::map<std::string_view, Record> merged;
+    for (uint64_t i = 0; i < record_count; i++) {
+        merged.emplace(record_path(records[i]), records[i]);
+    }
+    for (const auto &[file, update]: updates) {
+        const auto &[state, digest] = update;
+        Record record{0, 0, state.inode, state.size, state.mtime_ns, state.ctime_ns, digest.high(), digest.low()};
+        merged.insert_or_assign(std::string_view(file), record);
+    }
+
+    Header header{};
+    memcpy(header.magic, magic, sizeof(magic));
+    header.record_count = merged.size();
+
+    std::vector<Record> new_records;
+    new_records.reserve(merged.size());
+    std::string new_paths;
+    for (auto &[file, record]: merged) {
+        record.path_offset = new_paths.size();
+        record.path_length = file.size();
+        new_paths += file;
+        new_records.push_back(record);
+    }
+    header.paths_size = new_paths.size();
+
+    std::string buffer;
+    buffer.reserve(sizeof(header) + new_records.size() * sizeof(Record) + new_paths.size());
+    buffer.append(reinterpret_cast<const char *>(&header), sizeof(header));
+    buffer.append(reinterpret_cast<const char *>(new_records.data()), new_records.size() * sizeof(Record));
+    buffer += new_paths;
+    if (!write_file_atomically(path, buffer)) return false;
+
+    // Switch to the new file
+    if (mapped) munmap(const_cast<char *>(mapped), mapped_size);
+    mapped = nullptr;
+    mapped_size = 0;
+    records = nullptr;
+    record_count = 0;
+    paths = nullptr;
+    updates.clear();
+    load();
+    return true;
+}
+
+unsigned int FileStateDb::files_hashed() const {
+    return hashed;
+}
@@ -0,0 +1,109 @@
+//
+// Created by roel on 10/19/26.
+//
+
+
+#pragma once
+
+#include <string>
+#include <optional>
+#include <unordered_map>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+
+#include "util/Digest.h"
+
+class FileHasher;
+
+/*
+ * Persistent map of file states (inode, size, modification and change time)
+ * to the digest of the file contents, so the contents of unchanged files are
+ * never read again.
+ *
+ * The file is memory mapped and consists of a header, a table of fixed size
+ * records sorted by path and a table with the paths:
+ *
+ *     Header   magic, record count, size of the path table
+ *     Record   path offset and length, inode, size, mtime_ns, ctime_ns, digest
+ *     char[]   paths
+ *
+ * Files hashed during a build are kept in memory until save(), which writes
+ * a new file next to the old one and renames it in place.
+ */
+class FileStateDb {
+public:
+    explicit FileStateDb(std::string path);
+
+    /*
+     * Reads changed files with the hasher, so that large files are hashed on
+     * its threads.
+     */
+    FileStateDb(std::string path, FileHasher &hasher);
+
+    FileStateDb(const FileStateDb &) = delete;
+
+    FileStateDb &operator=(const FileStateDb &) = delete;
+
+    ~FileStateDb();
+
+    /*
+     * Returns the digest of the contents of a file, or nothing if the file
+     * cannot be read. Only reads the file if its state changed since it was
+     * last hashed. Safe to call concurrently.
+     */
+    std::optional<Digest> hash(const std::string &file);
+
+    /*
+     * Writes all known file states. Returns false if the file could not be
+     * written. Must not be called concurrently with hash().
+     */
+    bool save();
+
+    /*
+     * The number of files read by hash() since this database was opened.
+     */
+    [[nodiscard]] unsigned int files_hashed() const;
+
+    struct State {
+        uint64_t inode = 0;
+        uint64_t size = 0;
+        int64_t mtime_ns = 0;
+        int64_t ctime_ns = 0;
+
+        bool operator==(const State &rhs) const = default;
+    };
+
+private:
+    struct Header;
+    struct Record;
+
+    const std::string path;
+    FileHasher *const hasher;
+
+    const char *mapped;
+    size_t mapped_size;
+    const Record *records;
+    uint64_t record_count;
+    const char *paths;
+
+    std::mutex mutex;
+    std::unordered_map<std::string, std::pair<State, Digest>> updates;
+    std::atomic<unsigned int> hashed;
+
+    /*
+     * Maps the file, or leaves the database empty if it is missing or not
+     * valid.
+     */
+    void load();
+
+    /*
+     * Whether the paths of all records lie within the path table, and are
+     * sorted and unique, as find_record() relies on.
+     */
+    [[nodiscard]] bool check_records(uint64_t paths_size) const;
+
+    [[nodiscard]] const Record *find_record(const std::string &file) const;
+
+    [[nodiscard]] std::string_view record_path(const Record &record) const;
+};
@@ -0,0 +1,126 @@
+//
+// Created by roel on 10/19/26.
+//
+
+#include "FileWatcher.h"
+
+#include <cerrno>
+#include <cstdint>
+#include <filesystem>
+#include <stdexcept>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+static constexpr uint32_t watch_mask = IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_CREATE | IN_DELETE |
+                                       IN_ATTRIB;
+
+static std::string normal_path(const std::string &path) {
+    return std::filesystem::path(path).lexically_normal().string();
+}
+
+static std::string directory_of(const std::string &normal_file) {
+    const std::string directory = std::filesystem::path(normal_file).parent_path().string();
+    return directory.empty() ? "." : directory;
+}
+
+FileWatcher::FileWatcher() :
+        inotify_fd(inotify_init1(IN_NONBLOCK | IN_CLOEXEC)),
+        stop_fd(eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)),
+        files(),
+        directory_watches(),
+        watched_directories() {
+    if (inotify_fd < 0 || stop_fd < 0) {
+        if (inotify_fd >= 0) close(inotify_fd);
+        if (stop_fd >= 0) close(stop_fd);
+        throw std::runtime_error("Cannot create an inotify instance to watch files");
+    }
+}
+
+FileWatcher::~FileWatcher() {
+    close(inotify_fd);
+    close(stop_fd);
+}
+
+void FileWatcher::watch(const std::vector<std::string> &new_files) {
+    files.clear();
+    for (const std::string &file: new_files) {
+        const std::string path = normal_path(file);
+        const std::string directory = directory_of(path);
+        if (!directory_watches.contains(directory)) {
+            const int wd = inotify_add_watch(inotify_fd, directory.c_str(), watch_mask);
+            if (wd < 0) continue;
+            directory_watches.emplace(directory, wd);
+            watched_directories[wd] = directory;
+        }
+        files.insert(path);
+    }
+}
+
+size_t FileWatcher::size() const {
+    return files.size();
+}
+
+std::set<std::string> FileWatcher::wait(std::chrono::milliseconds quiet_period) {
+    std::set<std::string> changed;
+    pollfd fds[2] = {
+            {inotify_fd, POLLIN, 0},
+            {stop_fd,    POLLIN, 0},
+    };
+
+    // Until a watched file changed, and then until it is quiet
+    while (true) {
+        const int timeout = changed.empty() ? -1 : static_cast<int>(quiet_period.count());
+        const int ready = poll(fds, 2, timeout);
+        if (ready < 0) {
+            if (errno == EINTR) continue;
+            throw std::runtime_error("Cannot wait for changes to files");
+        }
+        if (fds[1].revents) {
+            uint64_t value;
+            [[maybe_unused]] const ssize_t count = read(stop_fd, &value, sizeof(value));
+            return {};
+        }
+        if (ready == 0) return changed;
+        if (!read_events(changed)) return changed;
+    }
+}
+
+void FileWatcher::stop() {
+    const uint64_t value = 1;
+    [[maybe_unused]] const ssize_t count = write(stop_fd, &value, sizeof(value));
+}
+
+bool FileWatcher::read_events(std::set<std::string> &changed) {
+    alignas(inotify_event) char buffer[64 * 1024];
+    while (true) {
+        const ssize_t count = read(inotify_fd, buffer, sizeof(buffer));
+        if (count < 0 && errno == EINTR) continue;
+        if (count <= 0) return true;
+
+        for (ssize_t offset = 0; offset < count;) {
+            const auto *event = reinterpret_cast<const inotify_event *>(buffer + offset);
+            offset += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+
+            if (event->mask & IN_Q_OVERFLOW) {
+                changed.insert(files.begin(), files.end());
+                return false;
+            }
+
+            auto it = watched_directories.find(event->wd);
+            if (it == watched_directories.end()) continue;
+
+            if (event->mask & IN_IGNORED) {
+                // The directory is gone
+                directory_watches.erase(it->second);
+                watched_directories.erase(it);
+                continue;
+            }
+
+            if (event->len == 0) continue;
+            const std::string path = normal_path(it->second + "/" + event->name);
+            if (files.contains(path)) changed.insert(path);
+        }
+    }
+}
@@ -0,0 +1,72 @@
+//
+// Created by roel on 10/19/26.
+//
+
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <set>
+#include <unordered_map>
+#include <unordered_set>
+#include <chrono>
+
+/*
+ * Waits for changes to a set of files with inotify. The directories of the
+ * files are watched rather than the files themselves, so that files which are
+ * replaced (as editors save them) or do not exist yet are noticed as well.
+ *
+ * Paths are compared in their lexically normal form, and are reported in that
+ * form.
+ */
+class FileWatcher {
+public:
+    FileWatcher();
+
+    FileWatcher(const FileWatcher &) = delete;
+
+    FileWatcher &operator=(const FileWatcher &) = delete;
+
+    ~FileWatcher();
+
+    /*
+     * Watches the given files from now on, instead of the files watched so
+     * far. Files in directories that do not exist are not watched.
+     */
+    void watch(const std::vector<std::string> &files);
+
+    /*
+     * The number of files watched.
+     */
+    [[nodiscard]] size_t size() const;
+
+    /*
+     * Blocks until a watched file changes, and then until no changes follow
+     * for quiet_period, so that a burst of changes (such as a checkout) is
+     * handled at once. Returns the changed files, or nothing after stop().
+     */
+    std::set<std::string> wait(std::chrono::milliseconds quiet_period);
+
+    /*
+     * Makes wait() return. Safe to call from another thread or a signal
+     * handler.
+     */
+    void stop();
+
+private:
+    const int inotify_fd;
+
+    // Signalled to stop waiting
+    const int stop_fd;
+
+    std::unordered_set<std::string> files;
+    std::unordered_map<std::string, int> directory_watches;
+    std::unordered_map<int, std::string> watched_directories;
+
+    /*
+     * Reads the pending events and adds the watched files they concern.
+     * Returns false if events were lost, after which all files are added.
+     */
+    bool read_events(std::set<std::string> &changed);
+};
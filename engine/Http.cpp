@@ -0,0 +1,148 @@
+//
+// Created by roel on 10/19/26.
+//
+
+#include "Http.h"
+#include "util/Socket.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <charconv>
+#include <sys/socket.h>
+
+static constexpr size_t max_line_size = 64 * 1024;
+static constexpr size_t max_header_count = 256;
+static constexpr size_t max_body_size = 1024 * 1024 * 1024;
+
+std::optional<std::string> HttpMessage::header(const std::string &name) const {
+    for (const auto &[header_name, value]: headers) {
+        if (header_name == name) return value;
+    }
+    return std::nullopt;
+}
+
+static std::string to_lower(std::string str) {
+    std::transform(str.begin(), str.end(), str.begin(), [](unsigned char c) { return std::tolower(c); });
+    return str;
+}
+
+static bool receive_more(int fd, std::string &buffer) {
+    char data[64 * 1024];
+    while (true) {
+        const ssize_t count = recv(fd, data, sizeof(data), 0);
+        if (count < 0 && errno == EINTR) continue;
+        if (count <= 0) return false;
+        buffer.append(data, static_cast<size_t>(count));
+        return true;
+    }
+}
+
+/*
+ * Receives until the buffer holds at least size bytes.
+ */
+static bool receive_until(int fd, std::string &buffer, size_t size) {
+    buffer.reserve(size);
+    while (buffer.size() < size) {
+        if (!receive_more(fd, buffer)) return false;
+    }
+    return true;
+}
+
+/*
+ * Reads a line, without the "\r\n" it ends in.
+ */
+static std::optional<std::string> receive_line(int fd, std::string &buffer) {
+    size_t end;
+    while ((end = buffer.find("\r\n")) == std::string::npos) {
+        if (buffer.size() > max_line_size || !receive_more(fd, buffer)) return std::nullopt;
+    }
+    std::string line = buffer.substr(0, end);
+    buffer.erase(0, end + 2);
+    return line;
+}
+
+static std::optional<size_t> parse_size(const std::string &str, int base) {
+    size_t size;
+    const auto result = std::from_chars(str.data(), str.data() + str.size(), size, base);
+    if (result.ec != std::errc() || result.ptr == str.data() || size > max_body_size) return std::nullopt;
+    // Chunk sizes may be followed by extensions, which are ignored
+    if (result.ptr != str.data() + str.size() && (base != 16 || *result.ptr != ';')) return std::nullopt;
+    return size;
+}
+
+static bool receive_chunked(int fd, std::string &buffer, std::string &body) {
+    while (true) {
+        const std::optional<std::string> line = receive_line(fd, buffer);
+        if (!line) return false;
+        const std::optional<size_t> size = parse_size(*line, 16);
+        if (!size || body.size() + *size > max_body_size) return false;
+        if (*size == 0) break;
+
+        if (!receive_until(fd, buffer, *size + 2)) return false;
+        body.append(buffer, 0, *size);
+        buffer.erase(0, *size + 2);
+    }
+
+    // Trailers
+    while (true) {
+        const std::optional<std::string> line = receive_line(fd, buffer);
+        if (!line) return false;
+        if (line->empty()) return true;
+    }
+}
+
+std::optional<HttpMessage> receive_http_message(int fd, std::string &buffer, bool has_body) {
+    HttpMessage message;
+    std::optional<std::string> line = receive_line(fd, buffer);
+    if (!line || line->empty()) return std::nullopt;
+    message.start_line = std::move(*line);
+
+    while (true) {
+        line = receive_line(fd, buffer);
+        if (!line) return std::nullopt;
+        if (line->empty()) break;
+
+        const size_t colon = line->find(':');
+        if (colon == std::string::npos || message.headers.size() >= max_header_count) return std::nullopt;
+        const size_t value_start = line->find_first_not_of(" \t", colon + 1);
+        const size_t value_end = line->find_last_not_of(" \t");
+        message.headers.emplace_back(to_lower(line->substr(0, colon)),
+                                     value_start == std::string::npos ? "" :
+                                     line->substr(value_start, value_end + 1 - value_start));
+    }
+    if (!has_body) return message;
+
+    const std::optional<std::string> encoding = message.header("transfer-encoding");
+    if (encoding && to_lower(*encoding) == "chunked") {
+        if (!receive_chunked(fd, buffer, message.body)) return std::nullopt;
+        return message;
+    }
+
+    const std::optional<std::string> length = message.header("content-length");
+    const std::optional<size_t> size = length ? parse_size(*length, 10) : 0;
+    if (!size || !receive_until(fd, buffer, *size)) return std::nullopt;
+    message.body = buffer.substr(0, *size);
+    buffer.erase(0, *size);
+    return message;
+}
+
+bool send_http_message(int fd, const std::string &start_line, const std::string &headers, const std::string &body) {
+    // Small bodies go out together with the headers
+    std::string head = start_line + "\r\n" + headers + "Content-Length: " + std::to_string(body.size()) + "\r\n\r\n";
+    if (body.size() < 64 * 1024) {
+        head += body;
+        return send_all(fd, head.data(), head.size());
+    }
+    return send_all(fd, head.data(), head.size()) && send_all(fd, body.data(), body.size());
+}
+
+std::optional<int> http_status(const std::string &status_line) {
+    const size_t start = status_line.find(' ');
+    if (!status_line.starts_with("HTTP/") || start == std::string::npos) return std::nullopt;
+    int status;
+    const char *end = status_line.data() + status_line.size();
+    const auto result = std::from_chars(status_line.data() + start + 1, end, status);
+    if (result.ec != std::errc() || (result.ptr != end && *result.ptr != ' ')) return std::nullopt;
+    return status;
+}
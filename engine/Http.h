@@ -0,0 +1,49 @@
+//
+// Created by roel on 10/19/26.
+//
+
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <optional>
+
+/*
+ * An HTTP/1.1 request or response, as far as the remote cache uses them:
+ * bodies have a Content-Length, or are chunked in responses of other servers.
+ */
+struct HttpMessage {
+    // The request line or the status line
+    std::string start_line;
+    // Names are lowercase
+    std::vector<std::pair<std::string, std::string>> headers;
+    std::string body;
+
+    /*
+     * Returns the value of a header, or nothing if the message does not have
+     * it.
+     */
+    [[nodiscard]] std::optional<std::string> header(const std::string &name) const;
+};
+
+/*
+ * Reads a message from a connection. The buffer holds what was received on
+ * the connection but not read yet, and is passed again for the next message.
+ * Responses to HEAD requests have no body, whatever their headers say.
+ *
+ * Returns nothing if the connection failed or was closed, or if the message
+ * is malformed or larger than any message sent.
+ */
+std::optional<HttpMessage> receive_http_message(int fd, std::string &buffer, bool has_body);
+
+/*
+ * Sends the start line, the headers (lines that end in "\r\n") and the body
+ * with its Content-Length. Returns false if the connection failed.
+ */
+bool send_http_message(int fd, const std::string &start_line, const std::string &headers, const std::string &body);
+
+/*
+ * The status code of a status line, or nothing if it is malformed.
+ */
+std::optional<int> http_status(const std::string &status_line);
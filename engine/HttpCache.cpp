@@ -0,0 +1,216 @@
+//
+// Created by roel on 10/19/26.
+//
+
+#include "HttpCache.h"
+#include "Http.h"
+#include "hash/Blake3.h"
+
+#include <fstream>
+#include <latch>
+#include <strings.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// Transfers of each direction that run in parallel
+static constexpr unsigned int transfer_threads = 8;
+
+// A server that does not answer within this is taken to be gone
+static constexpr time_t transfer_timeout_seconds = 30;
+
+HttpCache::HttpCache(const std::string &url, bool upload_) :
+        address(),
+        host(),
+        path(),
+        upload_enabled(upload_),
+        mutex(),
+        idle_connections(),
+        error(),
+        uploads(0),
+        download_pool(transfer_threads),
+        upload_pool(transfer_threads) {
+    const std::string scheme = "http://";
+    if (!url.starts_with(scheme)) {
+        throw RemoteError("Remote cache URL '" + url + "' does not start with " + scheme);
+    }
+    const size_t slash = url.find('/', scheme.size());
+    host = url.substr(scheme.size(), slash == std::string::npos ? std::string::npos : slash - scheme.size());
+    path = slash == std::string::npos ? "" : url.substr(slash);
+    while (path.ends_with('/')) path.pop_back();
+    if (host.empty()) {
+        throw RemoteError("Remote cache URL '" + url + "' does not have a host");
+    }
+    address = host.find(':') == std::string::npos ? host + ":80" : host;
+}
+
+HttpCache::~HttpCache() {
+    upload_pool.wait();
+    for (const Connection &connection: idle_connections) {
+        close(connection.fd);
+    }
+}
+
+HttpCache::Response HttpCache::request(const std::string &method, const std::string &resource,
+                                       const std::string &body) {
+    std::optional<Connection> connection;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!idle_connections.empty()) {
+            connection = std::move(idle_connections.back());
+            idle_connections.pop_back();
+        }
+    }
+
+    // The server may have closed a connection that was kept open, so a
+    // request that fails on one is sent again on a new connection
+    if (connection) {
+        try {
+            return request(std::move(*connection), method, resource, body);
+        } catch (const RemoteError &) {
+            // try again
+        }
+    }
+
+    const int fd = connect_to(address);
+    const timeval timeout{transfer_timeout_seconds, 0};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+    return request(Connection{fd, ""}, method, resource, body);
+}
+
+HttpCache::Response HttpCache::request(Connection connection, const std::string &method,
+                                       const std::string &resource, const std::string &body) {
+    std::optional<HttpMessage> response;
+    if (send_http_message(connection.fd, method + " " + path + resource + " HTTP/1.1", "Host: " + host + "\r\n",
+                          body)) {
+        response = receive_http_message(connection.fd, connection.buffer, method != "HEAD");
+    }
+    if (!response) {
+        close(connection.fd);
+        throw RemoteError("Lost the connection to the remote cache at '" + address + "'");
+    }
+
+    const std::optional<int> status = http_status(response->start_line);
+    const std::optional<std::string> connection_header = response->header("connection");
+    if (!status || (connection_header && strcasecmp(connection_header->c_str(), "close") == 0)) {
+        close(connection.fd);
+    } else {
+        std::lock_guard<std::mutex> lock(mutex);
+        idle_connections.push_back(std::move(connection));
+    }
+
+    if (!status) {
+        throw RemoteError("Malformed response of the remote cache at '" + address + "': " + response->start_line);
+    }
+    return {*status, std::move(response->body)};
+}
+
+bool HttpCache::is_disabled() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return error.has_value();
+}
+
+void HttpCache::disable(const std::string &message) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!error) error = message;
+}
+
+std::optional<std::string> HttpCache::get(const std::string &resource) {
+    if (is_disabled()) return std::nullopt;
+    try {
+        Response response = request("GET", resource, "");
+        if (response.status == 200) return std::move(response.body);
+        if (response.status != 404) {
+            disable("The remote cache at '" + address + "' answered " + std::to_string(response.status) +
+                    " to GET " + resource);
+        }
+    } catch (const RemoteError &e) {
+        disable(e.what());
+    }
+    return std::nullopt;
+}
+
+std::optional<std::string> HttpCache::get_entry(const Digest &key) {
+    return get("/ac/" + key.to_string());
+}
+
+std::vector<std::optional<std::string>> HttpCache::get_blobs(const std::vector<std::string> &digests) {
+    std::vector<std::optional<std::string>> blobs(digests.size());
+    auto get_blob = [&](size_t i) {
+        std::optional<std::string> blob = get("/cas/" + digests[i]);
+        if (blob && Blake3::hash(blob->data(), blob->size()).to_string() != digests[i]) {
+            disable("The remote cache at '" + address + "' has other contents for blob " + digests[i]);
+            blob.reset();
+        }
+        blobs[i] = std::move(blob);
+    };
+
+    // All but the first are fetched on the pool, in parallel with it
+    std::latch done(digests.empty() ? 0 : static_cast<std::ptrdiff_t>(digests.size() - 1));
+    for (size_t i = 1; i < digests.size(); i++) {
+        download_pool.submit([&, i] {
+            get_blob(i);
+            done.count_down();
+        });
+    }
+    if (!digests.empty()) get_blob(0);
+    done.wait();
+    return blobs;
+}
+
+void HttpCache::upload(const Digest &key, std::string entry, std::vector<std::pair<std::string, std::string>> blobs) {
+    if (!upload_enabled || is_disabled()) return;
+    upload_pool.submit([this, key, entry = std::move(entry), blobs = std::move(blobs)] {
+        upload_entry(key, entry, blobs);
+    });
+}
+
+static bool is_stored(int status) {
+    return status == 200 || status == 201 || status == 204;
+}
+
+void HttpCache::upload_entry(const Digest &key, const std::string &entry,
+                             const std::vector<std::pair<std::string, std::string>> &blobs) {
+    if (is_disabled()) return;
+    try {
+        for (const auto &[digest, blob_path]: blobs) {
+            const std::string resource = "/cas/" + digest;
+            if (request("HEAD", resource, "").status == 200) continue;
+
+            // Without the blob the entry is not uploaded either
+            std::ifstream stream(blob_path, std::ios::binary);
+            if (!stream) return;
+            const std::string contents((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+            const int status = request("PUT", resource, contents).status;
+            if (!is_stored(status)) {
+                throw RemoteError("The remote cache at '" + address + "' answered " + std::to_string(status) +
+                                  " to PUT " + resource);
+            }
+        }
+
+        const std::string resource = "/ac/" + key.to_string();
+        const int status = request("PUT", resource, entry).status;
+        if (!is_stored(status)) {
+            throw RemoteError("The remote cache at '" + address + "' answered " + std::to_string(status) +
+                              " to PUT " + resource);
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        uploads++;
+    } catch (const RemoteError &e) {
+        disable(e.what());
+    }
+}
+
+void HttpCache::wait() {
+    upload_pool.wait();
+}
+
+unsigned int HttpCache::upload_count() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return uploads;
+}
+
+std::optional<std::string> HttpCache::get_error() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return error;
+}
@@ -0,0 +1,132 @@
+//
+// Created by roel on 10/19/26.
+//
+
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <optional>
+#include <mutex>
+
+#include "util/Digest.h"
+#include "util/WorkStealingPool.h"
+#include "RemoteProtocol.h"
+
+/*
+ * Client of a remote action cache that is shared over HTTP, such as an
+ * HttpCacheServer, for the entries and blobs of ActionCaches:
+ *
+ *     GET|HEAD|PUT URL/ac/KEY        the entry of an action
+ *     GET|HEAD|PUT URL/cas/DIGEST    a blob
+ *
+ * The server answers 200 for entries and blobs it has and 404 for others
+ * (PUT may also answer 201 or 204). Which is the layout of the HTTP caches
+ * of other build systems, so their servers can be used as well.
+ *
+ * Requests go over a few connections that are kept open. Blobs of an entry
+ * are fetched in parallel, and uploads run in the background, each entry
+ * after its blobs so that other clients never find an entry of which the
+ * blobs are missing. Downloaded blobs are checked against their digest.
+ *
+ * The first failure (other than a 404) disables the cache for the rest of the
+ * build, so that an unreachable server does not slow it down.
+ */
+class HttpCache {
+public:
+    /*
+     * Throws RemoteError if the URL is not http://HOST[:PORT][/PATH].
+     * Without upload, the cache is only read from.
+     */
+    HttpCache(const std::string &url, bool upload);
+
+    HttpCache(const HttpCache &) = delete;
+
+    HttpCache &operator=(const HttpCache &) = delete;
+
+    /*
+     * Waits for the uploads.
+     */
+    ~HttpCache();
+
+    /*
+     * Returns the entry of an action, or nothing if the cache does not have
+     * it.
+     */
+    std::optional<std::string> get_entry(const Digest &key);
+
+    /*
+     * Returns the contents of the blobs, or nothing for the blobs the cache
+     * does not have.
+     */
+    std::vector<std::optional<std::string>> get_blobs(const std::vector<std::string> &digests);
+
+    /*
+     * Uploads the blobs (digests and the files with their contents) that
+     * the cache does not have yet, and then the entry. Returns at once.
+     */
+    void upload(const Digest &key, std::string entry, std::vector<std::pair<std::string, std::string>> blobs);
+
+    /*
+     * Blocks until the uploads are done.
+     */
+    void wait();
+
+    /*
+     * The number of entries uploaded.
+     */
+    [[nodiscard]] unsigned int upload_count() const;
+
+    /*
+     * The failure that disabled the cache, if any.
+     */
+    [[nodiscard]] std::optional<std::string> get_error() const;
+
+private:
+    struct Connection {
+        int fd;
+        // Received but not read yet
+        std::string buffer;
+    };
+
+    struct Response {
+        int status;
+        std::string body;
+    };
+
+    std::string address;
+    std::string host;
+    std::string path;
+    const bool upload_enabled;
+
+    mutable std::mutex mutex;
+    std::vector<Connection> idle_connections;
+    std::optional<std::string> error;
+    unsigned int uploads;
+
+    // Last, so that their threads stop before the rest is destroyed
+    WorkStealingPool download_pool;
+    WorkStealingPool upload_pool;
+
+    /*
+     * Throws RemoteError if the request fails.
+     */
+    Response request(const std::string &method, const std::string &resource, const std::string &body);
+
+    /*
+     * Sends the request on the connection, which is kept open for the next
+     * request unless the server closes it.
+     */
+    Response request(Connection connection, const std::string &method, const std::string &resource,
+                     const std::string &body);
+
+    [[nodiscard]] bool is_disabled() const;
+
+    void disable(const std::string &message);
+
+    std::optional<std::string> get(const std::string &resource);
+
+    void upload_entry(const Digest &key, const std::string &entry,
+                      const std::vector<std::pair<std::string, std::string>> &blobs);
+};
@@ -0,0 +1,183 @@
+//
+// Created by roel on 10/19/26.
+//
+
+#include "HttpCacheServer.h"
+#include "RemoteProtocol.h"
+#include "hash/Blake3.h"
+
+#include <cerrno>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// Connections that stay idle for longer are closed, clients open new ones
+static constexpr time_t idle_timeout_seconds = 60;
+
+static std::string absolute_dir(const std::string &dir) {
+    return std::filesystem::absolute(dir).lexically_normal().string();
+}
+
+HttpCacheServer::HttpCacheServer(const std::string &dir_, const std::string &address) :
+        dir(absolute_dir(dir_)),
+        listen_fd(listen_on(address)),
+        stop_fd(eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)),
+        mutex(),
+        connections_closed(),
+        connections() {
+    std::error_code error;
+    std::filesystem::create_directories(dir + "/ac", error);
+    std::filesystem::create_directories(dir + "/cas", error);
+    if (error || stop_fd < 0) {
+        close(listen_fd);
+        if (stop_fd >= 0) close(stop_fd);
+        throw RemoteError("Cannot create the directories of the remote cache in '" + dir + "'");
+    }
+}
+
+HttpCacheServer::~HttpCacheServer() {
+    close(listen_fd);
+    close(stop_fd);
+}
+
+unsigned int HttpCacheServer::get_port() const {
+    sockaddr_storage address{};
+    socklen_t size = sizeof(address);
+    if (getsockname(listen_fd, reinterpret_cast<sockaddr *>(&address), &size) != 0) return 0;
+    if (address.ss_family == AF_INET) return ntohs(reinterpret_cast<const sockaddr_in &>(address).sin_port);
+    if (address.ss_family == AF_INET6) return ntohs(reinterpret_cast<const sockaddr_in6 &>(address).sin6_port);
+    return 0;
+}
+
+void HttpCacheServer::run() {
+    pollfd fds[2] = {{listen_fd, POLLIN, 0},
+                     {stop_fd,   POLLIN, 0}};
+    while (true) {
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        if (fds[1].revents) break;
+        if (!(fds[0].revents & POLLIN)) continue;
+
+        const int fd = accept4(listen_fd, nullptr, nullptr, SOCK_CLOEXEC);
+        if (fd < 0) continue;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            connections.insert(fd);
+        }
+        std::thread(&HttpCacheServer::handle, this, fd).detach();
+    }
+    uint64_t value;
+    [[maybe_unused]] const ssize_t count = read(stop_fd, &value, sizeof(value));
+
+    // Wakes up the connections that wait for a request
+    std::unique_lock<std::mutex> lock(mutex);
+    for (int fd: connections) {
+        shutdown(fd, SHUT_RDWR);
+    }
+    connections_closed.wait(lock, [this] { return connections.empty(); });
+}
+
+void HttpCacheServer::stop() {
+    const uint64_t value = 1;
+    [[maybe_unused]] const ssize_t count = write(stop_fd, &value, sizeof(value));
+}
+
+static std::string reason_phrase(int status) {
+    switch (status) {
+        case 200:
+            return "OK";
+        case 400:
+            return "Bad Request";
+        case 404:
+            return "Not Found";
+        case 405:
+            return "Method Not Allowed";
+        default:
+            return "Internal Server Error";
+    }
+}
+
+void HttpCacheServer::handle(int fd) {
+    const timeval timeout{idle_timeout_seconds, 0};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    std::string buffer;
+    while (std::optional<HttpMessage> request = receive_http_message(fd, buffer, true)) {
+        const Response response = respond(*request);
+        const bool head = request->start_line.starts_with("HEAD ");
+        if (!send_http_message(fd, "HTTP/1.1 " + std::to_string(response.status) + " " +
+                                   reason_phrase(response.status), "", head ? "" : response.body)) {
+            break;
+        }
+    }
+
+    // Under the lock, so that run() never shuts down a reused descriptor
+    std::lock_guard<std::mutex> lock(mutex);
+    connections.erase(fd);
+    close(fd);
+    connections_closed.notify_all();
+}
+
+std::optional<std::string> HttpCacheServer::resource_path(const std::string &path) const {
+    // The last two parts, so that clients can use any prefix
+    const size_t name_start = path.rfind('/');
+    if (name_start == std::string::npos || name_start == 0) return std::nullopt;
+    const size_t kind_start = path.rfind('/', name_start - 1);
+    if (kind_start == std::string::npos) return std::nullopt;
+
+    const std::string kind = path.substr(kind_start + 1, name_start - kind_start - 1);
+    const std::string name = path.substr(name_start + 1);
+    if ((kind != "ac" && kind != "cas") || !is_digest(name)) return std::nullopt;
+    return dir + "/" + kind + "/" + name;
+}
+
+HttpCacheServer::Response HttpCacheServer::respond(const HttpMessage &request) {
+    const size_t method_end = request.start_line.find(' ');
+    const size_t target_end = method_end == std::string::npos ? method_end :
+                              request.start_line.find(' ', method_end + 1);
+    if (target_end == std::string::npos) return {400, ""};
+    const std::string method = request.start_line.substr(0, method_end);
+    const std::optional<std::string> path = resource_path(
+            request.start_line.substr(method_end + 1, target_end - method_end - 1));
+    if (!path) return {404, ""};
+
+    if (method == "GET" || method == "HEAD") {
+        std::ifstream stream(*path, std::ios::binary);
+        if (!stream) return {404, ""};
+        if (method == "HEAD") return {200, ""};
+        return {200, std::string((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>())};
+    }
+
+    if (method == "PUT") {
+        // A blob that does not match its digest would be restored as another file
+        const std::string blob_dir = dir + "/cas/";
+        if (path->starts_with(blob_dir) &&
+            Blake3::hash(request.body.data(), request.body.size()).to_string() != path->substr(blob_dir.size())) {
+            return {400, "The contents do not match the digest\n"};
+        }
+        return {store(*path, request.body) ? 200 : 500, ""};
+    }
+    return {405, ""};
+}
+
+bool HttpCacheServer::store(const std::string &path, const std::string &contents) {
+    // Other connections may store the same file, each writes a file of its own
+    const std::string temp_path = path + "." + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+    {
+        std::ofstream stream(temp_path, std::ios::binary | std::ios::trunc);
+        stream.write(contents.data(), static_cast<std::streamsize>(contents.size()));
+        if (!stream.flush()) {
+            unlink(temp_path.c_str());
+            return false;
+        }
+    }
+    return rename(temp_path.c_str(), path.c_str()) == 0;
+}
@@ -0,0 +1,82 @@
+//
+// Created by roel on 10/19/26.
+//
+
+
+#pragma once
+
+#include <string>
+#include <set>
+#include <mutex>
+#include <condition_variable>
+
+#include "Http.h"
+
+/*
+ * A remote cache for HttpCaches, with the entries and blobs in files below a
+ * directory:
+ *
+ *     DIR/ac/KEY         entries of actions
+ *     DIR/cas/DIGEST     blobs, stored only if their contents match
+ *
+ * Every connection is served on a thread of its own, in one process. Nothing
+ * is ever removed, so this is meant for tests and small teams rather than
+ * as the cache of a company.
+ */
+class HttpCacheServer {
+public:
+    /*
+     * Listens on HOST:PORT (port 0 picks a free port), throws RemoteError if
+     * it cannot.
+     */
+    HttpCacheServer(const std::string &dir, const std::string &address);
+
+    HttpCacheServer(const HttpCacheServer &) = delete;
+
+    HttpCacheServer &operator=(const HttpCacheServer &) = delete;
+
+    ~HttpCacheServer();
+
+    /*
+     * The port it listens on.
+     */
+    [[nodiscard]] unsigned int get_port() const;
+
+    /*
+     * Serves connections until stop() is called, and closes them then.
+     */
+    void run();
+
+    /*
+     * Makes run() return. Safe to call from a signal handler.
+     */
+    void stop();
+
+private:
+    struct Response {
+        int status;
+        std::string body;
+    };
+
+    const std::string dir;
+    const int listen_fd;
+
+    // Signalled to stop serving
+    const int stop_fd;
+
+    std::mutex mutex;
+    std::condition_variable connections_closed;
+    std::set<int> connections;
+
+    void handle(int fd);
+
+    Response respond(const HttpMessage &request);
+
+    /*
+     * Returns the file of a resource, or nothing if the path does not name
+     * an entry or a blob.
+     */
+    [[nodiscard]] std::optional<std::string> resource_path(const std::string &path) const;
+
+    bool store(const std::string &path, const std::string &contents);
+};
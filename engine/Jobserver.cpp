@@ -0,0 +1,129 @@
+//
+// Created by roel on 10/19/26.
+//
+
+#include "Jobserver.h"
+
+#include <cerrno>
+#include <sstream>
+#include <vector>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// How long acquire() waits for a token before checking whether the implicit
+// token was returned
+static constexpr int poll_timeout_ms = 50;
+
+static constexpr char token_char = '+';
+
+Jobserver::Jobserver(int read_fd_, int write_fd_, bool owns_fds_, std::string fifo_path_, std::string makeflags_) :
+        read_fd(read_fd_),
+        write_fd(write_fd_),
+        owns_fds(owns_fds_),
+        fifo_path(std::move(fifo_path_)),
+        makeflags(std::move(makeflags_)),
+        implicit_taken(false),
+        broken(false) {}
+
+Jobserver::~Jobserver() {
+    if (owns_fds) {
+        close(read_fd);
+        if (write_fd != read_fd) close(write_fd);
+    }
+    if (!fifo_path.empty()) unlink(fifo_path.c_str());
+}
+
+static bool is_open(int fd) {
+    return fd >= 0 && fcntl(fd, F_GETFD) != -1;
+}
+
+std::unique_ptr<Jobserver> Jobserver::connect(const std::string &makeflags) {
+    // The last option wins, as in make
+    std::string auth;
+    std::istringstream words(makeflags);
+    std::string word;
+    while (words >> word) {
+        for (const std::string option: {"--jobserver-auth=", "--jobserver-fds="}) {
+            if (word.starts_with(option)) auth = word.substr(option.size());
+        }
+    }
+    if (auth.empty()) return nullptr;
+
+    if (auth.starts_with("fifo:")) {
+        const int fd = open(auth.substr(5).c_str(), O_RDWR | O_NONBLOCK | O_CLOEXEC);
+        if (fd < 0) return nullptr;
+        return std::unique_ptr<Jobserver>(new Jobserver(fd, fd, true, "", makeflags));
+    }
+
+    const size_t comma = auth.find(',');
+    if (comma == std::string::npos) return nullptr;
+    int read_fd, write_fd;
+    try {
+        read_fd = std::stoi(auth.substr(0, comma));
+        write_fd = std::stoi(auth.substr(comma + 1));
+    } catch (const std::logic_error &) {
+        return nullptr;
+    }
+
+    // make only passes the descriptors to commands it knows to be a make
+    if (!is_open(read_fd) || !is_open(write_fd)) return nullptr;
+    return std::unique_ptr<Jobserver>(new Jobserver(read_fd, write_fd, false, "", makeflags));
+}
+
+std::unique_ptr<Jobserver> Jobserver::create(unsigned int jobs, const std::string &dir) {
+    const std::string path = dir + "/mkr-jobserver-" + std::to_string(getpid());
+    unlink(path.c_str());
+    if (mkfifo(path.c_str(), 0600) != 0) return nullptr;
+
+    // Opened for reading and writing, so it never reaches end of file and
+    // writing never blocks for lack of a reader
+    const int fd = open(path.c_str(), O_RDWR | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0) {
+        unlink(path.c_str());
+        return nullptr;
+    }
+
+    const std::vector<char> tokens(jobs > 1 ? jobs - 1 : 0, token_char);
+    if (!tokens.empty() && write(fd, tokens.data(), tokens.size()) != static_cast<ssize_t>(tokens.size())) {
+        close(fd);
+        unlink(path.c_str());
+        return nullptr;
+    }
+
+    const std::string makeflags = "-j" + std::to_string(jobs) + " --jobserver-auth=fifo:" + path;
+    return std::unique_ptr<Jobserver>(new Jobserver(fd, fd, true, path, makeflags));
+}
+
+Jobserver::Token Jobserver::acquire() {
+    while (true) {
+        if (!implicit_taken.exchange(true)) return {Token::Source::IMPLICIT, 0};
+        if (broken) return {Token::Source::NONE, 0};
+
+        // Other threads and processes may take the token between poll() and
+        // read(), in which case read() fails (or, if the descriptors were
+        // inherited from make and are blocking, waits for the next token)
+        pollfd poll_fd{read_fd, POLLIN, 0};
+        const int ready = poll(&poll_fd, 1, poll_timeout_ms);
+        if (ready < 0 && errno != EINTR) broken = true;
+        if (ready <= 0) continue;
+
+        char value;
+        const ssize_t count = read(read_fd, &value, 1);
+        if (count == 1) return {Token::Source::JOBSERVER, value};
+        if (count == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) broken = true;
+    }
+}
+
+void Jobserver::release(const Token &token) {
+    if (token.source == Token::Source::IMPLICIT) {
+        implicit_taken = false;
+    } else if (token.source == Token::Source::JOBSERVER) {
+        while (write(write_fd, &token.value, 1) < 0 && errno == EINTR) {}
+    }
+}
+
+const std::string &Jobserver::get_makeflags() const {
+    return makeflags;
+}
@@ -0,0 +1,86 @@
+//
+// Created by roel on 10/19/26.
+//
+
+
+#pragma once
+
+#include <string>
+#include <memory>
+#include <atomic>
+
+/*
+ * GNU make compatible jobserver: a pipe holding one byte (token) for every job
+ * that may run in addition to the one every process may always run, shared by
+ * all processes of a (nested) build.
+ *
+ * mkr connects to the jobserver of a make it runs under, or otherwise creates
+ * a named pipe (fifo) of its own and exports it in MAKEFLAGS to the actions it
+ * runs. Both mkr and the makes it runs then take a token for every job, so
+ * together they run no more jobs than requested.
+ */
+class Jobserver {
+public:
+    struct Token {
+        enum class Source {
+            // The job every process may run without a token
+            IMPLICIT,
+            JOBSERVER,
+            // The jobserver broke down, jobs are no longer limited
+            NONE,
+        };
+
+        Source source;
+        char value;
+    };
+
+    Jobserver(const Jobserver &) = delete;
+
+    Jobserver &operator=(const Jobserver &) = delete;
+
+    ~Jobserver();
+
+    /*
+     * Connects to the jobserver described by the value of MAKEFLAGS, as a
+     * fifo (--jobserver-auth=fifo:PATH) or as a pair of inherited file
+     * descriptors (--jobserver-auth=R,W). Returns nullptr if there is none.
+     */
+    static std::unique_ptr<Jobserver> connect(const std::string &makeflags);
+
+    /*
+     * Creates a jobserver for the given number of jobs, with a fifo in dir.
+     * Returns nullptr if the fifo cannot be created.
+     */
+    static std::unique_ptr<Jobserver> create(unsigned int jobs, const std::string &dir);
+
+    /*
+     * Takes a token, blocking until one is available. Safe to call
+     * concurrently.
+     */
+    Token acquire();
+
+    /*
+     * Returns a token taken by acquire().
+     */
+    void release(const Token &token);
+
+    /*
+     * The value of MAKEFLAGS by which child processes use this jobserver.
+     */
+    [[nodiscard]] const std::string &get_makeflags() const;
+
+private:
+    Jobserver(int read_fd, int write_fd, bool owns_fds, std::string fifo_path, std::string makeflags);
+
+    const int read_fd;
+    const int write_fd;
+    const bool owns_fds;
+
+    // Removed when this jobserver is destroyed, if not empty
+    const std::string fifo_path;
+
+    const std::string makeflags;
+
+    std::atomic<bool> implicit_taken;
+    std::atomic<bool> broken;
+};
@@ -0,0 +1,113 @@
+//
+// Created by roel on 10/19/26.
+//
+
+#include "OutputCollector.h"
+
+#include <cerrno>
+#include <condition_variable>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+static constexpr int max_events = 64;
+
+struct OutputCollector::Pipe {
+    const int fd;
+    std::string output;
+    bool truncated = false;
+    bool closed = false;
+    std::condition_variable closed_changed;
+
+    explicit Pipe(int fd_) :
+            fd(fd_) {}
+};
+
+OutputCollector::OutputCollector(size_t max_size_) :
+        max_size(max_size_),
+        epoll_fd(epoll_create1(EPOLL_CLOEXEC)),
+        stop_fd(eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)),
+        mutex(),
+        thread() {
+    if (epoll_fd < 0 || stop_fd < 0) {
+        throw std::runtime_error("Cannot create an epoll instance for the output of actions");
+    }
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.ptr = nullptr;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, stop_fd, &event);
+
+    thread = std::thread(&OutputCollector::run_loop, this);
+}
+
+OutputCollector::~OutputCollector() {
+    const uint64_t one = 1;
+    while (write(stop_fd, &one, sizeof(one)) < 0 && errno == EINTR) {}
+    thread.join();
+    close(stop_fd);
+    close(epoll_fd);
+}
+
+std::string OutputCollector::collect(int fd) {
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+
+    Pipe pipe(fd);
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.ptr = &pipe;
+
+    std::unique_lock<std::mutex> lock(mutex);
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) == 0) {
+        pipe.closed_changed.wait(lock, [&pipe] { return pipe.closed; });
+    } else {
+        // Read it on this thread instead
+        lock.unlock();
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_NONBLOCK);
+        while (read_available(pipe)) {}
+    }
+    close(fd);
+
+    if (pipe.truncated) pipe.output += "\n[output truncated]\n";
+    return std::move(pipe.output);
+}
+
+bool OutputCollector::read_available(Pipe &pipe) const {
+    char buffer[64 * 1024];
+    while (true) {
+        const ssize_t count = read(pipe.fd, buffer, sizeof(buffer));
+        if (count > 0) {
+            const size_t room = max_size - std::min(max_size, pipe.output.size());
+            if (static_cast<size_t>(count) > room) pipe.truncated = true;
+            pipe.output.append(buffer, std::min(room, static_cast<size_t>(count)));
+            continue;
+        }
+        if (count < 0 && errno == EINTR) continue;
+        if (count < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return true;
+        return false;
+    }
+}
+
+void OutputCollector::run_loop() {
+    epoll_event events[max_events];
+    while (true) {
+        const int count = epoll_wait(epoll_fd, events, max_events, -1);
+        if (count < 0) {
+            if (errno == EINTR) continue;
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        for (int i = 0; i < count; i++) {
+            Pipe *pipe = static_cast<Pipe *>(events[i].data.ptr);
+            if (!pipe) return;
+
+            if (!read_available(*pipe)) {
+                epoll_ctl(epoll_fd, EPOLL_CTL_DEL, pipe->fd, nullptr);
+                pipe->closed = true;
+                pipe->closed_changed.notify_one();
+            }
+        }
+    }
+}
@@ -0,0 +1,56 @@
+//
+// Created by roel on 10/19/26.
+//
+
+
+#pragma once
+
+#include <string>
+#include <mutex>
+#include <thread>
+#include <cstddef>
+
+/*
+ * Reads the output of child processes from pipes, with a single epoll loop on
+ * a thread of its own, so collecting the output of many concurrently running
+ * processes costs no thread per process.
+ *
+ * Output beyond max_size bytes is read but dropped, and replaced by a note
+ * that it was truncated.
+ */
+class OutputCollector {
+public:
+    explicit OutputCollector(size_t max_size);
+
+    OutputCollector(const OutputCollector &) = delete;
+
+    OutputCollector &operator=(const OutputCollector &) = delete;
+
+    ~OutputCollector();
+
+    /*
+     * Reads from a pipe until all its writers closed it, and returns what was
+     * read. Takes ownership of fd. Blocks the calling thread. Safe to call
+     * concurrently.
+     */
+    std::string collect(int fd);
+
+private:
+    struct Pipe;
+
+    const size_t max_size;
+    const int epoll_fd;
+
+    // Signalled to stop the loop
+    const int stop_fd;
+
+    std::mutex mutex;
+    std::thread thread;
+
+    void run_loop();
+
+    /*
+     * Reads what is available. Returns false once the pipe is closed.
+     */
+    bool read_available(Pipe &pipe) const;
+};
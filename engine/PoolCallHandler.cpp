@@ -0,0 +1,59 @@
+//
+// Created by roel on 10/19/26.
+//
+
+#include "PoolCallHandler.h"
+#include "Resources.h"
+
+PoolCallHandler::PoolCallHandler(ObjectStore &object_store_) :
+        object_store(object_store_) {}
+
+CallResult PoolCallHandler::call(const CallArgList &arguments) const {
+    CallResult result;
+
+    const Object *name = nullptr;
+    try {
+        const CallArg &arg = arguments.arg("name");
+        try {
+            if (arg.object().get_string().empty()) {
+                result.add_arg_error(arg, "Pool name is empty");
+            }
+            name = &arg.object();
+        } catch (const ObjectIsNotAString &) {
+            result.add_arg_error(arg, "'name' must be a string");
+        }
+    } catch (const MissingKeywordArgument &) {
+        result.add_call_error("Missing argument 'name'");
+    }
+
+    const Object *depth = nullptr;
+    try {
+        const CallArg &arg = arguments.arg("depth");
+        try {
+            if (!parse_count(arg.object().get_string())) {
+                result.add_arg_error(arg, "'depth' must be a positive number");
+            }
+            depth = &arg.object();
+        } catch (const ObjectIsNotAString &) {
+            result.add_arg_error(arg, "'depth' must be a string");
+        }
+    } catch (const MissingKeywordArgument &) {
+        result.add_call_error("Missing argument 'depth'");
+    }
+
+    if (!result.success()) return result;
+
+    result.set_return_value(object_store.create_struct({
+            {"name",  *name},
+            {"depth", *depth},
+    }));
+    return result;
+}
+
+bool PoolCallHandler::operator==(const CallHandler &rhs) const {
+    return this == &rhs;
+}
+
+bool PoolCallHandler::is_pure() const {
+    return true;
+}
@@ -0,0 +1,32 @@
+//
+// Created by roel on 10/19/26.
+//
+
+
+#pragma once
+
+#include "interpreter/Object.h"
+
+/*
+ * Implements the pool() builtin, which declares a pool of which at most depth
+ * actions run at once:
+ *
+ *     link_pool = pool(name="link" depth="4")
+ *     exe = action(command=["ld" "-o" "$out" objects] outputs=["exe"] pool=link_pool)
+ *
+ * Pools are identified by their name. The result is a struct with the
+ * attributes 'name' and 'depth'.
+ */
+class PoolCallHandler : public CallHandler {
+public:
+    explicit PoolCallHandler(ObjectStore &object_store);
+
+    [[nodiscard]] CallResult call(const CallArgList &arguments) const override;
+
+    [[nodiscard]] bool operator==(const CallHandler &rhs) const override;
+
+    [[nodiscard]] bool is_pure() const override;
+
+private:
+    ObjectStore &object_store;
+};
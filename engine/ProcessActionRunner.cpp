@@ -0,0 +1,104 @@
+//
+// Created by roel on 10/19/26.
+//
+
+#include "ProcessActionRunner.h"
+
+#include <filesystem>
+#include <vector>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <spawn.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+extern char **environ;
+
+ProcessActionRunner::ProcessActionRunner() :
+        environment(),
+        inherit(true),
+        output_collector(max_output_size) {}
+
+ProcessActionRunner::ProcessActionRunner(std::vector<std::string> environment_) :
+        environment(std::move(environment_)),
+        inherit(false),
+        output_collector(max_output_size) {}
+
+std::vector<std::string> ProcessActionRunner::inherit_environment(const std::vector<std::string> &names) {
+    std::vector<std::string> entries;
+    for (const std::string &name: names) {
+        const char *value = getenv(name.c_str());
+        if (value) entries.push_back(name + "=" + value);
+    }
+    return entries;
+}
+
+bool ProcessActionRunner::create_output_directories(const Action &action, Result &result) {
+    for (const std::string &output: action.outputs) {
+        std::error_code error;
+        std::filesystem::create_directories(std::filesystem::path(output).parent_path(), error);
+        if (error) {
+            result.exit_code = 1;
+            result.output = "Cannot create directory for '" + output + "': " + error.message() + "\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+ActionRunner::Result ProcessActionRunner::run(const Action &action) {
+    Result result;
+    if (!create_output_directories(action, result)) return result;
+
+    std::vector<char *> argv;
+    for (const std::string &arg: action.command) {
+        argv.push_back(const_cast<char *>(arg.c_str()));
+    }
+    argv.push_back(nullptr);
+
+    std::vector<char *> envp;
+    for (const std::string &entry: environment) {
+        envp.push_back(const_cast<char *>(entry.c_str()));
+    }
+    envp.push_back(nullptr);
+
+    // Close-on-exec, so processes started concurrently by other threads do
+    // not keep the pipe open
+    int pipe_fds[2];
+    if (pipe2(pipe_fds, O_CLOEXEC) != 0) {
+        result.exit_code = 1;
+        result.output = std::string("Cannot create a pipe: ") + strerror(errno) + "\n";
+        return result;
+    }
+
+    posix_spawn_file_actions_t file_actions;
+    posix_spawn_file_actions_init(&file_actions);
+    posix_spawn_file_actions_addopen(&file_actions, 0, "/dev/null", O_RDONLY, 0);
+    posix_spawn_file_actions_adddup2(&file_actions, pipe_fds[1], 1);
+    posix_spawn_file_actions_adddup2(&file_actions, pipe_fds[1], 2);
+
+    pid_t pid;
+    const int error = posix_spawnp(&pid, argv.front(), &file_actions, nullptr, argv.data(),
+                                   inherit ? environ : envp.data());
+    posix_spawn_file_actions_destroy(&file_actions);
+    close(pipe_fds[1]);
+    if (error) {
+        close(pipe_fds[0]);
+        result.exit_code = 127;
+        result.output = "Cannot start '" + action.command.front() + "': " + strerror(error) + "\n";
+        return result;
+    }
+
+    result.output = output_collector.collect(pipe_fds[0]);
+
+    int status = 0;
+    while (waitpid(pid, &status, 0) < 0 && errno == EINTR) {}
+
+    if (WIFEXITED(status)) {
+        result.exit_code = WEXITSTATUS(status);
+    } else {
+        result.exit_code = 128 + WTERMSIG(status);
+    }
+    return result;
+}
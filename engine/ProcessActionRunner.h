@@ -0,0 +1,56 @@
+//
+// Created by roel on 10/19/26.
+//
+
+
+#pragma once
+
+#include <vector>
+#include <string>
+
+#include "ActionRunner.h"
+#include "OutputCollector.h"
+
+/*
+ * Runs the command of an action as a child process, after creating the
+ * directories of its outputs.
+ *
+ * Processes are started with posix_spawn, which does not copy the page tables
+ * of this process the way fork does. Their stdout and stderr go to a pipe, of
+ * which the output is returned as a whole, so the output of actions that run
+ * at the same time is never interleaved. Their stdin is /dev/null.
+ */
+class ProcessActionRunner : public ActionRunner {
+public:
+    /*
+     * Runs actions in the environment of this process.
+     */
+    ProcessActionRunner();
+
+    /*
+     * Runs actions in the given environment only ("NAME=value" entries).
+     */
+    explicit ProcessActionRunner(std::vector<std::string> environment);
+
+    Result run(const Action &action) override;
+
+    /*
+     * Returns the entries of the environment of this process for the given
+     * variables, in the same order, skipping the variables that are not set.
+     */
+    static std::vector<std::string> inherit_environment(const std::vector<std::string> &names);
+
+    /*
+     * Creates the directories of the outputs of an action. On failure the
+     * result is set to an error and false is returned.
+     */
+    static bool create_output_directories(const Action &action, Result &result);
+
+    // Output beyond this is dropped
+    static constexpr size_t max_output_size = 4 * 1024 * 1024;
+
+private:
+    std::vector<std::string> environment;
+    const bool inherit;
+    OutputCollector output_collector;
+};
@@ -0,0 +1,490 @@
+//
+// Created by roel on 10/19/26.
+//
+
+#include "PythonUnitLoader.h"
+#include "util/Socket.h"
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char **environ;
+
+static constexpr uint32_t max_frame_size = 256 * 1024 * 1024;
+
+/*
+ * Runs in the helper process, with the root directory as argument. Every
+ * operation of a batch is decoded before any of them runs, so a failing
+ * operation does not affect the others.
+ */
+static const char *helper_source = R"(
+import importlib.util, inspect, os, struct, sys, traceback
+
+def read_exact(size):
+    data = bytearray()
+    while len(data) < size:
+        chunk = os.read(3, size - len(data))
+        if not chunk:
+            return None
+        data += chunk
+    return bytes(data)
+
+def write_all(data):
+    view = memoryview(data)
+    while view:
+        view = view[os.write(3, view):]
+
+class Reader:
+    def __init__(self, data):
+        self.data = data
+        self.offset = 0
+
+    def tag(self):
+        self.offset += 1
+        return self.data[self.offset - 1:self.offset]
+
+    def u32(self):
+        self.offset += 4
+        return struct.unpack_from('<I', self.data, self.offset - 4)[0]
+
+    def string(self):
+        size = self.u32()
+        self.offset += size
+        return self.data[self.offset - size:self.offset].decode()
+
+    def value(self):
+        tag = self.tag()
+        if tag == b'N':
+            return None
+        if tag == b'S':
+            return self.string()
+        if tag == b'L':
+            return [self.value() for _ in range(self.u32())]
+        if tag == b'D':
+            return {self.string(): self.value() for _ in range(self.u32())}
+        raise ValueError('Unknown value tag %r' % tag)
+
+def put_string(out, value):
+    data = value.encode()
+    out += struct.pack('<I', len(data))
+    out += data
+
+def put_value(out, value):
+    if value is None:
+        out += b'N'
+    elif isinstance(value, str):
+        out += b'S'
+        put_string(out, value)
+    elif isinstance(value, (int, float)) and not isinstance(value, bool):
+        out += b'S'
+        put_string(out, str(value))
+    elif isinstance(value, (list, tuple)):
+        out += b'L' + struct.pack('<I', len(value))
+        for entry in value:
+            put_value(out, entry)
+    elif isinstance(value, dict):
+        out += b'D' + struct.pack('<I', len(value))
+        for key, entry in value.items():
+            if not isinstance(key, str):
+                raise TypeError('Struct keys must be strings, not %s' % type(key).__name__)
+            put_string(out, key)
+            put_value(out, entry)
+    else:
+        raise TypeError('Cannot return a %s to mkr' % type(value).__name__)
+
+units = {}
+
+def import_unit(unit, path):
+    spec = importlib.util.spec_from_file_location('mkr_unit_%d' % unit, path)
+    module = importlib.util.module_from_spec(spec)
+    spec.loader.exec_module(module)
+    units[unit] = module
+    return sorted(name for name, value in vars(module).items()
+                  if not name.startswith('_') and inspect.isfunction(value) and value.__module__ == module.__name__)
+
+def forget_unit(unit):
+    units.pop(unit, None)
+
+def call(unit, name, args, kwargs):
+    return getattr(units[unit], name)(*args, **kwargs)
+
+def read_operation(reader):
+    kind = reader.tag()
+    unit = reader.u32()
+    if kind == b'I':
+        return import_unit, (unit, reader.string())
+    if kind == b'F':
+        return forget_unit, (unit,)
+    name = reader.string()
+    args = [reader.value() for _ in range(reader.u32())]
+    kwargs = {reader.string(): reader.value() for _ in range(reader.u32())}
+    return call, (unit, name, args, kwargs)
+
+sys.path.insert(0, sys.argv[1])
+while True:
+    header = read_exact(4)
+    if header is None:
+        break
+    reader = Reader(read_exact(struct.unpack('<I', header)[0]))
+    operations = [read_operation(reader) for _ in range(reader.u32())]
+    out = bytearray(struct.pack('<I', len(operations)))
+    for function, args in operations:
+        result = bytearray(b'+')
+        try:
+            put_value(result, function(*args))
+        except Exception:
+            result = bytearray(b'-')
+            put_value(result, traceback.format_exc().rstrip())
+        out += result
+    write_all(struct.pack('<I', len(out)) + out)
+)";
+
+static void append_string(std::string &buffer, const std::string &value) {
+    append_u32(buffer, static_cast<uint32_t>(value.size()));
+    buffer += value;
+}
+
+/*
+ * PythonUnitLoader::FunctionHandler::*
+ */
+
+PythonUnitLoader::FunctionHandler::FunctionHandler(PythonUnitLoader &loader_, uint32_t unit_, std::string name_) :
+        loader(loader_),
+        unit(unit_),
+        name(std::move(name_)) {}
+
+CallResult PythonUnitLoader::FunctionHandler::call(const CallArgList &arguments) const {
+    return loader.call(unit, name, arguments);
+}
+
+bool PythonUnitLoader::FunctionHandler::operator==(const CallHandler &rhs) const {
+    return this == &rhs;
+}
+
+bool PythonUnitLoader::FunctionHandler::is_pure() const {
+    return false;
+}
+
+/*
+ * PythonUnitLoader::*
+ */
+
+PythonUnitLoader::PythonUnitLoader(ObjectStore &object_store_, std::string root_dir_, std::string python_) :
+        object_store(object_store_),
+        root_dir(std::move(root_dir_)),
+        python(std::move(python_)),
+        mutex(),
+        pid(-1),
+        fd(-1),
+        started(0),
+        next_unit(0),
+        unit_paths(),
+        units(),
+        handlers() {}
+
+PythonUnitLoader::~PythonUnitLoader() {
+    stop();
+}
+
+unsigned int PythonUnitLoader::helpers_started() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return started;
+}
+
+const Object &PythonUnitLoader::load(const std::string &import_spec) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto it = units.find(import_spec);
+    if (it != units.end()) return *it->second.object;
+
+    const uint32_t unit = next_unit;
+    const std::string path = root_dir + "/" + import_spec;
+    std::vector<Response> responses;
+    try {
+        responses = request({import_operation(unit, path)});
+    } catch (const HelperError &e) {
+        throw ExternalObjectError(e.what());
+    }
+    if (!responses.front().value) {
+        throw ExternalObjectError("Cannot import '" + import_spec + "':\n" + responses.front().error);
+    }
+    next_unit++;
+    unit_paths.emplace(unit, path);
+
+    std::unordered_map<std::string, const Object &> functions;
+    for (const Object &name: responses.front().value->entries()) {
+        FunctionHandler &handler = handlers.emplace_back(*this, unit, name.get_string());
+        functions.emplace(name.get_string(), object_store.create_function(handler));
+    }
+    const Object &object = object_store.create_struct(functions);
+    units.emplace(import_spec, Unit{unit, &object});
+    return object;
+}
+
+void PythonUnitLoader::forget(const std::string &import_spec) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = units.find(import_spec);
+    if (it == units.end()) return;
+    const uint32_t unit = it->second.number;
+    units.erase(it);
+    unit_paths.erase(unit);
+
+    // A helper that is started later does not import the unit at all
+    if (fd < 0) return;
+    std::string operation = "F";
+    append_u32(operation, unit);
+    try {
+        [[maybe_unused]] const std::vector<Response> responses = exchange({operation});
+    } catch (const HelperError &) {
+        stop();
+    }
+}
+
+void PythonUnitLoader::start() {
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) != 0) {
+        throw HelperError(std::string("Cannot create a socket: ") + strerror(errno));
+    }
+
+    std::vector<char *> argv = {
+            const_cast<char *>(python.c_str()),
+            const_cast<char *>("-c"),
+            const_cast<char *>(helper_source),
+            const_cast<char *>(root_dir.c_str()),
+            nullptr,
+    };
+
+    posix_spawn_file_actions_t file_actions;
+    posix_spawn_file_actions_init(&file_actions);
+    posix_spawn_file_actions_addopen(&file_actions, 0, "/dev/null", O_RDONLY, 0);
+    posix_spawn_file_actions_adddup2(&file_actions, 2, 1);
+    posix_spawn_file_actions_adddup2(&file_actions, fds[1], 3);
+
+    const int spawn_error = posix_spawnp(&pid, argv.front(), &file_actions, nullptr, argv.data(), environ);
+    posix_spawn_file_actions_destroy(&file_actions);
+    close(fds[1]);
+    if (spawn_error) {
+        close(fds[0]);
+        pid = -1;
+        throw HelperError("Cannot start '" + python + "': " + strerror(spawn_error));
+    }
+    fd = fds[0];
+    started++;
+}
+
+void PythonUnitLoader::stop() {
+    if (fd < 0) return;
+    // Closing the socket asks the helper to exit
+    close(fd);
+    int status;
+    while (waitpid(pid, &status, 0) < 0 && errno == EINTR) {}
+    fd = -1;
+    pid = -1;
+}
+
+std::vector<PythonUnitLoader::Response> PythonUnitLoader::request(const std::vector<std::string> &operations) {
+    for (int attempt = 0;; attempt++) {
+        try {
+            if (fd < 0) {
+                start();
+                std::vector<std::string> imports;
+                for (const auto &[unit, path]: unit_paths) {
+                    imports.push_back(import_operation(unit, path));
+                }
+                if (!imports.empty()) {
+                    for (const Response &response: exchange(imports)) {
+                        if (!response.value) throw HelperError("Cannot import again:\n" + response.error);
+                    }
+                }
+            }
+            return exchange(operations);
+        } catch (const HelperError &) {
+            stop();
+            if (attempt > 0) throw;
+        }
+    }
+}
+
+std::vector<PythonUnitLoader::Response> PythonUnitLoader::exchange(const std::vector<std::string> &operations) const {
+    std::string frame;
+    append_u32(frame, 0);
+    append_u32(frame, static_cast<uint32_t>(operations.size()));
+    for (const std::string &operation: operations) {
+        frame += operation;
+    }
+    const uint32_t size = static_cast<uint32_t>(frame.size() - sizeof(uint32_t));
+    memcpy(frame.data(), &size, sizeof(size));
+
+    uint32_t response_size;
+    if (!send_all(fd, frame.data(), frame.size()) ||
+        !receive_all(fd, reinterpret_cast<char *>(&response_size), sizeof(response_size)) ||
+        response_size < sizeof(uint32_t) || response_size > max_frame_size) {
+        throw HelperError("Python helper stopped");
+    }
+    std::string body(response_size, '\0');
+    if (!receive_all(fd, body.data(), body.size())) {
+        throw HelperError("Python helper stopped");
+    }
+
+    uint32_t count;
+    memcpy(&count, body.data(), sizeof(count));
+    if (count != operations.size()) {
+        throw HelperError("Python helper sent the wrong number of results");
+    }
+
+    std::vector<Response> responses;
+    size_t offset = sizeof(count);
+    for (uint32_t i = 0; i < count; i++) {
+        if (offset >= body.size()) throw HelperError("Truncated response from the Python helper");
+        if (body[offset++] == '+') {
+            responses.push_back({&decode(body, offset), ""});
+        } else {
+            responses.push_back({nullptr, decode(body, offset).get_string()});
+        }
+    }
+    return responses;
+}
+
+CallResult PythonUnitLoader::call(uint32_t unit, const std::string &name, const CallArgList &arguments) {
+    CallResult result;
+
+    std::string operation = "C";
+    append_u32(operation, unit);
+    append_string(operation, name);
+    append_u32(operation, static_cast<uint32_t>(arguments.positional().size()));
+    for (const CallArg &arg: arguments.positional()) {
+        try {
+            encode(operation, arg.object());
+        } catch (const std::invalid_argument &e) {
+            result.add_arg_error(arg, e.what());
+        }
+    }
+    append_u32(operation, static_cast<uint32_t>(arguments.keywords().size()));
+    for (const auto &[keyword, arg]: arguments.keywords()) {
+        append_string(operation, keyword);
+        try {
+            encode(operation, arg.object());
+        } catch (const std::invalid_argument &e) {
+            result.add_arg_error(arg, e.what());
+        }
+    }
+    if (!result.success()) return result;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!unit_paths.contains(unit)) {
+        result.add_call_error("The unit of '" + name + "' was loaded again, its functions cannot be called anymore");
+        return result;
+    }
+    std::vector<Response> responses;
+    try {
+        responses = request({operation});
+    } catch (const HelperError &e) {
+        result.add_call_error(e.what());
+        return result;
+    }
+
+    if (!responses.front().value) {
+        result.add_call_error(responses.front().error);
+        return result;
+    }
+    result.set_return_value(*responses.front().value);
+    return result;
+}
+
+std::string PythonUnitLoader::import_operation(uint32_t unit, const std::string &path) {
+    std::string operation = "I";
+    append_u32(operation, unit);
+    append_string(operation, path);
+    return operation;
+}
+
+void PythonUnitLoader::encode(std::string &buffer, const Object &object) {
+    if (NullObject::is_null(object)) {
+        buffer += 'N';
+        return;
+    }
+
+    if (object.is_callable()) {
+        throw std::invalid_argument("Functions cannot be passed to Python");
+    }
+
+    try {
+        const std::string &value = object.get_string();
+        buffer += 'S';
+        append_string(buffer, value);
+        return;
+    } catch (const ObjectIsNotAString &) {
+        // not a string
+    }
+
+    const Object::Entries *entries = nullptr;
+    try {
+        entries = &object.entries();
+    } catch (const ObjectIsNotAList &) {
+        // not a list
+    }
+    if (entries) {
+        buffer += 'L';
+        append_u32(buffer, static_cast<uint32_t>(entries->size()));
+        for (const Object &entry: *entries) {
+            encode(buffer, entry);
+        }
+        return;
+    }
+
+    const Object::Attributes &attributes = object.attributes();
+    buffer += 'D';
+    append_u32(buffer, static_cast<uint32_t>(attributes.size()));
+    for (const auto &[key, value]: attributes) {
+        append_string(buffer, key);
+        encode(buffer, value);
+    }
+}
+
+const Object &PythonUnitLoader::decode(const std::string &data, size_t &offset) const {
+    auto read_u32 = [&]() {
+        if (data.size() - offset < sizeof(uint32_t)) throw HelperError("Truncated response from the Python helper");
+        uint32_t value;
+        memcpy(&value, data.data() + offset, sizeof(value));
+        offset += sizeof(value);
+        return value;
+    };
+    auto read_string = [&]() {
+        const uint32_t size = read_u32();
+        if (data.size() - offset < size) throw HelperError("Truncated response from the Python helper");
+        std::string value = data.substr(offset, size);
+        offset += size;
+        return value;
+    };
+
+    if (offset >= data.size()) throw HelperError("Truncated response from the Python helper");
+    const char tag = data[offset++];
+    switch (tag) {
+        case 'N':
+            return NullObject::get_instance();
+        case 'S':
+            return object_store.create_string(read_string());
+        case 'L': {
+            std::list<std::reference_wrapper<const Object>> entries;
+            for (uint32_t count = read_u32(); count > 0; count--) {
+                entries.emplace_back(decode(data, offset));
+            }
+            return object_store.create_list(entries);
+        }
+        case 'D': {
+            std::unordered_map<std::string, const Object &> attributes;
+            for (uint32_t count = read_u32(); count > 0; count--) {
+                std::string key = read_string();
+                attributes.emplace(std::move(key), decode(data, offset));
+            }
+            return object_store.create_struct(attributes);
+        }
+        default:
+            throw HelperError("Malformed response from the Python helper");
+    }
+}
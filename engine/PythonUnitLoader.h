@@ -0,0 +1,157 @@
+//
+// Created by roel on 10/19/26.
+//
+
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <list>
+#include <map>
+#include <unordered_map>
+#include <mutex>
+#include <cstdint>
+#include <sys/types.h>
+
+#include "interpreter/ExternalObjectLoader.h"
+
+/*
+ * Loads Python units (.py files relative to the root directory) in a single
+ * long-lived Python process, so that calling a function of a unit costs a
+ * round trip over a socket instead of starting Python. An imported unit is a
+ * struct of functions, one for every public function the unit defines:
+ *
+ *     tools = import("tools.py")
+ *     flags = tools.cflags("release")
+ *
+ * Functions take and return strings, lists, structs (dicts in Python) and
+ * null (None). Python results that are numbers are converted to strings.
+ *
+ * The helper process reads requests from fd 3, its stdout goes to stderr so
+ * that units can print. Frames are batches of operations:
+ *
+ *     request    u32 size of the rest, u32 count, operations
+ *     response   u32 size of the rest, u32 count, results
+ *
+ *     operation  'I' u32 unit, string path      import a unit
+ *                'F' u32 unit                    forget a unit
+ *                'C' u32 unit, string function, u32 count, values,
+ *                u32 count, (string name, value)...   call a function
+ *     result     '+' value, or '-' value (the error message)
+ *     value      'N' | 'S' string | 'L' u32 count, values |
+ *                'D' u32 count, (string key, value)...
+ *     string     u32 length, bytes
+ *
+ * The result of an import is the list of function names. Integers are little
+ * endian. If the helper goes away it is restarted on the next call, and all
+ * units are imported again in one batch.
+ */
+class PythonUnitLoader : public ExternalObjectLoader {
+public:
+    PythonUnitLoader(ObjectStore &object_store, std::string root_dir, std::string python);
+
+    PythonUnitLoader(const PythonUnitLoader &) = delete;
+
+    PythonUnitLoader &operator=(const PythonUnitLoader &) = delete;
+
+    /*
+     * Stops the helper process.
+     */
+    ~PythonUnitLoader() override;
+
+    const Object &load(const std::string &import_spec) override;
+
+    /*
+     * The next load imports the unit in the helper again, under a new unit
+     * number. The helper drops the old unit, calls of its functions fail.
+     */
+    void forget(const std::string &import_spec) override;
+
+    /*
+     * The number of times the helper process was started.
+     */
+    [[nodiscard]] unsigned int helpers_started() const;
+
+private:
+    class FunctionHandler : public CallHandler {
+    public:
+        FunctionHandler(PythonUnitLoader &loader, uint32_t unit, std::string name);
+
+        [[nodiscard]] CallResult call(const CallArgList &arguments) const override;
+
+        [[nodiscard]] bool operator==(const CallHandler &rhs) const override;
+
+        /*
+         * Python functions may read files or keep state, so calls are not
+         * cached.
+         */
+        [[nodiscard]] bool is_pure() const override;
+
+    private:
+        PythonUnitLoader &loader;
+        const uint32_t unit;
+        const std::string name;
+    };
+
+    /*
+     * Thrown when the helper cannot be started or goes away.
+     */
+    class HelperError : public std::runtime_error {
+    public:
+        explicit HelperError(const std::string &message_) :
+                std::runtime_error(message_) {}
+    };
+
+    struct Unit {
+        uint32_t number;
+        const Object *object;
+    };
+
+    struct Response {
+        const Object *value;  // nullptr if the operation failed
+        std::string error;
+    };
+
+    ObjectStore &object_store;
+    const std::string root_dir;
+    const std::string python;
+
+    mutable std::mutex mutex;
+    pid_t pid;
+    int fd;
+    unsigned int started;
+    uint32_t next_unit;
+    // The paths of the units that are loaded, by number
+    std::map<uint32_t, std::string> unit_paths;
+    std::unordered_map<std::string, Unit> units;
+    std::list<FunctionHandler> handlers;
+
+    void start();
+
+    void stop();
+
+    /*
+     * Sends a batch of operations and returns their results, restarting the
+     * helper (and importing all units again) if it went away.
+     */
+    std::vector<Response> request(const std::vector<std::string> &operations);
+
+    [[nodiscard]] std::vector<Response> exchange(const std::vector<std::string> &operations) const;
+
+    [[nodiscard]] CallResult call(uint32_t unit, const std::string &name, const CallArgList &arguments);
+
+    [[nodiscard]] static std::string import_operation(uint32_t unit, const std::string &path);
+
+    /*
+     * Appends the encoding of an object, throws std::invalid_argument for
+     * objects that cannot be passed to Python.
+     */
+    static void encode(std::string &buffer, const Object &object);
+
+    /*
+     * Decodes the value at offset and moves offset past it, throws
+     * HelperError if the data is malformed.
+     */
+    [[nodiscard]] const Object &decode(const std::string &data, size_t &offset) const;
+};
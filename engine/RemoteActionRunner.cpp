@@ -0,0 +1,247 @@
+//
+// Created by roel on 10/19/26.
+//
+
+#include "RemoteActionRunner.h"
+
+#include <filesystem>
+#include <fstream>
+#include <unordered_map>
+#include <unordered_set>
+#include <unistd.h>
+
+/*
+ * The worker could be reached, but could not run the action.
+ */
+class WorkerError : public RemoteError {
+public:
+    explicit WorkerError(const std::string &message) :
+            RemoteError(message) {}
+};
+
+/*
+ * Closes the connection of an action when it is done.
+ */
+class Connection {
+public:
+    explicit Connection(const std::string &address_) :
+            address(address_),
+            fd(connect_to(address_)) {}
+
+    Connection(const Connection &) = delete;
+
+    Connection &operator=(const Connection &) = delete;
+
+    ~Connection() {
+        close(fd);
+    }
+
+    RemoteMessage request(const RemoteMessage &message) const {
+        if (!send_message(fd, message)) {
+            throw RemoteError("Lost the connection to '" + address + "'");
+        }
+        std::optional<RemoteMessage> response = receive_message(fd);
+        if (!response || response->empty()) {
+            throw RemoteError("Lost the connection to '" + address + "'");
+        }
+        if (response->front() != "ok") {
+            throw WorkerError(response->size() > 1 ? (*response)[1] : "Unknown error");
+        }
+        return std::move(*response);
+    }
+
+private:
+    const std::string &address;
+    const int fd;
+};
+
+RemoteActionRunner::RemoteActionRunner(ActionRunner &runner_, std::vector<std::string> addresses_,
+                                       std::vector<std::string> environment_, FileStateDb &file_states_) :
+        RemoteActionRunner(runner_, std::move(addresses_), std::move(environment_), file_states_, nullptr) {}
+
+RemoteActionRunner::RemoteActionRunner(ActionRunner &runner_, std::vector<std::string> addresses_,
+                                       std::vector<std::string> environment_, FileStateDb &file_states_,
+                                       DepsLog &deps_log_) :
+        RemoteActionRunner(runner_, std::move(addresses_), std::move(environment_), file_states_, &deps_log_) {}
+
+RemoteActionRunner::RemoteActionRunner(ActionRunner &runner_, std::vector<std::string> addresses_,
+                                       std::vector<std::string> environment_, FileStateDb &file_states_,
+                                       DepsLog *deps_log_) :
+        runner(runner_),
+        addresses(std::move(addresses_)),
+        environment(std::move(environment_)),
+        file_states(file_states_),
+        deps_log(deps_log_),
+        mutex(),
+        unreachable(addresses.size(), false),
+        remote_runs(0) {}
+
+ActionRunner::Result RemoteActionRunner::run(const Action &action) {
+    const std::optional<std::vector<Input>> inputs = remote_inputs(action);
+    std::optional<size_t> worker = inputs ? route(action) : std::nullopt;
+    if (!worker) return runner.run(action);
+
+    std::string error;
+    try {
+        Result result = run_remotely(addresses[*worker], action, *inputs);
+        std::lock_guard<std::mutex> lock(mutex);
+        remote_runs++;
+        return result;
+    } catch (const WorkerError &e) {
+        error = "Worker '" + addresses[*worker] + "' cannot run the action, running it here: " + e.what() + "\n";
+    } catch (const RemoteError &e) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!unreachable[*worker]) {
+            error = std::string(e.what()) + ", no longer using it\n";
+        }
+        unreachable[*worker] = true;
+    }
+
+    Result result = runner.run(action);
+    result.output = error + result.output;
+    return result;
+}
+
+unsigned int RemoteActionRunner::remote_count() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return remote_runs;
+}
+
+std::optional<std::vector<RemoteActionRunner::Input>> RemoteActionRunner::remote_inputs(const Action &action) const {
+    if (action.outputs.empty() || !action.worker.empty() || action.command.empty()) return std::nullopt;
+
+    std::vector<std::string> paths = action.inputs;
+    if (!action.depfile.empty()) {
+        const std::optional<std::vector<std::string>> discovered = deps_log ? deps_log->get(action.depfile) :
+                                                                   std::nullopt;
+        if (!discovered) return std::nullopt;
+        paths.insert(paths.end(), discovered->begin(), discovered->end());
+    }
+    // A command in the tree, such as a script
+    if (action.command.front().find('/') != std::string::npos) {
+        paths.push_back(action.command.front());
+    }
+
+    std::vector<Input> inputs;
+    std::unordered_set<std::string> seen;
+    for (const std::string &path: paths) {
+        if (!is_relative_below(path)) continue;
+        const std::string normal_path = std::filesystem::path(path).lexically_normal().string();
+        if (!seen.insert(normal_path).second) continue;
+
+        // Missing inputs make the action fail, which it does here
+        const std::optional<Digest> digest = file_states.hash(path);
+        if (!digest) return std::nullopt;
+
+        std::error_code error;
+        const auto perms = std::filesystem::status(path, error).permissions();
+        inputs.push_back({normal_path, digest->to_string(),
+                          (perms & std::filesystem::perms::owner_exec) != std::filesystem::perms::none});
+    }
+    return inputs;
+}
+
+std::optional<size_t> RemoteActionRunner::route(const Action &action) const {
+    const size_t start = std::hash<std::string>()(action.id) % addresses.size();
+    std::lock_guard<std::mutex> lock(mutex);
+    for (size_t i = 0; i < addresses.size(); i++) {
+        const size_t index = (start + i) % addresses.size();
+        if (!unreachable[index]) return index;
+    }
+    return std::nullopt;
+}
+
+static std::string read_file(const std::string &path) {
+    std::ifstream stream(path, std::ios::binary);
+    if (!stream) throw WorkerError("Cannot read '" + path + "'");
+    return {std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>()};
+}
+
+/*
+ * Writes the contents next to the path and renames the file in place, so
+ * that readers never see a partial output.
+ */
+static void write_output(const std::string &path, const std::string &contents, bool executable) {
+    std::error_code error;
+    std::filesystem::create_directories(std::filesystem::path(path).parent_path(), error);
+    const std::string temp_path = path + ".download";
+    {
+        std::ofstream stream(temp_path, std::ios::binary | std::ios::trunc);
+        stream.write(contents.data(), static_cast<std::streamsize>(contents.size()));
+        if (!stream.flush()) throw WorkerError("Cannot write '" + path + "'");
+    }
+    if (executable) {
+        std::filesystem::permissions(temp_path, std::filesystem::perms::owner_exec |
+                                                std::filesystem::perms::group_exec |
+                                                std::filesystem::perms::others_exec,
+                                     std::filesystem::perm_options::add, error);
+    }
+    std::filesystem::rename(temp_path, path, error);
+    if (error) throw WorkerError("Cannot write '" + path + "': " + error.message());
+}
+
+ActionRunner::Result RemoteActionRunner::run_remotely(const std::string &address, const Action &action,
+                                                      const std::vector<Input> &inputs) {
+    Connection connection(address);
+
+    RemoteMessage missing_request = {"missing"};
+    std::unordered_map<std::string, const Input *> by_digest;
+    for (const Input &input: inputs) {
+        if (by_digest.emplace(input.digest, &input).second) missing_request.push_back(input.digest);
+    }
+    const RemoteMessage missing = connection.request(missing_request);
+    for (size_t i = 1; i < missing.size(); i++) {
+        auto it = by_digest.find(missing[i]);
+        if (it == by_digest.end()) continue;
+        connection.request({"put", missing[i], read_file(it->second->path)});
+    }
+
+    // The depfile is downloaded as one of the outputs
+    std::vector<std::string> outputs = action.outputs;
+    if (!action.depfile.empty()) outputs.push_back(action.depfile);
+
+    RemoteMessage run_request = {"run", std::to_string(environment.size())};
+    run_request.insert(run_request.end(), environment.begin(), environment.end());
+    run_request.push_back(std::to_string(action.command.size()));
+    run_request.insert(run_request.end(), action.command.begin(), action.command.end());
+    run_request.push_back(std::to_string(inputs.size()));
+    for (const Input &input: inputs) {
+        run_request.insert(run_request.end(), {input.path, input.digest, input.executable ? "x" : ""});
+    }
+    run_request.push_back(std::to_string(outputs.size()));
+    for (const std::string &output: outputs) {
+        if (!is_relative_below(output)) throw WorkerError("Output '" + output + "' is not below the root directory");
+        run_request.push_back(output);
+    }
+
+    const RemoteMessage response = connection.request(run_request);
+    if (response.size() != 3 + 2 * outputs.size()) {
+        throw WorkerError("Malformed response to a run request");
+    }
+
+    Result result;
+    try {
+        result.exit_code = std::stoi(response[1]);
+    } catch (const std::logic_error &) {
+        throw WorkerError("Malformed exit code '" + response[1] + "'");
+    }
+    result.output = response[2];
+
+    for (size_t i = 0; i < outputs.size(); i++) {
+        const std::string &digest = response[3 + 2 * i];
+        const bool executable = response[4 + 2 * i] == "x";
+        std::error_code error;
+        if (digest.empty()) {
+            // Not written by this run
+            std::filesystem::remove(outputs[i], error);
+            continue;
+        }
+
+        const std::optional<Digest> current = file_states.hash(outputs[i]);
+        if (current && current->to_string() == digest) continue;
+        const RemoteMessage blob = connection.request({"get", digest});
+        if (blob.size() != 2) throw WorkerError("Malformed response to a get request");
+        write_output(outputs[i], blob[1], executable);
+    }
+    return result;
+}
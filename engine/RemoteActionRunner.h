@@ -0,0 +1,82 @@
+//
+// Created by roel on 10/19/26.
+//
+
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <mutex>
+
+#include "ActionRunner.h"
+#include "DepsLog.h"
+#include "FileStateDb.h"
+#include "RemoteProtocol.h"
+
+/*
+ * Runs actions on remote workers (see RemoteWorker). Every action goes to the
+ * worker its id hashes to, over a connection of its own: the inputs the
+ * worker does not have yet are uploaded by their digest, the action runs and
+ * its outputs are downloaded to their paths here.
+ *
+ * Inputs are the declared inputs, and for actions with a depfile the inputs
+ * it listed the last time. Only relative paths below the root directory are
+ * shipped, others (such as system headers) are expected on the worker.
+ *
+ * Other actions run on the wrapped runner: actions without outputs (which
+ * are run for their side effects here), actions for a persistent worker, and
+ * actions with a depfile of which the inputs are not known yet. So are
+ * actions of which the worker fails, and a worker that cannot be reached is
+ * not used again.
+ */
+class RemoteActionRunner : public ActionRunner {
+public:
+    RemoteActionRunner(ActionRunner &runner, std::vector<std::string> addresses,
+                       std::vector<std::string> environment, FileStateDb &file_states);
+
+    RemoteActionRunner(ActionRunner &runner, std::vector<std::string> addresses,
+                       std::vector<std::string> environment, FileStateDb &file_states, DepsLog &deps_log);
+
+    Result run(const Action &action) override;
+
+    /*
+     * The number of actions that ran remotely.
+     */
+    [[nodiscard]] unsigned int remote_count() const;
+
+private:
+    struct Input {
+        std::string path;
+        std::string digest;
+        bool executable;
+    };
+
+    ActionRunner &runner;
+    const std::vector<std::string> addresses;
+    const std::vector<std::string> environment;
+    FileStateDb &file_states;
+    DepsLog *deps_log;
+
+    mutable std::mutex mutex;
+    std::vector<bool> unreachable;
+    unsigned int remote_runs;
+
+    RemoteActionRunner(ActionRunner &runner, std::vector<std::string> addresses,
+                       std::vector<std::string> environment, FileStateDb &file_states, DepsLog *deps_log);
+
+    /*
+     * The inputs to ship, or nothing if the action cannot run remotely.
+     */
+    [[nodiscard]] std::optional<std::vector<Input>> remote_inputs(const Action &action) const;
+
+    /*
+     * The worker for the action, or nothing if none can be reached.
+     */
+    [[nodiscard]] std::optional<size_t> route(const Action &action) const;
+
+    /*
+     * Throws RemoteError if the worker fails.
+     */
+    Result run_remotely(const std::string &address, const Action &action, const std::vector<Input> &inputs);
+};
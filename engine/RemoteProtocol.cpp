@@ -0,0 +1,173 @@
+//
+// Created by roel on 10/19/26.
+//
+
+#include "RemoteProtocol.h"
+#include "util/Socket.h"
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+static constexpr uint32_t max_field_count = 1024 * 1024;
+static constexpr uint32_t max_field_size = 1024 * 1024 * 1024;
+
+bool send_message(int fd, const RemoteMessage &message) {
+    // Small fields go out together with their header
+    std::string buffer;
+    append_u32(buffer, static_cast<uint32_t>(message.size()));
+    for (const std::string &field: message) {
+        append_u32(buffer, static_cast<uint32_t>(field.size()));
+        if (field.size() < 64 * 1024) {
+            buffer += field;
+            continue;
+        }
+        if (!send_all(fd, buffer.data(), buffer.size()) || !send_all(fd, field.data(), field.size())) return false;
+        buffer.clear();
+    }
+    return send_all(fd, buffer.data(), buffer.size());
+}
+
+std::optional<RemoteMessage> receive_message(int fd) {
+    uint32_t count;
+    if (!receive_all(fd, reinterpret_cast<char *>(&count), sizeof(count)) || count > max_field_count) {
+        return std::nullopt;
+    }
+
+    RemoteMessage message(count);
+    for (std::string &field: message) {
+        uint32_t size;
+        if (!receive_all(fd, reinterpret_cast<char *>(&size), sizeof(size)) || size > max_field_size) {
+            return std::nullopt;
+        }
+        field.resize(size);
+        if (!receive_all(fd, field.data(), field.size())) return std::nullopt;
+    }
+    return message;
+}
+
+static bool is_unix_address(const std::string &address) {
+    return address.find('/') != std::string::npos;
+}
+
+static sockaddr_un unix_address(const std::string &path) {
+    if (path.size() >= sizeof(sockaddr_un::sun_path)) {
+        throw RemoteError("Socket path '" + path + "' is too long");
+    }
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    memcpy(address.sun_path, path.c_str(), path.size() + 1);
+    return address;
+}
+
+/*
+ * Resolves HOST:PORT, or :PORT for all addresses of this machine when
+ * listening.
+ */
+static addrinfo *tcp_addresses(const std::string &address, bool listening) {
+    const size_t colon = address.rfind(':');
+    if (colon == std::string::npos) {
+        throw RemoteError("Address '" + address + "' is not a socket path or HOST:PORT");
+    }
+    const std::string host = address.substr(0, colon);
+    const std::string port = address.substr(colon + 1);
+
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    if (listening) hints.ai_flags = AI_PASSIVE;
+
+    addrinfo *addresses = nullptr;
+    const int error = getaddrinfo(host.empty() ? nullptr : host.c_str(), port.c_str(), &hints, &addresses);
+    if (error) {
+        throw RemoteError("Cannot resolve '" + address + "': " + gai_strerror(error));
+    }
+    return addresses;
+}
+
+int connect_to(const std::string &address) {
+    if (is_unix_address(address)) {
+        const sockaddr_un socket_address = unix_address(address);
+        const int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd >= 0 && connect(fd, reinterpret_cast<const sockaddr *>(&socket_address), sizeof(socket_address)) == 0) {
+            return fd;
+        }
+        const std::string error = strerror(errno);
+        if (fd >= 0) close(fd);
+        throw RemoteError("Cannot connect to '" + address + "': " + error);
+    }
+
+    addrinfo *addresses = tcp_addresses(address, false);
+    std::string error = "no addresses";
+    for (const addrinfo *info = addresses; info; info = info->ai_next) {
+        const int fd = socket(info->ai_family, info->ai_socktype | SOCK_CLOEXEC, info->ai_protocol);
+        if (fd < 0) continue;
+        if (connect(fd, info->ai_addr, info->ai_addrlen) == 0) {
+            // Requests are small and answered before the next is sent
+            const int enable = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+            freeaddrinfo(addresses);
+            return fd;
+        }
+        error = strerror(errno);
+        close(fd);
+    }
+    freeaddrinfo(addresses);
+    throw RemoteError("Cannot connect to '" + address + "': " + error);
+}
+
+int listen_on(const std::string &address) {
+    int fd;
+    if (is_unix_address(address)) {
+        const sockaddr_un socket_address = unix_address(address);
+        fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        unlink(address.c_str());
+        if (fd >= 0 && bind(fd, reinterpret_cast<const sockaddr *>(&socket_address), sizeof(socket_address)) != 0) {
+            close(fd);
+            fd = -1;
+        }
+    } else {
+        addrinfo *addresses = tcp_addresses(address, true);
+        fd = -1;
+        for (const addrinfo *info = addresses; info && fd < 0; info = info->ai_next) {
+            fd = socket(info->ai_family, info->ai_socktype | SOCK_CLOEXEC, info->ai_protocol);
+            if (fd < 0) continue;
+            const int enable = 1;
+            setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+            if (bind(fd, info->ai_addr, info->ai_addrlen) != 0) {
+                close(fd);
+                fd = -1;
+            }
+        }
+        freeaddrinfo(addresses);
+    }
+
+    if (fd < 0 || listen(fd, 64) != 0) {
+        const std::string error = strerror(errno);
+        if (fd >= 0) close(fd);
+        throw RemoteError("Cannot listen on '" + address + "': " + error);
+    }
+    return fd;
+}
+
+bool is_digest(const std::string &str) {
+    if (str.empty() || str.size() > 64) return false;
+    for (char c: str) {
+        if (!((c >= '0' && c <= '9') || (c >= 'a' && c <= 'f'))) return false;
+    }
+    return true;
+}
+
+bool is_relative_below(const std::string &path) {
+    const std::filesystem::path normal = std::filesystem::path(path).lexically_normal();
+    if (normal.empty() || normal.is_absolute()) return false;
+    const std::string first = normal.begin()->string();
+    return first != ".." && first != ".";
+}
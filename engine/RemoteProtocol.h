@@ -0,0 +1,80 @@
+//
+// Created by roel on 10/19/26.
+//
+
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <optional>
+#include <stdexcept>
+
+/*
+ * The protocol between RemoteActionRunner and RemoteWorker. A connection
+ * carries requests, each answered by one response, and both are messages:
+ *
+ *     message    u32 number of fields, and for every field: u32 length, bytes
+ *
+ * Integers are little endian. The first field of a request names it, the
+ * first field of a response is "ok" or "error" followed by a description.
+ * Blobs (file contents) are identified by their digest, as a string:
+ *
+ *     missing DIGEST...    ok DIGEST...    the blobs the worker does not have
+ *     put DIGEST BYTES     ok              stores a blob
+ *     get DIGEST           ok BYTES        fetches a blob
+ *     run ...              ok ...          runs an action, see below
+ *
+ * A run request consists of counted lists: "run", the number of environment
+ * variables and the variables, the number of command arguments and the
+ * arguments, the number of inputs and for every input its path, digest and
+ * mode, and the number of outputs and their paths. Its response has the
+ * exit code, the output of the command and for every output its digest and
+ * mode, or an empty digest if it was not written. Paths are relative to the
+ * directory the action runs in, modes are "x" for executable files and ""
+ * otherwise.
+ *
+ * Addresses are paths of Unix domain sockets if they contain a '/', and
+ * HOST:PORT for TCP otherwise.
+ */
+using RemoteMessage = std::vector<std::string>;
+
+/*
+ * Returns false if the connection failed.
+ */
+bool send_message(int fd, const RemoteMessage &message);
+
+/*
+ * Returns nothing if the connection failed or was closed, or if the message
+ * is larger than any message sent.
+ */
+std::optional<RemoteMessage> receive_message(int fd);
+
+/*
+ * Connects to the address, throws RemoteError if that fails.
+ */
+int connect_to(const std::string &address);
+
+/*
+ * Listens on the address, throws RemoteError if that fails. A socket file
+ * left behind is replaced.
+ */
+int listen_on(const std::string &address);
+
+/*
+ * Whether the string has the form of a digest, so it can be used as a file
+ * name.
+ */
+bool is_digest(const std::string &str);
+
+/*
+ * Whether the path is relative and stays below the directory it is relative
+ * to. Such paths are shipped, others are expected to exist on the worker.
+ */
+bool is_relative_below(const std::string &path);
+
+class RemoteError : public std::runtime_error {
+public:
+    explicit RemoteError(const std::string &message) :
+            std::runtime_error(message) {}
+};
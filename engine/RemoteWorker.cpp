@@ -0,0 +1,284 @@
+//
+// Created by roel on 10/19/26.
+//
+
+#include "RemoteWorker.h"
+#include "ProcessActionRunner.h"
+#include "hash/Blake3.h"
+
+#include <cerrno>
+#include <csignal>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/prctl.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// Clients that stop sending requests are dropped after this
+static constexpr time_t request_timeout_seconds = 60;
+
+static std::string absolute_dir(const std::string &dir) {
+    return std::filesystem::absolute(dir).lexically_normal().string();
+}
+
+RemoteWorker::RemoteWorker(const std::string &dir_, std::string address_) :
+        dir(absolute_dir(dir_)),
+        address(std::move(address_)),
+        listen_fd(listen_on(address)),
+        stop_fd(eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)),
+        processes() {
+    std::error_code error;
+    std::filesystem::create_directories(dir + "/blobs", error);
+    std::filesystem::create_directories(dir + "/exec", error);
+    if (error || stop_fd < 0) {
+        close(listen_fd);
+        if (stop_fd >= 0) close(stop_fd);
+        throw RemoteError("Cannot create the directories of the worker in '" + dir + "'");
+    }
+}
+
+RemoteWorker::~RemoteWorker() {
+    for (pid_t pid: processes) {
+        kill(pid, SIGTERM);
+    }
+    for (pid_t pid: processes) {
+        while (waitpid(pid, nullptr, 0) < 0 && errno == EINTR) {}
+    }
+    close(listen_fd);
+    close(stop_fd);
+    if (address.find('/') != std::string::npos) {
+        unlink(address.c_str());
+    }
+}
+
+void RemoteWorker::start(unsigned int process_count) {
+    const pid_t parent = getpid();
+    for (unsigned int i = 0; i < process_count; i++) {
+        const pid_t pid = fork();
+        if (pid < 0) {
+            throw RemoteError("Cannot start a worker process");
+        }
+        if (pid == 0) {
+            prctl(PR_SET_PDEATHSIG, SIGTERM);
+            if (getppid() != parent) _exit(0);
+            serve();
+        }
+        processes.push_back(pid);
+    }
+}
+
+void RemoteWorker::wait() {
+    pollfd fd{stop_fd, POLLIN, 0};
+    while (poll(&fd, 1, -1) < 0 && errno == EINTR) {}
+    uint64_t value;
+    [[maybe_unused]] const ssize_t count = read(stop_fd, &value, sizeof(value));
+}
+
+void RemoteWorker::stop() {
+    const uint64_t value = 1;
+    [[maybe_unused]] const ssize_t count = write(stop_fd, &value, sizeof(value));
+}
+
+void RemoteWorker::serve() {
+    signal(SIGINT, SIG_DFL);
+    signal(SIGTERM, SIG_DFL);
+    signal(SIGPIPE, SIG_IGN);
+
+    while (true) {
+        const int fd = accept4(listen_fd, nullptr, nullptr, SOCK_CLOEXEC);
+        if (fd < 0) continue;
+        handle(fd);
+        close(fd);
+    }
+}
+
+void RemoteWorker::handle(int fd) {
+    const timeval timeout{request_timeout_seconds, 0};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    while (std::optional<RemoteMessage> request = receive_message(fd)) {
+        if (!send_message(fd, respond(*request))) return;
+    }
+}
+
+static RemoteMessage error_response(const std::string &message) {
+    return {"error", message};
+}
+
+RemoteMessage RemoteWorker::respond(const RemoteMessage &request) {
+    if (request.empty()) return error_response("Empty request");
+    const std::string &type = request.front();
+
+    if (type == "missing") {
+        RemoteMessage response = {"ok"};
+        for (size_t i = 1; i < request.size(); i++) {
+            if (!is_digest(request[i])) return error_response("Not a digest: '" + request[i] + "'");
+            if (!std::filesystem::exists(blob_path(request[i]))) response.push_back(request[i]);
+        }
+        return response;
+    }
+
+    if (type == "put") {
+        if (request.size() != 3 || !is_digest(request[1])) return error_response("Malformed put request");
+        if (Blake3::hash(request[2].data(), request[2].size()).to_string() != request[1]) {
+            return error_response("The contents of blob " + request[1] + " do not match its digest");
+        }
+        if (!store(request[1], request[2])) return error_response("Cannot store blob " + request[1]);
+        return {"ok"};
+    }
+
+    if (type == "get") {
+        if (request.size() != 2 || !is_digest(request[1])) return error_response("Malformed get request");
+        std::ifstream stream(blob_path(request[1]), std::ios::binary);
+        if (!stream) return error_response("No blob " + request[1]);
+        return {"ok", std::string((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>())};
+    }
+
+    if (type == "run") {
+        try {
+            return run(request);
+        } catch (const RemoteError &e) {
+            return error_response(e.what());
+        }
+    }
+    return error_response("Unknown request '" + type + "'");
+}
+
+/*
+ * Reads the counted lists of a run request.
+ */
+class RunRequestReader {
+public:
+    explicit RunRequestReader(const RemoteMessage &request_) :
+            request(request_),
+            index(1) {}
+
+    const std::string &next() {
+        if (index >= request.size()) throw RemoteError("Malformed run request");
+        return request[index++];
+    }
+
+    size_t next_count() {
+        const std::string &count = next();
+        try {
+            const size_t value = std::stoul(count);
+            if (value <= request.size()) return value;
+        } catch (const std::logic_error &) {
+            // not a count
+        }
+        throw RemoteError("Malformed run request");
+    }
+
+    std::vector<std::string> next_list() {
+        std::vector<std::string> list(next_count());
+        for (std::string &entry: list) {
+            entry = next();
+        }
+        return list;
+    }
+
+    std::string next_path() {
+        const std::string &path = next();
+        if (!is_relative_below(path)) throw RemoteError("Path '" + path + "' is not below the directory");
+        return path;
+    }
+
+private:
+    const RemoteMessage &request;
+    size_t index;
+};
+
+RemoteMessage RemoteWorker::run(const RemoteMessage &request) {
+    RunRequestReader reader(request);
+    const std::vector<std::string> environment = reader.next_list();
+    Action action;
+    action.command = reader.next_list();
+    if (action.command.empty()) throw RemoteError("Run request without a command");
+
+    const std::string exec_dir = dir + "/exec/" + std::to_string(getpid());
+    std::error_code error;
+    std::filesystem::remove_all(exec_dir, error);
+    std::filesystem::create_directories(exec_dir, error);
+    if (error) throw RemoteError("Cannot create '" + exec_dir + "': " + error.message());
+
+    const size_t input_count = reader.next_count();
+    for (size_t i = 0; i < input_count; i++) {
+        const std::filesystem::path path = exec_dir + "/" + reader.next_path();
+        const std::string &digest = reader.next();
+        const bool executable = reader.next() == "x";
+        if (!is_digest(digest) || !std::filesystem::exists(blob_path(digest))) {
+            throw RemoteError("Missing blob " + digest + " for '" + path.string() + "'");
+        }
+
+        std::filesystem::create_directories(path.parent_path(), error);
+        if (executable) {
+            std::filesystem::copy_file(blob_path(digest), path, std::filesystem::copy_options::overwrite_existing,
+                                       error);
+            std::filesystem::permissions(path, std::filesystem::perms::owner_all, error);
+        } else if (link(blob_path(digest).c_str(), path.c_str()) != 0) {
+            std::filesystem::copy_file(blob_path(digest), path, std::filesystem::copy_options::overwrite_existing,
+                                       error);
+        }
+        if (error) throw RemoteError("Cannot create input '" + path.string() + "': " + error.message());
+    }
+
+    const size_t output_count = reader.next_count();
+    for (size_t i = 0; i < output_count; i++) {
+        action.outputs.push_back(reader.next_path());
+    }
+
+    // Worker processes run one action at a time, so they can change directory
+    if (chdir(exec_dir.c_str()) != 0) throw RemoteError("Cannot enter '" + exec_dir + "'");
+    const ActionRunner::Result result = ProcessActionRunner(environment).run(action);
+    [[maybe_unused]] const int chdir_result = chdir(dir.c_str());
+
+    RemoteMessage response = {"ok", std::to_string(result.exit_code), result.output};
+    for (const std::string &output: action.outputs) {
+        const std::string path = exec_dir + "/" + output;
+        const std::optional<std::string> digest = std::filesystem::is_regular_file(path, error) ?
+                                                  store_file(path) : std::nullopt;
+        const auto perms = std::filesystem::status(path, error).permissions();
+        response.push_back(digest.value_or(""));
+        response.emplace_back(digest && (perms & std::filesystem::perms::owner_exec) != std::filesystem::perms::none ?
+                              "x" : "");
+    }
+    return response;
+}
+
+std::string RemoteWorker::blob_path(const std::string &digest) const {
+    return dir + "/blobs/" + digest;
+}
+
+bool RemoteWorker::store(const std::string &digest, const std::string &contents) {
+    const std::string path = blob_path(digest);
+    if (std::filesystem::exists(path)) return true;
+
+    // Other processes may store the same blob, each writes a file of its own
+    const std::string temp_path = path + "." + std::to_string(getpid());
+    {
+        std::ofstream stream(temp_path, std::ios::binary | std::ios::trunc);
+        stream.write(contents.data(), static_cast<std::streamsize>(contents.size()));
+        if (!stream.flush()) {
+            unlink(temp_path.c_str());
+            return false;
+        }
+    }
+    std::error_code error;
+    std::filesystem::permissions(temp_path, std::filesystem::perms::owner_read | std::filesystem::perms::group_read |
+                                            std::filesystem::perms::others_read, error);
+    return rename(temp_path.c_str(), path.c_str()) == 0;
+}
+
+std::optional<std::string> RemoteWorker::store_file(const std::string &path) {
+    std::ifstream stream(path, std::ios::binary);
+    if (!stream) return std::nullopt;
+    const std::string contents((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+
+    const std::string digest = Blake3::hash(contents.data(), contents.size()).to_string();
+    if (!store(digest, contents)) return std::nullopt;
+    return digest;
+}
@@ -0,0 +1,92 @@
+//
+// Created by roel on 10/19/26.
+//
+
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <sys/types.h>
+
+#include "RemoteProtocol.h"
+
+/*
+ * Runs the actions of RemoteActionRunners on this machine. start() forks the
+ * processes that serve the connections, each of which handles a connection
+ * (a client opens one for every action) at a time, in a directory of its own:
+ *
+ *     DIR/blobs/DIGEST   the contents of inputs and outputs, read only
+ *     DIR/exec/PID/      where a process runs actions, emptied before each
+ *
+ * The inputs of an action are linked from the blobs to their paths below the
+ * directory it runs in (executable ones are copied), the outputs it wrote are
+ * added to the blobs afterwards. Commands get the environment the client
+ * sends, so tools are expected at the same place on all machines.
+ */
+class RemoteWorker {
+public:
+    /*
+     * Listens on the address, throws RemoteError if it cannot.
+     */
+    RemoteWorker(const std::string &dir, std::string address);
+
+    RemoteWorker(const RemoteWorker &) = delete;
+
+    RemoteWorker &operator=(const RemoteWorker &) = delete;
+
+    /*
+     * Stops the processes and stops listening.
+     */
+    ~RemoteWorker();
+
+    /*
+     * Starts the processes, which exit with the process that started them.
+     */
+    void start(unsigned int process_count);
+
+    /*
+     * Blocks until stop() is called.
+     */
+    void wait();
+
+    /*
+     * Makes wait() return. Safe to call from a signal handler.
+     */
+    void stop();
+
+private:
+    const std::string dir;
+    const std::string address;
+    const int listen_fd;
+
+    // Signalled to stop waiting
+    const int stop_fd;
+
+    std::vector<pid_t> processes;
+
+    /*
+     * Serves connections in a started process until it is killed.
+     */
+    [[noreturn]] void serve();
+
+    void handle(int fd);
+
+    RemoteMessage respond(const RemoteMessage &request);
+
+    RemoteMessage run(const RemoteMessage &request);
+
+    [[nodiscard]] std::string blob_path(const std::string &digest) const;
+
+    /*
+     * Adds contents to the blobs, unless they are already. Returns false if
+     * they cannot be written.
+     */
+    bool store(const std::string &digest, const std::string &contents);
+
+    /*
+     * Adds a file to the blobs and returns its digest, or nothing if it cannot
+     * be read.
+     */
+    std::optional<std::string> store_file(const std::string &path);
+};
@@ -0,0 +1,54 @@
+//
+// Created by roel on 10/19/26.
+//
+
+#include "Resources.h"
+
+#include <limits>
+#include <unistd.h>
+
+std::optional<uint64_t> parse_size(const std::string &str) {
+    size_t pos = 0;
+    uint64_t value = 0;
+    while (pos < str.size() && str[pos] >= '0' && str[pos] <= '9') {
+        if (value > std::numeric_limits<uint64_t>::max() / 10) return std::nullopt;
+        value = value * 10 + static_cast<uint64_t>(str[pos++] - '0');
+    }
+    if (pos == 0) return std::nullopt;
+    if (pos == str.size()) return value;
+    if (pos + 1 != str.size()) return std::nullopt;
+
+    unsigned int shift;
+    switch (str[pos]) {
+        case 'K':
+            shift = 10;
+            break;
+        case 'M':
+            shift = 20;
+            break;
+        case 'G':
+            shift = 30;
+            break;
+        case 'T':
+            shift = 40;
+            break;
+        default:
+            return std::nullopt;
+    }
+    if (value > (std::numeric_limits<uint64_t>::max() >> shift)) return std::nullopt;
+    return value << shift;
+}
+
+std::optional<unsigned int> parse_count(const std::string &str) {
+    const std::optional<uint64_t> value = parse_size(str);
+    if (!value || *value == 0 || *value > std::numeric_limits<unsigned int>::max()) return std::nullopt;
+    if (str.back() < '0' || str.back() > '9') return std::nullopt;
+    return static_cast<unsigned int>(*value);
+}
+
+uint64_t physical_memory() {
+    const long pages = sysconf(_SC_PHYS_PAGES);
+    const long page_size = sysconf(_SC_PAGE_SIZE);
+    if (pages <= 0 || page_size <= 0) return 0;
+    return static_cast<uint64_t>(pages) * static_cast<uint64_t>(page_size);
+}
@@ -0,0 +1,43 @@
+//
+// Created by roel on 10/19/26.
+//
+
+
+#pragma once
+
+#include <string>
+#include <optional>
+#include <cstdint>
+
+/*
+ * What an action needs while it runs, according to the build files. The
+ * executor only starts an action while all of it fits in what is left of
+ * the budgets of the machine.
+ */
+struct Resources {
+    // Name of the pool the action runs in, and how many actions of that pool
+    // may run at once; empty and 0 if the action is not in a pool
+    std::string pool;
+    unsigned int pool_depth = 0;
+
+    // In bytes, 0 if unknown
+    uint64_t memory = 0;
+
+    unsigned int cpus = 1;
+};
+
+/*
+ * Parses a number of bytes, optionally followed by K, M, G or T (powers of
+ * 1024). Returns nothing if the string is not a size.
+ */
+std::optional<uint64_t> parse_size(const std::string &str);
+
+/*
+ * Parses a positive number. Returns nothing if the string is not one.
+ */
+std::optional<unsigned int> parse_count(const std::string &str);
+
+/*
+ * The amount of physical memory of the machine, in bytes.
+ */
+uint64_t physical_memory();
@@ -0,0 +1,143 @@
+//
+// Created by roel on 10/19/26.
+//
+
+#include "SpeculativeActionRunner.h"
+
+#include <chrono>
+#include <optional>
+
+SpeculativeActionRunner::SpeculativeActionRunner(ActionRunner &runner_, unsigned int jobs) :
+        SpeculativeActionRunner(runner_, jobs, nullptr) {}
+
+SpeculativeActionRunner::SpeculativeActionRunner(ActionRunner &runner_, unsigned int jobs, Jobserver &jobserver_) :
+        SpeculativeActionRunner(runner_, jobs, &jobserver_) {}
+
+SpeculativeActionRunner::SpeculativeActionRunner(ActionRunner &runner_, unsigned int jobs, Jobserver *jobserver_) :
+        runner(runner_),
+        jobserver(jobserver_),
+        mutex(),
+        finished(),
+        stopped(false),
+        started_count(0),
+        graph(),
+        entries(),
+        indexes(),
+        pool(jobs) {}
+
+SpeculativeActionRunner::~SpeculativeActionRunner() {
+    stop();
+    pool.wait();
+}
+
+/*
+ * Whether an action may run before it is asked for.
+ */
+static bool is_speculative(const Action &action) {
+    const Resources &resources = action.resources;
+    return !action.outputs.empty() && resources.pool.empty() && resources.memory == 0 && resources.cpus <= 1;
+}
+
+void SpeculativeActionRunner::action_created(const Object &action) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (stopped) return;
+
+    try {
+        graph.add_target(action);
+    } catch (const std::exception &) {
+        // The executor reports invalid actions when they are asked for
+    }
+
+    // Including the dependencies added before an invalid action was found
+    for (size_t index = entries.size(); index < graph.size(); index++) {
+        const ActionGraph::Node &node = graph.node(index);
+        size_t remaining = 0;
+        for (size_t dependency: node.dependencies) {
+            const Entry &entry = entries[dependency];
+            if (entry.state != State::DONE || !entry.result.success()) remaining++;
+        }
+
+        entries.emplace_back().remaining = remaining;
+        indexes.emplace(node.action.id, index);
+        if (remaining == 0 && is_speculative(node.action)) {
+            start(index);
+        }
+    }
+}
+
+ActionRunner::Result SpeculativeActionRunner::run(const Action &action) {
+    std::unique_lock<std::mutex> lock(mutex);
+    auto it = indexes.find(action.id);
+    if (it != indexes.end()) {
+        const size_t index = it->second;
+        finished.wait(lock, [&] { return entries[index].state != State::RUNNING; });
+        if (entries[index].state == State::DONE) {
+            return entries[index].result;
+        }
+        entries[index].state = State::CLAIMED;
+    }
+    lock.unlock();
+
+    return runner.run(action);
+}
+
+void SpeculativeActionRunner::stop() {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopped = true;
+}
+
+unsigned int SpeculativeActionRunner::started() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return started_count;
+}
+
+void SpeculativeActionRunner::start(size_t index) {
+    entries[index].state = State::QUEUED;
+    pool.submit([this, index, action = graph.node(index).action] { run_started(index, action); });
+}
+
+void SpeculativeActionRunner::run_started(size_t index, const Action &action) {
+    // Actions the executor claimed, or that are no longer wanted, are dropped
+    // before and after waiting for a token
+    auto keep = [&](bool running) {
+        std::lock_guard<std::mutex> lock(mutex);
+        Entry &entry = entries[index];
+        if (entry.state != State::QUEUED) return false;
+        if (stopped) {
+            entry.state = State::WAITING;
+            return false;
+        }
+        if (running) {
+            entry.state = State::RUNNING;
+            started_count++;
+        }
+        return true;
+    };
+    if (!keep(false)) return;
+
+    std::optional<Jobserver::Token> token;
+    if (jobserver) token = jobserver->acquire();
+    if (!keep(true)) {
+        if (token) jobserver->release(*token);
+        return;
+    }
+
+    const auto start_time = std::chrono::steady_clock::now();
+    Result result = runner.run(action);
+    result.ran_for = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start_time);
+    if (token) jobserver->release(*token);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    entries[index].result = std::move(result);
+    entries[index].state = State::DONE;
+    finished.notify_all();
+
+    if (!entries[index].result.success() || stopped) return;
+    for (size_t dependent: graph.node(index).dependents) {
+        Entry &entry = entries[dependent];
+        if (--entry.remaining == 0 && entry.state == State::WAITING && is_speculative(graph.node(dependent).action)) {
+            start(dependent);
+        }
+    }
+}
@@ -0,0 +1,107 @@
+//
+// Created by roel on 10/19/26.
+//
+
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+#include <condition_variable>
+
+#include "util/WorkStealingPool.h"
+#include "ActionCallHandler.h"
+#include "ActionGraph.h"
+#include "ActionRunner.h"
+#include "Jobserver.h"
+
+/*
+ * Starts actions while the build files are still being interpreted, so that
+ * early units compile while later ones are evaluated. As a listener of the
+ * action() builtin it is given every action as it is created, complete, and
+ * runs it on the wrapped runner as soon as the actions it depends on
+ * succeeded.
+ *
+ * Only actions that produce outputs and declare no resources are started:
+ * actions without outputs are run for their side effects (tests, deploys),
+ * and budgets are for the executor to keep. Nothing is started after stop(),
+ * which is meant for when interpretation is done and the executor knows what
+ * is asked for.
+ *
+ * To the executor it is the runner of the build: actions that were started
+ * already give the result of that run, waiting for it if needed, the others
+ * run on the wrapped runner. An action that was started but is not asked for
+ * has still run, and is restored or up to date by the next build.
+ */
+class SpeculativeActionRunner : public ActionRunner, public ActionListener {
+public:
+    SpeculativeActionRunner(ActionRunner &runner, unsigned int jobs);
+
+    /*
+     * Takes a token of the jobserver for every action it starts.
+     */
+    SpeculativeActionRunner(ActionRunner &runner, unsigned int jobs, Jobserver &jobserver);
+
+    SpeculativeActionRunner(const SpeculativeActionRunner &) = delete;
+
+    SpeculativeActionRunner &operator=(const SpeculativeActionRunner &) = delete;
+
+    /*
+     * Waits for the actions that are running.
+     */
+    ~SpeculativeActionRunner() override;
+
+    void action_created(const Object &action) override;
+
+    Result run(const Action &action) override;
+
+    /*
+     * Starts no more actions. Those that are running continue.
+     */
+    void stop();
+
+    /*
+     * The number of actions started before they were asked for.
+     */
+    [[nodiscard]] unsigned int started() const;
+
+private:
+    enum class State {
+        WAITING,
+        QUEUED,
+        RUNNING,
+        DONE,
+        // Asked for before it was started, the executor runs it
+        CLAIMED,
+    };
+
+    struct Entry {
+        State state = State::WAITING;
+        // The dependencies that did not succeed yet
+        size_t remaining = 0;
+        Result result;
+    };
+
+    ActionRunner &runner;
+    Jobserver *jobserver;
+
+    mutable std::mutex mutex;
+    std::condition_variable finished;
+    bool stopped;
+    unsigned int started_count;
+
+    // The actions created so far, and for every node of the graph its entry
+    ActionGraph graph;
+    std::vector<Entry> entries;
+    std::unordered_map<std::string, size_t> indexes;
+
+    WorkStealingPool pool;
+
+    SpeculativeActionRunner(ActionRunner &runner, unsigned int jobs, Jobserver *jobserver);
+
+    void start(size_t index);
+
+    void run_started(size_t index, const Action &action);
+};
@@ -0,0 +1,25 @@
+//
+// Created by roel on 10/19/26.
+//
+
+#include "WorkerActionRunner.h"
+#include "ProcessActionRunner.h"
+
+#include <algorithm>
+
+WorkerActionRunner::WorkerActionRunner(ActionRunner &runner_, WorkerPool &workers_) :
+        runner(runner_),
+        workers(workers_) {}
+
+ActionRunner::Result WorkerActionRunner::run(const Action &action) {
+    const bool has_worker = !action.worker.empty() && action.worker.size() <= action.command.size() &&
+                            std::equal(action.worker.begin(), action.worker.end(), action.command.begin());
+    if (!has_worker) return runner.run(action);
+
+    Result result;
+    if (!ProcessActionRunner::create_output_directories(action, result)) return result;
+
+    const std::vector<std::string> arguments(
+            action.command.begin() + static_cast<std::ptrdiff_t>(action.worker.size()), action.command.end());
+    return workers.run(action.worker, arguments);
+}
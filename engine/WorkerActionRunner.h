@@ -0,0 +1,28 @@
+//
+// Created by roel on 10/19/26.
+//
+
+
+#pragma once
+
+#include "ActionRunner.h"
+#include "WorkerPool.h"
+
+/*
+ * Sends actions that declare a worker to a persistent worker, and runs all
+ * other actions on the wrapped runner.
+ *
+ * The command of such an action starts with the command of its worker, the
+ * rest of the command is sent as the request. Without workers the same
+ * command runs the tool once.
+ */
+class WorkerActionRunner : public ActionRunner {
+public:
+    WorkerActionRunner(ActionRunner &runner, WorkerPool &workers);
+
+    Result run(const Action &action) override;
+
+private:
+    ActionRunner &runner;
+    WorkerPool &workers;
+};
@@ -0,0 +1,166 @@
+//
+// Created by roel on 10/19/26.
+//
+
+#include "WorkerPool.h"
+#include "util/Socket.h"
+
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+static constexpr uint32_t max_frame_size = 256 * 1024 * 1024;
+
+WorkerPool::WorkerPool(std::vector<std::string> environment_, uint64_t max_memory_) :
+        environment(std::move(environment_)),
+        max_memory(max_memory_),
+        mutex(),
+        idle_workers(),
+        started(0) {}
+
+WorkerPool::~WorkerPool() {
+    for (const auto &[command, workers]: idle_workers) {
+        for (const Worker &worker: workers) {
+            stop(worker);
+        }
+    }
+}
+
+unsigned int WorkerPool::workers_started() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return started;
+}
+
+std::unique_ptr<WorkerPool::Worker> WorkerPool::start(const std::vector<std::string> &command, std::string &error) {
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) != 0) {
+        error = std::string("Cannot create a socket: ") + strerror(errno);
+        return nullptr;
+    }
+
+    std::vector<std::string> args = command;
+    args.emplace_back("--persistent_worker");
+    std::vector<char *> argv;
+    for (const std::string &arg: args) {
+        argv.push_back(const_cast<char *>(arg.c_str()));
+    }
+    argv.push_back(nullptr);
+
+    std::vector<char *> envp;
+    for (const std::string &entry: environment) {
+        envp.push_back(const_cast<char *>(entry.c_str()));
+    }
+    envp.push_back(nullptr);
+
+    posix_spawn_file_actions_t file_actions;
+    posix_spawn_file_actions_init(&file_actions);
+    posix_spawn_file_actions_adddup2(&file_actions, fds[1], 0);
+    posix_spawn_file_actions_adddup2(&file_actions, fds[1], 1);
+    posix_spawn_file_actions_addopen(&file_actions, 2, "/dev/null", O_WRONLY, 0);
+
+    pid_t pid;
+    const int spawn_error = posix_spawnp(&pid, argv.front(), &file_actions, nullptr, argv.data(), envp.data());
+    posix_spawn_file_actions_destroy(&file_actions);
+    close(fds[1]);
+    if (spawn_error) {
+        close(fds[0]);
+        error = "Cannot start worker '" + command.front() + "': " + strerror(spawn_error);
+        return nullptr;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        started++;
+    }
+    return std::make_unique<Worker>(Worker{pid, fds[0]});
+}
+
+void WorkerPool::stop(const Worker &worker) {
+    // Closing stdin asks the worker to exit
+    close(worker.fd);
+    int status;
+    while (waitpid(worker.pid, &status, 0) < 0 && errno == EINTR) {}
+}
+
+bool WorkerPool::request(const Worker &worker, const std::vector<std::string> &arguments,
+                         ActionRunner::Result &result) {
+    std::string frame;
+    append_u32(frame, 0);
+    for (const std::string &arg: arguments) {
+        append_u32(frame, static_cast<uint32_t>(arg.size()));
+        frame += arg;
+    }
+    const uint32_t size = static_cast<uint32_t>(frame.size() - sizeof(uint32_t));
+    memcpy(frame.data(), &size, sizeof(size));
+    if (!send_all(worker.fd, frame.data(), frame.size())) return false;
+
+    uint32_t response_size;
+    int32_t exit_code;
+    if (!receive_all(worker.fd, reinterpret_cast<char *>(&response_size), sizeof(response_size)) ||
+        response_size < sizeof(exit_code) || response_size > max_frame_size ||
+        !receive_all(worker.fd, reinterpret_cast<char *>(&exit_code), sizeof(exit_code))) {
+        return false;
+    }
+    result.exit_code = exit_code;
+    result.output.resize(response_size - sizeof(exit_code));
+    return receive_all(worker.fd, result.output.data(), result.output.size());
+}
+
+uint64_t WorkerPool::resident_memory(pid_t pid) {
+    // The second field is the resident set size in pages
+    std::ifstream statm("/proc/" + std::to_string(pid) + "/statm");
+    uint64_t size = 0, resident = 0;
+    if (!(statm >> size >> resident)) return 0;
+    return resident * static_cast<uint64_t>(sysconf(_SC_PAGE_SIZE));
+}
+
+ActionRunner::Result WorkerPool::run(const std::vector<std::string> &command,
+                                     const std::vector<std::string> &arguments) {
+    ActionRunner::Result result;
+
+    for (int attempt = 0; attempt < 2; attempt++) {
+        std::unique_ptr<Worker> worker;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            std::list<Worker> &workers = idle_workers[command];
+            if (!workers.empty()) {
+                worker = std::make_unique<Worker>(workers.front());
+                workers.pop_front();
+            }
+        }
+
+        if (!worker) {
+            std::string error;
+            worker = start(command, error);
+            if (!worker) {
+                result.exit_code = 127;
+                result.output = error + "\n";
+                return result;
+            }
+        }
+
+        result = ActionRunner::Result();
+        if (!request(*worker, arguments, result)) {
+            stop(*worker);
+            continue;
+        }
+
+        if (max_memory && resident_memory(worker->pid) > max_memory) {
+            stop(*worker);
+        } else {
+            std::lock_guard<std::mutex> lock(mutex);
+            idle_workers[command].push_back(*worker);
+        }
+        return result;
+    }
+
+    result = ActionRunner::Result();
+    result.exit_code = 1;
+    result.output = "Worker '" + command.front() + "' stopped while running the action\n";
+    return result;
+}
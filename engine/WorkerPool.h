@@ -0,0 +1,92 @@
+//
+// Created by roel on 10/19/26.
+//
+
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <list>
+#include <mutex>
+#include <memory>
+#include <cstdint>
+#include <sys/types.h>
+
+#include "ActionRunner.h"
+
+/*
+ * Long-lived tool processes (workers) that run many actions each, so the cost
+ * of starting a tool (such as a Python interpreter) is paid once instead of
+ * for every action.
+ *
+ * A worker is started with its command followed by "--persistent_worker".
+ * Its stdin and stdout are both connected to a socket, over which it reads
+ * requests and writes responses, one at a time, until stdin is closed:
+ *
+ *     request    u32 size of the rest, and for every argument: u32 length,
+ *                bytes
+ *     response   u32 size of the rest, i32 exit code, output bytes
+ *
+ * Integers are little endian. The stderr of a worker is discarded, all output
+ * of an action belongs in its response.
+ *
+ * A worker that dies during a request is replaced and the request is sent to
+ * the new worker, once. Workers of which the resident memory grows beyond a
+ * limit are stopped after their request and replaced when needed.
+ */
+class WorkerPool {
+public:
+    /*
+     * Starts workers in the given environment ("NAME=value" entries), and
+     * stops workers that use more than max_memory bytes (0 for no limit).
+     */
+    WorkerPool(std::vector<std::string> environment, uint64_t max_memory);
+
+    WorkerPool(const WorkerPool &) = delete;
+
+    WorkerPool &operator=(const WorkerPool &) = delete;
+
+    /*
+     * Stops all idle workers.
+     */
+    ~WorkerPool();
+
+    /*
+     * Sends the arguments to an idle worker started with the given command,
+     * or to a new one if none is idle. Safe to call concurrently.
+     */
+    ActionRunner::Result run(const std::vector<std::string> &command, const std::vector<std::string> &arguments);
+
+    /*
+     * The number of workers started so far.
+     */
+    [[nodiscard]] unsigned int workers_started() const;
+
+private:
+    struct Worker {
+        pid_t pid;
+        int fd;
+    };
+
+    const std::vector<std::string> environment;
+    const uint64_t max_memory;
+
+    mutable std::mutex mutex;
+    std::map<std::vector<std::string>, std::list<Worker>> idle_workers;
+    unsigned int started;
+
+    [[nodiscard]] std::unique_ptr<Worker> start(const std::vector<std::string> &command, std::string &error);
+
+    static void stop(const Worker &worker);
+
+    /*
+     * Sends a request and reads the response. Returns false if the worker
+     * went away.
+     */
+    static bool request(const Worker &worker, const std::vector<std::string> &arguments,
+                        ActionRunner::Result &result);
+
+    [[nodiscard]] static uint64_t resident_memory(pid_t pid);
+};
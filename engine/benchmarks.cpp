@@ -0,0 +1,156 @@
+//
+// Created by roel on 10/19/26.
+//
+
+#include <benchmark/benchmark.h>
+
+#include "engine/ProcessActionRunner.h"
+#include "engine/WorkerActionRunner.h"
+#include "engine/PythonUnitLoader.h"
+#include "interpreter/BasicObjectStore.h"
+#include "util/WorkStealingPool.h"
+
+#include <filesystem>
+#include <fstream>
+#include <spawn.h>
+#include <sys/wait.h>
+
+extern char **environ;
+
+static constexpr int process_count = 10000;
+
+/*
+ * Starts and reaps processes that do nothing, and captures their output.
+ */
+static void BM_process_runner_true(benchmark::State &state) {
+    ProcessActionRunner runner;
+    Action action;
+    action.command = {"true"};
+
+    WorkStealingPool pool(static_cast<unsigned int>(state.range(0)));
+    for (auto _: state) {
+        for (int i = 0; i < process_count; i++) {
+            pool.submit([&runner, &action] {
+                benchmark::DoNotOptimize(runner.run(action));
+            });
+        }
+        pool.wait();
+    }
+    state.SetItemsProcessed(state.iterations() * process_count);
+}
+
+BENCHMARK(BM_process_runner_true)->Arg(1)->Arg(8)->Iterations(1)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+/*
+ * The same without capturing output, as a lower bound for the cost of a
+ * process.
+ */
+static void BM_posix_spawn_true(benchmark::State &state) {
+    char true_command[] = "true";
+    char *argv[] = {true_command, nullptr};
+
+    WorkStealingPool pool(static_cast<unsigned int>(state.range(0)));
+    for (auto _: state) {
+        for (int i = 0; i < process_count; i++) {
+            pool.submit([&argv] {
+                pid_t pid;
+                if (posix_spawnp(&pid, argv[0], nullptr, nullptr, argv, environ) == 0) {
+                    int status;
+                    waitpid(pid, &status, 0);
+                }
+            });
+        }
+        pool.wait();
+    }
+    state.SetItemsProcessed(state.iterations() * process_count);
+}
+
+BENCHMARK(BM_posix_spawn_true)->Arg(1)->Arg(8)->Iterations(1)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+static constexpr int request_count = 200;
+
+/*
+ * Runs actions of a tool that takes range(0) milliseconds to start, as a
+ * process per action.
+ */
+static void BM_tool_process_per_action(benchmark::State &state) {
+    ProcessActionRunner runner;
+    Action action;
+    action.command = {FAKE_WORKER_PATH, "--startup-ms=" + std::to_string(state.range(0)), "echo", "x"};
+
+    for (auto _: state) {
+        for (int i = 0; i < request_count; i++) {
+            benchmark::DoNotOptimize(runner.run(action));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * request_count);
+}
+
+BENCHMARK(BM_tool_process_per_action)->Arg(0)->Arg(10)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+/*
+ * The same actions sent to a persistent worker.
+ */
+static void BM_tool_persistent_worker(benchmark::State &state) {
+    ProcessActionRunner process_runner;
+    WorkerPool workers({}, 0);
+    WorkerActionRunner runner(process_runner, workers);
+    Action action;
+    action.worker = {FAKE_WORKER_PATH, "--startup-ms=" + std::to_string(state.range(0))};
+    action.command = action.worker;
+    action.command.insert(action.command.end(), {"echo", "x"});
+
+    for (auto _: state) {
+        for (int i = 0; i < request_count; i++) {
+            benchmark::DoNotOptimize(runner.run(action));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * request_count);
+}
+
+BENCHMARK(BM_tool_persistent_worker)->Arg(0)->Arg(10)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+/*
+ * Calls a function of a Python unit that joins a list of range(0) strings,
+ * which costs a round trip to the Python helper per call.
+ */
+static void BM_python_unit_call(benchmark::State &state) {
+    const std::string dir = std::filesystem::temp_directory_path().string() + "/mkr_python_benchmark";
+    std::filesystem::create_directories(dir);
+    std::ofstream(dir + "/unit.py") << "def join(values):\n    return ' '.join(values)\n";
+
+    BasicObjectStore store;
+    PythonUnitLoader python_units(store, dir, "python3");
+    const CallHandler *join;
+    try {
+        join = &python_units.load("unit.py").attr("join").get_call_handler();
+    } catch (const ExternalObjectError &e) {
+        state.SkipWithError(e.what());
+        return;
+    }
+
+    std::list<std::reference_wrapper<const Object>> values;
+    for (int64_t i = 0; i < state.range(0); i++) {
+        values.emplace_back(store.create_string("-DVALUE_" + std::to_string(i)));
+    }
+    struct Arg : public CallArg {
+        explicit Arg(const Object &obj_) :
+                obj(obj_) {}
+
+        [[nodiscard]] const Object &object() const override {
+            return obj;
+        }
+
+        const Object &obj;
+    } arg(store.create_list(values));
+    CallArgList arguments;
+    arguments.add(arg);
+
+    for (auto _: state) {
+        benchmark::DoNotOptimize(join->call(arguments));
+    }
+    state.SetItemsProcessed(state.iterations());
+    std::filesystem::remove_all(dir);
+}
+
+BENCHMARK(BM_python_unit_call)->Arg(1)->Arg(100)->Unit(benchmark::kMicrosecond)->UseRealTime();
@@ -0,0 +1,137 @@
+//
+// Created by roel on 10/19/26.
+//
+
+/*
+ * Tool for the tests and benchmarks of persistent workers. Runs a single
+ * request given as arguments, or serves requests as a persistent worker (see
+ * WorkerPool) if the last argument is "--persistent_worker":
+ *
+ *     echo ARG...     outputs the arguments
+ *     pid             outputs the process id
+ *     fail CODE       exits with the code
+ *     crash           dies
+ *     grow MIB        allocates (and keeps) memory
+ *     touch PATH      creates a file
+ *
+ * A first argument --startup-ms=N makes starting take N milliseconds.
+ */
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+
+static std::vector<std::vector<char>> allocations;
+
+static int handle(const std::vector<std::string> &args, std::string &output) {
+    if (args.empty()) {
+        output = "no request\n";
+        return 2;
+    }
+
+    const std::string &request = args.front();
+    if (request == "echo") {
+        for (size_t i = 1; i < args.size(); i++) {
+            if (i > 1) output += ' ';
+            output += args[i];
+        }
+        output += '\n';
+        return 0;
+    }
+    if (request == "pid") {
+        output = std::to_string(getpid()) + "\n";
+        return 0;
+    }
+    if (request == "fail" && args.size() == 2) {
+        output = "failed\n";
+        return std::atoi(args[1].c_str());
+    }
+    if (request == "crash") {
+        abort();
+    }
+    if (request == "grow" && args.size() == 2) {
+        std::vector<char> &allocation = allocations.emplace_back(std::atoi(args[1].c_str()) * 1024 * 1024);
+        memset(allocation.data(), 1, allocation.size());
+        return 0;
+    }
+    if (request == "touch" && args.size() == 2) {
+        std::ofstream file(args[1]);
+        return file ? 0 : 1;
+    }
+
+    output = "unknown request '" + request + "'\n";
+    return 2;
+}
+
+static bool read_all(void *data, size_t size) {
+    char *pos = static_cast<char *>(data);
+    while (size > 0) {
+        const ssize_t count = read(0, pos, size);
+        if (count <= 0) return false;
+        pos += count;
+        size -= static_cast<size_t>(count);
+    }
+    return true;
+}
+
+static bool write_all(const void *data, size_t size) {
+    const char *pos = static_cast<const char *>(data);
+    while (size > 0) {
+        const ssize_t count = write(1, pos, size);
+        if (count <= 0) return false;
+        pos += count;
+        size -= static_cast<size_t>(count);
+    }
+    return true;
+}
+
+static int serve() {
+    uint32_t size;
+    while (read_all(&size, sizeof(size))) {
+        std::string frame(size, '\0');
+        if (!read_all(frame.data(), frame.size())) return 1;
+
+        std::vector<std::string> args;
+        size_t pos = 0;
+        while (pos + sizeof(uint32_t) <= frame.size()) {
+            uint32_t length;
+            memcpy(&length, frame.data() + pos, sizeof(length));
+            pos += sizeof(length);
+            args.push_back(frame.substr(pos, length));
+            pos += length;
+        }
+
+        std::string output;
+        const int32_t exit_code = handle(args, output);
+        const uint32_t response_size = static_cast<uint32_t>(sizeof(exit_code) + output.size());
+        if (!write_all(&response_size, sizeof(response_size)) || !write_all(&exit_code, sizeof(exit_code)) ||
+            !write_all(output.data(), output.size())) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    std::vector<std::string> args(argv + 1, argv + argc);
+
+    if (!args.empty() && args.front().starts_with("--startup-ms=")) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(std::atoi(args.front().c_str() + 13)));
+        args.erase(args.begin());
+    }
+
+    if (!args.empty() && args.back() == "--persistent_worker") {
+        return serve();
+    }
+
+    std::string output;
+    const int exit_code = handle(args, output);
+    fputs(output.c_str(), stdout);
+    return exit_code;
+}
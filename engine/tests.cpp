@@ -0,0 +1,1284 @@
+//
+// Created by roel on 10/19/26.
+//
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+using testing::Eq;
+using testing::Gt;
+using testing::Ref;
+using testing::StartsWith;
+using testing::EndsWith;
+using testing::ElementsAre;
+
+#include "interpreter/BasicObjectStore.h"
+#include "interpreter/Interpreter.h"
+#include "interpreter/RootScope.h"
+#include "interpreter/ScopeWrapper.h"
+#include "parser/DefaultParser.h"
+#include "parser/StringSource.h"
+#include "parser/StaticImportResolver.h"
+#include "engine/Builtins.h"
+#include "engine/ActionGraph.h"
+#include "engine/Executor.h"
+#include "engine/ProcessActionRunner.h"
+#include "engine/CachingActionRunner.h"
+#include "engine/FileStateDb.h"
+#include "engine/Depfile.h"
+#include "engine/DepsLog.h"
+#include "engine/BuildLog.h"
+#include "engine/DurationDb.h"
+#include "engine/Jobserver.h"
+#include "engine/SpeculativeActionRunner.h"
+#include "engine/WorkerActionRunner.h"
+#include "engine/RemoteActionRunner.h"
+#include "engine/RemoteWorker.h"
+#include "engine/HttpCache.h"
+#include "engine/HttpCacheServer.h"
+#include "engine/PythonUnitLoader.h"
+#include "engine/FileWatcher.h"
+#include "hash/FileHasher.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <mutex>
+
+/*
+ * Interprets a program with the builtins installed and keeps everything alive
+ * for the duration of a test.
+ */
+class BuildFixture {
+public:
+    BuildFixture() :
+            scope(builtin_scope),
+            builtins(store, "out") {
+        builtins.install(builtin_scope);
+    }
+
+    bool interpret_str(const std::string &input) {
+        StringSource &source = sources.emplace_back(input);
+        DefaultParser parser(import_resolver);
+        auto parse_result = parser.parse(source);
+        if (!parse_result.success()) return false;
+        const Node &ast = asts.emplace_back(parse_result.ast());
+        return Interpreter(store, scope, ast, call_cache, builtin_scope).interpret().success();
+    }
+
+    ActionGraph graph(const std::string &target) {
+        ActionGraph action_graph;
+        action_graph.add_target(scope.get(target));
+        return action_graph;
+    }
+
+    BasicObjectStore store;
+    RootScope builtin_scope;
+    ScopeWrapper scope;
+    Builtins builtins;
+    CallCache call_cache;
+    StaticImportResolver import_resolver;
+    std::list<StringSource> sources;
+    std::list<Node> asts;
+};
+
+/*
+ * Records the actions it is asked to run, and fails the ones of which the
+ * first command argument is "false".
+ */
+class FakeActionRunner : public ActionRunner {
+public:
+    explicit FakeActionRunner(std::chrono::milliseconds duration_ = std::chrono::milliseconds(0)) :
+            duration(duration_) {}
+
+    Result run(const Action &action) override {
+        const int now_running = ++running;
+        int max = max_running;
+        while (now_running > max && !max_running.compare_exchange_weak(max, now_running)) {}
+
+        std::this_thread::sleep_for(duration);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            order.push_back(action.description());
+        }
+        running--;
+
+        Result result;
+        result.exit_code = action.command.front() == "false" ? 1 : 0;
+        return result;
+    }
+
+    [[nodiscard]] size_t position(const std::string &description) const {
+        auto it = std::find(order.begin(), order.end(), description);
+        return std::distance(order.begin(), it);
+    }
+
+    std::mutex mutex;
+    std::vector<std::string> order;
+    std::atomic<int> running = 0;
+    std::atomic<int> max_running = 0;
+
+private:
+    const std::chrono::milliseconds duration;
+};
+
+TEST(ActionCallHandler, test_action) {
+    BuildFixture fixture;
+    ASSERT_TRUE(fixture.interpret_str(
+            "a = action(command=[\"cc\" \"-c\" \"$in\" \"-o\" \"$out\"] inputs=[\"a.c\"] outputs=[\"a.o\"])"));
+
+    const Object &a = fixture.scope.get("a");
+    const Object &outputs = a.attr("outputs");
+    ASSERT_THAT(outputs.entries().size(), Eq(1u));
+    const std::string output = outputs.entries().at(0).get().get_string();
+    EXPECT_THAT(output, StartsWith("out/"));
+    EXPECT_THAT(output, EndsWith("/a.o"));
+
+    std::vector<std::string> command;
+    for (const Object &arg: a.attr("command").entries()) command.push_back(arg.get_string());
+    EXPECT_THAT(command, ElementsAre("cc", "-c", "a.c", "-o", output));
+}
+
+TEST(ActionCallHandler, test_expand_in_string) {
+    BuildFixture fixture;
+    ASSERT_TRUE(fixture.interpret_str(
+            "a = action(command=[\"sh\" \"-c\" \"cat $in > $out\"] inputs=[\"x\" \"y\"] outputs=[\"a\"])"));
+
+    const Object &a = fixture.scope.get("a");
+    const std::string output = a.attr("outputs").entries().at(0).get().get_string();
+    EXPECT_THAT(a.attr("command").entries().at(2).get().get_string(), Eq("cat x y > " + output));
+}
+
+TEST(ActionCallHandler, test_action_as_input) {
+    BuildFixture fixture;
+    ASSERT_TRUE(fixture.interpret_str(
+            "a = action(command=[\"touch\" \"$out\"] outputs=[\"a.o\"])"
+            "b = action(command=[\"ld\" a \"-o\" \"$out\"] outputs=[\"b\"])"));
+
+    const std::string a_output = fixture.scope.get("a").attr("outputs").entries().at(0).get().get_string();
+    const Object &b = fixture.scope.get("b");
+    EXPECT_THAT(b.attr("inputs").entries().at(0).get().get_string(), Eq(a_output));
+    EXPECT_THAT(b.attr("command").entries().at(1).get().get_string(), Eq(a_output));
+    EXPECT_THAT(b.attr("dependencies").entries().at(0).get(), Ref(fixture.scope.get("a")));
+}
+
+TEST(ActionCallHandler, test_invalid_output_name) {
+    BuildFixture fixture;
+    EXPECT_FALSE(fixture.interpret_str("a = action(command=[\"true\"] outputs=[\"../a.o\"])"));
+    EXPECT_FALSE(fixture.interpret_str("b = action(outputs=[\"a.o\"])"));
+}
+
+TEST(ActionCallHandler, test_gcc_deps) {
+    BuildFixture fixture;
+    ASSERT_TRUE(fixture.interpret_str(
+            "a = action(command=[\"cc\" \"-c\" \"$in\" \"-o\" \"$out\"] inputs=[\"a.c\"] outputs=[\"a.o\"] deps=\"gcc\")"));
+
+    const Object &a = fixture.scope.get("a");
+    const std::string depfile = a.attr("depfile").get_string();
+    EXPECT_THAT(depfile, StartsWith("out/"));
+
+    std::vector<std::string> command;
+    for (const Object &arg: a.attr("command").entries()) command.push_back(arg.get_string());
+    ASSERT_THAT(command.size(), Eq(8u));
+    EXPECT_THAT(std::vector<std::string>(command.begin() + 5, command.end()), ElementsAre("-MD", "-MF", depfile));
+
+    EXPECT_THAT(fixture.graph("a").nodes().front().action.depfile, Eq(depfile));
+
+    EXPECT_FALSE(fixture.interpret_str("b = action(command=[\"cc\"] outputs=[\"b.o\"] deps=\"msvc\")"));
+}
+
+TEST(ActionCallHandler, test_resources) {
+    BuildFixture fixture;
+    ASSERT_TRUE(fixture.interpret_str(
+            "link = pool(name=\"link\" depth=\"4\")"
+            "a = action(command=[\"ld\"] outputs=[\"a\"] pool=link memory=\"8G\" cpus=\"2\")"
+            "b = action(command=[\"cc\"] outputs=[\"b\"])"));
+
+    const ActionGraph graph = fixture.graph("a");
+    const Resources &resources = graph.node(0).action.resources;
+    EXPECT_THAT(resources.pool, Eq("link"));
+    EXPECT_THAT(resources.pool_depth, Eq(4u));
+    EXPECT_THAT(resources.memory, Eq(8ull << 30));
+    EXPECT_THAT(resources.cpus, Eq(2u));
+
+    const Resources &defaults = fixture.graph("b").node(0).action.resources;
+    EXPECT_THAT(defaults.pool, Eq(""));
+    EXPECT_THAT(defaults.memory, Eq(0u));
+    EXPECT_THAT(defaults.cpus, Eq(1u));
+
+    EXPECT_FALSE(fixture.interpret_str("p = pool(name=\"p\" depth=\"0\")"));
+    EXPECT_FALSE(fixture.interpret_str("c = action(command=[\"cc\"] pool=\"link\")"));
+    EXPECT_FALSE(fixture.interpret_str("d = action(command=[\"cc\"] memory=\"8X\")"));
+    EXPECT_FALSE(fixture.interpret_str("e = action(command=[\"cc\"] cpus=\"2G\")"));
+}
+
+TEST(ActionCallHandler, test_listener_on_cached_call) {
+    class RecordingListener : public ActionListener {
+    public:
+        void action_created(const Object &action) override {
+            actions.push_back(&action);
+        }
+
+        std::vector<const Object *> actions;
+    };
+
+    BuildFixture fixture;
+    RecordingListener listener;
+    fixture.builtins.set_action_listener(&listener);
+    ASSERT_TRUE(fixture.interpret_str("a = action(command=[\"cc\"] outputs=[\"a\"])"));
+
+    // The action reused from the call cache is passed on again
+    ASSERT_TRUE(fixture.interpret_str("b = action(command=[\"cc\"] outputs=[\"a\"])"));
+    fixture.builtins.set_action_listener(nullptr);
+    ASSERT_THAT(listener.actions.size(), Eq(2u));
+    EXPECT_THAT(listener.actions[1], Eq(listener.actions[0]));
+    EXPECT_THAT(listener.actions[1], Eq(&fixture.scope.get("b")));
+}
+
+TEST(Resources, test_parse_size) {
+    EXPECT_THAT(parse_size("123"), Eq(123u));
+    EXPECT_THAT(parse_size("2K"), Eq(2048u));
+    EXPECT_THAT(parse_size("3G"), Eq(3ull << 30));
+    EXPECT_FALSE(parse_size("").has_value());
+    EXPECT_FALSE(parse_size("G").has_value());
+    EXPECT_FALSE(parse_size("1GB").has_value());
+    EXPECT_FALSE(parse_size("99999999999999999999").has_value());
+    EXPECT_FALSE(parse_count("0").has_value());
+}
+
+TEST(ActionGraph, test_dependency_order) {
+    BuildFixture fixture;
+    ASSERT_TRUE(fixture.interpret_str(
+            "a = action(command=[\"cc\"] outputs=[\"a.o\"])"
+            "b = action(command=[\"cc\"] outputs=[\"b.o\"])"
+            "exe = action(command=[\"ld\" a b] outputs=[\"exe\"])"
+            "all = [exe a]"));
+
+    ActionGraph graph = fixture.graph("all");
+    ASSERT_THAT(graph.size(), Eq(3u));
+    EXPECT_THAT(graph.node(2).action.description(), EndsWith("/exe"));
+    EXPECT_THAT(graph.node(2).dependencies, ElementsAre(0, 1));
+    EXPECT_THAT(graph.node(0).dependents, ElementsAre(2));
+}
+
+TEST(ActionGraph, test_merge_identical_actions) {
+    BuildFixture fixture;
+    ASSERT_TRUE(fixture.interpret_str(
+            "a1 = action(command=[\"cc\" \"a.c\"] outputs=[\"a.o\"])"
+            "b = action(command=[\"ld\" a1] outputs=[\"b\"])"));
+
+    // As if defined by another unit, which does not share the call cache
+    fixture.call_cache.clear();
+    ASSERT_TRUE(fixture.interpret_str(
+            "a2 = action(command=[\"cc\" \"a.c\"] outputs=[\"a.o\"])"
+            "c = action(command=[\"ar\" a2] outputs=[\"c\"])"
+            "all = [b c]"));
+    ASSERT_THAT(&fixture.scope.get("a1"), testing::Ne(&fixture.scope.get("a2")));
+
+    ActionGraph graph = fixture.graph("all");
+    ASSERT_THAT(graph.size(), Eq(3u));
+    EXPECT_THAT(graph.merged(), Eq(1u));
+    EXPECT_THAT(graph.node(0).dependents, ElementsAre(1, 2));
+    EXPECT_THAT(graph.node(2).action.inputs, Eq(graph.node(1).action.inputs));
+}
+
+TEST(ActionGraph, test_merge_actions_with_other_resources) {
+    BuildFixture fixture;
+    ASSERT_TRUE(fixture.interpret_str(
+            "a1 = action(command=[\"cc\" \"a.c\"] outputs=[\"a.o\"] memory=\"1G\")"
+            "a2 = action(command=[\"cc\" \"a.c\"] outputs=[\"a.o\"] cpus=\"2\")"
+            "all = [a1 a2]"));
+    ASSERT_THAT(fixture.scope.get("a1").digest(), testing::Ne(fixture.scope.get("a2").digest()));
+
+    // Both write the same file
+    ActionGraph graph = fixture.graph("all");
+    ASSERT_THAT(graph.size(), Eq(1u));
+    EXPECT_THAT(graph.merged(), Eq(1u));
+    EXPECT_THAT(graph.node(0).action.resources.memory, Eq(1ull << 30));
+    EXPECT_THAT(graph.node(0).action.resources.cpus, Eq(2u));
+}
+
+TEST(ActionGraph, test_merge_keeps_declared_resources) {
+    BuildFixture fixture;
+    ASSERT_TRUE(fixture.interpret_str(
+            "link = pool(name=\"link\" depth=\"2\")"
+            "a1 = action(command=[\"ld\" \"a.o\"] outputs=[\"a\"])"
+            "a2 = action(command=[\"ld\" \"a.o\"] outputs=[\"a\"] pool=link memory=\"4G\" cpus=\"3\""
+            "            worker=[\"ld\"])"
+            "all = [a1 a2]"));
+
+    // The duplicate without resources comes first
+    ActionGraph graph = fixture.graph("all");
+    ASSERT_THAT(graph.size(), Eq(1u));
+    const Resources &resources = graph.node(0).action.resources;
+    EXPECT_THAT(resources.pool, Eq("link"));
+    EXPECT_THAT(resources.pool_depth, Eq(2u));
+    EXPECT_THAT(resources.memory, Eq(4ull << 30));
+    EXPECT_THAT(resources.cpus, Eq(3u));
+    EXPECT_THAT(graph.node(0).action.worker, ElementsAre("ld"));
+
+    ASSERT_TRUE(fixture.interpret_str(
+            "other = pool(name=\"other\" depth=\"2\")"
+            "a3 = action(command=[\"ld\" \"a.o\"] outputs=[\"a\"] pool=other)"
+            "conflict = [a2 a3]"));
+    EXPECT_THROW((void) fixture.graph("conflict"), ActionIsNotValid);
+}
+
+TEST(ActionGraph, test_struct_target) {
+    BuildFixture fixture;
+    StringSource unit("a = action(command=[\"cc\"] outputs=[\"a.o\"]) s = \"str\"");
+    fixture.import_resolver.set("unit.mkr", unit);
+    ASSERT_TRUE(fixture.interpret_str("unit = import(\"unit.mkr\")"));
+    EXPECT_THAT(fixture.graph("unit").size(), Eq(1u));
+}
+
+TEST(Executor, test_dependencies_run_first) {
+    BuildFixture fixture;
+    ASSERT_TRUE(fixture.interpret_str(
+            "a = action(command=[\"cc\"] outputs=[\"a\"])"
+            "b = action(command=[\"cc\" a] outputs=[\"b\"])"
+            "c = action(command=[\"cc\" a] outputs=[\"c\"])"
+            "d = action(command=[\"ld\" b c] outputs=[\"d\"])"));
+
+    FakeActionRunner runner;
+    Executor executor(runner, {.jobs = 4});
+    const Executor::Result result = executor.execute(fixture.graph("d"));
+
+    EXPECT_TRUE(result.success());
+    EXPECT_THAT(result.succeeded, Eq(4u));
+    ASSERT_THAT(runner.order.size(), Eq(4u));
+    EXPECT_THAT(runner.order.front(), EndsWith("/a"));
+    EXPECT_THAT(runner.order.back(), EndsWith("/d"));
+}
+
+TEST(Executor, test_runs_in_parallel) {
+    BuildFixture fixture;
+    ASSERT_TRUE(fixture.interpret_str(
+            "all = [action(command=[\"cc\" x] outputs=[\"o\"]) for x in [\"1\" \"2\" \"3\" \"4\"]]"));
+
+    FakeActionRunner runner(std::chrono::milliseconds(50));
+    Executor executor(runner, {.jobs = 4});
+    EXPECT_TRUE(executor.execute(fixture.graph("all")).success());
+    EXPECT_THAT(runner.max_running.load(), Gt(1));
+}
+
+TEST(Executor, test_failure_skips_dependents) {
+    BuildFixture fixture;
+    ASSERT_TRUE(fixture.interpret_str(
+            "a = action(command=[\"false\"] outputs=[\"a\"])"
+            "b = action(command=[\"cc\" a] outputs=[\"b\"])"
+            "c = action(command=[\"cc\"] outputs=[\"c\"])"
+            "all = [b c]"));
+
+    FakeActionRunner runner;
+    Executor executor(runner, {.jobs = 1, .keep_going = true});
+    const Executor::Result result = executor.execute(fixture.graph("all"));
+
+    EXPECT_FALSE(result.success());
+    EXPECT_THAT(result.failed, Eq(1u));
+    EXPECT_THAT(result.succeeded, Eq(1u));
+    EXPECT_THAT(result.skipped, Eq(1u));
+}
+
+TEST(Executor, test_critical_path_first) {
+    BuildFixture fixture;
+    ASSERT_TRUE(fixture.interpret_str(
+            "d = action(command=[\"cc\"] outputs=[\"d\"])"
+            "e = action(command=[\"cc\"] outputs=[\"e\"])"
+            "a = action(command=[\"cc\"] outputs=[\"a\"])"
+            "b = action(command=[\"cc\" a] outputs=[\"b\"])"
+            "c = action(command=[\"ld\" b] outputs=[\"c\"])"
+            "all = [d e c]"));
+    const ActionGraph graph = fixture.graph("all");
+
+    const std::string dir = testing::TempDir() + "mkr_critical_path";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+    DurationDb durations(dir + "/durations");
+
+    {
+        // Without durations the longest chain goes first
+        FakeActionRunner runner(std::chrono::milliseconds(2));
+        const Executor::Result result = Executor(runner, {.jobs = 1}, durations).execute(graph);
+        EXPECT_TRUE(result.success());
+        EXPECT_THAT(runner.order.front(), EndsWith("/a"));
+        EXPECT_THAT(runner.order.at(1), EndsWith("/b"));
+        EXPECT_THAT(durations.size(), Eq(5u));
+        EXPECT_THAT(result.critical_path, testing::Ge(std::chrono::milliseconds(6)));
+        EXPECT_THAT(result.wall_time, testing::Ge(result.critical_path));
+    }
+
+    // Once d is known to take longer than the chain, it goes first
+    durations.record(graph.node(0).action.id, std::chrono::seconds(10));
+    EXPECT_TRUE(durations.save());
+    DurationDb loaded(dir + "/durations");
+    EXPECT_THAT(loaded.get(graph.node(0).action.id), Eq(std::chrono::seconds(10)));
+
+    FakeActionRunner runner;
+    EXPECT_TRUE(Executor(runner, {.jobs = 1}, loaded).execute(graph).success());
+    EXPECT_THAT(runner.order.front(), EndsWith("/d"));
+
+    std::filesystem::remove_all(dir);
+}
+
+TEST(Executor, test_pool_depth) {
+    BuildFixture fixture;
+    ASSERT_TRUE(fixture.interpret_str(
+            "link = pool(name=\"link\" depth=\"2\")"
+            "all = [action(command=[\"ld\" n] outputs=[n] pool=link) for n in [\"a\" \"b\" \"c\" \"d\" \"e\" \"f\"]]"));
+
+    FakeActionRunner runner(std::chrono::milliseconds(5));
+    EXPECT_TRUE(Executor(runner, {.jobs = 4}).execute(fixture.graph("all")).success());
+    EXPECT_THAT(runner.order.size(), Eq(6u));
+    EXPECT_THAT(runner.max_running.load(), testing::Le(2));
+}
+
+TEST(Executor, test_memory_budget) {
+    BuildFixture fixture;
+    ASSERT_TRUE(fixture.interpret_str(
+            "a = action(command=[\"ld\"] outputs=[\"a\"] memory=\"6G\")"
+            "b = action(command=[\"ld\"] outputs=[\"b\"] memory=\"6G\")"
+            "c = action(command=[\"ld\"] outputs=[\"c\"] memory=\"6G\")"
+            "huge = action(command=[\"ld\"] outputs=[\"huge\"] memory=\"64G\")"
+            "all = [a b c huge]"));
+
+    FakeActionRunner runner(std::chrono::milliseconds(5));
+    const Executor::Result result = Executor(runner, {.jobs = 4, .memory = 16ull << 30}).execute(
+            fixture.graph("all"));
+    EXPECT_TRUE(result.success());
+    EXPECT_THAT(runner.order.size(), Eq(4u));
+    EXPECT_THAT(runner.max_running.load(), Eq(2));
+}
+
+TEST(Jobserver, test_tokens) {
+    const std::string dir = testing::TempDir();
+    std::unique_ptr<Jobserver> jobserver = Jobserver::create(3, dir);
+    ASSERT_TRUE(jobserver);
+    EXPECT_THAT(jobserver->get_makeflags(), StartsWith("-j3 --jobserver-auth=fifo:" + dir));
+
+    // A make running below uses the same tokens
+    std::unique_ptr<Jobserver> client = Jobserver::connect("k " + jobserver->get_makeflags());
+    ASSERT_TRUE(client);
+
+    const Jobserver::Token implicit = jobserver->acquire();
+    EXPECT_THAT(implicit.source, Eq(Jobserver::Token::Source::IMPLICIT));
+    const Jobserver::Token first = jobserver->acquire();
+    EXPECT_THAT(client->acquire().source, Eq(Jobserver::Token::Source::IMPLICIT));
+    const Jobserver::Token second = client->acquire();
+    EXPECT_THAT(first.source, Eq(Jobserver::Token::Source::JOBSERVER));
+    ASSERT_THAT(second.source, Eq(Jobserver::Token::Source::JOBSERVER));
+
+    std::atomic<bool> acquired = false;
+    std::thread thread([&] {
+        jobserver->release(jobserver->acquire());
+        acquired = true;
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    EXPECT_FALSE(acquired);
+    client->release(second);
+    thread.join();
+    EXPECT_TRUE(acquired);
+
+    EXPECT_FALSE(Jobserver::connect("-j4"));
+    EXPECT_FALSE(Jobserver::connect("-j4 --jobserver-auth=1000,1001"));
+}
+
+TEST(Executor, test_jobserver) {
+    BuildFixture fixture;
+    ASSERT_TRUE(fixture.interpret_str(
+            "all = [action(command=[\"cc\" n] outputs=[n]) for n in [\"a\" \"b\" \"c\" \"d\" \"e\" \"f\"]]"));
+
+    std::unique_ptr<Jobserver> jobserver = Jobserver::create(2, testing::TempDir());
+    ASSERT_TRUE(jobserver);
+
+    FakeActionRunner runner(std::chrono::milliseconds(5));
+    EXPECT_TRUE(Executor(runner, {.jobs = 4, .jobserver = jobserver.get()}).execute(fixture.graph("all")).success());
+    EXPECT_THAT(runner.order.size(), Eq(6u));
+    EXPECT_THAT(runner.max_running.load(), testing::Le(2));
+}
+
+TEST(SpeculativeActionRunner, test_start_while_interpreting) {
+    BuildFixture fixture;
+    FakeActionRunner runner;
+    SpeculativeActionRunner speculative_runner(runner, 2);
+    fixture.builtins.set_action_listener(&speculative_runner);
+    ASSERT_TRUE(fixture.interpret_str(
+            "a = action(command=[\"cc\"] outputs=[\"a\"])"
+            "b = action(command=[\"ld\" a] outputs=[\"b\"])"
+            "test = action(command=[\"test\" b])"));
+    fixture.builtins.set_action_listener(nullptr);
+
+    // The action without outputs is left for the executor
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (speculative_runner.started() < 2 && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    speculative_runner.stop();
+    EXPECT_THAT(speculative_runner.started(), Eq(2u));
+
+    const Executor::Result result = Executor(speculative_runner, {.jobs = 2}).execute(fixture.graph("test"));
+    EXPECT_TRUE(result.success());
+    EXPECT_THAT(result.succeeded, Eq(3u));
+    ASSERT_THAT(runner.order.size(), Eq(3u));
+    EXPECT_THAT(runner.order.front(), EndsWith("/a"));
+}
+
+TEST(ProcessActionRunner, test_run) {
+    const std::string dir = testing::TempDir() + "mkr_process_runner";
+    std::filesystem::remove_all(dir);
+
+    ProcessActionRunner runner;
+    Action action;
+    action.command = {"touch", dir + "/sub/out.txt"};
+    action.outputs = {dir + "/sub/out.txt"};
+    EXPECT_TRUE(runner.run(action).success());
+    EXPECT_TRUE(std::filesystem::exists(dir + "/sub/out.txt"));
+
+    action.command = {"false"};
+    EXPECT_FALSE(runner.run(action).success());
+
+    action.command = {"/non/existing/command"};
+    EXPECT_THAT(runner.run(action).exit_code, Eq(127));
+
+    std::filesystem::remove_all(dir);
+}
+
+TEST(ProcessActionRunner, test_output) {
+    ProcessActionRunner runner;
+    Action action;
+    action.command = {"sh", "-c", "echo out; echo err >&2; cat"};
+    const ActionRunner::Result result = runner.run(action);
+    EXPECT_TRUE(result.success());
+    EXPECT_THAT(result.output, Eq("out\nerr\n"));
+
+    action.command = {"sh", "-c", "head -c 5000000 /dev/zero | tr '\\0' x; exit 3"};
+    const ActionRunner::Result large_result = runner.run(action);
+    EXPECT_THAT(large_result.exit_code, Eq(3));
+    EXPECT_THAT(large_result.output.size(), testing::Lt(ProcessActionRunner::max_output_size + 100));
+    EXPECT_THAT(large_result.output, EndsWith("[output truncated]\n"));
+}
+
+TEST(ProcessActionRunner, test_concurrent_output) {
+    ProcessActionRunner runner;
+    std::vector<std::string> outputs(16);
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < outputs.size(); i++) {
+        threads.emplace_back([&, i] {
+            Action action;
+            action.command = {"sh", "-c", "for n in 1 2 3 4 5; do echo " + std::to_string(i) + "; done"};
+            outputs[i] = runner.run(action).output;
+        });
+    }
+    for (std::thread &thread: threads) thread.join();
+
+    for (size_t i = 0; i < outputs.size(); i++) {
+        std::string expected;
+        for (int n = 0; n < 5; n++) expected += std::to_string(i) + "\n";
+        EXPECT_THAT(outputs[i], Eq(expected));
+    }
+}
+
+static void write_file(const std::string &path, const std::string &content) {
+    std::ofstream(path) << content;
+}
+
+static std::string read_file(const std::string &path) {
+    std::ifstream stream(path);
+    return {std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>()};
+}
+
+/*
+ * Counts the actions that are actually run.
+ */
+class CountingActionRunner : public ActionRunner {
+public:
+    Result run(const Action &action) override {
+        count++;
+        return runner.run(action);
+    }
+
+    ProcessActionRunner runner;
+    unsigned int count = 0;
+};
+
+TEST(ActionCache, test_restore_after_input_change) {
+    const std::string dir = testing::TempDir() + "mkr_action_cache";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+
+    Action action;
+    action.command = {"sh", "-c", "echo building; cp " + dir + "/in.txt " + dir + "/out/out.txt"};
+    action.inputs = {dir + "/in.txt"};
+    action.outputs = {dir + "/out/out.txt"};
+
+    CountingActionRunner counting_runner;
+    ActionCache cache(dir + "/cache");
+    CachingActionRunner runner(counting_runner, cache, {"PATH=/bin"});
+
+    write_file(dir + "/in.txt", "one");
+    EXPECT_FALSE(runner.run(action).cached);
+    write_file(dir + "/in.txt", "two");
+    EXPECT_FALSE(runner.run(action).cached);
+    EXPECT_THAT(counting_runner.count, Eq(2u));
+
+    // Back to the first revision
+    write_file(dir + "/in.txt", "one");
+    std::filesystem::remove_all(dir + "/out");
+    const ActionRunner::Result result = runner.run(action);
+    EXPECT_TRUE(result.success());
+    EXPECT_TRUE(result.cached);
+    EXPECT_THAT(counting_runner.count, Eq(2u));
+    EXPECT_THAT(read_file(dir + "/out/out.txt"), Eq("one"));
+    EXPECT_THAT(result.output, Eq("building\n"));
+
+    std::filesystem::remove_all(dir);
+}
+
+TEST(ActionCache, test_key) {
+    const std::string dir = testing::TempDir() + "mkr_action_cache_key";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+    write_file(dir + "/in.txt", "in");
+
+    ActionCache cache(dir + "/cache");
+    Action action;
+    action.command = {"cc"};
+    action.inputs = {dir + "/in.txt"};
+    action.outputs = {dir + "/out.o"};
+
+    const auto key = cache.key(action, {"PATH=/bin"});
+    ASSERT_TRUE(key.has_value());
+    EXPECT_THAT(cache.key(action, {"PATH=/bin"}), Eq(key));
+    EXPECT_THAT(cache.key(action, {"PATH=/usr/bin"}), testing::Ne(key));
+
+    action.command = {"cc", "-O2"};
+    EXPECT_THAT(cache.key(action, {"PATH=/bin"}), testing::Ne(key));
+
+    action.inputs = {dir + "/missing.txt"};
+    EXPECT_FALSE(cache.key(action, {"PATH=/bin"}).has_value());
+
+    std::filesystem::remove_all(dir);
+}
+
+TEST(FileStateDb, test_unchanged_files_are_not_read) {
+    const std::string dir = testing::TempDir() + "mkr_file_state_db";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+
+    // Old enough to not be racy
+    const auto old_time = std::filesystem::file_time_type::clock::now() - std::chrono::hours(1);
+    for (const std::string name: {"a", "b"}) {
+        write_file(dir + "/" + name, name);
+        std::filesystem::last_write_time(dir + "/" + name, old_time);
+    }
+
+    Digest a_digest;
+    {
+        FileStateDb db(dir + "/db");
+        a_digest = db.hash(dir + "/a").value();
+        EXPECT_THAT(a_digest, Eq(FileHasher::hash_file(dir + "/a").value()));
+        EXPECT_TRUE(db.hash(dir + "/b").has_value());
+        EXPECT_FALSE(db.hash(dir + "/missing").has_value());
+        EXPECT_THAT(db.files_hashed(), Eq(2u));
+        EXPECT_TRUE(db.save());
+    }
+
+    {
+        FileStateDb db(dir + "/db");
+        EXPECT_THAT(db.hash(dir + "/a"), Eq(a_digest));
+        EXPECT_THAT(db.files_hashed(), Eq(0u));
+
+        write_file(dir + "/b", "changed");
+        EXPECT_THAT(db.hash(dir + "/b"), Eq(FileHasher::hash_file(dir + "/b")));
+        EXPECT_THAT(db.files_hashed(), Eq(1u));
+    }
+
+    std::filesystem::remove_all(dir);
+}
+
+TEST(FileStateDb, test_corrupt_file) {
+    const std::string dir = testing::TempDir() + "mkr_file_state_db_corrupt";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+    write_file(dir + "/db", "not a database");
+    write_file(dir + "/a", "a");
+
+    FileStateDb db(dir + "/db");
+    EXPECT_TRUE(db.hash(dir + "/a").has_value());
+    EXPECT_THAT(db.files_hashed(), Eq(1u));
+
+    // Valid headers, with a path outside the path table, with a record count
+    // of which the size overflows, and with records out of order
+    const auto write_db = [&](uint64_t record_count, const std::vector<std::pair<uint64_t, uint64_t>> &records,
+                              const std::string &paths) {
+        std::string content = "MKRFSDB1";
+        const auto append_u64 = [&](uint64_t value) {
+            content.append(reinterpret_cast<const char *>(&value), sizeof(value));
+        };
+        append_u64(record_count);
+        append_u64(paths.size());
+        for (const auto &[offset, length]: records) {
+            append_u64(offset);
+            append_u64(length);
+            for (int i = 0; i < 6; i++) append_u64(0);
+        }
+        write_file(dir + "/db", content + paths);
+    };
+    write_db(1, {{1000, 1}}, "a");
+    EXPECT_TRUE(FileStateDb(dir + "/db").hash(dir + "/a").has_value());
+    write_db(uint64_t(1) << 58, {}, "a");
+    EXPECT_TRUE(FileStateDb(dir + "/db").hash(dir + "/a").has_value());
+    write_db(2, {{1, 1}, {0, 1}}, "ab");
+    EXPECT_TRUE(FileStateDb(dir + "/db").hash(dir + "/a").has_value());
+
+    std::filesystem::remove_all(dir);
+}
+
+TEST(Depfile, test_parse) {
+    EXPECT_THAT(parse_depfile("a.o: a.c a.h \\\n  b.h\nb.h:\n"), ElementsAre("a.c", "a.h", "b.h"));
+    EXPECT_THAT(parse_depfile("a.o: a\\ b.c c$$.h\r\n"), ElementsAre("a b.c", "c$.h"));
+    EXPECT_THAT(parse_depfile("a.o b.o: x.h\nc.o: x.h y.h\n"), ElementsAre("x.h", "y.h"));
+    EXPECT_THAT(parse_depfile(""), ElementsAre());
+    EXPECT_THROW((void) parse_depfile(": a.h"), DepfileError);
+    EXPECT_THROW((void) parse_depfile("a.o a.h"), DepfileError);
+}
+
+TEST(DepsLog, test_reopen) {
+    const std::string dir = testing::TempDir() + "mkr_deps_log";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+
+    {
+        DepsLog log(dir + "/deps_log");
+        EXPECT_FALSE(log.get("a.d").has_value());
+        EXPECT_TRUE(log.record("a.d", {"a.c", "a.h", "common.h"}));
+        EXPECT_TRUE(log.record("b.d", {"b.c", "common.h"}));
+        EXPECT_TRUE(log.record("a.d", {"a.c", "common.h"}));
+    }
+
+    DepsLog log(dir + "/deps_log");
+    EXPECT_THAT(log.size(), Eq(2u));
+    EXPECT_THAT(log.get("a.d").value(), ElementsAre("a.c", "common.h"));
+    EXPECT_THAT(log.get("b.d").value(), ElementsAre("b.c", "common.h"));
+
+    std::filesystem::remove_all(dir);
+}
+
+TEST(DepsLog, test_shared_by_processes) {
+    const std::string dir = testing::TempDir() + "mkr_deps_log_shared";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+
+    // As if opened by two processes, which number the paths they add
+    {
+        DepsLog first(dir + "/deps_log");
+        DepsLog second(dir + "/deps_log");
+        EXPECT_TRUE(first.record("a.d", {"a.c", "common.h"}));
+        EXPECT_TRUE(second.record("b.d", {"b.c", "b.h"}));
+        EXPECT_TRUE(first.record("c.d", {"c.c", "b.h"}));
+        EXPECT_THAT(first.get("b.d").value(), ElementsAre("b.c", "b.h"));
+    }
+
+    DepsLog log(dir + "/deps_log");
+    EXPECT_THAT(log.size(), Eq(3u));
+    EXPECT_THAT(log.get("a.d").value(), ElementsAre("a.c", "common.h"));
+    EXPECT_THAT(log.get("b.d").value(), ElementsAre("b.c", "b.h"));
+    EXPECT_THAT(log.get("c.d").value(), ElementsAre("c.c", "b.h"));
+
+    std::filesystem::remove_all(dir);
+}
+
+TEST(DepsLog, test_truncated_tail) {
+    const std::string dir = testing::TempDir() + "mkr_deps_log_truncated";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+
+    uintmax_t size_after_a;
+    {
+        DepsLog log(dir + "/deps_log");
+        EXPECT_TRUE(log.record("a.d", {"a.c"}));
+    }
+    size_after_a = std::filesystem::file_size(dir + "/deps_log");
+    {
+        DepsLog log(dir + "/deps_log");
+        EXPECT_TRUE(log.record("b.d", {"b.c"}));
+    }
+
+    // An interrupted write leaves part of a record
+    std::filesystem::resize_file(dir + "/deps_log", std::filesystem::file_size(dir + "/deps_log") - 3);
+    {
+        DepsLog log(dir + "/deps_log");
+        EXPECT_THAT(log.get("a.d").value(), ElementsAre("a.c"));
+        EXPECT_FALSE(log.get("b.d").has_value());
+        EXPECT_TRUE(log.record("c.d", {"c.c"}));
+    }
+    EXPECT_THAT(std::filesystem::file_size(dir + "/deps_log"), Gt(size_after_a));
+
+    DepsLog log(dir + "/deps_log");
+    EXPECT_THAT(log.get("c.d").value(), ElementsAre("c.c"));
+
+    write_file(dir + "/deps_log", "garbage");
+    DepsLog garbage_log(dir + "/deps_log");
+    EXPECT_THAT(garbage_log.size(), Eq(0u));
+
+    std::filesystem::remove_all(dir);
+}
+
+TEST(CachingActionRunner, test_discovered_inputs) {
+    const std::string dir = testing::TempDir() + "mkr_discovered_inputs";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir + "/out");
+
+    // Compiles a.c, which includes a.h, like gcc -MD would
+    Action action;
+    action.command = {"sh", "-c", "cat " + dir + "/a.c " + dir + "/a.h > " + dir + "/out/a.o; "
+                                  "echo '" + dir + "/out/a.o: " + dir + "/a.c \\\n " + dir + "/a.h' > " + dir + "/out/a.d"};
+    action.inputs = {dir + "/a.c"};
+    action.outputs = {dir + "/out/a.o"};
+    action.depfile = dir + "/out/a.d";
+
+    write_file(dir + "/a.c", "c");
+    write_file(dir + "/a.h", "one");
+
+    CountingActionRunner counting_runner;
+    ActionCache cache(dir + "/cache");
+    DepsLog deps_log(dir + "/deps_log");
+    CachingActionRunner runner(counting_runner, cache, {"PATH=/bin"}, deps_log);
+
+    EXPECT_TRUE(runner.run(action).success());
+    EXPECT_THAT(deps_log.get(action.depfile).value(), ElementsAre(dir + "/a.c", dir + "/a.h"));
+    EXPECT_TRUE(runner.run(action).cached);
+
+    // The header is not a declared input, but it is in the depfile
+    write_file(dir + "/a.h", "two");
+    EXPECT_FALSE(runner.run(action).cached);
+    EXPECT_THAT(read_file(dir + "/out/a.o"), Eq("ctwo"));
+    EXPECT_THAT(counting_runner.count, Eq(2u));
+
+    write_file(dir + "/a.h", "one");
+    std::filesystem::remove_all(dir + "/out");
+    EXPECT_TRUE(runner.run(action).cached);
+    EXPECT_THAT(read_file(dir + "/out/a.o"), Eq("cone"));
+    EXPECT_TRUE(std::filesystem::exists(action.depfile));
+    EXPECT_THAT(counting_runner.count, Eq(2u));
+
+    // A checkout without a deps log finds the inputs in the cache
+    {
+        DepsLog new_deps_log(dir + "/new_deps_log");
+        CachingActionRunner new_runner(counting_runner, cache, {"PATH=/bin"}, new_deps_log);
+        std::filesystem::remove_all(dir + "/out");
+        EXPECT_TRUE(new_runner.run(action).cached);
+        EXPECT_THAT(new_deps_log.get(action.depfile).value(), ElementsAre(dir + "/a.c", dir + "/a.h"));
+        EXPECT_THAT(counting_runner.count, Eq(2u));
+    }
+
+    // Without a depfile the action fails
+    action.command = {"touch", dir + "/out/a.o"};
+    std::filesystem::remove(action.depfile);
+    EXPECT_FALSE(runner.run(action).success());
+
+    std::filesystem::remove_all(dir);
+}
+
+TEST(CachingActionRunner, test_early_cutoff) {
+    const std::string dir = testing::TempDir() + "mkr_early_cutoff";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+
+    // Compiling drops the comments, so the link does not need to run again
+    // when only a comment changed
+    Action compile;
+    compile.id = "compile";
+    compile.command = {"sh", "-c", "grep -v '^#' " + dir + "/a.c > " + dir + "/a.o"};
+    compile.inputs = {dir + "/a.c"};
+    compile.outputs = {dir + "/a.o"};
+
+    Action link;
+    link.id = "link";
+    link.command = {"cp", dir + "/a.o", dir + "/a"};
+    link.inputs = {dir + "/a.o"};
+    link.outputs = {dir + "/a"};
+
+    CountingActionRunner counting_runner;
+    ActionCache cache(dir + "/cache");
+    DepsLog deps_log(dir + "/deps_log");
+    {
+        BuildLog build_log(dir + "/build_log");
+        CachingActionRunner runner(counting_runner, cache, {"PATH=/bin"}, deps_log, build_log);
+
+        write_file(dir + "/a.c", "# one\ncode\n");
+        EXPECT_TRUE(runner.run(compile).success());
+        EXPECT_TRUE(runner.run(link).success());
+        EXPECT_TRUE(runner.run(compile).up_to_date);
+        EXPECT_TRUE(runner.run(link).up_to_date);
+        EXPECT_TRUE(build_log.save());
+    }
+
+    BuildLog build_log(dir + "/build_log");
+    EXPECT_THAT(build_log.size(), Eq(2u));
+    CachingActionRunner runner(counting_runner, cache, {"PATH=/bin"}, deps_log, build_log);
+
+    write_file(dir + "/a.c", "# two\ncode\n");
+    const ActionRunner::Result compile_result = runner.run(compile);
+    EXPECT_FALSE(compile_result.up_to_date);
+    EXPECT_FALSE(compile_result.cached);
+    EXPECT_TRUE(runner.run(link).up_to_date);
+    EXPECT_THAT(counting_runner.count, Eq(3u));
+
+    // A changed output is not up to date, but can be restored
+    write_file(dir + "/a", "modified");
+    const ActionRunner::Result link_result = runner.run(link);
+    EXPECT_FALSE(link_result.up_to_date);
+    EXPECT_TRUE(link_result.cached);
+    EXPECT_THAT(read_file(dir + "/a"), Eq("code\n"));
+
+    std::filesystem::remove_all(dir);
+}
+
+TEST(ActionCallHandler, test_worker) {
+    BuildFixture fixture;
+    ASSERT_TRUE(fixture.interpret_str(
+            "a = action(command=[\"python3\" \"cc.py\" \"$in\"] inputs=[\"a.c\"] worker=[\"python3\" \"cc.py\"])"));
+    EXPECT_THAT(fixture.graph("a").node(0).action.worker, ElementsAre("python3", "cc.py"));
+
+    EXPECT_FALSE(fixture.interpret_str("b = action(command=[\"python3\" \"cc.py\"] worker=[\"cc.py\"])"));
+}
+
+TEST(WorkerPool, test_reuse) {
+    WorkerPool workers({}, 0);
+    const std::vector<std::string> command = {FAKE_WORKER_PATH};
+
+    const ActionRunner::Result echo = workers.run(command, {"echo", "a", "b"});
+    EXPECT_TRUE(echo.success());
+    EXPECT_THAT(echo.output, Eq("a b\n"));
+
+    const std::string pid = workers.run(command, {"pid"}).output;
+    EXPECT_THAT(workers.run(command, {"pid"}).output, Eq(pid));
+    EXPECT_THAT(workers.run(command, {"fail", "3"}).exit_code, Eq(3));
+    EXPECT_THAT(workers.workers_started(), Eq(1u));
+
+    // Concurrent requests need workers of their own
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 4; i++) {
+        threads.emplace_back([&] { EXPECT_TRUE(workers.run(command, {"echo"}).success()); });
+    }
+    for (std::thread &thread: threads) thread.join();
+    EXPECT_THAT(workers.workers_started(), testing::Le(4u));
+
+    const ActionRunner::Result missing = workers.run({"/non/existing/worker"}, {"echo"});
+    EXPECT_THAT(missing.exit_code, Eq(127));
+}
+
+TEST(WorkerPool, test_restart) {
+    WorkerPool workers({}, 64 * 1024 * 1024);
+    const std::vector<std::string> command = {FAKE_WORKER_PATH};
+
+    // Crashes again after a restart, so the action fails
+    const ActionRunner::Result crash = workers.run(command, {"crash"});
+    EXPECT_FALSE(crash.success());
+    EXPECT_THAT(crash.output, testing::HasSubstr("stopped"));
+    EXPECT_THAT(workers.workers_started(), Eq(2u));
+    EXPECT_TRUE(workers.run(command, {"echo"}).success());
+    EXPECT_THAT(workers.workers_started(), Eq(3u));
+
+    // Grows beyond the limit, so it is replaced
+    const std::string pid = workers.run(command, {"pid"}).output;
+    EXPECT_TRUE(workers.run(command, {"grow", "100"}).success());
+    EXPECT_THAT(workers.run(command, {"pid"}).output, testing::Ne(pid));
+}
+
+TEST(WorkerActionRunner, test_run) {
+    const std::string dir = testing::TempDir() + "mkr_worker_runner";
+    std::filesystem::remove_all(dir);
+
+    CountingActionRunner process_runner;
+    WorkerPool workers({}, 0);
+    WorkerActionRunner runner(process_runner, workers);
+
+    Action action;
+    action.command = {FAKE_WORKER_PATH, "--startup-ms=1", "touch", dir + "/sub/out"};
+    action.outputs = {dir + "/sub/out"};
+    action.worker = {FAKE_WORKER_PATH, "--startup-ms=1"};
+    EXPECT_TRUE(runner.run(action).success());
+    EXPECT_TRUE(std::filesystem::exists(dir + "/sub/out"));
+    EXPECT_THAT(process_runner.count, Eq(0u));
+    EXPECT_THAT(workers.workers_started(), Eq(1u));
+
+    // The same command runs once without a worker
+    std::filesystem::remove_all(dir);
+    action.worker.clear();
+    EXPECT_TRUE(runner.run(action).success());
+    EXPECT_TRUE(std::filesystem::exists(dir + "/sub/out"));
+    EXPECT_THAT(process_runner.count, Eq(1u));
+
+    std::filesystem::remove_all(dir);
+}
+
+TEST(RemoteActionRunner, test_run) {
+    const std::string dir = testing::TempDir() + "remote";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir + "/root/src");
+
+    // Paths of remote actions are relative to the root directory
+    const std::filesystem::path previous_dir = std::filesystem::current_path();
+    std::filesystem::current_path(dir + "/root");
+    {
+        RemoteWorker worker(dir + "/worker", dir + "/worker.sock");
+        worker.start(2);
+
+        write_file("src/in.txt", "input\n");
+        FileStateDb file_states(dir + "/file_states");
+        CountingActionRunner local;
+        RemoteActionRunner runner(local, {dir + "/worker.sock"}, {"PATH=/usr/bin:/bin"}, file_states);
+
+        Action action;
+        action.id = "double";
+        action.command = {"sh", "-c", "cat src/in.txt src/in.txt > out/double.txt; echo done"};
+        action.inputs = {"src/in.txt"};
+        action.outputs = {"out/double.txt"};
+        const ActionRunner::Result result = runner.run(action);
+        EXPECT_TRUE(result.success());
+        EXPECT_THAT(result.output, Eq("done\n"));
+        EXPECT_THAT(read_file("out/double.txt"), Eq("input\ninput\n"));
+        EXPECT_THAT(runner.remote_count(), Eq(1u));
+        EXPECT_THAT(local.count, Eq(0u));
+
+        // Actions without outputs are run for their side effects here
+        Action check;
+        check.command = {"true"};
+        EXPECT_TRUE(runner.run(check).success());
+        EXPECT_THAT(local.count, Eq(1u));
+
+        RemoteActionRunner unreachable(local, {dir + "/nobody.sock"}, {}, file_states);
+        const ActionRunner::Result local_result = unreachable.run(action);
+        EXPECT_TRUE(local_result.success());
+        EXPECT_THAT(local_result.output, StartsWith("Cannot connect"));
+        EXPECT_THAT(local.count, Eq(2u));
+    }
+    std::filesystem::current_path(previous_dir);
+}
+
+TEST(HttpCache, test_share_outputs) {
+    const std::string dir = testing::TempDir() + "mkr_http_cache";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+    write_file(dir + "/in.txt", "input");
+
+    Action action;
+    action.command = {"sh", "-c", "echo building; mkdir -p " + dir + "/out; cp " + dir + "/in.txt " + dir +
+                                  "/out/out.txt; echo 'echo hi' > " + dir + "/out/tool; chmod +x " + dir + "/out/tool"};
+    action.inputs = {dir + "/in.txt"};
+    action.outputs = {dir + "/out/out.txt", dir + "/out/tool"};
+
+    FileStateDb file_states(dir + "/file_states");
+    CountingActionRunner counting_runner;
+    unsigned int port;
+    {
+        HttpCacheServer server(dir + "/server", "127.0.0.1:0");
+        port = server.get_port();
+        std::thread serving([&server] { server.run(); });
+        const std::string url = "http://127.0.0.1:" + std::to_string(port) + "/mkr/";
+
+        // One machine builds the action and uploads its outputs
+        {
+            HttpCache remote(url, true);
+            ActionCache cache(dir + "/ci", file_states, remote);
+            CachingActionRunner runner(counting_runner, cache, {"PATH=/usr/bin:/bin"});
+            EXPECT_FALSE(runner.run(action).cached);
+            remote.wait();
+            EXPECT_THAT(remote.upload_count(), Eq(1u));
+            EXPECT_FALSE(remote.get_error().has_value());
+        }
+        EXPECT_THAT(counting_runner.count, Eq(1u));
+
+        // Another one restores them, and from its own cache after that
+        {
+            std::filesystem::remove_all(dir + "/out");
+            HttpCache remote(url, false);
+            ActionCache cache(dir + "/dev", file_states, remote);
+            CachingActionRunner runner(counting_runner, cache, {"PATH=/usr/bin:/bin"});
+            const ActionRunner::Result result = runner.run(action);
+            EXPECT_TRUE(result.cached);
+            EXPECT_THAT(result.output, Eq("building\n"));
+            EXPECT_THAT(read_file(dir + "/out/out.txt"), Eq("input"));
+            const auto perms = std::filesystem::status(dir + "/out/tool").permissions();
+            EXPECT_NE(perms & std::filesystem::perms::owner_exec, std::filesystem::perms::none);
+
+            std::filesystem::remove_all(dir + "/out");
+            EXPECT_TRUE(runner.run(action).cached);
+            EXPECT_THAT(cache.remote_count(), Eq(1u));
+
+            // Without upload, only this machine has the outputs
+            write_file(dir + "/in.txt", "changed");
+            EXPECT_FALSE(runner.run(action).cached);
+            remote.wait();
+            EXPECT_THAT(remote.upload_count(), Eq(0u));
+            EXPECT_THAT(counting_runner.count, Eq(2u));
+        }
+
+        server.stop();
+        serving.join();
+    }
+
+    // Without a server the actions run, and the cache is not used again
+    HttpCache remote("http://127.0.0.1:" + std::to_string(port), true);
+    ActionCache cache(dir + "/other", file_states, remote);
+    CachingActionRunner runner(counting_runner, cache, {"PATH=/usr/bin:/bin"});
+    EXPECT_TRUE(runner.run(action).success());
+    EXPECT_THAT(counting_runner.count, Eq(3u));
+    EXPECT_THAT(remote.get_error().value_or(""), StartsWith("Cannot connect"));
+
+    std::filesystem::remove_all(dir);
+}
+
+/*
+ * Interprets sources in which the Python units in a temporary directory can be
+ * imported.
+ */
+class PythonFixture : public BuildFixture {
+public:
+    PythonFixture() :
+            dir(testing::TempDir() + "mkr_python_units"),
+            python_units(store, dir, "python3") {
+        std::filesystem::remove_all(dir);
+        std::filesystem::create_directories(dir);
+    }
+
+    ~PythonFixture() {
+        std::filesystem::remove_all(dir);
+    }
+
+    void write_unit(const std::string &name, const std::string &content) {
+        write_file(dir + "/" + name, content);
+        import_resolver.set_external(name);
+    }
+
+    bool interpret_str(const std::string &input) {
+        StringSource &source = sources.emplace_back(input);
+        DefaultParser parser(import_resolver);
+        auto parse_result = parser.parse(source);
+        if (!parse_result.success()) return false;
+        const Node &ast = asts.emplace_back(parse_result.ast());
+        return Interpreter(store, scope, ast, call_cache, builtin_scope, python_units).interpret().success();
+    }
+
+    const std::string dir;
+    PythonUnitLoader python_units;
+};
+
+TEST(PythonUnitLoader, test_call) {
+    if (std::system("python3 -c '' 2>/dev/null") != 0) GTEST_SKIP() << "python3 is not available";
+
+    PythonFixture fixture;
+    fixture.write_unit("tools.py",
+               "import os\n"
+               "def flags(mode, extra=None):\n"
+               "    return ['-O2' if mode == 'release' else '-O0'] + (extra or [])\n"
+               "def describe(action):\n"
+               "    return {'outputs': action['outputs'], 'count': len(action['inputs'])}\n"
+               "def nothing():\n"
+               "    return None\n"
+               "def fail():\n"
+               "    raise ValueError('bad input')\n"
+               "def crash():\n"
+               "    os._exit(1)\n"
+               "def _private():\n"
+               "    pass\n");
+
+    ASSERT_TRUE(fixture.interpret_str("tools = import(\"tools.py\")"));
+    EXPECT_THROW(fixture.scope.get("tools").attr("_private"), UnknownAttributeError);
+    EXPECT_THROW(fixture.scope.get("tools").attr("os"), UnknownAttributeError);
+
+    ASSERT_TRUE(fixture.interpret_str("a = tools.flags(\"release\" extra=[\"-g\"])"));
+    const Object::Entries &flags = fixture.scope.get("a").entries();
+    ASSERT_THAT(flags.size(), Eq(2u));
+    EXPECT_THAT(flags[0].get().get_string(), Eq("-O2"));
+    EXPECT_THAT(flags[1].get().get_string(), Eq("-g"));
+
+    ASSERT_TRUE(fixture.interpret_str(
+            "b = tools.describe(action(command=[\"cc\" \"$in\"] inputs=[\"x.c\" \"y.c\"] outputs=[\"x.o\"]))"));
+    EXPECT_THAT(fixture.scope.get("b").attr("count").get_string(), Eq("2"));
+    EXPECT_THAT(fixture.scope.get("b").attr("outputs").entries()[0].get().get_string(), EndsWith("/x.o"));
+
+    // The same unit is imported once
+    ASSERT_TRUE(fixture.interpret_str("same = import(\"tools.py\")"));
+    EXPECT_THAT(fixture.scope.get("same"), Ref(fixture.scope.get("tools")));
+
+    EXPECT_FALSE(fixture.interpret_str("c = tools.nothing()"));
+    EXPECT_FALSE(fixture.interpret_str("d = tools.fail()"));
+    EXPECT_FALSE(fixture.interpret_str("e = tools.flags(tools.flags)"));
+    fixture.import_resolver.set_external("missing.py");
+    EXPECT_FALSE(fixture.interpret_str("f = import(\"missing.py\")"));
+    EXPECT_THAT(fixture.python_units.helpers_started(), Eq(1u));
+}
+
+TEST(PythonUnitLoader, test_restart) {
+    if (std::system("python3 -c '' 2>/dev/null") != 0) GTEST_SKIP() << "python3 is not available";
+
+    PythonFixture fixture;
+    fixture.write_unit("a.py", "def name():\n    return 'a'\n");
+    fixture.write_unit("b.py", "import os\ndef crash():\n    os._exit(1)\n");
+    ASSERT_TRUE(fixture.interpret_str("a = import(\"a.py\")\nb = import(\"b.py\")"));
+
+    // Crashes again after a restart, so the call fails
+    EXPECT_FALSE(fixture.interpret_str("x = b.crash()"));
+    EXPECT_THAT(fixture.python_units.helpers_started(), Eq(2u));
+
+    // The units are imported again by the next helper
+    ASSERT_TRUE(fixture.interpret_str("y = a.name()"));
+    EXPECT_THAT(fixture.scope.get("y").get_string(), Eq("a"));
+    EXPECT_THAT(fixture.python_units.helpers_started(), Eq(3u));
+
+    PythonUnitLoader missing_python(fixture.store, fixture.dir, "/non/existing/python");
+    EXPECT_THROW(missing_python.load("a.py"), ExternalObjectError);
+}
+
+TEST(PythonUnitLoader, test_forget) {
+    if (std::system("python3 -c '' 2>/dev/null") != 0) GTEST_SKIP() << "python3 is not available";
+
+    PythonFixture fixture;
+    fixture.write_unit("a.py", "def name():\n    return 'a'\n");
+    ASSERT_TRUE(fixture.interpret_str("a = import(\"a.py\")"));
+    ASSERT_TRUE(fixture.interpret_str("x = a.name()"));
+
+    fixture.write_unit("a.py", "def name():\n    return 'changed'\n");
+    fixture.python_units.forget("a.py");
+    ASSERT_TRUE(fixture.interpret_str("b = import(\"a.py\") y = b.name()"));
+    EXPECT_THAT(fixture.scope.get("y").get_string(), Eq("changed"));
+    EXPECT_FALSE(fixture.interpret_str("z = a.name()"));
+    EXPECT_THAT(fixture.python_units.helpers_started(), Eq(1u));
+}
+
+TEST(FileWatcher, test_wait) {
+    const std::string dir = testing::TempDir() + "file_watcher";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+    std::ofstream(dir + "/a.mkr") << "a";
+    std::ofstream(dir + "/other") << "other";
+
+    FileWatcher watcher;
+    watcher.watch({dir + "/a.mkr", dir + "/./b.mkr"});
+    EXPECT_THAT(watcher.size(), Eq(2u));
+
+    // A burst of changes is reported at once, a file that is created as well
+    std::thread thread([&] {
+        std::ofstream(dir + "/other") << "changed";
+        std::ofstream(dir + "/a.mkr") << "changed";
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        std::ofstream(dir + "/b.mkr") << "b";
+    });
+    const std::set<std::string> changed = watcher.wait(std::chrono::milliseconds(50));
+    thread.join();
+    EXPECT_THAT(changed, ElementsAre(dir + "/a.mkr", dir + "/b.mkr"));
+
+    std::thread stopper([&] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        watcher.stop();
+    });
+    EXPECT_TRUE(watcher.wait(std::chrono::milliseconds(50)).empty());
+    stopper.join();
+}
@@ -0,0 +1,532 @@
+//
+// Created by roel on 10/19/26.
+//
+
+#include "Blake3.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstring>
+#include <latch>
+#include <vector>
+
+#include "util/WorkStealingPool.h"
+
+static constexpr uint32_t iv[8] = {
+        0x6A09E667, 0xBB67AE85, 0x3C6EF372, 0xA54FF53A,
+        0x510E527F, 0x9B05688C, 0x1F83D9AB, 0x5BE0CD19
+};
+
+// The message word permutation applied for each of the 7 rounds
+static constexpr uint8_t msg_schedule[7][16] = {
+        {0,  1,  2,  3,  4,  5,  6,  7,  8,  9,  10, 11, 12, 13, 14, 15},
+        {2,  6,  3,  10, 7,  0,  4,  13, 1,  11, 12, 5,  9,  14, 15, 8},
+        {3,  4,  10, 12, 13, 2,  7,  14, 6,  5,  9,  0,  11, 15, 8,  1},
+        {10, 7,  12, 9,  14, 3,  13, 15, 4,  0,  11, 2,  5,  8,  1,  6},
+        {12, 13, 9,  11, 15, 10, 14, 8,  7,  2,  5,  3,  0,  1,  6,  4},
+        {9,  14, 11, 5,  8,  12, 15, 1,  13, 3,  0,  10, 2,  6,  4,  7},
+        {11, 15, 5,  0,  1,  9,  8,  6,  14, 10, 2,  12, 3,  4,  7,  13},
+};
+
+enum Flags : uint8_t {
+    CHUNK_START = 1 << 0,
+    CHUNK_END = 1 << 1,
+    PARENT = 1 << 2,
+    ROOT = 1 << 3,
+};
+
+// Inputs up to this size are not worth splitting over threads
+static constexpr size_t parallel_threshold = 512 * 1024;
+
+static constexpr size_t min_subtree_chunks = 64;
+
+static inline uint32_t load32(const uint8_t *bytes) {
+    uint32_t value;
+    memcpy(&value, bytes, sizeof(value));
+    if constexpr (std::endian::native == std::endian::big) value = __builtin_bswap32(value);
+    return value;
+}
+
+static inline void store32(uint8_t *bytes, uint32_t value) {
+    if constexpr (std::endian::native == std::endian::big) value = __builtin_bswap32(value);
+    memcpy(bytes, &value, sizeof(value));
+}
+
+/*
+ * The compression function, written once for scalars (one block) and for
+ * vectors (one block of each of several chunks, one chunk per lane). Vectors
+ * are passed by reference only, so the kernels do not depend on the vector
+ * calling convention of the target.
+ */
+template<typename T>
+[[gnu::always_inline]] static inline void xor_rotr(T &x, const T &y, int n) {
+    x ^= y;
+    x = (x >> n) | (x << (32 - n));
+}
+
+template<typename T>
+[[gnu::always_inline]] static inline void g(T *v, int a, int b, int c, int d, const T &x, const T &y) {
+    v[a] = v[a] + v[b] + x;
+    xor_rotr<T>(v[d], v[a], 16);
+    v[c] = v[c] + v[d];
+    xor_rotr<T>(v[b], v[c], 12);
+    v[a] = v[a] + v[b] + y;
+    xor_rotr<T>(v[d], v[a], 8);
+    v[c] = v[c] + v[d];
+    xor_rotr<T>(v[b], v[c], 7);
+}
+
+template<typename T>
+[[gnu::always_inline]] static inline void rounds(T *v, const T *m) {
+    // Unrolled, so all indices are constant and the state stays in registers
+#pragma GCC unroll 7
+    for (const auto &s: msg_schedule) {
+        g<T>(v, 0, 4, 8, 12, m[s[0]], m[s[1]]);
+        g<T>(v, 1, 5, 9, 13, m[s[2]], m[s[3]]);
+        g<T>(v, 2, 6, 10, 14, m[s[4]], m[s[5]]);
+        g<T>(v, 3, 7, 11, 15, m[s[6]], m[s[7]]);
+        g<T>(v, 0, 5, 10, 15, m[s[8]], m[s[9]]);
+        g<T>(v, 1, 6, 11, 12, m[s[10]], m[s[11]]);
+        g<T>(v, 2, 7, 8, 13, m[s[12]], m[s[13]]);
+        g<T>(v, 3, 4, 9, 14, m[s[14]], m[s[15]]);
+    }
+}
+
+static void compress(const uint32_t cv[8], const uint8_t block[Blake3::block_length], uint8_t block_length,
+                     uint64_t counter, uint8_t flags, uint32_t out[16]) {
+    uint32_t m[16];
+    for (size_t i = 0; i < 16; i++) {
+        m[i] = load32(block + 4 * i);
+    }
+
+    uint32_t v[16] = {
+            cv[0], cv[1], cv[2], cv[3], cv[4], cv[5], cv[6], cv[7],
+            iv[0], iv[1], iv[2], iv[3],
+            static_cast<uint32_t>(counter), static_cast<uint32_t>(counter >> 32), block_length, flags
+    };
+    rounds<uint32_t>(v, m);
+
+    for (size_t i = 0; i < 8; i++) {
+        out[i] = v[i] ^ v[i + 8];
+        out[i + 8] = v[i + 8] ^ cv[i];
+    }
+}
+
+static void parent_cv(const uint32_t left[8], const uint32_t right[8], uint32_t out[8]) {
+    uint8_t block[Blake3::block_length];
+    for (size_t i = 0; i < 8; i++) {
+        store32(block + 4 * i, left[i]);
+        store32(block + 32 + 4 * i, right[i]);
+    }
+    uint32_t words[16];
+    compress(iv, block, Blake3::block_length, 0, PARENT, words);
+    memcpy(out, words, 8 * sizeof(uint32_t));
+}
+
+typedef uint32_t Vector4 __attribute__((vector_size(16)));
+
+[[gnu::always_inline]] static inline void transpose(Vector4 (&rows)[4]) {
+    const Vector4 t0 = __builtin_shuffle(rows[0], rows[1], Vector4{0, 4, 1, 5});
+    const Vector4 t1 = __builtin_shuffle(rows[0], rows[1], Vector4{2, 6, 3, 7});
+    const Vector4 t2 = __builtin_shuffle(rows[2], rows[3], Vector4{0, 4, 1, 5});
+    const Vector4 t3 = __builtin_shuffle(rows[2], rows[3], Vector4{2, 6, 3, 7});
+    rows[0] = __builtin_shuffle(t0, t2, Vector4{0, 1, 4, 5});
+    rows[1] = __builtin_shuffle(t0, t2, Vector4{2, 3, 6, 7});
+    rows[2] = __builtin_shuffle(t1, t3, Vector4{0, 1, 4, 5});
+    rows[3] = __builtin_shuffle(t1, t3, Vector4{2, 3, 6, 7});
+}
+
+#if defined(__x86_64__)
+typedef uint32_t Vector8 __attribute__((vector_size(32)));
+
+[[gnu::always_inline]] static inline void transpose(Vector8 (&rows)[8]) {
+    const Vector8 lo32{0, 8, 1, 9, 4, 12, 5, 13};
+    const Vector8 hi32{2, 10, 3, 11, 6, 14, 7, 15};
+    const Vector8 lo64{0, 1, 8, 9, 4, 5, 12, 13};
+    const Vector8 hi64{2, 3, 10, 11, 6, 7, 14, 15};
+    const Vector8 lo128{0, 1, 2, 3, 8, 9, 10, 11};
+    const Vector8 hi128{4, 5, 6, 7, 12, 13, 14, 15};
+
+    Vector8 t[8];
+    for (size_t i = 0; i < 8; i += 2) {
+        t[i] = __builtin_shuffle(rows[i], rows[i + 1], lo32);
+        t[i + 1] = __builtin_shuffle(rows[i], rows[i + 1], hi32);
+    }
+    Vector8 u[8];
+    for (size_t i = 0; i < 8; i += 4) {
+        u[i] = __builtin_shuffle(t[i], t[i + 2], lo64);
+        u[i + 1] = __builtin_shuffle(t[i], t[i + 2], hi64);
+        u[i + 2] = __builtin_shuffle(t[i + 1], t[i + 3], lo64);
+        u[i + 3] = __builtin_shuffle(t[i + 1], t[i + 3], hi64);
+    }
+    for (size_t i = 0; i < 4; i++) {
+        rows[i] = __builtin_shuffle(u[i], u[i + 4], lo128);
+        rows[i + 4] = __builtin_shuffle(u[i], u[i + 4], hi128);
+    }
+}
+#endif
+
+/*
+ * Loads the message words of a block of each lane, such that m[word] holds
+ * that word for all lanes: loads lanes words of each lane at once and
+ * transposes them.
+ */
+template<typename V, size_t lanes>
+[[gnu::always_inline]] static inline void load_message(V (&m)[16], const uint8_t *block) {
+    for (size_t group = 0; group < 16 / lanes; group++) {
+        V rows[lanes];
+        for (size_t lane = 0; lane < lanes; lane++) {
+            memcpy(&rows[lane], block + lane * Blake3::chunk_length + group * lanes * 4, sizeof(V));
+            if constexpr (std::endian::native == std::endian::big) {
+                for (size_t i = 0; i < lanes; i++) rows[lane][i] = __builtin_bswap32(rows[lane][i]);
+            }
+        }
+        transpose(rows);
+        for (size_t lane = 0; lane < lanes; lane++) {
+            m[group * lanes + lane] = rows[lane];
+        }
+    }
+}
+
+/*
+ * Hashes lanes whole chunks at once, each in a lane of a vector, and writes
+ * their chaining values.
+ */
+template<typename V, size_t lanes>
+[[gnu::always_inline]] static inline void hash_chunks_parallel(const uint8_t *input, uint64_t counter,
+                                                               std::array<uint32_t, 8> *out) {
+    V h[8];
+    for (size_t i = 0; i < 8; i++) {
+        h[i] = V{} + iv[i];
+    }
+
+    V counter_low{};
+    V counter_high{};
+    for (size_t lane = 0; lane < lanes; lane++) {
+        counter_low[lane] = static_cast<uint32_t>(counter + lane);
+        counter_high[lane] = static_cast<uint32_t>((counter + lane) >> 32);
+    }
+
+    const size_t blocks = Blake3::chunk_length / Blake3::block_length;
+    for (size_t block = 0; block < blocks; block++) {
+        V m[16];
+        load_message<V, lanes>(m, input + block * Blake3::block_length);
+
+        const uint32_t flags = (block == 0 ? CHUNK_START : 0) | (block == blocks - 1 ? CHUNK_END : 0);
+        V v[16] = {
+                h[0], h[1], h[2], h[3], h[4], h[5], h[6], h[7],
+                V{} + iv[0], V{} + iv[1], V{} + iv[2], V{} + iv[3],
+                counter_low, counter_high, V{} + static_cast<uint32_t>(Blake3::block_length), V{} + flags
+        };
+        rounds<V>(v, m);
+
+        for (size_t i = 0; i < 8; i++) {
+            h[i] = v[i] ^ v[i + 8];
+        }
+    }
+
+    for (size_t lane = 0; lane < lanes; lane++) {
+        for (size_t i = 0; i < 8; i++) {
+            out[lane][i] = h[i][lane];
+        }
+    }
+}
+
+static void hash_chunks_x4(const uint8_t *input, uint64_t counter, std::array<uint32_t, 8> *out) {
+    hash_chunks_parallel<Vector4, 4>(input, counter, out);
+}
+
+#if defined(__x86_64__)
+[[gnu::target("avx2")]]
+static void hash_chunks_x8(const uint8_t *input, uint64_t counter, std::array<uint32_t, 8> *out) {
+    hash_chunks_parallel<Vector8, 8>(input, counter, out);
+}
+
+static bool has_avx2() {
+    static const bool supported = __builtin_cpu_supports("avx2");
+    return supported;
+}
+#endif
+
+/*
+ * Blake3::*
+ */
+
+struct Blake3::Output {
+    uint32_t input_cv[8];
+    uint8_t block[block_length];
+    uint8_t length;
+    uint64_t counter;
+    uint8_t flags;
+
+    void chaining_value(uint32_t cv[8]) const {
+        uint32_t words[16];
+        compress(input_cv, block, length, counter, flags, words);
+        memcpy(cv, words, 8 * sizeof(uint32_t));
+    }
+
+    void root_bytes(uint8_t *out, size_t out_length) const {
+        uint64_t output_counter = 0;
+        while (out_length > 0) {
+            uint32_t words[16];
+            compress(input_cv, block, length, output_counter++, flags | ROOT, words);
+
+            uint8_t bytes[64];
+            for (size_t i = 0; i < 16; i++) {
+                store32(bytes + 4 * i, words[i]);
+            }
+            const size_t n = std::min(out_length, sizeof(bytes));
+            memcpy(out, bytes, n);
+            out += n;
+            out_length -= n;
+        }
+    }
+};
+
+Blake3::ChunkState::ChunkState(uint64_t chunk_counter_) :
+        cv(),
+        chunk_counter(chunk_counter_),
+        buffer(),
+        buffer_length(0),
+        blocks_compressed(0) {
+    memcpy(cv, iv, sizeof(cv));
+}
+
+size_t Blake3::ChunkState::length() const {
+    return block_length * blocks_compressed + buffer_length;
+}
+
+void Blake3::ChunkState::update(const uint8_t *input, size_t input_length) {
+    while (input_length > 0) {
+        if (buffer_length == block_length) {
+            uint32_t words[16];
+            compress(cv, buffer, block_length, chunk_counter, flags(), words);
+            memcpy(cv, words, sizeof(cv));
+            blocks_compressed++;
+            buffer_length = 0;
+            memset(buffer, 0, sizeof(buffer));
+        }
+
+        const size_t n = std::min(input_length, block_length - buffer_length);
+        memcpy(buffer + buffer_length, input, n);
+        buffer_length += n;
+        input += n;
+        input_length -= n;
+    }
+}
+
+uint8_t Blake3::ChunkState::flags() const {
+    return blocks_compressed == 0 ? CHUNK_START : 0;
+}
+
+Blake3::Output Blake3::ChunkState::output() const {
+    Output output{};
+    memcpy(output.input_cv, cv, sizeof(cv));
+    memcpy(output.block, buffer, sizeof(buffer));
+    output.length = buffer_length;
+    output.counter = chunk_counter;
+    output.flags = flags() | CHUNK_END;
+    return output;
+}
+
+// The chaining value stack is left uninitialized, only the first
+// cv_stack_length entries are ever read
+Blake3::Blake3() :
+        chunk(0),
+        cv_stack_length(0) {}
+
+/*
+ * Writes the chaining values of up to count whole chunks, and returns how many
+ * it wrote: as many as the widest available kernel takes at once.
+ */
+static size_t hash_chunks(const uint8_t *input, size_t count, uint64_t counter, std::array<uint32_t, 8> *out) {
+#if defined(__x86_64__)
+    if (count >= 8 && has_avx2()) {
+        hash_chunks_x8(input, counter, out);
+        return 8;
+    }
+#endif
+    if (count >= 4) {
+        hash_chunks_x4(input, counter, out);
+        return 4;
+    }
+
+    // A single chunk: sequential blocks of one chunk depend on each other
+    uint32_t cv[8];
+    memcpy(cv, iv, sizeof(cv));
+    const size_t blocks = Blake3::chunk_length / Blake3::block_length;
+    for (size_t block = 0; block < blocks; block++) {
+        const uint8_t flags = (block == 0 ? CHUNK_START : 0) | (block == blocks - 1 ? CHUNK_END : 0);
+        uint32_t words[16];
+        compress(cv, input + block * Blake3::block_length, Blake3::block_length, counter, flags, words);
+        memcpy(cv, words, sizeof(cv));
+    }
+    std::copy(cv, cv + 8, out->begin());
+    return 1;
+}
+
+/*
+ * Chaining value of a complete subtree of chunk_count chunks (a power of two).
+ */
+static void subtree_cv(const uint8_t *input, size_t chunk_count, uint64_t counter, uint32_t out[8]) {
+    std::vector<std::array<uint32_t, 8>> cvs(chunk_count);
+    for (size_t done = 0; done < chunk_count;) {
+        done += hash_chunks(input + done * Blake3::chunk_length, chunk_count - done, counter + done, &cvs[done]);
+    }
+
+    for (size_t count = chunk_count; count > 1; count /= 2) {
+        for (size_t i = 0; i < count / 2; i++) {
+            parent_cv(cvs[2 * i].data(), cvs[2 * i + 1].data(), cvs[i].data());
+        }
+    }
+    std::copy(cvs[0].begin(), cvs[0].end(), out);
+}
+
+Blake3 &Blake3::update(const void *data, size_t length) {
+    auto input = static_cast<const uint8_t *>(data);
+
+    while (length > 0) {
+        if (chunk.length() == chunk_length) {
+            // There is more input, so this chunk is not the root
+            uint32_t cv[8];
+            chunk.output().chaining_value(cv);
+            push_subtree(cv, 1);
+        }
+
+        if (chunk.length() == 0 && length > chunk_length) {
+            // Whole chunks, except the last one which may be the root
+            std::array<uint32_t, 8> cvs[8];
+            const size_t count = hash_chunks(input, (length - 1) / chunk_length, chunk.chunk_counter, cvs);
+            for (size_t i = 0; i < count; i++) {
+                push_subtree(cvs[i].data(), 1);
+            }
+            input += count * chunk_length;
+            length -= count * chunk_length;
+            continue;
+        }
+
+        // Everything before the current chunk is complete, which finalize()
+        // relies on
+        merge_cv_stack(chunk.chunk_counter);
+
+        const size_t n = std::min(length, chunk_length - chunk.length());
+        chunk.update(input, n);
+        input += n;
+        length -= n;
+    }
+    return *this;
+}
+
+void Blake3::push_subtree(const uint32_t cv[8], uint64_t chunk_count) {
+    merge_cv_stack(chunk.chunk_counter);
+    memcpy(cv_stack[cv_stack_length++], cv, 8 * sizeof(uint32_t));
+    chunk = ChunkState(chunk.chunk_counter + chunk_count);
+}
+
+/*
+ * Merges completed subtrees, leaving one chaining value on the stack for each
+ * 1 bit in total_chunks. The last subtree is only merged when more input
+ * follows, as it may turn out to be the root.
+ */
+void Blake3::merge_cv_stack(uint64_t total_chunks) {
+    const size_t post_merge_length = std::popcount(total_chunks);
+    while (cv_stack_length > post_merge_length) {
+        parent_cv(cv_stack[cv_stack_length - 2], cv_stack[cv_stack_length - 1], cv_stack[cv_stack_length - 2]);
+        cv_stack_length--;
+    }
+}
+
+Blake3::Output Blake3::parent_output(const uint32_t left[8], const uint32_t right[8]) {
+    Output output{};
+    memcpy(output.input_cv, iv, sizeof(iv));
+    for (size_t i = 0; i < 8; i++) {
+        store32(output.block + 4 * i, left[i]);
+        store32(output.block + 32 + 4 * i, right[i]);
+    }
+    output.length = block_length;
+    output.counter = 0;
+    output.flags = PARENT;
+    return output;
+}
+
+void Blake3::finalize(uint8_t *out, size_t length) const {
+    if (cv_stack_length == 0) {
+        chunk.output().root_bytes(out, length);
+        return;
+    }
+
+    size_t remaining = cv_stack_length;
+    Output output{};
+    if (chunk.length() > 0) {
+        output = chunk.output();
+    } else {
+        output = parent_output(cv_stack[remaining - 2], cv_stack[remaining - 1]);
+        remaining -= 2;
+    }
+
+    while (remaining > 0) {
+        uint32_t cv[8];
+        output.chaining_value(cv);
+        output = parent_output(cv_stack[--remaining], cv);
+    }
+    output.root_bytes(out, length);
+}
+
+Digest Blake3::digest() const {
+    uint8_t out[16];
+    finalize(out, sizeof(out));
+
+    uint64_t hi = 0;
+    uint64_t lo = 0;
+    for (size_t i = 0; i < 8; i++) {
+        hi = (hi << 8) | out[i];
+        lo = (lo << 8) | out[8 + i];
+    }
+    return {hi, lo};
+}
+
+Digest Blake3::hash(const void *data, size_t length, WorkStealingPool *pool) {
+    if (!pool || length < parallel_threshold) {
+        return Blake3().update(data, length).digest();
+    }
+
+    // Several subtrees per thread, so threads that finish early can steal
+    const size_t target_chunks = length / chunk_length / (4 * pool->size());
+    const size_t subtree_chunks = std::max(min_subtree_chunks, std::bit_floor(std::max<size_t>(target_chunks, 1)));
+    const size_t subtree_length = subtree_chunks * chunk_length;
+
+    // Keep at least one byte for the last chunk, which may be the root
+    const size_t subtrees = (length - 1) / subtree_length;
+    if (subtrees < 2) {
+        return Blake3().update(data, length).digest();
+    }
+
+    // Waits for its own subtrees only, so that other threads can use the pool
+    // at the same time
+    auto input = static_cast<const uint8_t *>(data);
+    std::vector<std::array<uint32_t, 8>> cvs(subtrees);
+    std::latch done(static_cast<std::ptrdiff_t>(subtrees));
+    for (size_t i = 0; i < subtrees; i++) {
+        pool->submit([&, i] {
+            subtree_cv(input + i * subtree_length, subtree_chunks, i * subtree_chunks, cvs[i].data());
+            done.count_down();
+        });
+    }
+    done.wait();
+
+    Blake3 hasher;
+    for (const auto &cv: cvs) {
+        hasher.push_subtree(cv.data(), subtree_chunks);
+    }
+    const size_t tail = subtrees * subtree_length;
+    hasher.update(input + tail, length - tail);
+    return hasher.digest();
+}
+
+const char *Blake3::kernel_name() {
+#if defined(__x86_64__)
+    if (has_avx2()) return "avx2 x8";
+#endif
+    return "vector x4";
+}
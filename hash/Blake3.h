@@ -0,0 +1,90 @@
+//
+// Created by roel on 10/19/26.
+//
+
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+#include "util/Digest.h"
+
+class WorkStealingPool;
+
+/*
+ * Incremental BLAKE3 hasher (unkeyed mode).
+ *
+ * The input is split in chunks of 1 KiB which are the leaves of a binary
+ * tree. Runs of whole chunks are compressed several at a time with vector
+ * instructions, and large buffers can be split in subtrees that are hashed
+ * on a thread pool. digest() is the first 128 bits of the 256 bit hash.
+ */
+class Blake3 {
+public:
+    static constexpr size_t key_length = 32;
+    static constexpr size_t out_length = 32;
+    static constexpr size_t block_length = 64;
+    static constexpr size_t chunk_length = 1024;
+
+    Blake3();
+
+    Blake3 &update(const void *data, size_t length);
+
+    /*
+     * Writes length bytes of output, which may be more than out_length.
+     */
+    void finalize(uint8_t *out, size_t length) const;
+
+    [[nodiscard]] Digest digest() const;
+
+    /*
+     * Hashes a buffer at once. Buffers larger than a few hundred KiB are split
+     * in subtrees which are hashed in parallel on the pool, if given. Threads
+     * may share the pool, but must not call this from a task of that pool.
+     */
+    static Digest hash(const void *data, size_t length, WorkStealingPool *pool = nullptr);
+
+    /*
+     * Name of the vector kernel used for runs of whole chunks.
+     */
+    static const char *kernel_name();
+
+private:
+    struct Output;
+
+    struct ChunkState {
+        uint32_t cv[8];
+        uint64_t chunk_counter;
+        uint8_t buffer[block_length];
+        uint8_t buffer_length;
+        uint8_t blocks_compressed;
+
+        explicit ChunkState(uint64_t chunk_counter_);
+
+        [[nodiscard]] size_t length() const;
+
+        void update(const uint8_t *input, size_t input_length);
+
+        [[nodiscard]] uint8_t flags() const;
+
+        [[nodiscard]] Output output() const;
+    };
+
+    // Enough for 2^54 chunks, the maximum input length of BLAKE3
+    static constexpr size_t max_depth = 54;
+
+    ChunkState chunk;
+    uint32_t cv_stack[max_depth][8];
+    size_t cv_stack_length;
+
+    /*
+     * Adds the chaining value of a subtree of chunk_count (a power of two)
+     * chunks, of which the first chunk is the current chunk.
+     */
+    void push_subtree(const uint32_t cv[8], uint64_t chunk_count);
+
+    void merge_cv_stack(uint64_t total_chunks);
+
+    static Output parent_output(const uint32_t left[8], const uint32_t right[8]);
+};
@@ -0,0 +1,77 @@
+//
+// Created by roel on 10/19/26.
+//
+
+#include "FileHasher.h"
+#include "Blake3.h"
+
+#include <latch>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Files from this size on are memory mapped instead of read
+static constexpr size_t mmap_threshold = 256 * 1024;
+
+static constexpr size_t read_buffer_size = 64 * 1024;
+
+FileHasher::FileHasher(unsigned int threads) :
+        pool(threads) {}
+
+std::optional<Digest> FileHasher::hash(const std::string &path) {
+    return hash_file(path, &pool);
+}
+
+std::vector<std::optional<Digest>> FileHasher::hash_all(const std::vector<std::string> &paths) {
+    std::vector<std::optional<Digest>> digests(paths.size());
+    std::latch done(static_cast<std::ptrdiff_t>(paths.size()));
+    for (size_t i = 0; i < paths.size(); i++) {
+        pool.submit([&, i] {
+            digests[i] = hash_file(paths[i]);
+            done.count_down();
+        });
+    }
+    done.wait();
+    return digests;
+}
+
+static std::optional<Digest> hash_mapped(int fd, size_t size, WorkStealingPool *pool) {
+    void *address = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (address == MAP_FAILED) return std::nullopt;
+    madvise(address, size, MADV_SEQUENTIAL | MADV_WILLNEED);
+
+    const Digest digest = Blake3::hash(address, size, pool);
+    munmap(address, size);
+    return digest;
+}
+
+static std::optional<Digest> hash_read(int fd) {
+    Blake3 hasher;
+    uint8_t buffer[read_buffer_size];
+    while (true) {
+        const ssize_t n = read(fd, buffer, sizeof(buffer));
+        if (n == 0) break;
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return std::nullopt;
+        }
+        hasher.update(buffer, static_cast<size_t>(n));
+    }
+    return hasher.digest();
+}
+
+std::optional<Digest> FileHasher::hash_file(const std::string &path, WorkStealingPool *pool) {
+    const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return std::nullopt;
+
+    struct stat st{};
+    std::optional<Digest> digest;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && static_cast<size_t>(st.st_size) >= mmap_threshold) {
+        digest = hash_mapped(fd, static_cast<size_t>(st.st_size), pool);
+    } else {
+        digest = hash_read(fd);
+    }
+    close(fd);
+    return digest;
+}
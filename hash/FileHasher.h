@@ -0,0 +1,40 @@
+//
+// Created by roel on 10/19/26.
+//
+
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <optional>
+
+#include "util/Digest.h"
+#include "util/WorkStealingPool.h"
+
+/*
+ * Hashes the contents of files with Blake3. Large files are memory mapped and
+ * split over the threads of the pool, many small files are hashed on the
+ * pool one file per task. Safe to call concurrently, the threads then share
+ * the pool.
+ */
+class FileHasher {
+public:
+    explicit FileHasher(unsigned int threads);
+
+    /*
+     * Returns the digest of the contents of a file, or nothing if it cannot be
+     * read.
+     */
+    std::optional<Digest> hash(const std::string &path);
+
+    std::vector<std::optional<Digest>> hash_all(const std::vector<std::string> &paths);
+
+    /*
+     * Hashes a file on the calling thread, or split over the pool if given.
+     */
+    static std::optional<Digest> hash_file(const std::string &path, WorkStealingPool *pool = nullptr);
+
+private:
+    WorkStealingPool pool;
+};
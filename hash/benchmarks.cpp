@@ -0,0 +1,86 @@
+//
+// Created by roel on 10/19/26.
+//
+
+#include <benchmark/benchmark.h>
+
+#include "hash/Blake3.h"
+#include "hash/FileHasher.h"
+
+#include <filesystem>
+#include <fstream>
+#include <thread>
+#include <vector>
+
+static std::vector<uint8_t> random_bytes(size_t length) {
+    std::vector<uint8_t> bytes(length);
+    uint64_t x = 0x9E3779B97F4A7C15ULL;
+    for (uint8_t &byte: bytes) {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        byte = static_cast<uint8_t>(x);
+    }
+    return bytes;
+}
+
+static void BM_blake3_buffer(benchmark::State &state) {
+    const std::vector<uint8_t> input = random_bytes(static_cast<size_t>(state.range(0)));
+    for (auto _: state) {
+        benchmark::DoNotOptimize(Blake3().update(input.data(), input.size()).digest());
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * input.size()));
+    state.SetLabel(Blake3::kernel_name());
+}
+
+BENCHMARK(BM_blake3_buffer)->Arg(64)->Arg(1024)->Arg(64 * 1024)->Arg(16 * 1024 * 1024);
+
+static void BM_blake3_buffer_parallel(benchmark::State &state) {
+    const std::vector<uint8_t> input = random_bytes(64 * 1024 * 1024);
+    WorkStealingPool pool(std::max(1u, std::thread::hardware_concurrency()));
+    for (auto _: state) {
+        benchmark::DoNotOptimize(Blake3::hash(input.data(), input.size(), &pool));
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * input.size()));
+}
+
+BENCHMARK(BM_blake3_buffer_parallel)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+/*
+ * A synthetic source tree: many small files and a few large ones, 256 MiB in
+ * total.
+ */
+static std::vector<std::string> create_tree(const std::string &dir, size_t &total_size) {
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+
+    const std::vector<uint8_t> bytes = random_bytes(32 * 1024 * 1024);
+    std::vector<std::string> paths;
+    total_size = 0;
+
+    auto add_file = [&](size_t size) {
+        paths.push_back(dir + "/" + std::to_string(paths.size()));
+        std::ofstream(paths.back(), std::ios::binary).write(reinterpret_cast<const char *>(bytes.data()),
+                                                             static_cast<std::streamsize>(size));
+        total_size += size;
+    };
+    for (size_t i = 0; i < 8192; i++) add_file(4 * 1024 + (i * 977) % (28 * 1024));
+    for (size_t i = 0; i < 4; i++) add_file(32 * 1024 * 1024);
+    return paths;
+}
+
+static void BM_hash_synthetic_tree(benchmark::State &state) {
+    const std::string dir = std::filesystem::temp_directory_path().string() + "/mkr_hash_tree";
+    size_t total_size;
+    const std::vector<std::string> paths = create_tree(dir, total_size);
+
+    FileHasher hasher(static_cast<unsigned int>(state.range(0)));
+    for (auto _: state) {
+        benchmark::DoNotOptimize(hasher.hash_all(paths));
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * total_size));
+
+    std::filesystem::remove_all(dir);
+}
+
+BENCHMARK(BM_hash_synthetic_tree)->Arg(1)->Arg(8)->Unit(benchmark::kMillisecond)->UseRealTime();
@@ -0,0 +1,146 @@
+//
+// Created by roel on 10/19/26.
+//
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+using testing::Eq;
+using testing::ElementsAre;
+
+#include "hash/Blake3.h"
+#include "hash/FileHasher.h"
+
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+
+/*
+ * The inputs of the official BLAKE3 test vectors: bytes 0, 1, ..., 250, 0, 1, ...
+ */
+static std::vector<uint8_t> test_input(size_t length) {
+    std::vector<uint8_t> input(length);
+    for (size_t i = 0; i < length; i++) {
+        input[i] = static_cast<uint8_t>(i % 251);
+    }
+    return input;
+}
+
+static std::string hex(const uint8_t *bytes, size_t length) {
+    std::string str;
+    char buf[3];
+    for (size_t i = 0; i < length; i++) {
+        snprintf(buf, sizeof(buf), "%02x", bytes[i]);
+        str += buf;
+    }
+    return str;
+}
+
+static std::string blake3_hex(const std::vector<uint8_t> &input) {
+    uint8_t out[Blake3::out_length];
+    Blake3().update(input.data(), input.size()).finalize(out, sizeof(out));
+    return hex(out, sizeof(out));
+}
+
+TEST(Blake3, test_vectors) {
+    const std::vector<std::pair<size_t, std::string>> vectors = {
+            {0,       "af1349b9f5f9a1a6a0404dea36dcc9499bcb25c9adc112b7cc9a93cae41f3262"},
+            {1,       "2d3adedff11b61f14c886e35afa036736dcd87a74d27b5c1510225d0f592e213"},
+            {63,      "e9bc37a594daad83be9470df7f7b3798297c3d834ce80ba85d6e207627b7db7b"},
+            {64,      "4eed7141ea4a5cd4b788606bd23f46e212af9cacebacdc7d1f4c6dc7f2511b98"},
+            {65,      "de1e5fa0be70df6d2be8fffd0e99ceaa8eb6e8c93a63f2d8d1c30ecb6b263dee"},
+            {1023,    "10108970eeda3eb932baac1428c7a2163b0e924c9a9e25b35bba72b28f70bd11"},
+            {1024,    "42214739f095a406f3fc83deb889744ac00df831c10daa55189b5d121c855af7"},
+            {1025,    "d00278ae47eb27b34faecf67b4fe263f82d5412916c1ffd97c8cb7fb814b8444"},
+            {2048,    "e776b6028c7cd22a4d0ba182a8bf62205d2ef576467e838ed6f2529b85fba24a"},
+            {2049,    "5f4d72f40d7a5f82b15ca2b2e44b1de3c2ef86c426c95c1af0b6879522563030"},
+            {3072,    "b98cb0ff3623be03326b373de6b9095218513e64f1ee2edd2525c7ad1e5cffd2"},
+            {3073,    "7124b49501012f81cc7f11ca069ec9226cecb8a2c850cfe644e327d22d3e1cd3"},
+            {4096,    "015094013f57a5277b59d8475c0501042c0b642e531b0a1c8f58d2163229e969"},
+            {4097,    "9b4052b38f1c5fc8b1f9ff7ac7b27cd242487b3d890d15c96a1c25b8aa0fb995"},
+            {5120,    "9cadc15fed8b5d854562b26a9536d9707cadeda9b143978f319ab34230535833"},
+            {8192,    "aae792484c8efe4f19e2ca7d371d8c467ffb10748d8a5a1ae579948f718a2a63"},
+            {8193,    "bab6c09cb8ce8cf459261398d2e7aef35700bf488116ceb94a36d0f5f1b7bc3b"},
+            {16384,   "f875d6646de28985646f34ee13be9a576fd515f76b5b0a26bb324735041ddde4"},
+            {31744,   "62b6960e1a44bcc1eb1a611a8d6235b6b4b78f32e7abc4fb4c6cdcce94895c47"},
+            {102400,  "bc3e3d41a1146b069abffad3c0d44860cf664390afce4d9661f7902e7943e085"},
+            {1048577, "2f053cd7472cf0cd2f9adaf45c1180255b91b9a865404a63671a0ee5f792ed33"},
+    };
+    for (const auto &[length, expected]: vectors) {
+        EXPECT_THAT(blake3_hex(test_input(length)), Eq(expected)) << "length " << length;
+    }
+}
+
+TEST(Blake3, test_digest) {
+    const std::string abc = "abc";
+    EXPECT_THAT(Blake3().update(abc.data(), abc.size()).digest().to_string(),
+                Eq("6437b3ac38465133ffb63b75273a8db5"));
+}
+
+TEST(Blake3, test_incremental) {
+    const std::vector<uint8_t> input = test_input(1048577);
+    const Digest expected = Blake3().update(input.data(), input.size()).digest();
+
+    for (size_t piece: {1, 63, 1000, 1024, 4097, 65536}) {
+        Blake3 hasher;
+        for (size_t pos = 0; pos < input.size(); pos += piece) {
+            hasher.update(input.data() + pos, std::min(piece, input.size() - pos));
+        }
+        EXPECT_THAT(hasher.digest(), Eq(expected)) << "piece " << piece;
+    }
+}
+
+TEST(Blake3, test_parallel) {
+    WorkStealingPool pool(4);
+    for (size_t length: {512 * 1024, 4 * 1024 * 1024, 4 * 1024 * 1024 + 1, 5 * 1024 * 1024 + 1000}) {
+        const std::vector<uint8_t> input = test_input(length);
+        EXPECT_THAT(Blake3::hash(input.data(), input.size(), &pool),
+                    Eq(Blake3().update(input.data(), input.size()).digest())) << "length " << length;
+    }
+
+    const std::vector<uint8_t> input = test_input(1048577);
+    EXPECT_THAT(Blake3::hash(input.data(), input.size(), &pool).to_string(),
+                Eq("2f053cd7472cf0cd2f9adaf45c118025"));
+}
+
+TEST(FileHasher, test_hash_files) {
+    const std::string dir = testing::TempDir() + "mkr_file_hasher";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+
+    std::vector<std::string> paths;
+    std::vector<Digest> expected;
+    for (size_t length: {0, 100, 300 * 1024, 3 * 1024 * 1024}) {
+        const std::vector<uint8_t> input = test_input(length);
+        paths.push_back(dir + "/" + std::to_string(length));
+        std::ofstream(paths.back(), std::ios::binary).write(reinterpret_cast<const char *>(input.data()),
+                                                             static_cast<std::streamsize>(input.size()));
+        expected.push_back(Blake3().update(input.data(), input.size()).digest());
+    }
+    paths.push_back(dir + "/missing");
+
+    FileHasher hasher(3);
+    const auto digests = hasher.hash_all(paths);
+    ASSERT_THAT(digests.size(), Eq(paths.size()));
+    for (size_t i = 0; i < expected.size(); i++) {
+        EXPECT_THAT(digests[i], Eq(expected[i]));
+        EXPECT_THAT(hasher.hash(paths[i]), Eq(expected[i]));
+    }
+    EXPECT_FALSE(digests.back().has_value());
+
+    // Threads that hash at the same time share the pool
+    std::atomic<unsigned int> matching(0);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 4; i++) {
+        threads.emplace_back([&] {
+            if (hasher.hash(paths[3]) == expected[3]) matching++;
+        });
+    }
+    for (std::thread &thread: threads) {
+        thread.join();
+    }
+    EXPECT_THAT(matching.load(), Eq(4u));
+
+    std::filesystem::remove_all(dir);
+}
@@ -8,6 +8,14 @@ Object &BasicObjectStore::create_struct(std::unordered_map<std::string, const Ob
     return struct_objects.emplace_back(attributes);
 }
 
+Object &BasicObjectStore::create_struct(const Object &base, std::unordered_map<std::string, const Object &> attributes) {
+    Object::Attributes derived = base.attributes();
+    for (const auto &[id, value]: attributes) {
+        derived = derived.set(id, value);
+    }
+    return struct_objects.emplace_back(std::move(derived));
+}
+
 Object &BasicObjectStore::create_function(CallHandler &handler) {
     return function_objects.emplace_back(handler);
 }
@@ -19,3 +27,25 @@ Object &BasicObjectStore::create_string(std::string value) {
 Object &BasicObjectStore::create_list(std::list<std::reference_wrapper<const Object>> entries) {
     return list_objects.emplace_back(entries);
 }
+
+Object &BasicObjectStore::create_concatenated_list(const Object &lhs, const Object &rhs) {
+    return list_objects.emplace_back(lhs.entries().concat(rhs.entries()));
+}
+
+Object &BasicObjectStore::create_appended_list(const Object &list, const Object &entry) {
+    return list_objects.emplace_back(list.entries().push_back(entry));
+}
+
+Object &BasicObjectStore::create_sliced_list(const Object &list, size_t begin, size_t end) {
+    return list_objects.emplace_back(list.entries().slice(begin, end));
+}
+
+Object &BasicObjectStore::create_lazy_list(LazyListObject::Generator generator) {
+    return lazy_list_objects.emplace_back(std::move(generator));
+}
+
+Object &BasicObjectStore::create_action(const Object &command, const Object &inputs, const Object &outputs,
+                                       const Object &dependencies, const Object &depfile,
+                                       const Object &resources) {
+    return action_objects.emplace_back(command, inputs, outputs, dependencies, depfile, resources);
+}
@@ -13,17 +13,32 @@ class BasicObjectStore : public ObjectStore {
 public:
     Object &create_struct(std::unordered_map<std::string, const Object &> attributes) override;
 
+    Object &create_struct(const Object &base, std::unordered_map<std::string, const Object &> attributes) override;
+
     Object &create_function(CallHandler &handler) override;
 
     Object &create_string(std::string value) override;
 
     Object &create_list(std::list<std::reference_wrapper<const Object>> entries) override;
 
+    Object &create_concatenated_list(const Object &lhs, const Object &rhs) override;
+
+    Object &create_appended_list(const Object &list, const Object &entry) override;
+
+    Object &create_sliced_list(const Object &list, size_t begin, size_t end) override;
+
+    Object &create_lazy_list(LazyListObject::Generator generator) override;
+
+    Object &create_action(const Object &command, const Object &inputs, const Object &outputs,
+                          const Object &dependencies, const Object &depfile, const Object &resources) override;
+
 private:
     std::list<StructObject> struct_objects;
     std::list<FunctionObject> function_objects;
     std::list<StringObject> string_objects;
     std::list<ListObject> list_objects;
+    std::list<LazyListObject> lazy_list_objects;
+    std::list<ActionObject> action_objects;
 };
 
 
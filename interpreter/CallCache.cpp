@@ -0,0 +1,62 @@
+//
+// Created by roel on 10/19/26.
+//
+
+#include "CallCache.h"
+
+#include <vector>
+#include <algorithm>
+
+#include "util/Hasher.h"
+
+CallCache::CallCache() :
+        results() {}
+
+Digest CallCache::key(const CallHandler &handler,
+                      const std::list<std::reference_wrapper<const Object>> &positional_args,
+                      const std::list<std::pair<std::string, const Object &>> &keyword_args) {
+    Hasher hasher;
+    hasher.add(handler.identity());
+
+    hasher.add(static_cast<uint64_t>(positional_args.size()));
+    for (const Object &arg: positional_args) {
+        hasher.add(arg.digest());
+    }
+
+    // Keyword arguments are matched by name, so their order does not matter
+    std::vector<const std::pair<std::string, const Object &> *> sorted;
+    sorted.reserve(keyword_args.size());
+    for (const auto &arg: keyword_args) {
+        sorted.push_back(&arg);
+    }
+    std::sort(sorted.begin(), sorted.end(), [](auto *lhs, auto *rhs) {
+        return lhs->first < rhs->first;
+    });
+
+    hasher.add(static_cast<uint64_t>(sorted.size()));
+    for (const auto *arg: sorted) {
+        hasher.add(arg->first);
+        hasher.add(arg->second.digest());
+    }
+    return hasher.digest();
+}
+
+const Object *CallCache::find(const Digest &key) const {
+    auto it = results.find(key);
+    if (it == results.end()) {
+        return nullptr;
+    }
+    return &it->second;
+}
+
+void CallCache::put(const Digest &key, const Object &result) {
+    results.emplace(key, result);
+}
+
+size_t CallCache::size() const {
+    return results.size();
+}
+
+void CallCache::clear() {
+    results.clear();
+}
@@ -0,0 +1,35 @@
+//
+// Created by roel on 10/19/26.
+//
+
+
+#pragma once
+
+#include <unordered_map>
+
+#include "Object.h"
+
+/*
+ * Results of calls to pure call handlers, keyed by the identity of the handler
+ * and the digests of the arguments. A CallCache outlives a single Interpreter
+ * so that calls are also reused between subsequent interpretations.
+ */
+class CallCache {
+public:
+    CallCache();
+
+    [[nodiscard]] static Digest key(const CallHandler &handler,
+                                    const std::list<std::reference_wrapper<const Object>> &positional_args,
+                                    const std::list<std::pair<std::string, const Object &>> &keyword_args);
+
+    [[nodiscard]] const Object *find(const Digest &key) const;
+
+    void put(const Digest &key, const Object &result);
+
+    [[nodiscard]] size_t size() const;
+
+    void clear();
+
+private:
+    std::unordered_map<Digest, const Object &> results;
+};
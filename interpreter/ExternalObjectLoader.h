@@ -0,0 +1,53 @@
+//
+// Created by roel on 10/19/26.
+//
+
+
+#pragma once
+
+#include <string>
+#include <stdexcept>
+
+#include "Object.h"
+
+/*
+ * Loads the objects of imports that are not mkr programs, such as Python
+ * units. The parser leaves these as EXTERNAL_OBJECT nodes with the import spec
+ * as data, the interpreter asks the loader for their object.
+ */
+class ExternalObjectLoader {
+public:
+    virtual ~ExternalObjectLoader() = default;
+
+    /*
+     * Returns the object of the import, loading it on first use. Throws
+     * ExternalObjectError if it cannot be loaded.
+     */
+    virtual const Object &load(const std::string &import_spec) = 0;
+
+    /*
+     * Drops the object of the import if it was loaded, so that the next load
+     * sees changes to it. Loaders that keep nothing ignore this.
+     */
+    virtual void forget(const std::string &import_spec) {}
+
+    /*
+     * Called when the interpreter reads an attribute of an object, so that
+     * loaders can track which parts of the objects they loaded are used.
+     * Ignored by default.
+     */
+    virtual void attribute_read(const Object &object, const std::string &attribute) {}
+
+    /*
+     * Called when the interpreter uses an object as a whole: as an argument,
+     * a list entry, the input of a list-for or a variable captured by one.
+     * Assigning an object to a variable is not a use. Ignored by default.
+     */
+    virtual void object_used(const Object &object) {}
+};
+
+class ExternalObjectError : public std::runtime_error {
+public:
+    explicit ExternalObjectError(const std::string &message_) :
+            std::runtime_error(message_) {}
+};
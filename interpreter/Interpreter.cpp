@@ -5,8 +5,11 @@
 #include "Interpreter.h"
 #include "ScopeWrapper.h"
 #include "RootScope.h"
+#include "BasicObjectStore.h"
 
 #include <utility>
+#include <memory>
+#include <set>
 
 /*
  * InterpretResult::*
@@ -28,13 +31,39 @@ void InterpretResult::add_error(const Node &node, std::string message) {
     error_list.emplace_back(node, std::move(message));
 }
 
+const InterpretResult::Stats &InterpretResult::stats() const {
+    return _stats;
+}
+
+InterpretResult::Stats &InterpretResult::stats() {
+    return _stats;
+}
+
 /*
  * Interpreter::*
  */
 
 Interpreter::Interpreter(ObjectStore &object_store_, Scope &root_scope_, const Node &ast_) :
+        Interpreter(object_store_, root_scope_, ast_, nullptr, nullptr, nullptr) {}
+
+Interpreter::Interpreter(ObjectStore &object_store_, Scope &root_scope_, const Node &ast_, CallCache &call_cache_) :
+        Interpreter(object_store_, root_scope_, ast_, &call_cache_, nullptr, nullptr) {}
+
+Interpreter::Interpreter(ObjectStore &object_store_, Scope &root_scope_, const Node &ast_, CallCache &call_cache_,
+                         const Scope &builtin_scope_) :
+        Interpreter(object_store_, root_scope_, ast_, &call_cache_, &builtin_scope_, nullptr) {}
+
+Interpreter::Interpreter(ObjectStore &object_store_, Scope &root_scope_, const Node &ast_, CallCache &call_cache_,
+                         const Scope &builtin_scope_, ExternalObjectLoader &external_objects_) :
+        Interpreter(object_store_, root_scope_, ast_, &call_cache_, &builtin_scope_, &external_objects_) {}
+
+Interpreter::Interpreter(ObjectStore &object_store_, Scope &root_scope_, const Node &ast_, CallCache *call_cache_,
+                         const Scope *builtin_scope_, ExternalObjectLoader *external_objects_) :
         object_store(object_store_),
         root_scope(root_scope_),
+        call_cache(call_cache_),
+        builtin_scope(builtin_scope_),
+        external_objects(external_objects_),
         ast(ast_) {}
 
 
@@ -107,10 +136,18 @@ const Object &Interpreter::parse_expression(Scope &scope, const Node &node) {
         return parse_list_for(scope, node);
     }
 
+    if (node.get_type() == NodeType::ADD) {
+        return parse_add(scope, node);
+    }
+
     if (node.get_type() == NodeType::PROGRAM) {
         return parse_program(scope, node);
     }
 
+    if (node.get_type() == NodeType::EXTERNAL_OBJECT) {
+        return parse_external_object(node);
+    }
+
     throw std::runtime_error("Unexpected node '" + std::string(to_str(node.get_type())) + "'");
 }
 
@@ -118,7 +155,11 @@ const Object &Interpreter::parse_object(Scope &scope, const Node &node) {
     const std::string &id = node.get_data();
 
     if (!node.get_children().empty()) {
-        return parse_expression(scope, node.get_child(0)).attr(id);
+        const Object &object = parse_expression(scope, node.get_child(0));
+        if (external_objects) {
+            external_objects->attribute_read(object, id);
+        }
+        return object.attr(id);
     }
 
     try {
@@ -132,25 +173,189 @@ const Object &Interpreter::parse_object(Scope &scope, const Node &node) {
 const Object &Interpreter::parse_list(Scope &scope, const Node &node) {
     std::list<std::reference_wrapper<const Object>> entries;
     for (const auto &entry_node: node.get_children()) {
-        entries.emplace_back(parse_expression(scope, entry_node));
+        const Object &entry = parse_expression(scope, entry_node);
+        use_object(entry);
+        entries.emplace_back(entry);
     }
     return object_store.create_list(entries);
 }
 
+/*
+ * A use of a variable in an expression, and the node reading an attribute of
+ * it if that is all it is used for.
+ */
+struct FreeVariable {
+    const Node &node;
+    const Node *attribute;
+};
+
+/*
+ * Collects the variables used by an expression that are not bound within the
+ * expression itself by a list-for.
+ */
+static void collect_free_variables(const Node &node,
+                                   const std::set<std::string> &bound,
+                                   std::list<FreeVariable> &free) {
+    if (node.get_type() == NodeType::OBJECT) {
+        if (node.get_children().empty()) {
+            if (!bound.contains(node.get_data())) free.push_back({node, nullptr});
+        } else if (node.get_child(0).get_type() == NodeType::OBJECT && node.get_child(0).get_children().empty()) {
+            if (!bound.contains(node.get_child(0).get_data())) free.push_back({node.get_child(0), &node});
+        } else {
+            collect_free_variables(node.get_child(0), bound, free);
+        }
+        return;
+    }
+
+    if (node.get_type() == NodeType::LIST_FOR) {
+        std::set<std::string> inner_bound = bound;
+        inner_bound.insert(node.get_child(1).get_data());
+        collect_free_variables(node.get_child(0), inner_bound, free);
+        collect_free_variables(node.get_child(2), bound, free);
+        return;
+    }
+
+    if (node.get_type() == NodeType::PROGRAM) {
+        // Imported programs are interpreted in a scope of their own
+        return;
+    }
+
+    for (const Node &child: node.get_children()) {
+        collect_free_variables(child, bound, free);
+    }
+}
+
+/*
+ * Evaluates the expression of a list-for for each entry of the input list as
+ * the entries are pulled from the stream. Owns everything it needs, so it
+ * stays usable after the interpreter that created it is gone.
+ *
+ * A transient stream creates the objects of an entry in a store of its own,
+ * which it drops when the next entry is asked for, and streams the input
+ * transiently as well. Without the call cache, as that keeps the results.
+ */
+class Interpreter::ListForStream : public EntryStream {
+public:
+    ListForStream(ObjectStore &object_store_,
+                  CallCache *call_cache_,
+                  const Scope *builtin_scope_,
+                  ExternalObjectLoader *external_objects_,
+                  std::shared_ptr<const Node> expr_node_,
+                  std::string variable_,
+                  std::shared_ptr<const RootScope> captured_scope_,
+                  std::unique_ptr<EntryStream> input_,
+                  bool transient_) :
+            object_store(object_store_),
+            call_cache(call_cache_),
+            builtin_scope(builtin_scope_),
+            external_objects(external_objects_),
+            expr_node(std::move(expr_node_)),
+            variable(std::move(variable_)),
+            captured_scope(std::move(captured_scope_)),
+            input(std::move(input_)),
+            transient(transient_),
+            entry_store() {}
+
+    const Object *next() override {
+        entry_store.reset();
+        const Object *input_obj = input->next();
+        if (!input_obj) return nullptr;
+
+        ScopeWrapper expr_scope(*captured_scope);
+        expr_scope.put(variable, *input_obj);
+
+        if (transient) entry_store = std::make_unique<BasicObjectStore>();
+        Interpreter interpreter(transient ? *entry_store : object_store, expr_scope, *expr_node,
+                                transient ? nullptr : call_cache, builtin_scope, external_objects);
+        try {
+            return &interpreter.parse_expression(expr_scope, *expr_node);
+        } catch (const InterpretError &) {
+            throw ListForError(interpreter.result.errors());
+        }
+    }
+
+private:
+    ObjectStore &object_store;
+    CallCache *call_cache;
+    const Scope *builtin_scope;
+    ExternalObjectLoader *external_objects;
+    const std::shared_ptr<const Node> expr_node;
+    const std::string variable;
+    const std::shared_ptr<const RootScope> captured_scope;
+    const std::unique_ptr<EntryStream> input;
+    const bool transient;
+    // The objects created for the last entry of a transient stream
+    std::unique_ptr<BasicObjectStore> entry_store;
+};
+
 const Object &Interpreter::parse_list_for(Scope &scope, const Node &node) {
     const Node &expr_node = node.get_child(0);
     const Node &var_node = node.get_child(1);
     const Object &input_list = parse_expression(scope, node.get_child(2));
+    use_object(input_list);
+
+    // The entries are evaluated lazily, when this scope may no longer exist.
+    // Capture the variables the expression depends on instead.
+    std::list<FreeVariable> free_variables;
+    collect_free_variables(expr_node, {var_node.get_data()}, free_variables);
+
+    auto captured_scope = std::make_shared<RootScope>();
+    for (const FreeVariable &free_variable: free_variables) {
+        const Node &variable_node = free_variable.node;
+        const std::string &id = variable_node.get_data();
+        try {
+            const Object &value = scope.get(id);
+            if (!free_variable.attribute) {
+                use_object(value);
+            } else if (external_objects) {
+                external_objects->attribute_read(value, free_variable.attribute->get_data());
+            }
+            try {
+                captured_scope->put(id, value);
+            } catch (const Scope::AlreadyDefinedError &) {
+                // used more than once
+            }
+        } catch (const Scope::UndefinedVariableError &) {
+            result.add_error(variable_node, "Undefined variable");
+            throw InterpretError();
+        }
+    }
+
+    auto expr_copy = std::make_shared<const Node>(expr_node);
+    std::string variable = var_node.get_data();
+    ObjectStore &store = object_store;
+    CallCache *cache = call_cache;
+    const Scope *builtins = builtin_scope;
+    ExternalObjectLoader *loader = external_objects;
+
+    return object_store.create_lazy_list([=, &store, &input_list](bool transient) {
+        return std::make_unique<ListForStream>(store, cache, builtins, loader, expr_copy, variable, captured_scope,
+                                               transient ? input_list.transient_stream() : input_list.stream(),
+                                               transient);
+    });
+}
 
-    std::list<std::reference_wrapper<const Object>> output_list;
-    for (const Object &input_obj: input_list.entries()) {
-        ScopeWrapper expr_scope(scope);
-        expr_scope.put(var_node.get_data(), input_obj);
-        const Object &output_obj = parse_expression(expr_scope, expr_node);
-        output_list.emplace_back(output_obj);
+const Object &Interpreter::parse_add(Scope &scope, const Node &node) {
+    const Object &lhs = parse_expression(scope, node.get_child(0));
+    const Object &rhs = parse_expression(scope, node.get_child(1));
+
+    try {
+        return object_store.create_concatenated_list(lhs, rhs);
+    } catch (const ObjectIsNotAList &) {
+        // try strings
+    } catch (const LazyEvaluationError &e) {
+        add_lazy_evaluation_error(node, e);
+        throw InterpretError();
     }
 
-    return object_store.create_list(output_list);
+    try {
+        return object_store.create_string(lhs.get_string() + rhs.get_string());
+    } catch (const ObjectIsNotAString &) {
+        // fall through
+    }
+
+    result.add_error(node, "Operands of '+' must both be lists or both be strings");
+    throw InterpretError();
 }
 
 const Object &Interpreter::parse_function_call(Scope &scope, const Node &node) {
@@ -178,15 +383,42 @@ const Object &Interpreter::parse_function_call(Scope &scope, const Node &node) {
 
     std::list<Arg> arg_store;
     CallArgList arg_list;
+    std::list<std::reference_wrapper<const Object>> positional_args;
+    std::list<std::pair<std::string, const Object &>> keyword_args;
     for (auto arg_node = ++node.get_children().begin(); arg_node != node.get_children().end(); arg_node++) {
         if (arg_node->get_type() == NodeType::KWARG) {
-            arg_list.add(arg_node->get_data(), arg_store.emplace_back(node, parse_expression(scope, arg_node->get_child(0))));
+            const Arg &arg = arg_store.emplace_back(node, parse_expression(scope, arg_node->get_child(0)));
+            use_object(arg.obj);
+            arg_list.add(arg_node->get_data(), arg);
+            keyword_args.emplace_back(arg_node->get_data(), arg.obj);
         } else {
-            arg_list.add(arg_store.emplace_back(node, parse_expression(scope, *arg_node)));
+            const Arg &arg = arg_store.emplace_back(node, parse_expression(scope, *arg_node));
+            use_object(arg.obj);
+            arg_list.add(arg);
+            positional_args.emplace_back(arg.obj);
         }
     }
 
-    const CallResult call_result = call_handler.call(arg_list);
+    // Hashing the arguments for the key consumes lazy lists as well
+    std::optional<Digest> cache_key;
+    std::optional<CallResult> optional_call_result;
+    try {
+        if (call_cache && call_handler.is_pure()) {
+            cache_key = CallCache::key(call_handler, positional_args, keyword_args);
+            const Object *cached = call_cache->find(*cache_key);
+            if (cached) {
+                result.stats().call_cache_hits++;
+                call_handler.reused(*cached);
+                return *cached;
+            }
+            result.stats().call_cache_misses++;
+        }
+        optional_call_result.emplace(call_handler.call(arg_list));
+    } catch (const LazyEvaluationError &e) {
+        add_lazy_evaluation_error(node, e);
+        throw InterpretError();
+    }
+    const CallResult &call_result = *optional_call_result;
 
     for (const CallResult::ArgError &error: call_result.arg_errors()) {
         const Arg &arg = dynamic_cast<const Arg &>(error.arg);
@@ -201,10 +433,20 @@ const Object &Interpreter::parse_function_call(Scope &scope, const Node &node) {
         throw InterpretError();
     }
 
+    if (cache_key) {
+        call_cache->put(*cache_key, call_result.return_value());
+    }
+
     return call_result.return_value();
 }
 
 const Object &Interpreter::parse_program(Scope &scope, const Node &node) {
+    if (builtin_scope) {
+        ScopeWrapper program_scope(*builtin_scope);
+        interpret_program(program_scope, node);
+        return object_store.create_struct(program_scope.get_map());
+    }
+
     RootScope program_scope;
     interpret_program(program_scope, node);
     Object &obj = object_store.create_struct(program_scope.get_map());
@@ -215,3 +457,39 @@ InterpretResult interpret(ObjectStore &object_store, Scope &root_scope, const No
     Interpreter interpreter(object_store, root_scope, ast);
     return interpreter.interpret();
 }
+
+InterpretResult interpret(ObjectStore &object_store, Scope &root_scope, const Node &ast, CallCache &call_cache) {
+    Interpreter interpreter(object_store, root_scope, ast, call_cache);
+    return interpreter.interpret();
+}
+
+const Object &Interpreter::parse_external_object(const Node &node) {
+    if (!external_objects) {
+        result.add_error(node, "Cannot import '" + node.get_data() + "'");
+        throw InterpretError();
+    }
+
+    try {
+        return external_objects->load(node.get_data());
+    } catch (const ExternalObjectError &e) {
+        result.add_error(node, e.what());
+        throw InterpretError();
+    }
+}
+
+void Interpreter::use_object(const Object &object) {
+    if (external_objects) {
+        external_objects->object_used(object);
+    }
+}
+
+void Interpreter::add_lazy_evaluation_error(const Node &node, const LazyEvaluationError &error) {
+    const auto *list_for_error = dynamic_cast<const ListForError *>(&error);
+    if (!list_for_error || list_for_error->errors.empty()) {
+        result.add_error(node, error.what());
+        return;
+    }
+    for (const InterpretResult::Error &entry_error: list_for_error->errors) {
+        result.add_error(entry_error.node, entry_error.message);
+    }
+}
@@ -6,9 +6,12 @@
 #pragma once
 
 #include <stdexcept>
+#include <list>
 
 #include "ast/Ast.h"
 #include "Scope.h"
+#include "CallCache.h"
+#include "ExternalObjectLoader.h"
 
 
 class InterpretResult {
@@ -27,19 +30,53 @@ public:
 
     void add_error(const Node &node, std::string message);
 
+    struct Stats {
+        unsigned int call_cache_hits = 0;
+        unsigned int call_cache_misses = 0;
+    };
+
+    [[nodiscard]] const Stats &stats() const;
+
+    Stats &stats();
+
 private:
     std::list<Error> error_list;
+    Stats _stats;
 };
 
 class Interpreter {
 public:
     explicit Interpreter(ObjectStore &object_store, Scope &root_scope, const Node &ast);
 
+    explicit Interpreter(ObjectStore &object_store, Scope &root_scope, const Node &ast, CallCache &call_cache);
+
+    /*
+     * The builtin scope is visible from imported programs, which are otherwise
+     * interpreted in a scope of their own.
+     */
+    explicit Interpreter(ObjectStore &object_store, Scope &root_scope, const Node &ast, CallCache &call_cache,
+                         const Scope &builtin_scope);
+
+    /*
+     * Imports that are not mkr programs are loaded by the external object
+     * loader, without one they fail.
+     */
+    explicit Interpreter(ObjectStore &object_store, Scope &root_scope, const Node &ast, CallCache &call_cache,
+                         const Scope &builtin_scope, ExternalObjectLoader &external_objects);
+
     InterpretResult interpret();
 
 private:
+    explicit Interpreter(ObjectStore &object_store, Scope &root_scope, const Node &ast, CallCache *call_cache,
+                         const Scope *builtin_scope, ExternalObjectLoader *external_objects);
+
+    class ListForStream;
+
     ObjectStore &object_store;
     Scope &root_scope;
+    CallCache *call_cache;
+    const Scope *builtin_scope;
+    ExternalObjectLoader *external_objects;
     InterpretResult result;
     const Node &ast;
 
@@ -59,15 +96,44 @@ private:
 
     const Object &parse_list_for(Scope &scope, const Node &node);
 
+    const Object &parse_add(Scope &scope, const Node &node);
+
     const Object &parse_function_call(Scope &scope, const Node &node);
 
     const Object &parse_program(Scope &scope, const Node &node);
+
+    const Object &parse_external_object(const Node &node);
+
+    /*
+     * Reports the use of the object as a whole to the external object loader.
+     */
+    void use_object(const Object &object);
+
+    /*
+     * Adds the errors of a lazy list that failed while the node consumed it.
+     */
+    void add_lazy_evaluation_error(const Node &node, const LazyEvaluationError &error);
 };
 
 InterpretResult interpret(ObjectStore &object_store, Scope &root_scope, const Node &ast);
 
+InterpretResult interpret(ObjectStore &object_store, Scope &root_scope, const Node &ast, CallCache &call_cache);
+
 class InterpretError : public std::exception {
 public:
     explicit InterpretError() = default;
 };
 
+/*
+ * Thrown while producing the entries of a list-for, with the errors of its
+ * expression (which point into the expression, not at the consumer).
+ */
+class ListForError : public LazyEvaluationError {
+public:
+    explicit ListForError(std::list<InterpretResult::Error> errors_) :
+            LazyEvaluationError(errors_.empty() ? "List-for failed" : errors_.front().message),
+            errors(std::move(errors_)) {}
+
+    const std::list<InterpretResult::Error> errors;
+};
+
@@ -5,6 +5,77 @@
 #include "Object.h"
 
 #include <utility>
+#include <algorithm>
+
+#include "util/Hasher.h"
+
+/*
+ * Tags that are hashed in front of the content of every object, so that objects
+ * of different types with the same content get different digests.
+ */
+enum class DigestTag : uint64_t {
+    NULL_OBJECT = 1,
+    STRUCT,
+    FUNCTION,
+    STRING,
+    LIST,
+    ACTION,
+};
+
+static Hasher tagged_hasher(DigestTag tag) {
+    Hasher hasher;
+    hasher.add(static_cast<uint64_t>(tag));
+    return hasher;
+}
+
+
+/*
+ * Lists are hashed while streaming their entries, the number of entries is
+ * only known at the end. Lazy and materialized lists with the same entries
+ * get the same digest.
+ */
+static Digest list_digest(EntryStream &entry_stream) {
+    Hasher hasher = tagged_hasher(DigestTag::LIST);
+    uint64_t count = 0;
+    while (const Object *entry = entry_stream.next()) {
+        hasher.add(entry->digest());
+        count++;
+    }
+    hasher.add(count);
+    return hasher.digest();
+}
+
+class EntriesStream : public EntryStream {
+public:
+    explicit EntriesStream(const Object::Entries &entries) :
+            it(entries.begin()),
+            end(entries.end()) {}
+
+    const Object *next() override {
+        if (it == end) return nullptr;
+        return &(it++)->get();
+    }
+
+private:
+    Object::Entries::const_iterator it;
+    const Object::Entries::const_iterator end;
+};
+
+
+/*
+ * Object::*
+ */
+
+const Digest &Object::digest() const {
+    if (!_digest) {
+        _digest.emplace(compute_digest());
+    }
+    return *_digest;
+}
+
+std::unique_ptr<EntryStream> Object::transient_stream() const {
+    return stream();
+}
 
 
 /*
@@ -24,6 +95,10 @@ const Object &NullObject::attr(const std::string &id) const {
     throw UnknownAttributeError(id);
 }
 
+const Object::Attributes &NullObject::attributes() const {
+    throw ObjectIsNotAStruct(*this);
+}
+
 bool NullObject::is_callable() const {
     return false;
 }
@@ -36,25 +111,40 @@ const std::string &NullObject::get_string() const {
     throw ObjectIsNotAString(*this);
 }
 
-const std::vector<std::reference_wrapper<const Object>> &NullObject::entries() const {
+const Object::Entries &NullObject::entries() const {
     throw ObjectIsNotAList(*this);
 }
 
+std::unique_ptr<EntryStream> NullObject::stream() const {
+    throw ObjectIsNotAList(*this);
+}
+
+Digest NullObject::compute_digest() const {
+    return tagged_hasher(DigestTag::NULL_OBJECT).digest();
+}
+
 
 /*
  * StructObject::*
  */
 
-StructObject::StructObject(std::unordered_map<std::string, const Object &> attributes_) :
-        attributes(std::move(attributes_)) {}
+StructObject::StructObject(const std::unordered_map<std::string, const Object &> &attributes_) :
+        _attributes(attributes_) {}
+
+StructObject::StructObject(Attributes attributes_) :
+        _attributes(std::move(attributes_)) {}
 
 
 const Object &StructObject::attr(const std::string &id) const {
-    auto it = attributes.find(id);
-    if (it == attributes.end()) {
+    const auto *value = _attributes.find(id);
+    if (!value) {
         throw UnknownAttributeError(id);
     }
-    return it->second;
+    return *value;
+}
+
+const Object::Attributes &StructObject::attributes() const {
+    return _attributes;
 }
 
 bool StructObject::is_callable() const {
@@ -69,10 +159,34 @@ const std::string &StructObject::get_string() const {
     throw ObjectIsNotAString(*this);
 }
 
-const std::vector<std::reference_wrapper<const Object>> &StructObject::entries() const {
+const Object::Entries &StructObject::entries() const {
     throw ObjectIsNotAList(*this);
 }
 
+std::unique_ptr<EntryStream> StructObject::stream() const {
+    throw ObjectIsNotAList(*this);
+}
+
+Digest StructObject::compute_digest() const {
+    // Attributes are hashed in key order, the order of the map is unspecified
+    std::vector<const Attributes::value_type *> sorted;
+    sorted.reserve(_attributes.size());
+    for (const auto &attribute: _attributes) {
+        sorted.push_back(&attribute);
+    }
+    std::sort(sorted.begin(), sorted.end(), [](auto *lhs, auto *rhs) {
+        return lhs->first < rhs->first;
+    });
+
+    Hasher hasher = tagged_hasher(DigestTag::STRUCT);
+    hasher.add(static_cast<uint64_t>(sorted.size()));
+    for (const auto *attribute: sorted) {
+        hasher.add(attribute->first);
+        hasher.add(attribute->second.get().digest());
+    }
+    return hasher.digest();
+}
+
 
 /*
  * FunctionObject::*
@@ -86,6 +200,10 @@ const Object &FunctionObject::attr(const std::string &id) const {
     throw UnknownAttributeError(id);
 }
 
+const Object::Attributes &FunctionObject::attributes() const {
+    throw ObjectIsNotAStruct(*this);
+}
+
 bool FunctionObject::is_callable() const {
     return true;
 }
@@ -98,10 +216,33 @@ const std::string &FunctionObject::get_string() const {
     throw ObjectIsNotAString(*this);
 }
 
-const std::vector<std::reference_wrapper<const Object>> &FunctionObject::entries() const {
+const Object::Entries &FunctionObject::entries() const {
     throw ObjectIsNotAList(*this);
 }
 
+std::unique_ptr<EntryStream> FunctionObject::stream() const {
+    throw ObjectIsNotAList(*this);
+}
+
+Digest FunctionObject::compute_digest() const {
+    return tagged_hasher(DigestTag::FUNCTION).add(handler.identity()).digest();
+}
+
+
+/*
+ * CallHandler::*
+ */
+
+Digest CallHandler::identity() const {
+    return Hasher().add(reinterpret_cast<uint64_t>(this)).digest();
+}
+
+bool CallHandler::is_pure() const {
+    return false;
+}
+
+void CallHandler::reused(const Object &) const {}
+
 
 /*
  * CallArgList::*
@@ -130,6 +271,14 @@ const CallArg &CallArgList::arg(const std::string &key) const {
     return it->second;
 }
 
+const std::list<std::reference_wrapper<const CallArg>> &CallArgList::positional() const {
+    return positional_args;
+}
+
+const std::unordered_map<std::string, const CallArg &> &CallArgList::keywords() const {
+    return keyword_args;
+}
+
 
 /*
  * CallResult::*
@@ -183,6 +332,10 @@ const Object &StringObject::attr(const std::string &id) const {
     throw UnknownAttributeError(id);
 }
 
+const Object::Attributes &StringObject::attributes() const {
+    throw ObjectIsNotAStruct(*this);
+}
+
 bool StringObject::is_callable() const {
     return false;
 }
@@ -195,22 +348,37 @@ const std::string &StringObject::get_string() const {
     return value;
 }
 
-const std::vector<std::reference_wrapper<const Object>> &StringObject::entries() const {
+const Object::Entries &StringObject::entries() const {
     throw ObjectIsNotAList(*this);
 }
 
+std::unique_ptr<EntryStream> StringObject::stream() const {
+    throw ObjectIsNotAList(*this);
+}
+
+Digest StringObject::compute_digest() const {
+    return tagged_hasher(DigestTag::STRING).add(value).digest();
+}
+
 
 /*
  * ListObject::*
  */
 
-ListObject::ListObject(std::list<std::reference_wrapper<const Object>> entries) :
-        _entries(entries.begin(), entries.end()) {}
+ListObject::ListObject(const std::list<std::reference_wrapper<const Object>> &entries) :
+        _entries(entries) {}
+
+ListObject::ListObject(Entries entries) :
+        _entries(std::move(entries)) {}
 
 const Object &ListObject::attr(const std::string &id) const {
     throw UnknownAttributeError(id);
 }
 
+const Object::Attributes &ListObject::attributes() const {
+    throw ObjectIsNotAStruct(*this);
+}
+
 bool ListObject::is_callable() const {
     return false;
 }
@@ -223,6 +391,99 @@ const std::string &ListObject::get_string() const {
     throw ObjectIsNotAString(*this);
 }
 
-const std::vector<std::reference_wrapper<const Object>> &ListObject::entries() const {
+const Object::Entries &ListObject::entries() const {
     return _entries;
 }
+
+std::unique_ptr<EntryStream> ListObject::stream() const {
+    return std::make_unique<EntriesStream>(_entries);
+}
+
+Digest ListObject::compute_digest() const {
+    EntriesStream entries_stream(_entries);
+    return list_digest(entries_stream);
+}
+
+
+/*
+ * ActionObject::*
+ */
+
+ActionObject::ActionObject(const Object &command, const Object &inputs, const Object &outputs,
+                           const Object &dependencies, const Object &depfile, const Object &resources) :
+        StructObject(std::unordered_map<std::string, const Object &>{
+                {"command",      command},
+                {"inputs",       inputs},
+                {"outputs",      outputs},
+                {"dependencies", dependencies},
+                {"depfile",      depfile},
+                {"resources",    resources},
+        }) {}
+
+Digest ActionObject::compute_digest() const {
+    return tagged_hasher(DigestTag::ACTION).add(StructObject::compute_digest()).digest();
+}
+
+
+/*
+ * LazyListObject::*
+ */
+
+LazyListObject::LazyListObject(Generator generator_) :
+        generator(std::move(generator_)),
+        materialized() {}
+
+const Object &LazyListObject::attr(const std::string &id) const {
+    throw UnknownAttributeError(id);
+}
+
+const Object::Attributes &LazyListObject::attributes() const {
+    throw ObjectIsNotAStruct(*this);
+}
+
+bool LazyListObject::is_callable() const {
+    return false;
+}
+
+const CallHandler &LazyListObject::get_call_handler() const {
+    throw ObjectNotCallableError(*this);
+}
+
+const std::string &LazyListObject::get_string() const {
+    throw ObjectIsNotAString(*this);
+}
+
+const Object::Entries &LazyListObject::entries() const {
+    if (!materialized) {
+        Entries entries;
+        auto entry_stream = generator(false);
+        while (const Object *entry = entry_stream->next()) {
+            entries = entries.push_back(*entry);
+        }
+        materialized.emplace(std::move(entries));
+    }
+    return *materialized;
+}
+
+std::unique_ptr<EntryStream> LazyListObject::stream() const {
+    if (materialized) {
+        return std::make_unique<EntriesStream>(*materialized);
+    }
+    return generator(false);
+}
+
+std::unique_ptr<EntryStream> LazyListObject::transient_stream() const {
+    if (materialized) {
+        return std::make_unique<EntriesStream>(*materialized);
+    }
+    return generator(true);
+}
+
+bool LazyListObject::is_materialized() const {
+    return materialized.has_value();
+}
+
+Digest LazyListObject::compute_digest() const {
+    auto entry_stream = transient_stream();
+    return list_digest(*entry_stream);
+}
@@ -12,6 +12,12 @@
 #include <unordered_map>
 #include <stdexcept>
 #include <optional>
+#include <memory>
+#include <functional>
+
+#include "util/Digest.h"
+#include "util/PersistentMap.h"
+#include "util/PersistentVector.h"
 
 class Object;
 
@@ -33,6 +39,10 @@ public:
 
     const CallArg &arg(const std::string &keyword) const;
 
+    [[nodiscard]] const std::list<std::reference_wrapper<const CallArg>> &positional() const;
+
+    [[nodiscard]] const std::unordered_map<std::string, const CallArg &> &keywords() const;
+
 private:
     std::list<std::reference_wrapper<const CallArg>> positional_args;
     std::unordered_map<std::string, const CallArg &> keyword_args;
@@ -88,19 +98,81 @@ public:
     [[nodiscard]] virtual CallResult call(const CallArgList &arguments) const = 0;
 
     [[nodiscard]] virtual bool operator==(const CallHandler &rhs) const = 0;
+
+    /*
+     * Identity of the handler as used in the digest of a FunctionObject.
+     * Defaults to the address of the handler, handlers that are
+     * reconstructed between runs should override this with something stable.
+     */
+    [[nodiscard]] virtual Digest identity() const;
+
+    /*
+     * A pure handler returns the same object for arguments with the same
+     * digests and has no side effects, which allows the interpreter to reuse
+     * the result of an earlier call instead of calling the handler again.
+     */
+    [[nodiscard]] virtual bool is_pure() const;
+
+    /*
+     * Called instead of call() when the interpreter reuses the result of an
+     * earlier call of a pure handler. Does nothing by default.
+     */
+    virtual void reused(const Object &result) const;
+};
+
+/*
+ * Produces the entries of a list one at a time, without requiring the list to
+ * be materialized.
+ */
+class EntryStream {
+public:
+    virtual ~EntryStream() = default;
+
+    /*
+     * Returns the next entry, or nullptr when there are no more entries.
+     */
+    virtual const Object *next() = 0;
 };
 
 class Object {
 public:
+    using Attributes = PersistentMap<std::string, std::reference_wrapper<const Object>>;
+
+    using Entries = PersistentVector<std::reference_wrapper<const Object>>;
+
     [[nodiscard]] virtual const Object &attr(const std::string &id) const = 0;
 
+    [[nodiscard]] virtual const Attributes &attributes() const = 0;
+
     [[nodiscard]] virtual bool is_callable() const = 0;
 
     [[nodiscard]] virtual const CallHandler &get_call_handler() const = 0;
 
     [[nodiscard]] virtual const std::string &get_string() const = 0;
 
-    [[nodiscard]] virtual const std::vector<std::reference_wrapper<const Object>> &entries() const = 0;
+    [[nodiscard]] virtual const Entries &entries() const = 0;
+
+    [[nodiscard]] virtual std::unique_ptr<EntryStream> stream() const = 0;
+
+    /*
+     * Like stream(), but an entry is only valid until the next call of next()
+     * or until the stream is gone, so that lazy lists can free what they
+     * created for it. For consumers that do not keep the entries, such as
+     * digests.
+     */
+    [[nodiscard]] virtual std::unique_ptr<EntryStream> transient_stream() const;
+
+    /*
+     * Structural (merkle) hash of the object and everything it references.
+     * Objects are immutable, so the digest is computed once and memoized.
+     */
+    [[nodiscard]] const Digest &digest() const;
+
+protected:
+    [[nodiscard]] virtual Digest compute_digest() const = 0;
+
+private:
+    mutable std::optional<Digest> _digest;
 };
 
 bool operator==(std::reference_wrapper<const Object>, std::reference_wrapper<const Object>);
@@ -113,31 +185,47 @@ public:
 
     [[nodiscard]] const Object &attr(const std::string &id) const override;
 
+    [[nodiscard]] const Attributes &attributes() const override;
+
     [[nodiscard]] bool is_callable() const override;
 
     [[nodiscard]] const CallHandler &get_call_handler() const override;
 
     [[nodiscard]] const std::string &get_string() const override;
 
-    [[nodiscard]] const std::vector<std::reference_wrapper<const Object>> &entries() const override;
+    [[nodiscard]] const Entries &entries() const override;
+
+    [[nodiscard]] std::unique_ptr<EntryStream> stream() const override;
+
+protected:
+    [[nodiscard]] Digest compute_digest() const override;
 };
 
 class StructObject : public Object {
 public:
-    explicit StructObject(std::unordered_map<std::string, const Object &> attributes);
+    explicit StructObject(const std::unordered_map<std::string, const Object &> &attributes);
+
+    explicit StructObject(Attributes attributes);
 
     [[nodiscard]] const Object &attr(const std::string &id) const override;
 
+    [[nodiscard]] const Attributes &attributes() const override;
+
     [[nodiscard]] bool is_callable() const override;
 
     [[nodiscard]] const CallHandler &get_call_handler() const override;
 
     [[nodiscard]] const std::string &get_string() const override;
 
-    [[nodiscard]] const std::vector<std::reference_wrapper<const Object>> &entries() const override;
+    [[nodiscard]] const Entries &entries() const override;
+
+    [[nodiscard]] std::unique_ptr<EntryStream> stream() const override;
+
+protected:
+    [[nodiscard]] Digest compute_digest() const override;
 
 private:
-    const std::unordered_map<std::string, const Object &> attributes;
+    const Attributes _attributes;
 };
 
 
@@ -147,13 +235,20 @@ public:
 
     [[nodiscard]] const Object &attr(const std::string &id) const override;
 
+    [[nodiscard]] const Attributes &attributes() const override;
+
     [[nodiscard]] bool is_callable() const override;
 
     [[nodiscard]] const CallHandler &get_call_handler() const override;
 
     [[nodiscard]] const std::string &get_string() const override;
 
-    [[nodiscard]] const std::vector<std::reference_wrapper<const Object>> &entries() const override;
+    [[nodiscard]] const Entries &entries() const override;
+
+    [[nodiscard]] std::unique_ptr<EntryStream> stream() const override;
+
+protected:
+    [[nodiscard]] Digest compute_digest() const override;
 
 private:
     CallHandler &handler;
@@ -166,13 +261,20 @@ public:
 
     [[nodiscard]] const Object &attr(const std::string &id) const override;
 
+    [[nodiscard]] const Attributes &attributes() const override;
+
     [[nodiscard]] bool is_callable() const override;
 
     [[nodiscard]] const CallHandler &get_call_handler() const override;
 
     [[nodiscard]] const std::string &get_string() const override;
 
-    [[nodiscard]] const std::vector<std::reference_wrapper<const Object>> &entries() const override;
+    [[nodiscard]] const Entries &entries() const override;
+
+    [[nodiscard]] std::unique_ptr<EntryStream> stream() const override;
+
+protected:
+    [[nodiscard]] Digest compute_digest() const override;
 
 private:
     const std::string value;
@@ -181,31 +283,120 @@ private:
 
 class ListObject : public Object {
 public:
-    explicit ListObject(std::list<std::reference_wrapper<const Object>> entries);
+    explicit ListObject(const std::list<std::reference_wrapper<const Object>> &entries);
+
+    explicit ListObject(Entries entries);
+
+    [[nodiscard]] const Object &attr(const std::string &id) const override;
+
+    [[nodiscard]] const Attributes &attributes() const override;
+
+    [[nodiscard]] bool is_callable() const override;
+
+    [[nodiscard]] const CallHandler &get_call_handler() const override;
+
+    [[nodiscard]] const std::string &get_string() const override;
+
+    [[nodiscard]] const Entries &entries() const override;
+
+    [[nodiscard]] std::unique_ptr<EntryStream> stream() const override;
+
+protected:
+    [[nodiscard]] Digest compute_digest() const override;
+
+private:
+    const Entries _entries;
+};
+
+/*
+ * Build action, as created by the action() builtin. An action is a struct with
+ * the attributes 'command', 'inputs' and 'outputs' (lists of strings),
+ * 'dependencies', the list of actions that produce its inputs, and 'depfile',
+ * the path of the file in which the command writes the inputs it discovered
+ * (or null), and 'resources', a struct with how the action runs: the pool it
+ * runs in, the memory and cores it uses and the worker it is sent to.
+ */
+class ActionObject : public StructObject {
+public:
+    ActionObject(const Object &command, const Object &inputs, const Object &outputs, const Object &dependencies,
+                 const Object &depfile, const Object &resources);
+
+protected:
+    [[nodiscard]] Digest compute_digest() const override;
+};
+
+
+/*
+ * List of which the entries are produced on demand by a generator. Every
+ * stream runs the generator again and keeps nothing, entries() materializes
+ * the list once and keeps the result for random access.
+ *
+ * The generator is told whether the stream is transient, in which case it
+ * may free what it created for an entry when the next one is asked for.
+ */
+class LazyListObject : public Object {
+public:
+    using Generator = std::function<std::unique_ptr<EntryStream>(bool transient)>;
+
+    explicit LazyListObject(Generator generator);
 
     [[nodiscard]] const Object &attr(const std::string &id) const override;
 
+    [[nodiscard]] const Attributes &attributes() const override;
+
     [[nodiscard]] bool is_callable() const override;
 
     [[nodiscard]] const CallHandler &get_call_handler() const override;
 
     [[nodiscard]] const std::string &get_string() const override;
 
-    [[nodiscard]] const std::vector<std::reference_wrapper<const Object>> &entries() const override;
+    [[nodiscard]] const Entries &entries() const override;
+
+    [[nodiscard]] std::unique_ptr<EntryStream> stream() const override;
+
+    [[nodiscard]] std::unique_ptr<EntryStream> transient_stream() const override;
+
+    [[nodiscard]] bool is_materialized() const;
+
+protected:
+    [[nodiscard]] Digest compute_digest() const override;
 
 private:
-    const std::vector<std::reference_wrapper<const Object>> _entries;
+    const Generator generator;
+    mutable std::optional<Entries> materialized;
 };
 
 class ObjectStore {
 public:
     virtual Object &create_struct(std::unordered_map<std::string, const Object &> attributes) = 0;
 
+    /*
+     * Creates a struct with the attributes of base, added to or overridden by
+     * the given attributes. The new struct shares its unchanged attributes
+     * with base.
+     */
+    virtual Object &create_struct(const Object &base, std::unordered_map<std::string, const Object &> attributes) = 0;
+
     virtual Object &create_function(CallHandler &handler) = 0;
 
     virtual Object &create_string(std::string value) = 0;
 
     virtual Object &create_list(std::list<std::reference_wrapper<const Object>> entries) = 0;
+
+    /*
+     * The following create lists that share their entries with the given
+     * list(s) instead of copying them.
+     */
+    virtual Object &create_concatenated_list(const Object &lhs, const Object &rhs) = 0;
+
+    virtual Object &create_appended_list(const Object &list, const Object &entry) = 0;
+
+    virtual Object &create_sliced_list(const Object &list, size_t begin, size_t end) = 0;
+
+    virtual Object &create_lazy_list(LazyListObject::Generator generator) = 0;
+
+    virtual Object &create_action(const Object &command, const Object &inputs, const Object &outputs,
+                                  const Object &dependencies, const Object &depfile, const Object &resources) = 0;
 };
 
 
@@ -236,6 +427,15 @@ private:
     const Object &object;
 };
 
+class ObjectIsNotAStruct : public std::runtime_error {
+public:
+    explicit ObjectIsNotAStruct(const Object &object_) :
+            std::runtime_error("Object is not a struct"),
+            object(object_) {};
+private:
+    const Object &object;
+};
+
 class ObjectIsNotAList : public std::runtime_error {
 public:
     explicit ObjectIsNotAList(const Object &object_) :
@@ -245,6 +445,16 @@ private:
     const Object &object;
 };
 
+/*
+ * Thrown while streaming or materializing a lazy list of which the entries
+ * could not be produced.
+ */
+class LazyEvaluationError : public std::runtime_error {
+public:
+    explicit LazyEvaluationError(const std::string &message_) :
+            std::runtime_error(message_) {}
+};
+
 class MissingPositionalArgument : public std::runtime_error {
 public:
     explicit MissingPositionalArgument() :
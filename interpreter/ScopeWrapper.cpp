@@ -22,3 +22,11 @@ void ScopeWrapper::put(const std::string &variable, const Object &object) {
         throw AlreadyDefinedError(variable);
     }
 }
+
+const std::unordered_map<std::string, const Object &> &ScopeWrapper::get_map() {
+    return objects;
+}
+
+void ScopeWrapper::clear() {
+    objects.clear();
+}
@@ -15,6 +15,17 @@ public:
 
     void put(const std::string &variable, const Object &object) override;
 
+    /*
+     * The objects put in this scope, excluding those of the base scope.
+     */
+    const std::unordered_map<std::string, const Object &> &get_map();
+
+    /*
+     * Removes the objects put in this scope, so that a program can be
+     * interpreted in it again.
+     */
+    void clear();
+
 private:
     const Scope &base;
     std::unordered_map<std::string, const Object &> objects;
@@ -0,0 +1,160 @@
+//
+// Created by roel on 10/19/26.
+//
+
+#include "benchmark/benchmark.h"
+
+#include "BasicObjectStore.h"
+
+#include <memory>
+
+static const Object &create_list_of_structs(ObjectStore &store, unsigned int count) {
+    const Object &flags = store.create_list({store.create_string("-Wall"), store.create_string("-O2")});
+
+    std::list<std::reference_wrapper<const Object>> entries;
+    for (unsigned int i = 0; i < count; i++) {
+        entries.emplace_back(store.create_struct({
+                {"source", store.create_string("src/file_" + std::to_string(i) + ".cpp")},
+                {"flags",  flags},
+        }));
+    }
+    return store.create_list(entries);
+}
+
+static void BM_hash_list_of_structs(benchmark::State &state) {
+    const auto count = static_cast<unsigned int>(state.range(0));
+    for (auto _: state) {
+        state.PauseTiming();
+        auto store = std::make_unique<BasicObjectStore>();
+        const Object &list = create_list_of_structs(*store, count);
+        state.ResumeTiming();
+
+        benchmark::DoNotOptimize(list.digest());
+
+        state.PauseTiming();
+        store.reset();
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * count);
+}
+
+BENCHMARK(BM_hash_list_of_structs)->Arg(100000)->Unit(benchmark::kMillisecond);
+
+static void BM_hash_list_of_structs_memoized(benchmark::State &state) {
+    BasicObjectStore store;
+    const Object &list = create_list_of_structs(store, static_cast<unsigned int>(state.range(0)));
+    benchmark::DoNotOptimize(list.digest());
+    for (auto _: state) {
+        benchmark::DoNotOptimize(list.digest());
+    }
+}
+
+BENCHMARK(BM_hash_list_of_structs_memoized)->Arg(100000);
+
+static void BM_derive_struct(benchmark::State &state) {
+    BasicObjectStore store;
+    const Object &value = store.create_string("value");
+
+    std::unordered_map<std::string, const Object &> attributes;
+    for (int64_t i = 0; i < state.range(0); i++) {
+        attributes.emplace("option_" + std::to_string(i), value);
+    }
+    const Object *config = &store.create_struct(attributes);
+
+    const Object &flag = store.create_string("-Wall");
+    for (auto _: state) {
+        config = &store.create_struct(*config, {{"flags", flag}});
+    }
+}
+
+BENCHMARK(BM_derive_struct)->Arg(10)->Arg(1000)->Arg(100000);
+
+static void BM_grow_list(benchmark::State &state) {
+    for (auto _: state) {
+        BasicObjectStore store;
+        const Object &entry = store.create_string("file.o");
+        const Object *list = &store.create_list({});
+        for (int64_t i = 0; i < state.range(0); i++) {
+            list = &store.create_appended_list(*list, entry);
+        }
+        benchmark::DoNotOptimize(list);
+    }
+    state.SetComplexityN(state.range(0));
+}
+
+BENCHMARK(BM_grow_list)->RangeMultiplier(5)->Range(2000, 50000)->Complexity()->Unit(benchmark::kMillisecond);
+
+static void BM_concatenate_lists(benchmark::State &state) {
+    for (auto _: state) {
+        BasicObjectStore store;
+        const Object &chunk = store.create_list({store.create_string("a.o"), store.create_string("b.o")});
+        const Object *list = &store.create_list({});
+        for (int64_t i = 0; i < state.range(0); i++) {
+            list = &store.create_concatenated_list(*list, chunk);
+        }
+        benchmark::DoNotOptimize(list);
+    }
+    state.SetComplexityN(state.range(0));
+}
+
+BENCHMARK(BM_concatenate_lists)->RangeMultiplier(5)->Range(2000, 50000)->Complexity()->Unit(benchmark::kMillisecond);
+
+#include "Interpreter.h"
+#include "RootScope.h"
+#include "parser/DefaultParser.h"
+#include "parser/StringSource.h"
+#include "parser/StaticImportResolver.h"
+
+class IdentityCallHandler : public CallHandler {
+public:
+    [[nodiscard]] CallResult call(const CallArgList &arguments) const override {
+        return CallResult(arguments.arg(0).object());
+    }
+
+    [[nodiscard]] bool operator==(const CallHandler &rhs) const override {
+        return this == &rhs;
+    }
+};
+
+/*
+ * Streams the result of three chained list-for's over a generated list. Each
+ * entry passes through the chain once, and none of the lists is materialized.
+ */
+static void BM_stream_chained_lists_for(benchmark::State &state) {
+    const auto count = state.range(0);
+
+    for (auto _: state) {
+        BasicObjectStore store;
+        RootScope scope;
+        IdentityCallHandler f;
+        const Object &file = store.create_string("file.cpp");
+
+        scope.put("f", store.create_function(f));
+        scope.put("files", store.create_lazy_list([&](bool) {
+            struct Generated : public EntryStream {
+                Generated(const Object &file_, int64_t count_) : file(file_), remaining(count_) {}
+
+                const Object *next() override { return remaining-- > 0 ? &file : nullptr; }
+
+                const Object &file;
+                int64_t remaining;
+            };
+            return std::make_unique<Generated>(file, count);
+        }));
+
+        StaticImportResolver import_resolver;
+        DefaultParser parser(import_resolver);
+        StringSource source("x = [f(c) for c in [f(b) for b in [f(a) for a in files]]]");
+        auto parse_result = parser.parse(source);
+        Node ast = parse_result.ast();
+        interpret(store, scope, ast);
+
+        auto stream = scope.get("x").transient_stream();
+        int64_t n = 0;
+        while (stream->next()) n++;
+        benchmark::DoNotOptimize(n);
+    }
+    state.SetItemsProcessed(state.iterations() * count);
+}
+
+BENCHMARK(BM_stream_chained_lists_for)->Arg(100000)->Unit(benchmark::kMillisecond);
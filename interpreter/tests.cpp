@@ -54,6 +54,15 @@ private:
     std::function<CallResult(const CallArgList &)> handler;
 };
 
+class PureCallHandler : public SimpleCallHandler {
+public:
+    using SimpleCallHandler::SimpleCallHandler;
+
+    [[nodiscard]] bool is_pure() const override {
+        return true;
+    }
+};
+
 TEST(Scope, test_define_get) {
     BasicObjectStore store;
     RootScope scope;
@@ -331,4 +340,412 @@ TEST(Interpreter, test_import_assignment) {
     import_resolver.set("t.mkr", source);
     interpret(store, scope, parse_str_with_import("a=import(\"t.mkr\")", import_resolver));
     EXPECT_THAT(scope.get("a").attr("t").get_string(), Eq("txt"));
-}
\ No newline at end of file
+}
+
+TEST(Interpreter, test_import_sees_builtins) {
+    BasicObjectStore store;
+    RootScope builtin_scope;
+    builtin_scope.put("b", store.create_string("builtin"));
+    ScopeWrapper scope(builtin_scope);
+    scope.put("c", store.create_string("not visible"));
+    CallCache call_cache;
+    StaticImportResolver import_resolver;
+    StringSource source("t=b");
+    import_resolver.set("t.mkr", source);
+    Node ast = parse_str_with_import("a=import(\"t.mkr\")", import_resolver);
+    Interpreter(store, scope, ast, call_cache, builtin_scope).interpret();
+    EXPECT_THAT(scope.get("a").attr("t").get_string(), Eq("builtin"));
+    EXPECT_THROW(scope.get("a").attr("b"), UnknownAttributeError);
+
+    StringSource other_source("t=c");
+    import_resolver.set("u.mkr", other_source);
+    Node other_ast = parse_str_with_import("u=import(\"u.mkr\")", import_resolver);
+    EXPECT_FALSE(Interpreter(store, scope, other_ast, call_cache, builtin_scope).interpret().success());
+}
+
+TEST(Interpreter, test_import_external_object) {
+    class StringLoader : public ExternalObjectLoader {
+    public:
+        explicit StringLoader(ObjectStore &store_) :
+                store(store_) {}
+
+        const Object &load(const std::string &import_spec) override {
+            if (import_spec == "missing.py") throw ExternalObjectError("Cannot import");
+            return store.create_string("loaded " + import_spec);
+        }
+
+    private:
+        ObjectStore &store;
+    };
+
+    BasicObjectStore store;
+    RootScope builtin_scope;
+    ScopeWrapper scope(builtin_scope);
+    CallCache call_cache;
+    StringLoader loader(store);
+    StaticImportResolver import_resolver;
+    import_resolver.set_external("tools.py");
+    import_resolver.set_external("missing.py");
+
+    Node ast = parse_str_with_import("a=import(\"tools.py\")", import_resolver);
+    EXPECT_TRUE(Interpreter(store, scope, ast, call_cache, builtin_scope, loader).interpret().success());
+    EXPECT_THAT(scope.get("a").get_string(), Eq("loaded tools.py"));
+
+    Node missing_ast = parse_str_with_import("b=import(\"missing.py\")", import_resolver);
+    EXPECT_FALSE(Interpreter(store, scope, missing_ast, call_cache, builtin_scope, loader).interpret().success());
+
+    // Without a loader
+    Node other_ast = parse_str_with_import("c=import(\"tools.py\")", import_resolver);
+    EXPECT_FALSE(Interpreter(store, scope, other_ast, call_cache, builtin_scope).interpret().success());
+}
+
+TEST(Object, test_digest_of_equal_content) {
+    BasicObjectStore store;
+    const Object &a = store.create_list({store.create_string("x"), store.create_struct({{"y", store.create_string("y")}})});
+    const Object &b = store.create_list({store.create_string("x"), store.create_struct({{"y", store.create_string("y")}})});
+    EXPECT_THAT(a.digest(), Eq(b.digest()));
+}
+
+TEST(Object, test_digest_of_different_content) {
+    BasicObjectStore store;
+    EXPECT_THAT(store.create_string("ab").digest(), testing::Ne(store.create_string("ba").digest()));
+    EXPECT_THAT(store.create_list({store.create_string("ab"), store.create_string("c")}).digest(),
+                testing::Ne(store.create_list({store.create_string("a"), store.create_string("bc")}).digest()));
+    EXPECT_THAT(store.create_struct({{"a", store.create_string("b")}}).digest(),
+                testing::Ne(store.create_struct({{"b", store.create_string("a")}}).digest()));
+}
+
+TEST(Object, test_digest_of_types) {
+    BasicObjectStore store;
+    EXPECT_THAT(store.create_list({}).digest(), testing::Ne(store.create_struct({}).digest()));
+}
+
+TEST(Object, test_digest_of_functions) {
+    BasicObjectStore store;
+    SimpleCallHandler f([](const CallArgList &args) { return CallResult(); });
+    SimpleCallHandler g([](const CallArgList &args) { return CallResult(); });
+    EXPECT_THAT(store.create_function(f).digest(), Eq(store.create_function(f).digest()));
+    EXPECT_THAT(store.create_function(f).digest(), testing::Ne(store.create_function(g).digest()));
+}
+
+
+TEST(CallCache, test_pure_call_is_reused) {
+    BasicObjectStore store;
+    RootScope scope;
+    CallCache cache;
+
+    int calls = 0;
+    PureCallHandler f([&](const CallArgList &args) {
+        calls++;
+        return CallResult(store.create_string(args.arg(0).object().get_string() + "!"));
+    });
+    scope.put("f", store.create_function(f));
+
+    const auto result = interpret(store, scope, parse_str("x = f(\"a\") y = f(\"a\") z = f(\"b\")"), cache);
+    EXPECT_THAT(calls, Eq(2));
+    EXPECT_THAT(scope.get("x"), Ref(scope.get("y")));
+    EXPECT_THAT(scope.get("z").get_string(), Eq("b!"));
+    EXPECT_THAT(result.stats().call_cache_hits, Eq(1u));
+    EXPECT_THAT(result.stats().call_cache_misses, Eq(2u));
+}
+
+TEST(CallCache, test_kwarg_order_is_ignored) {
+    BasicObjectStore store;
+    RootScope scope;
+    CallCache cache;
+
+    int calls = 0;
+    PureCallHandler f([&](const CallArgList &args) {
+        calls++;
+        return CallResult(args.arg("a").object());
+    });
+    scope.put("f", store.create_function(f));
+
+    interpret(store, scope, parse_str("x = f(a=\"1\" b=\"2\") y = f(b=\"2\" a=\"1\") z = f(a=\"2\" b=\"1\")"), cache);
+    EXPECT_THAT(calls, Eq(2));
+}
+
+TEST(CallCache, test_impure_call_is_not_cached) {
+    BasicObjectStore store;
+    RootScope scope;
+    CallCache cache;
+
+    int calls = 0;
+    SimpleCallHandler f([&](const CallArgList &args) {
+        calls++;
+        return CallResult(args.arg(0).object());
+    });
+    scope.put("f", store.create_function(f));
+
+    const auto result = interpret(store, scope, parse_str("x = f(\"a\") y = f(\"a\")"), cache);
+    EXPECT_THAT(calls, Eq(2));
+    EXPECT_THAT(result.stats().call_cache_hits, Eq(0u));
+}
+
+TEST(CallCache, test_failed_call_is_not_cached) {
+    BasicObjectStore store;
+    RootScope scope;
+    CallCache cache;
+
+    PureCallHandler f([&](const CallArgList &args) {
+        CallResult result;
+        result.add_call_error("error");
+        return result;
+    });
+    scope.put("f", store.create_function(f));
+
+    interpret(store, scope, parse_str("x = f(\"a\")"), cache);
+    EXPECT_THAT(cache.size(), Eq(0u));
+}
+
+TEST(CallCache, test_failing_lazy_argument_is_reported) {
+    BasicObjectStore store;
+    RootScope scope;
+    CallCache cache;
+
+    SimpleCallHandler f([](const CallArgList &args) {
+        CallResult result;
+        result.add_call_error("error");
+        return result;
+    });
+    PureCallHandler g([](const CallArgList &args) {
+        return CallResult(args.arg(0).object());
+    });
+    scope.put("f", store.create_function(f));
+    scope.put("g", store.create_function(g));
+
+    // The key of the call to g consumes the list
+    const auto result = interpret(store, scope, parse_str("x = g([f(x) for x in [\"a\"]])"), cache);
+    ASSERT_THAT(result.errors().size(), Eq(1u));
+    EXPECT_THAT(result.errors().front().message, Eq("error"));
+    EXPECT_THAT(cache.size(), Eq(0u));
+}
+
+TEST(ObjectStore, test_derived_struct) {
+    BasicObjectStore store;
+    const Object &a = store.create_string("a");
+    const Object &b = store.create_string("b");
+    const Object &c = store.create_string("c");
+    const Object &base = store.create_struct({{"x", a}, {"y", b}});
+    const Object &derived = store.create_struct(base, {{"y", c}, {"z", a}});
+
+    EXPECT_THAT(base.attr("y"), Ref(b));
+    EXPECT_THAT(derived.attr("x"), Ref(a));
+    EXPECT_THAT(derived.attr("y"), Ref(c));
+    EXPECT_THAT(derived.attr("z"), Ref(a));
+    EXPECT_THAT(derived.digest(), Eq(store.create_struct({{"x", a}, {"y", c}, {"z", a}}).digest()));
+}
+
+TEST(Interpreter, test_list_concatenation) {
+    BasicObjectStore store;
+    RootScope scope;
+
+    const auto result = interpret(store, scope, parse_str("x = [\"a\" \"b\"] y = x + [\"c\"]"));
+    EXPECT_THAT(result.success(), IsTrue());
+    const Object &y = scope.get("y");
+    EXPECT_THAT(y.entries().size(), Eq(3u));
+    EXPECT_THAT(y.entries().at(2).get().get_string(), Eq("c"));
+    EXPECT_THAT(scope.get("x").entries().size(), Eq(2u));
+}
+
+TEST(Interpreter, test_string_concatenation) {
+    BasicObjectStore store;
+    RootScope scope;
+
+    interpret(store, scope, parse_str("x = \"a\" + \"b\""));
+    EXPECT_THAT(scope.get("x").get_string(), Eq("ab"));
+}
+
+TEST(Interpreter, test_invalid_concatenation) {
+    BasicObjectStore store;
+    RootScope scope;
+
+    const auto result = interpret(store, scope, parse_str("x = [\"a\"] + \"b\""));
+    EXPECT_THAT(result.success(), IsFalse());
+}
+
+TEST(ObjectStore, test_list_operations) {
+    BasicObjectStore store;
+    const Object &a = store.create_string("a");
+    const Object &b = store.create_string("b");
+    const Object &list = store.create_list({a, b});
+
+    const Object &appended = store.create_appended_list(list, a);
+    EXPECT_THAT(appended.entries().size(), Eq(3u));
+    EXPECT_THAT(appended.entries().at(2).get(), Ref(a));
+
+    const Object &sliced = store.create_sliced_list(appended, 1, 3);
+    EXPECT_THAT(sliced.entries().size(), Eq(2u));
+    EXPECT_THAT(sliced.entries().at(0).get(), Ref(b));
+    EXPECT_THAT(sliced.digest(), Eq(store.create_list({b, a}).digest()));
+}
+
+TEST(Interpreter, test_lists_for_is_lazy) {
+    BasicObjectStore store;
+    RootScope scope;
+
+    std::string log;
+    SimpleCallHandler f([&](const CallArgList &args) {
+        log += "f" + args.arg(0).object().get_string();
+        return CallResult(args.arg(0).object());
+    });
+    SimpleCallHandler g([&](const CallArgList &args) {
+        log += "g" + args.arg(0).object().get_string();
+        return CallResult(args.arg(0).object());
+    });
+    scope.put("f", store.create_function(f));
+    scope.put("g", store.create_function(g));
+
+    const auto result = interpret(store, scope, parse_str("x = [g(y) for y in [f(x) for x in [\"1\" \"2\"]]]"));
+    EXPECT_THAT(result.success(), IsTrue());
+    EXPECT_THAT(log, Eq(""));
+
+    // Entries pass through the chain one at a time
+    auto stream = scope.get("x").stream();
+    while (stream->next()) {}
+    EXPECT_THAT(log, Eq("f1g1f2g2"));
+}
+
+TEST(Interpreter, test_lists_for_chain_is_not_materialized) {
+    class CountingObjectStore : public BasicObjectStore {
+    public:
+        Object &create_string(std::string value) override {
+            strings++;
+            return BasicObjectStore::create_string(std::move(value));
+        }
+
+        unsigned int strings = 0;
+    };
+
+    CountingObjectStore store;
+    RootScope scope;
+    const Object &file = store.create_string("file");
+    const int64_t count = 100000;
+    scope.put("files", store.create_lazy_list([&](bool) {
+        struct Generated : public EntryStream {
+            Generated(const Object &file_, int64_t count_) : file(file_), remaining(count_) {}
+
+            const Object *next() override { return remaining-- > 0 ? &file : nullptr; }
+
+            const Object &file;
+            int64_t remaining;
+        };
+        return std::make_unique<Generated>(file, count);
+    }));
+
+    const auto result = interpret(store, scope, parse_str(
+            "a = [x + \".o\" for x in files] b = [x + \".d\" for x in a] c = [x + \".s\" for x in b]"));
+    ASSERT_THAT(result.success(), IsTrue());
+    const unsigned int strings = store.strings;
+
+    auto stream = scope.get("c").transient_stream();
+    int64_t n = 0;
+    while (const Object *entry = stream->next()) {
+        if (n++ == 0) {
+            EXPECT_THAT(entry->get_string(), Eq("file.o.d.s"));
+        }
+    }
+    EXPECT_THAT(n, Eq(count));
+
+    // The strings of the entries were created in stores the streams dropped
+    EXPECT_THAT(store.strings, Eq(strings));
+    for (const char *id: {"a", "b", "c"}) {
+        EXPECT_FALSE(dynamic_cast<const LazyListObject &>(scope.get(id)).is_materialized());
+    }
+}
+
+TEST(Interpreter, test_lists_for_materializes_once) {
+    BasicObjectStore store;
+    RootScope scope;
+
+    int calls = 0;
+    SimpleCallHandler f([&](const CallArgList &args) {
+        calls++;
+        return CallResult(args.arg(0).object());
+    });
+    scope.put("f", store.create_function(f));
+
+    interpret(store, scope, parse_str("x = [f(x) for x in [\"a\" \"b\" \"c\"]]"));
+    const Object &x = scope.get("x");
+    EXPECT_THAT(x.entries().size(), Eq(3u));
+    EXPECT_THAT(x.entries().at(1).get().get_string(), Eq("b"));
+    EXPECT_THAT(calls, Eq(3));
+}
+
+TEST(Interpreter, test_nested_lists_for) {
+    BasicObjectStore store;
+    RootScope scope;
+
+    SimpleCallHandler f_concat([&](const CallArgList &args) {
+        return CallResult(store.create_string(args.arg(0).object().get_string() + args.arg(1).object().get_string()));
+    });
+    scope.put("f_concat", store.create_function(f_concat));
+
+    const auto result = interpret(store, scope, parse_str(
+            "ys = [\"1\" \"2\"] x = [[f_concat(x y) for y in ys] for x in [\"a\" \"b\"]]"));
+    EXPECT_THAT(result.success(), IsTrue());
+
+    const Object &x = scope.get("x");
+    EXPECT_THAT(x.entries().at(0).get().entries().at(1).get().get_string(), Eq("a2"));
+    EXPECT_THAT(x.entries().at(1).get().entries().at(0).get().get_string(), Eq("b1"));
+}
+
+TEST(Interpreter, test_lists_for_error_is_reported_on_use) {
+    BasicObjectStore store;
+    RootScope scope;
+
+    SimpleCallHandler f([](const CallArgList &args) {
+        CallResult result;
+        result.add_call_error("error");
+        return result;
+    });
+    SimpleCallHandler count([&](const CallArgList &args) {
+        return CallResult(store.create_string(std::to_string(args.arg(0).object().entries().size())));
+    });
+    scope.put("f", store.create_function(f));
+    scope.put("count", store.create_function(count));
+
+    const auto result = interpret(store, scope, parse_str("x = [f(x) for x in [\"a\"]] n = count(x)"));
+    EXPECT_THAT(result.success(), IsFalse());
+}
+
+TEST(Interpreter, test_lists_for_error_is_reported_in_expression) {
+    BasicObjectStore store;
+    RootScope scope;
+
+    SimpleCallHandler f([](const CallArgList &args) {
+        CallResult result;
+        result.add_call_error("error");
+        return result;
+    });
+    scope.put("f", store.create_function(f));
+
+    SimpleCallHandler count([&](const CallArgList &args) {
+        return CallResult(store.create_string(std::to_string(args.arg(0).object().entries().size())));
+    });
+    scope.put("count", store.create_function(count));
+
+    StringSource source("x = [f(x) for x in [\"a\"]] n = count(x)");
+    StaticImportResolver import_resolver;
+    DefaultParser parser(import_resolver);
+    const Node ast = parser.parse(source).ast();
+    const auto result = interpret(store, scope, ast);
+    ASSERT_THAT(result.errors().size(), Eq(1u));
+    EXPECT_THAT(result.errors().front().message, Eq("error"));
+    EXPECT_THAT(result.errors().front().node.get_type(), Eq(NodeType::CALL_STATEMENT));
+    EXPECT_THAT(result.errors().front().node.get_source_location().annotate("here"),
+                testing::EndsWith("\n     ^-- here"));
+}
+
+TEST(Interpreter, test_lazy_list_digest) {
+    BasicObjectStore store;
+    RootScope scope;
+
+    SimpleCallHandler f([](const CallArgList &args) {
+        return CallResult(args.arg(0).object());
+    });
+    scope.put("f", store.create_function(f));
+
+    interpret(store, scope, parse_str("x = [f(x) for x in [\"a\" \"b\"]] y = [\"a\" \"b\"]"));
+    EXPECT_THAT(scope.get("x").digest(), Eq(scope.get("y").digest()));
+}
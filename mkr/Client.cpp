@@ -0,0 +1,73 @@
+//
+// Created by roel on 10/19/26.
+//
+
+#include "Client.h"
+#include "Server.h"
+#include "util/Socket.h"
+
+#include <cerrno>
+#include <cstring>
+#include <cstdint>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+/*
+ * Sends the frame, with out_fd attached to its first bytes.
+ */
+static bool send_with_fd(int fd, const std::string &frame, int out_fd) {
+    iovec iov{const_cast<char *>(frame.data()), frame.size()};
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))] = {};
+    msghdr message{};
+    message.msg_iov = &iov;
+    message.msg_iovlen = 1;
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+
+    cmsghdr *header = CMSG_FIRSTHDR(&message);
+    header->cmsg_level = SOL_SOCKET;
+    header->cmsg_type = SCM_RIGHTS;
+    header->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(header), &out_fd, sizeof(out_fd));
+
+    ssize_t count;
+    do {
+        count = sendmsg(fd, &message, MSG_NOSIGNAL);
+    } while (count < 0 && errno == EINTR);
+    if (count <= 0) return false;
+    return send_all(fd, frame.data() + count, frame.size() - static_cast<size_t>(count));
+}
+
+std::optional<int> Client::request(const std::string &socket_path, const std::vector<std::string> &arguments,
+                                   int out_fd) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (socket_path.size() >= sizeof(address.sun_path)) return std::nullopt;
+    memcpy(address.sun_path, socket_path.c_str(), socket_path.size() + 1);
+
+    const int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return std::nullopt;
+    if (connect(fd, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) != 0) {
+        close(fd);
+        return std::nullopt;
+    }
+
+    std::string frame;
+    append_u32(frame, 0);
+    for (const std::string &arg: arguments) {
+        append_u32(frame, static_cast<uint32_t>(arg.size()));
+        frame += arg;
+    }
+    const uint32_t size = static_cast<uint32_t>(frame.size() - sizeof(uint32_t));
+    memcpy(frame.data(), &size, sizeof(size));
+
+    int32_t exit_code;
+    const bool success = send_with_fd(fd, frame, out_fd) &&
+                         receive_all(fd, reinterpret_cast<char *>(&exit_code), sizeof(exit_code));
+    close(fd);
+    if (!success) {
+        throw ServerError("The server stopped during the request");
+    }
+    return exit_code;
+}
@@ -0,0 +1,26 @@
+//
+// Created by roel on 10/19/26.
+//
+
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <optional>
+
+/*
+ * Sends requests to a Server, see Server.h for the protocol.
+ */
+class Client {
+public:
+    /*
+     * Sends the arguments to the server listening on the socket, which writes
+     * the output of the request to out_fd. Returns the exit code, or nothing
+     * if no server is listening. Throws ServerError if the server goes away
+     * during the request.
+     */
+    [[nodiscard]] static std::optional<int> request(const std::string &socket_path,
+                                                    const std::vector<std::string> &arguments,
+                                                    int out_fd);
+};
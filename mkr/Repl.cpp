@@ -10,7 +10,28 @@
 Repl::Repl(ImportResolver &import_resolver_, ObjectStore &object_store_, Scope &root_scope_) :
         import_resolver(import_resolver_),
         object_store(object_store_),
-        root_scope(root_scope_) {}
+        root_scope(root_scope_),
+        builtin_scope(nullptr),
+        external_objects(nullptr),
+        call_cache() {}
+
+Repl::Repl(ImportResolver &import_resolver_, ObjectStore &object_store_, Scope &root_scope_,
+           const Scope &builtin_scope_) :
+        import_resolver(import_resolver_),
+        object_store(object_store_),
+        root_scope(root_scope_),
+        builtin_scope(&builtin_scope_),
+        external_objects(nullptr),
+        call_cache() {}
+
+Repl::Repl(ImportResolver &import_resolver_, ObjectStore &object_store_, Scope &root_scope_,
+           const Scope &builtin_scope_, ExternalObjectLoader &external_objects_) :
+        import_resolver(import_resolver_),
+        object_store(object_store_),
+        root_scope(root_scope_),
+        builtin_scope(&builtin_scope_),
+        external_objects(&external_objects_),
+        call_cache() {}
 
 Repl::EvalResult Repl::eval(Source &source) {
     DefaultParser parser(import_resolver);
@@ -24,8 +45,12 @@ Repl::EvalResult Repl::eval(Source &source) {
     if (!parse_result.success()) return eval_result;
 
     Node ast = parse_result.ast();
-    Interpreter interpreter(object_store, root_scope, ast);
-    InterpretResult interpret_result = interpreter.interpret();
+    InterpretResult interpret_result =
+            external_objects ? Interpreter(object_store, root_scope, ast, call_cache, *builtin_scope,
+                                           *external_objects).interpret()
+            : builtin_scope ? Interpreter(object_store, root_scope, ast, call_cache, *builtin_scope).interpret()
+            : Interpreter(object_store, root_scope, ast, call_cache).interpret();
+    eval_result.set_stats(interpret_result.stats());
 
     for (const InterpretResult::Error &error: interpret_result.errors()) {
         eval_result.add_error(error.node.get_source_location(), error.message);
@@ -17,6 +17,12 @@ class Repl {
 public:
     explicit Repl(ImportResolver &import_resolver_, ObjectStore &object_store_, Scope &root_scope_);
 
+    explicit Repl(ImportResolver &import_resolver_, ObjectStore &object_store_, Scope &root_scope_,
+                  const Scope &builtin_scope_);
+
+    explicit Repl(ImportResolver &import_resolver_, ObjectStore &object_store_, Scope &root_scope_,
+                  const Scope &builtin_scope_, ExternalObjectLoader &external_objects_);
+
     class EvalResult {
     public:
         struct Error {
@@ -32,8 +38,13 @@ public:
 
         [[nodiscard]] const std::list<Error> &errors() const { return error_list; }
 
+        [[nodiscard]] const InterpretResult::Stats &stats() const { return _stats; }
+
+        void set_stats(const InterpretResult::Stats &stats) { _stats = stats; }
+
     private:
         std::list<Error> error_list;
+        InterpretResult::Stats _stats;
     };
 
     EvalResult eval(Source &source);
@@ -42,6 +53,9 @@ private:
     ImportResolver &import_resolver;
     ObjectStore &object_store;
     Scope &root_scope;
+    const Scope *builtin_scope;
+    ExternalObjectLoader *external_objects;
+    CallCache call_cache;
 };
 
 
@@ -0,0 +1,178 @@
+//
+// Created by roel on 10/19/26.
+//
+
+#include "Server.h"
+#include "util/Socket.h"
+
+#include <cerrno>
+#include <cstring>
+#include <cstdint>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+static constexpr uint32_t max_request_size = 1024 * 1024;
+
+// Clients that connect but do not send their request are dropped after this
+static constexpr time_t request_timeout_seconds = 5;
+
+static sockaddr_un socket_address(const std::string &socket_path) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    memcpy(address.sun_path, socket_path.c_str(), socket_path.size() + 1);
+    return address;
+}
+
+/*
+ * Whether a server accepts connections on the socket.
+ */
+static bool is_listening(const sockaddr_un &address) {
+    const int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return false;
+    const bool listening = connect(fd, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) == 0;
+    close(fd);
+    return listening;
+}
+
+Server::Server(std::string socket_path_) :
+        socket_path(std::move(socket_path_)),
+        listen_fd(socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0)),
+        stop_fd(eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)) {
+    auto fail = [this](const std::string &message) {
+        if (listen_fd >= 0) close(listen_fd);
+        if (stop_fd >= 0) close(stop_fd);
+        throw ServerError(message);
+    };
+
+    if (listen_fd < 0 || stop_fd < 0) {
+        fail(std::string("Cannot create a socket: ") + strerror(errno));
+    }
+
+    if (socket_path.size() >= sizeof(sockaddr_un::sun_path)) {
+        fail("Socket path '" + socket_path + "' is too long");
+    }
+
+    const sockaddr_un address = socket_address(socket_path);
+    if (bind(listen_fd, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) != 0) {
+        if (errno != EADDRINUSE) {
+            fail("Cannot bind '" + socket_path + "': " + strerror(errno));
+        }
+        if (is_listening(address)) {
+            fail("A server is already running on '" + socket_path + "'");
+        }
+        // Left behind by a server that is gone
+        unlink(socket_path.c_str());
+        if (bind(listen_fd, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) != 0) {
+            fail("Cannot bind '" + socket_path + "': " + strerror(errno));
+        }
+    }
+
+    if (listen(listen_fd, 16) != 0) {
+        unlink(socket_path.c_str());
+        fail("Cannot listen on '" + socket_path + "': " + strerror(errno));
+    }
+}
+
+Server::~Server() {
+    close(listen_fd);
+    close(stop_fd);
+    unlink(socket_path.c_str());
+}
+
+void Server::run(const Handler &handler) {
+    pollfd fds[2] = {
+            {listen_fd, POLLIN, 0},
+            {stop_fd,   POLLIN, 0},
+    };
+
+    while (true) {
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) continue;
+            throw ServerError(std::string("Cannot wait for clients: ") + strerror(errno));
+        }
+        if (fds[1].revents) return;
+        if (!(fds[0].revents & POLLIN)) continue;
+
+        const int fd = accept4(listen_fd, nullptr, nullptr, SOCK_CLOEXEC);
+        if (fd < 0) continue;
+        handle(fd, handler);
+        close(fd);
+    }
+}
+
+void Server::stop() {
+    const uint64_t value = 1;
+    [[maybe_unused]] const ssize_t count = write(stop_fd, &value, sizeof(value));
+}
+
+void Server::handle(int fd, const Handler &handler) const {
+    const timeval timeout{request_timeout_seconds, 0};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    // The stdout of the client comes with the first bytes of the request
+    uint32_t size;
+    iovec iov{&size, sizeof(size)};
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))];
+    msghdr message{};
+    message.msg_iov = &iov;
+    message.msg_iovlen = 1;
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+
+    ssize_t count;
+    do {
+        count = recvmsg(fd, &message, MSG_CMSG_CLOEXEC);
+    } while (count < 0 && errno == EINTR);
+    if (count <= 0) return;
+
+    int out_fd = -1;
+    const cmsghdr *header = CMSG_FIRSTHDR(&message);
+    if (header && header->cmsg_level == SOL_SOCKET && header->cmsg_type == SCM_RIGHTS) {
+        memcpy(&out_fd, CMSG_DATA(header), sizeof(out_fd));
+    }
+    if (out_fd < 0) return;
+
+    std::vector<std::string> arguments;
+    std::string body;
+    bool valid = receive_all(fd, reinterpret_cast<char *>(&size) + count,
+                             sizeof(size) - static_cast<size_t>(count)) && size <= max_request_size;
+    if (valid) {
+        body.resize(size);
+        valid = receive_all(fd, body.data(), body.size());
+    }
+    for (size_t offset = 0; valid && offset < body.size();) {
+        uint32_t length;
+        if (body.size() - offset < sizeof(length)) {
+            valid = false;
+            break;
+        }
+        memcpy(&length, body.data() + offset, sizeof(length));
+        offset += sizeof(length);
+        if (body.size() - offset < length) {
+            valid = false;
+            break;
+        }
+        arguments.push_back(body.substr(offset, length));
+        offset += length;
+    }
+
+    FILE *out = valid ? fdopen(out_fd, "w") : nullptr;
+    if (!out) {
+        close(out_fd);
+        return;
+    }
+
+    int32_t exit_code;
+    try {
+        exit_code = handler(arguments, out);
+    } catch (const std::exception &e) {
+        fprintf(out, "Error: %s\n", e.what());
+        exit_code = 1;
+    }
+    fclose(out);
+
+    send_all(fd, reinterpret_cast<const char *>(&exit_code), sizeof(exit_code));
+}
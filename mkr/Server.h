@@ -0,0 +1,77 @@
+//
+// Created by roel on 10/19/26.
+//
+
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <functional>
+#include <stdexcept>
+#include <cstdio>
+
+/*
+ * Serves the requests of mkr clients on a Unix domain socket, so that what a
+ * request needs (the parsed and interpreted build files, action graphs) can
+ * stay in memory between requests. Requests are handled one at a time, in the
+ * thread that runs the server.
+ *
+ * A request is the command line of the client together with its stdout, to
+ * which the server writes the output of the request directly:
+ *
+ *     request    u32 size of the rest, and for every argument: u32 length,
+ *                bytes; the stdout of the client is passed as SCM_RIGHTS
+ *     response   i32 exit code
+ *
+ * Integers are little endian.
+ */
+class Server {
+public:
+    /*
+     * Handles the arguments of a request, writes its output to out and
+     * returns the exit code.
+     */
+    using Handler = std::function<int(const std::vector<std::string> &arguments, FILE *out)>;
+
+    /*
+     * Listens on the socket, throws ServerError if another server already
+     * does. A socket file left behind by a server that is gone is replaced.
+     */
+    explicit Server(std::string socket_path);
+
+    Server(const Server &) = delete;
+
+    Server &operator=(const Server &) = delete;
+
+    /*
+     * Stops listening and removes the socket file.
+     */
+    ~Server();
+
+    /*
+     * Handles requests until stop() is called.
+     */
+    void run(const Handler &handler);
+
+    /*
+     * Makes run() return after the request it is handling, if any. Safe to
+     * call from another thread or a signal handler.
+     */
+    void stop();
+
+private:
+    const std::string socket_path;
+    const int listen_fd;
+
+    // Signalled to stop the server
+    const int stop_fd;
+
+    void handle(int fd, const Handler &handler) const;
+};
+
+class ServerError : public std::runtime_error {
+public:
+    explicit ServerError(const std::string &message_) :
+            std::runtime_error(message_) {}
+};
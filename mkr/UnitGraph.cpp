@@ -0,0 +1,328 @@
+//
+// Created by roel on 10/19/26.
+//
+
+#include "UnitGraph.h"
+
+#include "interpreter/Interpreter.h"
+#include "interpreter/ScopeWrapper.h"
+#include "parser/DefaultParser.h"
+#include "util/Hasher.h"
+
+#include <algorithm>
+
+UnitGraph::UnitGraph(ImportResolver &import_resolver_, ObjectStore &object_store_, const Scope &builtin_scope_) :
+        UnitGraph(import_resolver_, object_store_, builtin_scope_, nullptr) {}
+
+UnitGraph::UnitGraph(ImportResolver &import_resolver_, ObjectStore &object_store_, const Scope &builtin_scope_,
+                     ExternalObjectLoader &external_objects_) :
+        UnitGraph(import_resolver_, object_store_, builtin_scope_, &external_objects_) {}
+
+UnitGraph::UnitGraph(ImportResolver &import_resolver_, ObjectStore &object_store_, const Scope &builtin_scope_,
+                     ExternalObjectLoader *external_objects_) :
+        import_resolver(import_resolver_),
+        object_store(object_store_),
+        builtin_scope(builtin_scope_),
+        external_objects(external_objects_),
+        call_cache(),
+        sources(),
+        dropped_sources(),
+        units(),
+        unit_specs(),
+        binders(),
+        reads(),
+        readers(),
+        importers(),
+        loading(),
+        interpreted_count(0),
+        unit_stats() {}
+
+ImportResolver::Result UnitGraph::resolve(const std::string &import_spec) {
+    if (!loading.empty()) {
+        importers[import_spec].insert(loading.back());
+    }
+
+    if (sources.contains(import_spec)) {
+        return Result(Result::Type::EXTERNAL_OBJECT);
+    }
+
+    Result result = import_resolver.resolve(import_spec);
+    if (result.is_mkr_program()) {
+        sources.emplace(import_spec, result.get_source());
+        return Result(Result::Type::EXTERNAL_OBJECT);
+    }
+    return result;
+}
+
+const Object &UnitGraph::load(const std::string &import_spec) {
+    auto source_it = sources.find(import_spec);
+    if (source_it == sources.end()) {
+        if (!external_objects) {
+            throw ExternalObjectError("Cannot import '" + import_spec + "'");
+        }
+        return external_objects->load(import_spec);
+    }
+
+    auto it = units.find(import_spec);
+    if (it == units.end()) {
+        if (std::find(loading.begin(), loading.end(), import_spec) != loading.end()) {
+            std::string cycle;
+            for (auto loading_it = std::find(loading.begin(), loading.end(), import_spec);
+                 loading_it != loading.end(); loading_it++) {
+                cycle += "'" + *loading_it + "' -> ";
+            }
+            throw ExternalObjectError("Import cycle: " + cycle + "'" + import_spec + "'");
+        }
+        it = units.emplace(import_spec, interpret(import_spec, source_it->second)).first;
+    }
+
+    if (!it->second.object) {
+        throw ExternalObjectError(it->second.error);
+    }
+    return *it->second.object;
+}
+
+void UnitGraph::attribute_read(const Object &object, const std::string &attribute) {
+    Reads *unit_reads = reads_of(object);
+    if (unit_reads && !unit_reads->whole) {
+        unit_reads->attributes.insert(attribute);
+    }
+}
+
+void UnitGraph::object_used(const Object &object) {
+    Reads *unit_reads = reads_of(object);
+    if (unit_reads) {
+        unit_reads->whole = true;
+    }
+}
+
+size_t UnitGraph::invalidate(const std::vector<std::string> &import_specs) {
+    std::unordered_map<std::string, const Object *> previous;
+    std::vector<std::string> changed_specs;
+
+    // What failed units depend on is not known, so they are interpreted again
+    // on any change
+    std::vector<std::string> pending = import_specs;
+    for (const auto &[import_spec, unit]: units) {
+        if (!unit.object) pending.push_back(import_spec);
+    }
+
+    // Reads are not recorded for other imports, so the units importing them
+    // are dropped as a whole
+    std::unordered_set<std::string> visited;
+    while (!pending.empty()) {
+        const std::string import_spec = std::move(pending.back());
+        pending.pop_back();
+        if (!visited.insert(import_spec).second) continue;
+
+        if (drop(import_spec, previous)) {
+            changed_specs.push_back(import_spec);
+            continue;
+        }
+        if (external_objects) {
+            external_objects->forget(import_spec);
+        }
+        auto it = importers.find(import_spec);
+        if (it != importers.end()) {
+            pending.insert(pending.end(), it->second.begin(), it->second.end());
+            importers.erase(it);
+        }
+    }
+
+    // Units interpreted again before a unit they read was, read its previous
+    // struct and are compared again when that unit is
+    size_t count = changed_specs.size();
+    while (!changed_specs.empty()) {
+        const std::string import_spec = std::move(changed_specs.back());
+        changed_specs.pop_back();
+
+        const Object *before = previous[import_spec];
+        const Object *after = reload(import_spec);
+        if (before && after && before != after) {
+            rebind(*before, *after);
+        }
+
+        auto readers_it = readers.find(import_spec);
+        if (readers_it == readers.end()) continue;
+        const std::vector<std::string> unit_readers(readers_it->second.begin(), readers_it->second.end());
+        for (const std::string &reader: unit_readers) {
+            if (!units.contains(reader)) continue;
+            if (before && after && !changed(reads[reader][import_spec], *before, *after)) continue;
+            drop(reader, previous);
+            changed_specs.push_back(reader);
+            count++;
+        }
+    }
+
+    for (Source &source: dropped_sources) {
+        import_resolver.release(source);
+    }
+    dropped_sources.clear();
+    return count;
+}
+
+unsigned int UnitGraph::interpreted() const {
+    return interpreted_count;
+}
+
+const InterpretResult::Stats &UnitGraph::stats() const {
+    return unit_stats;
+}
+
+/*
+ * Describes an error in a unit, with the line it is on.
+ */
+static std::string describe_error(const Source::Location &location, const std::string &message) {
+    return "\n" + message + "\n" + location.annotate("here");
+}
+
+UnitGraph::Unit UnitGraph::interpret(const std::string &import_spec, Source &source) {
+    interpreted_count++;
+    forget_reads(import_spec);
+    loading.push_back(import_spec);
+
+    std::string error;
+    const Object *object = nullptr;
+    try {
+        DefaultParser parser(*this);
+        Parser::Result parse_result = parser.parse(source);
+        for (const Parser::Result::Error &parse_error: parse_result.errors()) {
+            error += describe_error(parse_error.source_location, parse_error.message);
+        }
+
+        if (parse_result.success()) {
+            ScopeWrapper scope(builtin_scope);
+            InterpretResult result = Interpreter(object_store, scope, parse_result.ast(), call_cache, builtin_scope,
+                                                 *this).interpret();
+            unit_stats.call_cache_hits += result.stats().call_cache_hits;
+            unit_stats.call_cache_misses += result.stats().call_cache_misses;
+            for (const InterpretResult::Error &interpret_error: result.errors()) {
+                error += describe_error(interpret_error.node.get_source_location(), interpret_error.message);
+            }
+            if (result.success()) {
+                object = &object_store.create_struct(scope.get_map());
+                add_unit_object(import_spec, *object);
+            }
+        }
+    } catch (...) {
+        loading.pop_back();
+        throw;
+    }
+
+    loading.pop_back();
+    return {object, object ? "" : "Cannot import '" + import_spec + "':" + error};
+}
+
+void UnitGraph::add_unit_object(const std::string &import_spec, const Object &object) {
+    unit_specs.emplace(&object, import_spec);
+    for (const auto &[id, value]: object.attributes()) {
+        if (unit_specs.contains(&value.get())) {
+            binders[&value.get()].insert(import_spec);
+        }
+    }
+}
+
+UnitGraph::Reads *UnitGraph::reads_of(const Object &object) {
+    if (loading.empty()) return nullptr;
+
+    auto it = unit_specs.find(&object);
+    if (it == unit_specs.end() || it->second == loading.back()) return nullptr;
+
+    readers[it->second].insert(loading.back());
+    return &reads[loading.back()][it->second];
+}
+
+void UnitGraph::forget_reads(const std::string &import_spec) {
+    auto it = reads.find(import_spec);
+    if (it == reads.end()) return;
+
+    for (const auto &[read_spec, unit_reads]: it->second) {
+        readers[read_spec].erase(import_spec);
+    }
+    reads.erase(it);
+}
+
+bool UnitGraph::drop(const std::string &import_spec, std::unordered_map<std::string, const Object *> &previous) {
+    auto source_it = sources.find(import_spec);
+    if (source_it != sources.end()) {
+        dropped_sources.push_back(source_it->second);
+        sources.erase(source_it);
+    }
+
+    auto it = units.find(import_spec);
+    if (it == units.end()) return false;
+
+    previous[import_spec] = it->second.object;
+    units.erase(it);
+    return true;
+}
+
+const Object *UnitGraph::reload(const std::string &import_spec) {
+    if (!units.contains(import_spec) && !(resolve(import_spec).success() && sources.contains(import_spec))) {
+        return nullptr;
+    }
+
+    try {
+        return &load(import_spec);
+    } catch (const ExternalObjectError &) {
+        return nullptr;
+    }
+}
+
+void UnitGraph::rebind(const Object &previous, const Object &current) {
+    std::vector<std::pair<const Object *, const Object *>> replaced = {{&previous, &current}};
+    while (!replaced.empty()) {
+        const auto [before, after] = replaced.back();
+        replaced.pop_back();
+
+        auto binders_it = binders.find(before);
+        if (binders_it == binders.end()) continue;
+        const std::unordered_set<std::string> unit_binders = std::move(binders_it->second);
+        binders.erase(binders_it);
+
+        for (const std::string &binder: unit_binders) {
+            auto it = units.find(binder);
+            if (it == units.end() || !it->second.object) continue;
+
+            const Object &bound = *it->second.object;
+            std::unordered_map<std::string, const Object &> attributes;
+            for (const auto &[id, value]: bound.attributes()) {
+                if (&value.get() == before) attributes.emplace(id, *after);
+            }
+            if (attributes.empty()) continue;
+
+            const Object &rebound = object_store.create_struct(bound, attributes);
+            add_unit_object(binder, rebound);
+            it->second.object = &rebound;
+            replaced.emplace_back(&bound, &rebound);
+        }
+    }
+}
+
+bool UnitGraph::changed(const Reads &unit_reads, const Object &previous, const Object &current) const {
+    if (unit_reads.whole) return true;
+
+    try {
+        for (const std::string &attribute: unit_reads.attributes) {
+            if (fingerprint(previous, attribute) != fingerprint(current, attribute)) return true;
+        }
+    } catch (const LazyEvaluationError &) {
+        return true;
+    }
+    return false;
+}
+
+Digest UnitGraph::fingerprint(const Object &object, const std::string &attribute) const {
+    const Object *value;
+    try {
+        value = &object.attr(attribute);
+    } catch (const UnknownAttributeError &) {
+        return {};
+    }
+
+    auto it = unit_specs.find(value);
+    if (it != unit_specs.end()) {
+        return Hasher().add(std::string("unit")).add(it->second).digest();
+    }
+    return value->digest();
+}
@@ -0,0 +1,184 @@
+//
+// Created by roel on 10/19/26.
+//
+
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "interpreter/ExternalObjectLoader.h"
+#include "interpreter/CallCache.h"
+#include "interpreter/Interpreter.h"
+#include "interpreter/Scope.h"
+#include "parser/ImportResolver.h"
+#include "util/Digest.h"
+
+/*
+ * Interprets every imported mkr program (a unit) once, and keeps its struct
+ * until the unit is invalidated. Importing a unit from many places, or loading
+ * the root file again, reuses the struct instead of parsing and interpreting
+ * the unit again.
+ *
+ * To the parser it is an import resolver that leaves all imports as
+ * EXTERNAL_OBJECT nodes, to the interpreter the loader of their objects. Units
+ * are read through the wrapped resolver, other imports (Python units) are
+ * passed to the wrapped loader. Units are interpreted in a scope of their own
+ * on top of the builtin scope.
+ *
+ * While a unit is interpreted, the attributes it reads of other units are
+ * recorded (also when it reaches them through a third unit, as in
+ * 'lib.tools.compile'), or that it uses a unit as a whole, e.g. by passing it
+ * to a function. When a unit changes, it is interpreted again, and only the
+ * units that read an attribute of it that has a different fingerprint now
+ * are invalidated in turn. Units that merely keep the struct of a changed
+ * unit in a variable get a struct that refers to the new one instead.
+ *
+ * Units that failed are kept too, and fail again on the next import with the
+ * same errors, until anything changes.
+ */
+class UnitGraph : public ImportResolver, public ExternalObjectLoader {
+public:
+    UnitGraph(ImportResolver &import_resolver, ObjectStore &object_store, const Scope &builtin_scope);
+
+    UnitGraph(ImportResolver &import_resolver, ObjectStore &object_store, const Scope &builtin_scope,
+              ExternalObjectLoader &external_objects);
+
+    UnitGraph(const UnitGraph &) = delete;
+
+    UnitGraph &operator=(const UnitGraph &) = delete;
+
+    Result resolve(const std::string &import_spec) override;
+
+    /*
+     * Throws ExternalObjectError with the errors of the unit if it cannot be
+     * parsed or interpreted, or if it imports itself.
+     */
+    const Object &load(const std::string &import_spec) override;
+
+    void attribute_read(const Object &object, const std::string &attribute) override;
+
+    void object_used(const Object &object) override;
+
+    /*
+     * Interprets the units with the given import specs again, and the units
+     * that depend on what changed in them. Other imports (Python units) are
+     * dropped together with the units that import them. The sources of the
+     * dropped units are released to the wrapped resolver. Returns the number
+     * of units invalidated.
+     *
+     * Objects of earlier versions of a unit that other units still refer to
+     * stay in the object store, which never frees anything.
+     */
+    size_t invalidate(const std::vector<std::string> &import_specs);
+
+    /*
+     * The number of units interpreted so far.
+     */
+    [[nodiscard]] unsigned int interpreted() const;
+
+    /*
+     * The call cache hits and misses of all units interpreted so far.
+     */
+    [[nodiscard]] const InterpretResult::Stats &stats() const;
+
+private:
+    struct Unit {
+        const Object *object;  // nullptr if the unit failed
+        std::string error;
+    };
+
+    /*
+     * What a unit read of another unit.
+     */
+    struct Reads {
+        bool whole = false;
+        std::unordered_set<std::string> attributes;
+    };
+
+    ImportResolver &import_resolver;
+    ObjectStore &object_store;
+    const Scope &builtin_scope;
+    ExternalObjectLoader *external_objects;
+    CallCache call_cache;
+
+    // The sources of the units resolved, and the units interpreted from them
+    std::unordered_map<std::string, std::reference_wrapper<Source>> sources;
+    std::vector<std::reference_wrapper<Source>> dropped_sources;
+    std::unordered_map<std::string, Unit> units;
+
+    // The import spec of every unit struct, including those of earlier
+    // versions of units, which may still be reachable
+    std::unordered_map<const Object *, std::string> unit_specs;
+
+    // For every unit struct, the units that keep it in one of their variables
+    std::unordered_map<const Object *, std::unordered_set<std::string>> binders;
+
+    // For every unit, what it read of other units, by their import spec, and
+    // the other way around
+    std::unordered_map<std::string, std::unordered_map<std::string, Reads>> reads;
+    std::unordered_map<std::string, std::unordered_set<std::string>> readers;
+
+    // For every import spec, the units that import it
+    std::unordered_map<std::string, std::unordered_set<std::string>> importers;
+
+    // The units being parsed and interpreted, the innermost last
+    std::vector<std::string> loading;
+
+    unsigned int interpreted_count;
+    InterpretResult::Stats unit_stats;
+
+    UnitGraph(ImportResolver &import_resolver, ObjectStore &object_store, const Scope &builtin_scope,
+              ExternalObjectLoader *external_objects);
+
+    [[nodiscard]] Unit interpret(const std::string &import_spec, Source &source);
+
+    /*
+     * Records the struct of a unit, and the units it keeps in its variables.
+     */
+    void add_unit_object(const std::string &import_spec, const Object &object);
+
+    /*
+     * The reads recorded for the unit being interpreted of the unit the
+     * object is the struct of, if it is one.
+     */
+    Reads *reads_of(const Object &object);
+
+    void forget_reads(const std::string &import_spec);
+
+    /*
+     * Drops the unit and its source, keeping its struct in previous. The
+     * source is released at the end of invalidate(), when the previous
+     * struct has been compared with the new one. Returns false if it was not
+     * a unit.
+     */
+    bool drop(const std::string &import_spec, std::unordered_map<std::string, const Object *> &previous);
+
+    /*
+     * Interprets a dropped unit again, returns nullptr if it failed.
+     */
+    const Object *reload(const std::string &import_spec);
+
+    /*
+     * Gives the units that keep the previous struct of a unit in a variable a
+     * struct with the current one instead, and so on for the units that keep
+     * theirs.
+     */
+    void rebind(const Object &previous, const Object &current);
+
+    /*
+     * Whether any of the reads has a different result on the current struct
+     * of a unit than on the previous one.
+     */
+    [[nodiscard]] bool changed(const Reads &unit_reads, const Object &previous, const Object &current) const;
+
+    /*
+     * The fingerprint of an attribute of a unit struct. The structs of units
+     * are identified by their import spec, so that a rebound struct has the
+     * same fingerprint.
+     */
+    [[nodiscard]] Digest fingerprint(const Object &object, const std::string &attribute) const;
+};
@@ -0,0 +1,174 @@
+//
+// Created by roel on 10/19/26.
+//
+
+#include "Workspace.h"
+
+#include <algorithm>
+#include <unordered_map>
+
+Workspace::Workspace(const std::string &root_dir) :
+        import_resolver(root_dir),
+        object_store(),
+        builtin_scope(),
+        scope(builtin_scope),
+        builtins(object_store, root_dir + "/.mkr/out"),
+        python_units(object_store, root_dir, "python3"),
+        units(import_resolver, object_store, builtin_scope, python_units),
+        repl(units, object_store, scope, builtin_scope, units),
+        loaded_file(),
+        loaded_source(nullptr) {
+    builtins.install(builtin_scope);
+}
+
+Repl::EvalResult Workspace::load(const std::string &file) {
+    return load(file, units.stats());
+}
+
+Repl::EvalResult Workspace::reload() {
+    const InterpretResult::Stats before = units.stats();
+    units.invalidate(import_resolver.refresh());
+    scope.clear();
+    return load(loaded_file, before);
+}
+
+Repl::EvalResult Workspace::load(const std::string &file, InterpretResult::Stats before) {
+    ImportResolver::Result import_result = import_resolver.resolve(file);
+    if (!import_result.success()) {
+        throw std::runtime_error("Cannot read '" + file + "'");
+    }
+    loaded_file = file;
+    if (loaded_source) {
+        import_resolver.release(*loaded_source);
+    }
+    loaded_source = &import_result.get_source();
+
+    Repl::EvalResult result = repl.eval(import_result.get_source());
+    InterpretResult::Stats stats = result.stats();
+    stats.call_cache_hits += units.stats().call_cache_hits - before.call_cache_hits;
+    stats.call_cache_misses += units.stats().call_cache_misses - before.call_cache_misses;
+    result.set_stats(stats);
+    return result;
+}
+
+const Object &Workspace::resolve_target(const std::string &name) const {
+    size_t start = 0;
+    const Object *object = nullptr;
+    while (start <= name.size()) {
+        size_t end = name.find('.', start);
+        if (end == std::string::npos) end = name.size();
+        const std::string id = name.substr(start, end - start);
+
+        try {
+            object = object ? &object->attr(id) : &scope.get(id);
+        } catch (const Scope::UndefinedVariableError &) {
+            throw UnknownTargetError(name);
+        } catch (const UnknownAttributeError &) {
+            throw UnknownTargetError(name);
+        } catch (const ObjectIsNotAStruct &) {
+            throw UnknownTargetError(name);
+        }
+        start = end + 1;
+    }
+    return *object;
+}
+
+/*
+ * Whether the object is an action or refers to one. Memoized, as the same
+ * objects are usually reachable from many targets.
+ */
+static bool refers_to_actions(const Object &object, std::unordered_map<const Object *, bool> &memo) {
+    auto it = memo.find(&object);
+    if (it != memo.end()) return it->second;
+    memo[&object] = false;
+
+    bool result = false;
+    if (dynamic_cast<const ActionObject *>(&object)) {
+        result = true;
+    } else if (!NullObject::is_null(object) && !object.is_callable()) {
+        try {
+            for (const auto &[id, value]: object.attributes()) {
+                if ((result = refers_to_actions(value, memo))) break;
+            }
+        } catch (const ObjectIsNotAStruct &) {
+            try {
+                auto entry_stream = object.stream();
+                while (const Object *entry = entry_stream->next()) {
+                    if ((result = refers_to_actions(*entry, memo))) break;
+                }
+            } catch (const ObjectIsNotAList &) {
+                // a string
+            } catch (const LazyEvaluationError &) {
+                // not buildable
+            }
+        }
+    }
+    memo[&object] = result;
+    return result;
+}
+
+/*
+ * Adds the name of the object if it refers to actions, or the names of its
+ * attributes if it is a struct (but not an action).
+ */
+static void collect_targets(const std::string &name, const Object &object, std::vector<std::string> &targets,
+                            std::unordered_map<const Object *, bool> &memo) {
+    if (!dynamic_cast<const ActionObject *>(&object)) {
+        const Object::Attributes *attributes = nullptr;
+        try {
+            attributes = &object.attributes();
+        } catch (const ObjectIsNotAStruct &) {
+            // not a struct
+        }
+        if (attributes) {
+            for (const auto &[id, value]: *attributes) {
+                collect_targets(name + "." + id, value, targets, memo);
+            }
+            return;
+        }
+    }
+
+    if (refers_to_actions(object, memo)) targets.push_back(name);
+}
+
+std::vector<std::string> Workspace::list_targets() {
+    std::vector<std::string> targets;
+    std::unordered_map<const Object *, bool> memo;
+    for (const auto &[id, object]: scope.get_map()) {
+        collect_targets(id, object, targets, memo);
+    }
+    std::sort(targets.begin(), targets.end());
+    return targets;
+}
+
+bool Workspace::is_stale() const {
+    return import_resolver.changed();
+}
+
+std::vector<std::string> Workspace::get_loaded_files() const {
+    return import_resolver.get_files();
+}
+
+void Workspace::set_action_listener(ActionListener *listener) {
+    builtins.set_action_listener(listener);
+}
+
+Repl &Workspace::get_repl() {
+    return repl;
+}
+
+const UnitGraph &Workspace::get_units() const {
+    return units;
+}
+
+const std::string &Workspace::get_root_dir() const {
+    return import_resolver.get_root_dir();
+}
+
+std::string Workspace::get_output_dir() const {
+    return get_root_dir() + "/.mkr/out";
+}
+
+std::string Workspace::get_cache_dir() const {
+    return get_root_dir() + "/.mkr/cache";
+}
@@ -0,0 +1,114 @@
+//
+// Created by roel on 10/19/26.
+//
+
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <stdexcept>
+
+#include "Repl.h"
+#include "UnitGraph.h"
+#include "interpreter/ScopeWrapper.h"
+#include "parser/FileImportResolver.h"
+#include "engine/Builtins.h"
+#include "engine/PythonUnitLoader.h"
+
+/*
+ * Everything needed to interpret the build files below a root directory: the
+ * import resolver, object store, the builtins, a root scope on top of them,
+ * the loader of Python units, the graph of imported units and a Repl to
+ * evaluate sources with.
+ */
+class Workspace {
+public:
+    explicit Workspace(const std::string &root_dir);
+
+    Workspace(const Workspace &) = delete;
+
+    Workspace &operator=(const Workspace &) = delete;
+
+    /*
+     * Interprets the given file (relative to the root directory) in the root
+     * scope. The stats of the result include those of the units interpreted
+     * for it. The errors of the result of the previous load refer to its
+     * source, which is released.
+     */
+    Repl::EvalResult load(const std::string &file);
+
+    /*
+     * Interprets the file loaded last again, in an empty root scope, after
+     * invalidating the units that changed since they were loaded and the
+     * units that import them. The other units are not interpreted again.
+     */
+    Repl::EvalResult reload();
+
+    /*
+     * Looks up a target by its (dotted) name, e.g. 'prslib.build'.
+     */
+    [[nodiscard]] const Object &resolve_target(const std::string &name) const;
+
+    /*
+     * The (dotted) names of all targets: the variables that refer to actions.
+     * Structs that are not actions themselves are listed by their attributes.
+     * Sorted by name.
+     */
+    [[nodiscard]] std::vector<std::string> list_targets();
+
+    /*
+     * Whether any of the files loaded so far changed since, after which the
+     * workspace has to be reloaded to see the changes.
+     */
+    [[nodiscard]] bool is_stale() const;
+
+    /*
+     * The paths of the build files (and Python units) loaded so far.
+     */
+    [[nodiscard]] std::vector<std::string> get_loaded_files() const;
+
+    /*
+     * Passes the actions created while loading from now on to the listener,
+     * or to none if it is nullptr. Actions that units created before are not
+     * created again.
+     */
+    void set_action_listener(ActionListener *listener);
+
+    [[nodiscard]] Repl &get_repl();
+
+    [[nodiscard]] const UnitGraph &get_units() const;
+
+    [[nodiscard]] const std::string &get_root_dir() const;
+
+    [[nodiscard]] std::string get_output_dir() const;
+
+    [[nodiscard]] std::string get_cache_dir() const;
+
+private:
+    FileImportResolver import_resolver;
+    BasicObjectStore object_store;
+    RootScope builtin_scope;
+    ScopeWrapper scope;
+    Builtins builtins;
+    PythonUnitLoader python_units;
+    UnitGraph units;
+    Repl repl;
+    std::string loaded_file;
+    Source *loaded_source;
+
+    /*
+     * Like load(), counting the stats of the units since they were before.
+     */
+    Repl::EvalResult load(const std::string &file, InterpretResult::Stats before);
+};
+
+class UnknownTargetError : public std::runtime_error {
+public:
+    explicit UnknownTargetError(const std::string &target_) :
+            std::runtime_error("Unknown target '" + target_ + "'"),
+            target(target_) {}
+
+private:
+    const std::string target;
+};
@@ -34,8 +34,33 @@
 
 #include "Shell.h"
 #include "Repl.h"
+#include "Workspace.h"
+#include "Server.h"
+#include "Client.h"
 #include "parser/StringSource.h"
-#include "parser/StaticImportResolver.h"
+#include "engine/ActionGraph.h"
+#include "engine/Executor.h"
+#include "engine/SpeculativeActionRunner.h"
+#include "engine/ProcessActionRunner.h"
+#include "engine/CachingActionRunner.h"
+#include "engine/RemoteActionRunner.h"
+#include "engine/RemoteWorker.h"
+#include "engine/HttpCache.h"
+#include "engine/HttpCacheServer.h"
+#include "engine/WorkerActionRunner.h"
+#include "engine/FileWatcher.h"
+#include "hash/FileHasher.h"
+
+#include <thread>
+#include <list>
+#include <map>
+#include <unordered_set>
+#include <optional>
+#include <cstring>
+#include <csignal>
+#include <filesystem>
+#include <memory>
+#include <unistd.h>
 
 
 std::string prefix_lines(const std::string &src, const std::string &prefix) {
@@ -49,6 +74,13 @@ std::string prefix_lines(const std::string &src, const std::string &prefix) {
     return result;
 }
 
+void print_errors(const Repl::EvalResult &result, FILE *out) {
+    for (const Repl::EvalResult::Error &error: result.errors()) {
+        fprintf(out, "Error: %s\n", error.msg.c_str());
+        fprintf(out, "%s\n", prefix_lines(error.source_location.annotate("here"), "    ").c_str());
+    }
+}
+
 class SimpleShellHandler : public ShellHandler {
 public:
     SimpleShellHandler(Shell &shell_, Repl &repl_) :
@@ -90,16 +122,586 @@ private:
     Repl &repl;
 };
 
-int main() {
-    StaticImportResolver import_resolver;
-    BasicObjectStore object_store;
-    RootScope scope;
+struct Options {
+    std::string root_file = "root.mkr";
+    std::list<std::string> targets;
+    Executor::Options executor;
+    bool list = false;
+    bool server = false;
+    bool no_server = false;
+    bool watch = false;
+    // Addresses of remote workers to run actions on
+    std::vector<std::string> remote;
+    // Address to serve as a remote worker on, if not empty
+    std::string remote_worker;
+    // URL of the remote cache to share outputs through, if not empty
+    std::string remote_cache;
+    bool remote_cache_read_only = false;
+    // Address to serve as a remote cache on, if not empty
+    std::string remote_cache_server;
+};
 
+// Relative to the root directory
+static constexpr const char *remote_worker_dir = ".mkr/remote_worker";
 
+// Relative to the root directory
+static constexpr const char *remote_cache_dir = ".mkr/remote_cache";
 
-    Repl repl(import_resolver, object_store, scope);
-    Shell shell;
-    SimpleShellHandler handler(shell, repl);
+// Relative to the root directory
+static constexpr const char *socket_path = ".mkr/server.sock";
+
+static void print_usage(FILE *out) {
+    fprintf(out, "usage: mkr [-j N] [-m SIZE] [-k] [-f FILE] [-l] [--server | --no-server] [--watch]\n"
+                 "           [--remote ADDRESS[,ADDRESS...]] [--remote-cache URL [--remote-cache-read-only]]\n"
+                 "           [TARGET...]\n"
+                 "       mkr [-j N] --remote-worker ADDRESS\n"
+                 "       mkr --remote-cache-server HOST:PORT\n"
+                 "\n"
+                 "Without targets an interactive shell is started.\n"
+                 "\n"
+                 "  -j N         run N actions in parallel (default: number of cores)\n"
+                 "  -m SIZE      memory the running actions may use together, such as 16G\n"
+                 "               (default: physical memory)\n"
+                 "  -k           keep going with independent actions when an action fails\n"
+                 "  -f FILE      build file to start from (default: root.mkr)\n"
+                 "  -l           list the targets\n"
+                 "  --server     keep the build files loaded in memory and handle the\n"
+                 "               requests of other invocations in this directory\n"
+                 "  --no-server  do not send the request to a running server\n"
+                 "  --watch      build the targets again whenever their build files or\n"
+                 "               inputs change\n"
+                 "  --remote ADDRESS[,ADDRESS...]\n"
+                 "               run actions on the remote workers at these addresses\n"
+                 "  --remote-worker ADDRESS\n"
+                 "               run the actions of other machines, in N processes\n"
+                 "  --remote-cache URL\n"
+                 "               restore the outputs of actions that other machines built\n"
+                 "               from the cache at http://HOST[:PORT][/PATH], and share the\n"
+                 "               outputs of actions built here\n"
+                 "  --remote-cache-read-only\n"
+                 "               do not share the outputs of actions built here\n"
+                 "  --remote-cache-server HOST:PORT\n"
+                 "               serve a remote cache for other machines\n"
+                 "\n"
+                 "Addresses are HOST:PORT, or the path of a Unix domain socket.\n");
+}
+
+static bool parse_options(const std::vector<std::string> &arguments, Options &options) {
+    options.executor.jobs = std::max(1u, std::thread::hardware_concurrency());
+    options.executor.status = stdout;
+    options.executor.memory = physical_memory();
 
+    for (size_t i = 0; i < arguments.size(); i++) {
+        const std::string &arg = arguments[i];
+
+        if (arg == "-j" || arg.starts_with("-j")) {
+            std::string value = arg.substr(2);
+            if (value.empty()) {
+                if (++i >= arguments.size()) return false;
+                value = arguments[i];
+            }
+            try {
+                options.executor.jobs = std::stoul(value);
+            } catch (const std::logic_error &) {
+                return false;
+            }
+            if (options.executor.jobs == 0) return false;
+        } else if (arg == "-m") {
+            if (++i >= arguments.size()) return false;
+            const std::optional<uint64_t> memory = parse_size(arguments[i]);
+            if (!memory) return false;
+            options.executor.memory = *memory;
+        } else if (arg == "-k") {
+            options.executor.keep_going = true;
+        } else if (arg == "-f") {
+            if (++i >= arguments.size()) return false;
+            options.root_file = arguments[i];
+        } else if (arg == "-l") {
+            options.list = true;
+        } else if (arg == "--server") {
+            options.server = true;
+        } else if (arg == "--no-server") {
+            options.no_server = true;
+        } else if (arg == "--watch") {
+            options.watch = true;
+        } else if (arg == "--remote") {
+            if (++i >= arguments.size()) return false;
+            for (size_t start = 0; start <= arguments[i].size();) {
+                size_t end = arguments[i].find(',', start);
+                if (end == std::string::npos) end = arguments[i].size();
+                if (end > start) options.remote.push_back(arguments[i].substr(start, end - start));
+                start = end + 1;
+            }
+            if (options.remote.empty()) return false;
+        } else if (arg == "--remote-worker") {
+            if (++i >= arguments.size() || arguments[i].empty()) return false;
+            options.remote_worker = arguments[i];
+        } else if (arg == "--remote-cache") {
+            if (++i >= arguments.size() || arguments[i].empty()) return false;
+            options.remote_cache = arguments[i];
+        } else if (arg == "--remote-cache-read-only") {
+            options.remote_cache_read_only = true;
+        } else if (arg == "--remote-cache-server") {
+            if (++i >= arguments.size() || arguments[i].empty()) return false;
+            options.remote_cache_server = arguments[i];
+        } else if (arg.starts_with("-")) {
+            return false;
+        } else {
+            options.targets.push_back(arg);
+        }
+    }
+
+    // Actions declare how many of the cores they use, of which there are as
+    // many as jobs
+    options.executor.cpus = options.executor.jobs;
+    return true;
+}
+
+static int run_shell(Workspace &workspace) {
+    Shell shell;
+    SimpleShellHandler handler(shell, workspace.get_repl());
     shell.run(handler);
+    return 0;
+}
+
+// Workers that grow beyond this are replaced
+static constexpr uint64_t max_worker_memory = 2ull * 1024 * 1024 * 1024;
+
+/*
+ * What requests have in common: the loaded workspace, and the action graphs
+ * of the targets built so far. A server keeps its session between requests.
+ */
+struct Session {
+    std::unique_ptr<Workspace> workspace;
+    std::string root_file;
+    std::optional<Repl::EvalResult> load_result;
+    std::map<std::list<std::string>, std::unique_ptr<ActionGraph>> graphs;
+    unsigned int reloads = 0;
+};
+
+// The object store of a workspace never frees anything, and every reload adds
+// the objects of the units interpreted again. So a session that reloaded this
+// often starts over with a new workspace, which interprets everything once.
+static constexpr unsigned int max_workspace_reloads = 100;
+
+/*
+ * Creates a new workspace for the root file, unless the session has one that
+ * was not reloaded too often.
+ */
+static void open_workspace(Session &session, const Options &options) {
+    if (session.workspace && session.root_file == options.root_file &&
+        session.reloads < max_workspace_reloads) {
+        return;
+    }
+
+    session.graphs.clear();
+    session.load_result.reset();
+    session.workspace.reset();
+    session.workspace = std::make_unique<Workspace>(".");
+    session.root_file = options.root_file;
+    session.reloads = 0;
+}
+
+/*
+ * Loads the root file, unless the session already loaded it. Then it is only
+ * reloaded if it failed or files it read changed since, which interprets just
+ * the changed units again. The actions created meanwhile are passed to the
+ * listener, if any.
+ */
+static bool load(Session &session, const Options &options, FILE *out, ActionListener *listener = nullptr) {
+    open_workspace(session, options);
+    Workspace &workspace = *session.workspace;
+    const bool loaded = session.load_result.has_value();
+    if (!loaded || !session.load_result->success() || workspace.is_stale()) {
+        if (loaded) session.reloads++;
+        session.graphs.clear();
+        session.load_result.reset();
+        workspace.set_action_listener(listener);
+        try {
+            session.load_result.emplace(loaded ? workspace.reload() : workspace.load(options.root_file));
+        } catch (...) {
+            workspace.set_action_listener(nullptr);
+            throw;
+        }
+        workspace.set_action_listener(nullptr);
+    }
+
+    if (!session.load_result->success()) {
+        print_errors(*session.load_result, out);
+        return false;
+    }
+    return true;
+}
+
+static const ActionGraph &get_graph(Session &session, const std::list<std::string> &targets) {
+    std::unique_ptr<ActionGraph> &graph = session.graphs[targets];
+    if (!graph) {
+        auto new_graph = std::make_unique<ActionGraph>();
+        for (const std::string &target: targets) {
+            new_graph->add_target(session.workspace->resolve_target(target));
+        }
+        graph = std::move(new_graph);
+    }
+    return *graph;
+}
+
+/*
+ * Prints the targets as a tree, structs end with a '/':
+ *
+ *     prslib/
+ *         build
+ *     deploy
+ */
+static void print_targets(Workspace &workspace, FILE *out) {
+    std::vector<std::string> previous;
+    for (const std::string &target: workspace.list_targets()) {
+        std::vector<std::string> parts;
+        for (size_t start = 0; start <= target.size();) {
+            size_t end = target.find('.', start);
+            if (end == std::string::npos) end = target.size();
+            parts.push_back(target.substr(start, end - start));
+            start = end + 1;
+        }
+
+        size_t common = 0;
+        while (common + 1 < parts.size() && common + 1 < previous.size() && parts[common] == previous[common]) {
+            common++;
+        }
+        for (size_t i = common; i < parts.size(); i++) {
+            fprintf(out, "%s%s%s\n", std::string(4 * i, ' ').c_str(), parts[i].c_str(),
+                    i + 1 < parts.size() ? "/" : "");
+        }
+        previous = std::move(parts);
+    }
+}
+
+static int run_build(Session &session, const Options &options, FILE *out) {
+    open_workspace(session, options);
+    const Workspace &workspace = *session.workspace;
+
+    // Actions only see these variables, so they can be part of the cache key
+    const std::vector<std::string> environment = ProcessActionRunner::inherit_environment(
+            {"PATH", "LANG", "LC_ALL", "TMPDIR"});
+
+    // Share the jobs with a make this runs under, or with the makes this runs
+    Executor::Options executor_options = options.executor;
+    executor_options.status = out;
+    const char *makeflags = getenv("MAKEFLAGS");
+    std::unique_ptr<Jobserver> jobserver = Jobserver::connect(makeflags ? makeflags : "");
+    if (!jobserver) {
+        jobserver = Jobserver::create(executor_options.jobs, std::filesystem::temp_directory_path());
+    }
+
+    // Not part of the cache key, as the path of the jobserver changes every build
+    std::vector<std::string> process_environment = environment;
+    if (jobserver) {
+        process_environment.push_back("MAKEFLAGS=" + jobserver->get_makeflags());
+        executor_options.jobserver = jobserver.get();
+    }
+
+    ProcessActionRunner process_runner(process_environment);
+    WorkerPool workers(process_environment, max_worker_memory);
+    WorkerActionRunner worker_runner(process_runner, workers);
+    // Large outputs, such as linked binaries, are hashed on all cores
+    FileHasher file_hasher(std::max(1u, std::thread::hardware_concurrency()));
+    FileStateDb file_states(workspace.get_cache_dir() + "/file_states", file_hasher);
+    std::unique_ptr<HttpCache> remote_cache;
+    if (!options.remote_cache.empty()) {
+        remote_cache = std::make_unique<HttpCache>(options.remote_cache, !options.remote_cache_read_only);
+    }
+    ActionCache cache = remote_cache ? ActionCache(workspace.get_cache_dir(), file_states, *remote_cache) :
+                        ActionCache(workspace.get_cache_dir(), file_states);
+    DepsLog deps_log(workspace.get_root_dir() + "/.mkr/deps_log");
+    BuildLog build_log(workspace.get_root_dir() + "/.mkr/build_log");
+
+    // Remote workers get the environment of the cache key, the jobserver is
+    // of this machine
+    std::unique_ptr<RemoteActionRunner> remote_runner;
+    if (!options.remote.empty()) {
+        remote_runner = std::make_unique<RemoteActionRunner>(worker_runner, options.remote, environment, file_states,
+                                                             deps_log);
+    }
+    ActionRunner &inner_runner = remote_runner ? *remote_runner : static_cast<ActionRunner &>(worker_runner);
+    CachingActionRunner runner(inner_runner, cache, environment, deps_log, build_log);
+    DurationDb durations(workspace.get_root_dir() + "/.mkr/durations");
+
+    // Actions are started as the build files create them, until it is known
+    // which are asked for. Only on the cores the interpreter leaves idle, as
+    // otherwise it would take longer to know.
+    const unsigned int speculative_jobs = std::min(
+            executor_options.jobs, std::max(1u, std::thread::hardware_concurrency())) - 1;
+    std::unique_ptr<SpeculativeActionRunner> speculative_runner;
+    if (speculative_jobs > 0 && jobserver) {
+        speculative_runner = std::make_unique<SpeculativeActionRunner>(runner, speculative_jobs, *jobserver);
+    } else if (speculative_jobs > 0) {
+        speculative_runner = std::make_unique<SpeculativeActionRunner>(runner, speculative_jobs);
+    }
+
+    const bool loaded = load(session, options, out, speculative_runner.get());
+    if (speculative_runner) speculative_runner->stop();
+    std::optional<Executor::Result> executor_result;
+    if (loaded) {
+        ActionRunner &build_runner = speculative_runner ? *speculative_runner : static_cast<ActionRunner &>(runner);
+        Executor executor(build_runner, executor_options, durations);
+        executor_result = executor.execute(get_graph(session, options.targets));
+    }
+
+    // Waits for the actions that were started but not asked for
+    speculative_runner.reset();
+    if (remote_cache) {
+        remote_cache->wait();
+        const std::optional<std::string> error = remote_cache->get_error();
+        if (error) fprintf(out, "Stopped using the remote cache: %s\n", error->c_str());
+    }
+    file_states.save();
+    build_log.save();
+    durations.save();
+    if (!executor_result) return 1;
+
+    const InterpretResult::Stats &stats = session.load_result->stats();
+    fprintf(out, "Call cache: %u hits, %u misses\n", stats.call_cache_hits, stats.call_cache_misses);
+
+    const Executor::Result &result = *executor_result;
+    if (!result.success()) {
+        fprintf(out, "Build failed: %u succeeded, %u failed, %u not started\n",
+                result.succeeded, result.failed, result.skipped);
+        return 1;
+    }
+    fprintf(out, "Build succeeded: %u ran, %u restored from cache, %u up to date\n",
+            result.succeeded - result.cached - result.up_to_date, result.cached, result.up_to_date);
+    if (remote_runner) {
+        fprintf(out, "Ran %u actions on remote workers\n", remote_runner->remote_count());
+    }
+    if (remote_cache) {
+        fprintf(out, "Restored %u actions from the remote cache, uploaded %u entries\n", cache.remote_count(),
+                remote_cache->upload_count());
+    }
+    fprintf(out, "Took %.2fs, the critical path takes %.2fs\n",
+            std::chrono::duration<double>(result.wall_time).count(),
+            std::chrono::duration<double>(result.critical_path).count());
+    return 0;
+}
+
+static int run(Session &session, const Options &options, FILE *out) {
+    if (options.list) {
+        if (!load(session, options, out)) return 1;
+        print_targets(*session.workspace, out);
+        return 0;
+    }
+    return run_build(session, options, out);
+}
+
+// Changes that follow each other within this are handled at once
+static constexpr std::chrono::milliseconds watch_quiet_period(50);
+
+/*
+ * The files a build depends on: the build files that were loaded, and the
+ * inputs of the actions (also those discovered from depfiles) that are not
+ * produced by other actions. Only the build files if the targets cannot be
+ * resolved, so that fixing them builds again.
+ */
+static std::vector<std::string> get_watched_files(Session &session, const Options &options) {
+    std::vector<std::string> files = session.workspace->get_loaded_files();
+    if (!session.load_result || !session.load_result->success()) return files;
+
+    const ActionGraph *graph_ptr;
+    try {
+        graph_ptr = &get_graph(session, options.targets);
+    } catch (const std::runtime_error &) {
+        // the build already printed the error
+        return files;
+    }
+    const ActionGraph &graph = *graph_ptr;
+    std::unordered_set<std::string> outputs;
+    for (const ActionGraph::Node &node: graph.nodes()) {
+        outputs.insert(node.action.outputs.begin(), node.action.outputs.end());
+    }
+
+    const DepsLog deps_log(session.workspace->get_root_dir() + "/.mkr/deps_log");
+    for (const ActionGraph::Node &node: graph.nodes()) {
+        std::vector<std::string> inputs = node.action.inputs;
+        if (!node.action.depfile.empty()) {
+            const std::vector<std::string> discovered = deps_log.get(node.action.depfile).value_or(
+                    std::vector<std::string>());
+            inputs.insert(inputs.end(), discovered.begin(), discovered.end());
+        }
+        for (const std::string &input: inputs) {
+            if (!outputs.contains(input)) files.push_back(input);
+        }
+    }
+    return files;
+}
+
+static FileWatcher *running_watcher = nullptr;
+
+static void stop_watching(int) {
+    if (running_watcher) running_watcher->stop();
+}
+
+/*
+ * Builds the targets, and again whenever a file they depend on changes, until
+ * stopped by SIGINT or SIGTERM. Only build files that changed cause them to
+ * be loaded again, and only actions of which inputs changed run again.
+ */
+static int run_watch(const Options &options) {
+    FileWatcher watcher;
+    running_watcher = &watcher;
+    signal(SIGINT, stop_watching);
+    signal(SIGTERM, stop_watching);
+
+    Session session;
+    int exit_code;
+    while (true) {
+        try {
+            exit_code = run(session, options, stdout);
+        } catch (const std::runtime_error &e) {
+            printf("Error: %s\n", e.what());
+            exit_code = 1;
+        }
+
+        watcher.watch(get_watched_files(session, options));
+        printf("Watching %zu files for changes\n", watcher.size());
+        fflush(stdout);
+
+        const std::set<std::string> changed = watcher.wait(watch_quiet_period);
+        if (changed.empty()) break;
+        printf("Changed: %s%s\n", changed.begin()->c_str(),
+               changed.size() > 1 ? (" and " + std::to_string(changed.size() - 1) + " more").c_str() : "");
+    }
+
+    running_watcher = nullptr;
+    return exit_code;
+}
+
+static Server *running_server = nullptr;
+
+static void stop_server(int) {
+    if (running_server) running_server->stop();
+}
+
+/*
+ * Handles the requests of other invocations in this directory until stopped
+ * by SIGINT or SIGTERM. Actions run in the environment of the server.
+ */
+static int run_server() {
+    std::filesystem::create_directories(".mkr");
+    Server server(socket_path);
+    running_server = &server;
+    signal(SIGINT, stop_server);
+    signal(SIGTERM, stop_server);
+    // Clients that go away must not stop the server
+    signal(SIGPIPE, SIG_IGN);
+
+    printf("Handling requests on '%s'\n", socket_path);
+    fflush(stdout);
+
+    Session session;
+    server.run([&session](const std::vector<std::string> &arguments, FILE *out) {
+        Options options;
+        if (!parse_options(arguments, options) || options.server) {
+            print_usage(out);
+            return 2;
+        }
+        return run(session, options, out);
+    });
+    running_server = nullptr;
+    return 0;
+}
+
+static RemoteWorker *running_worker = nullptr;
+
+static void stop_worker(int) {
+    if (running_worker) running_worker->stop();
+}
+
+/*
+ * Runs the actions of other machines in as many processes as jobs, until
+ * stopped by SIGINT or SIGTERM.
+ */
+static int run_remote_worker(const Options &options) {
+    RemoteWorker worker(remote_worker_dir, options.remote_worker);
+    worker.start(options.executor.jobs);
+    running_worker = &worker;
+    signal(SIGINT, stop_worker);
+    signal(SIGTERM, stop_worker);
+
+    printf("Running actions on '%s' in %u processes\n", options.remote_worker.c_str(), options.executor.jobs);
+    fflush(stdout);
+
+    worker.wait();
+    running_worker = nullptr;
+    return 0;
+}
+
+static HttpCacheServer *running_cache_server = nullptr;
+
+static void stop_cache_server(int) {
+    if (running_cache_server) running_cache_server->stop();
+}
+
+/*
+ * Serves the outputs that machines share through their remote cache, until
+ * stopped by SIGINT or SIGTERM.
+ */
+static int run_remote_cache_server(const Options &options) {
+    HttpCacheServer server(remote_cache_dir, options.remote_cache_server);
+    running_cache_server = &server;
+    signal(SIGINT, stop_cache_server);
+    signal(SIGTERM, stop_cache_server);
+    // Clients that go away must not stop the server
+    signal(SIGPIPE, SIG_IGN);
+
+    printf("Serving a remote cache on port %u\n", server.get_port());
+    fflush(stdout);
+
+    server.run();
+    running_cache_server = nullptr;
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    const std::vector<std::string> arguments(argv + 1, argv + argc);
+    Options options;
+    if (!parse_options(arguments, options)) {
+        print_usage(stdout);
+        return 2;
+    }
+
+    try {
+        if (options.server) {
+            return run_server();
+        }
+
+        if (!options.remote_worker.empty()) {
+            return run_remote_worker(options);
+        }
+
+        if (!options.remote_cache_server.empty()) {
+            return run_remote_cache_server(options);
+        }
+
+        if (options.watch) {
+            if (options.targets.empty()) {
+                print_usage(stdout);
+                return 2;
+            }
+            return run_watch(options);
+        }
+
+        if (options.targets.empty() && !options.list) {
+            Workspace workspace(".");
+            return run_shell(workspace);
+        }
+
+        if (!options.no_server) {
+            const std::optional<int> exit_code = Client::request(socket_path, arguments, STDOUT_FILENO);
+            if (exit_code) return *exit_code;
+        }
+
+        Session session;
+        return run(session, options, stdout);
+    } catch (const std::runtime_error &e) {
+        printf("Error: %s\n", e.what());
+        return 1;
+    }
 }
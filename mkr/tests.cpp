@@ -0,0 +1,237 @@
+//
+// Created by roel on 10/19/26.
+//
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+using testing::Eq;
+using testing::ElementsAre;
+
+#include "Workspace.h"
+#include "Server.h"
+#include "Client.h"
+
+#include <filesystem>
+#include <fstream>
+#include <thread>
+#include <unistd.h>
+
+static void write_file(const std::string &path, const std::string &content) {
+    std::ofstream(path) << content;
+}
+
+TEST(Workspace, test_list_targets) {
+    const std::string dir = testing::TempDir() + "mkr_workspace";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+    write_file(dir + "/lib.mkr",
+               "build = action(command=[\"cc\"] outputs=[\"lib.o\"])\n"
+               "name = \"lib\"\n");
+    write_file(dir + "/root.mkr",
+               "lib = import(\"lib.mkr\")\n"
+               "all = [lib.build]\n"
+               "flags = [\"-O2\"]\n");
+
+    Workspace workspace(dir);
+    ASSERT_TRUE(workspace.load("root.mkr").success());
+    EXPECT_THAT(workspace.list_targets(), ElementsAre("all", "lib.build"));
+    EXPECT_FALSE(workspace.is_stale());
+
+    write_file(dir + "/lib.mkr", "build = \"changed\"\n");
+    std::filesystem::last_write_time(dir + "/lib.mkr",
+                                     std::filesystem::file_time_type::clock::now() + std::chrono::seconds(1));
+    EXPECT_TRUE(workspace.is_stale());
+
+    std::filesystem::remove_all(dir);
+}
+
+/*
+ * Writes the file with a modification time that differs from the one it had.
+ */
+static void change_file(const std::string &path, const std::string &content) {
+    const auto modification_time = std::filesystem::last_write_time(path);
+    write_file(path, content);
+    std::filesystem::last_write_time(path, modification_time + std::chrono::seconds(1));
+}
+
+TEST(Workspace, test_reload) {
+    const std::string dir = testing::TempDir() + "mkr_workspace_reload";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+    write_file(dir + "/leaf.mkr", "name = \"leaf\"\n");
+    write_file(dir + "/mid.mkr", "leaf = import(\"leaf.mkr\")\nname = leaf.name\n");
+    write_file(dir + "/other.mkr", "name = \"other\"\n");
+    write_file(dir + "/both.mkr", "mid = import(\"mid.mkr\")\nother = import(\"other.mkr\")\n");
+    write_file(dir + "/root.mkr", "a = import(\"mid.mkr\")\nb = import(\"both.mkr\")\n");
+
+    // Units imported twice are interpreted once
+    Workspace workspace(dir);
+    ASSERT_TRUE(workspace.load("root.mkr").success());
+    EXPECT_THAT(workspace.get_units().interpreted(), Eq(4u));
+    EXPECT_THAT(&workspace.resolve_target("a"), Eq(&workspace.resolve_target("b.mid")));
+
+    // Only the changed unit and the units reading what changed are interpreted
+    // again, both.mkr only keeps mid.mkr in a variable
+    change_file(dir + "/leaf.mkr", "name = \"changed\"\n");
+    ASSERT_TRUE(workspace.is_stale());
+    ASSERT_TRUE(workspace.reload().success());
+    EXPECT_FALSE(workspace.is_stale());
+    EXPECT_THAT(workspace.get_units().interpreted(), Eq(6u));
+    EXPECT_THAT(workspace.resolve_target("b.mid.name").get_string(), Eq("changed"));
+    EXPECT_THAT(workspace.resolve_target("b.other.name").get_string(), Eq("other"));
+
+    change_file(dir + "/root.mkr", "a = import(\"other.mkr\")\n");
+    ASSERT_TRUE(workspace.reload().success());
+    EXPECT_THAT(workspace.get_units().interpreted(), Eq(6u));
+    EXPECT_THROW((void) workspace.resolve_target("b"), UnknownTargetError);
+
+    // Errors in units are reported at the import, and again until fixed
+    change_file(dir + "/other.mkr", "name = \"other\"\nname = \"again\"\n");
+    EXPECT_FALSE(workspace.reload().success());
+    EXPECT_FALSE(workspace.reload().success());
+    EXPECT_THAT(workspace.get_units().interpreted(), Eq(8u));
+    change_file(dir + "/other.mkr", "name = \"fixed\"\n");
+    ASSERT_TRUE(workspace.reload().success());
+    EXPECT_THAT(workspace.resolve_target("a.name").get_string(), Eq("fixed"));
+
+    change_file(dir + "/other.mkr", "root = import(\"root.mkr\")\n");
+    change_file(dir + "/root.mkr", "a = import(\"other.mkr\")\n");
+    const Repl::EvalResult result = workspace.reload();
+    ASSERT_FALSE(result.success());
+    EXPECT_THAT(result.errors().front().msg, testing::HasSubstr("Import cycle"));
+
+    std::filesystem::remove_all(dir);
+}
+
+TEST(Workspace, test_reload_attributes) {
+    const std::string dir = testing::TempDir() + "mkr_workspace_attributes";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+    write_file(dir + "/tools.mkr", "compile = \"cc\"\nlink = \"ld\"\nunused = \"x\"\n");
+    write_file(dir + "/a.mkr", "tools = import(\"tools.mkr\")\ncmd = [tools.compile]\n");
+    write_file(dir + "/b.mkr", "tools = import(\"tools.mkr\")\ncmd = [s for s in [tools.link]]\n");
+    write_file(dir + "/c.mkr", "tools = import(\"tools.mkr\")\nall = [tools]\n");
+    write_file(dir + "/d.mkr", "a = import(\"a.mkr\")\ncmd = a.tools.link\n");
+    write_file(dir + "/root.mkr", "a = import(\"a.mkr\")\nb = import(\"b.mkr\")\nc = import(\"c.mkr\")\n"
+                                  "d = import(\"d.mkr\")\n");
+
+    Workspace workspace(dir);
+    ASSERT_TRUE(workspace.load("root.mkr").success());
+    EXPECT_THAT(workspace.get_units().interpreted(), Eq(5u));
+
+    // Only c.mkr uses all of tools.mkr, the others keep the new struct
+    change_file(dir + "/tools.mkr", "compile = \"cc\"\nlink = \"ld\"\nunused = \"y\"\n");
+    ASSERT_TRUE(workspace.reload().success());
+    EXPECT_THAT(workspace.get_units().interpreted(), Eq(7u));
+    EXPECT_THAT(workspace.resolve_target("a.tools.unused").get_string(), Eq("y"));
+    EXPECT_THAT(workspace.resolve_target("d.a.tools.unused").get_string(), Eq("y"));
+
+    // Reads through another unit count too
+    change_file(dir + "/tools.mkr", "compile = \"cc\"\nlink = \"lld\"\nunused = \"y\"\n");
+    ASSERT_TRUE(workspace.reload().success());
+    EXPECT_THAT(workspace.get_units().interpreted(), Eq(11u));
+    EXPECT_THAT(workspace.resolve_target("d.cmd").get_string(), Eq("lld"));
+    EXPECT_THAT(workspace.resolve_target("b.cmd").stream()->next()->get_string(), Eq("lld"));
+
+    std::filesystem::remove_all(dir);
+}
+
+TEST(Workspace, test_call_cache_stats) {
+    const std::string dir = testing::TempDir() + "mkr_workspace_stats";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+    write_file(dir + "/lib.mkr", "build = action(command=[\"cc\"] outputs=[\"lib.o\"])\n");
+    write_file(dir + "/root.mkr", "lib = import(\"lib.mkr\")\n");
+
+    // The calls in imported units are counted too
+    Workspace workspace(dir);
+    const Repl::EvalResult loaded = workspace.load("root.mkr");
+    ASSERT_TRUE(loaded.success());
+    EXPECT_THAT(loaded.stats().call_cache_hits, Eq(0u));
+    EXPECT_THAT(loaded.stats().call_cache_misses, Eq(1u));
+
+    // A unit interpreted again finds its calls in the cache
+    change_file(dir + "/lib.mkr", "build = action(command=[\"cc\"] outputs=[\"lib.o\"])\n");
+    const Repl::EvalResult reloaded = workspace.reload();
+    ASSERT_TRUE(reloaded.success());
+    EXPECT_THAT(reloaded.stats().call_cache_hits, Eq(1u));
+    EXPECT_THAT(reloaded.stats().call_cache_misses, Eq(0u));
+
+    std::filesystem::remove_all(dir);
+}
+
+TEST(UnitGraph, test_release_sources) {
+    class ReleasingResolver : public ImportResolver {
+    public:
+        Result resolve(const std::string &import_spec) override {
+            return {Result::Type::MKR_PROGRAM, sources.emplace_back(contents)};
+        }
+
+        void release(const Source &source) override {
+            released.push_back(&source);
+        }
+
+        std::string contents = "name = \"lib\"";
+        std::list<StringSource> sources;
+        std::vector<const Source *> released;
+    };
+
+    ReleasingResolver resolver;
+    BasicObjectStore store;
+    RootScope builtin_scope;
+    UnitGraph units(resolver, store, builtin_scope);
+    ASSERT_TRUE(units.resolve("lib.mkr").success());
+    EXPECT_THAT(units.load("lib.mkr").attr("name").get_string(), Eq("lib"));
+    EXPECT_THAT(resolver.released.size(), Eq(0u));
+
+    // The source of the previous version is released once it is replaced
+    resolver.contents = "name = \"changed\"";
+    EXPECT_THAT(units.invalidate({"lib.mkr"}), Eq(1u));
+    EXPECT_THAT(units.load("lib.mkr").attr("name").get_string(), Eq("changed"));
+    ASSERT_THAT(resolver.released.size(), Eq(1u));
+    EXPECT_THAT(resolver.released.front(), Eq(&resolver.sources.front()));
+}
+
+TEST(Server, test_request) {
+    const std::string socket_path = testing::TempDir() + "mkr_server_test.sock";
+    EXPECT_FALSE(Client::request(socket_path, {"-l"}, STDOUT_FILENO));
+
+    // A socket file left behind is replaced
+    write_file(socket_path, "");
+    std::optional<Server> server;
+    server.emplace(socket_path);
+    EXPECT_THROW(Server{socket_path}, ServerError);
+
+    std::vector<std::vector<std::string>> requests;
+    std::thread thread([&] {
+        server->run([&](const std::vector<std::string> &arguments, FILE *out) {
+            requests.push_back(arguments);
+            fprintf(out, "handled %zu arguments\n", arguments.size());
+            return 3;
+        });
+    });
+
+    int fds[2];
+    ASSERT_THAT(pipe(fds), Eq(0));
+    EXPECT_THAT(Client::request(socket_path, {"-j4", "", "all"}, fds[1]), Eq(3));
+    EXPECT_THAT(Client::request(socket_path, {}, fds[1]), Eq(3));
+    close(fds[1]);
+
+    std::string output;
+    char buffer[256];
+    ssize_t count;
+    while ((count = read(fds[0], buffer, sizeof(buffer))) > 0) {
+        output.append(buffer, static_cast<size_t>(count));
+    }
+    close(fds[0]);
+    EXPECT_THAT(output, Eq("handled 3 arguments\nhandled 0 arguments\n"));
+
+    server->stop();
+    thread.join();
+    ASSERT_THAT(requests.size(), Eq(2u));
+    EXPECT_THAT(requests[0], ElementsAre("-j4", "", "all"));
+
+    server.reset();
+    EXPECT_FALSE(std::filesystem::exists(socket_path));
+}
@@ -100,7 +100,31 @@ Node DefaultParser::parse_assignment_statement(Result &result, RewindableTokenSt
 }
 
 /*
- * expr:
+ * expr
+ *      : operand ( PLUS operand )*
+ */
+Node DefaultParser::parse_expr(Result &result, RewindableTokenStream &tokens) {
+    auto node = std::make_unique<Node>(parse_operand(result, tokens));
+
+    while (true) {
+        auto snapshot = tokens.snapshot();
+        const Token &plus = tokens.next();
+        if (plus.type != TokenType::PLUS) {
+            tokens.rewind(snapshot);
+            break;
+        }
+
+        auto add_node = std::make_unique<Node>(NodeType::ADD, plus.location);
+        add_node->add_child(std::move(*node));
+        add_node->add_child(parse_operand(result, tokens));
+        node = std::move(add_node);
+    }
+
+    return *node;
+}
+
+/*
+ * operand:
  *      : import_statement
  *      | call_statement
  *      | object
@@ -109,7 +133,7 @@ Node DefaultParser::parse_assignment_statement(Result &result, RewindableTokenSt
  *      | list_for
  *      | STRING
  */
-Node DefaultParser::parse_expr(Result &result, RewindableTokenStream &tokens) {
+Node DefaultParser::parse_operand(Result &result, RewindableTokenStream &tokens) {
     auto snapshot = tokens.snapshot();
     const Token *failure_token = nullptr;
 
@@ -277,6 +301,11 @@ Node DefaultParser::parse_import_statement(Result &result, RewindableTokenStream
         return node;
     }
 
+    if (import_result.is_external_object()) {
+        // Loaded by the interpreter
+        return {NodeType::EXTERNAL_OBJECT, identifier.location, target.value};
+    }
+
     result.add_error(identifier.location, "Unknown import type");
     throw ParseError();
 }
@@ -28,6 +28,8 @@ private:
 
     Node parse_expr(Result &result, RewindableTokenStream &tokens);
 
+    Node parse_operand(Result &result, RewindableTokenStream &tokens);
+
     Node parse_list_for(Result &result, RewindableTokenStream &tokens);
 
     Node parse_list(Result &result, RewindableTokenStream &tokens);
@@ -0,0 +1,91 @@
+//
+// Created by roel on 10/19/26.
+//
+
+#include "FileImportResolver.h"
+
+#include <fstream>
+#include <sstream>
+
+FileImportResolver::FileImportResolver(std::string root_dir_) :
+        root_dir(std::move(root_dir_)),
+        sources(),
+        contents_map(),
+        modification_times() {}
+
+ImportResolver::Result FileImportResolver::resolve(const std::string &import_spec) {
+    if (import_spec.ends_with(".py")) {
+        record_modification_time(import_spec);
+        if (!std::ifstream(root_dir + "/" + import_spec)) {
+            return Result(Result::Type::ERROR);
+        }
+        return Result(Result::Type::EXTERNAL_OBJECT);
+    }
+
+    auto it = contents_map.find(import_spec);
+    if (it == contents_map.end()) {
+        // Before reading, so that a change while reading is noticed
+        record_modification_time(import_spec);
+        std::ifstream file(root_dir + "/" + import_spec);
+        if (!file) {
+            return Result(Result::Type::ERROR);
+        }
+
+        std::stringstream contents;
+        contents << file.rdbuf();
+        it = contents_map.emplace(import_spec, contents.str()).first;
+    }
+
+    return {Result::Type::MKR_PROGRAM, sources.emplace_back(it->second)};
+}
+
+void FileImportResolver::release(const Source &source) {
+    sources.remove_if([&source](const StringSource &candidate) { return &candidate == &source; });
+}
+
+const std::string &FileImportResolver::get_root_dir() const {
+    return root_dir;
+}
+
+/*
+ * The modification time of a file, or the minimum for files that do not
+ * exist, so that creating them is a change too.
+ */
+static std::filesystem::file_time_type modification_time_of(const std::string &path) {
+    std::error_code error;
+    const auto modification_time = std::filesystem::last_write_time(path, error);
+    return error ? std::filesystem::file_time_type::min() : modification_time;
+}
+
+bool FileImportResolver::changed() const {
+    for (const auto &[import_spec, modification_time]: modification_times) {
+        if (modification_time_of(root_dir + "/" + import_spec) != modification_time) return true;
+    }
+    return false;
+}
+
+std::vector<std::string> FileImportResolver::refresh() {
+    std::vector<std::string> changed_specs;
+    for (auto it = modification_times.begin(); it != modification_times.end();) {
+        if (modification_time_of(root_dir + "/" + it->first) == it->second) {
+            it++;
+            continue;
+        }
+        changed_specs.push_back(it->first);
+        contents_map.erase(it->first);
+        it = modification_times.erase(it);
+    }
+    return changed_specs;
+}
+
+std::vector<std::string> FileImportResolver::get_files() const {
+    std::vector<std::string> files;
+    for (const auto &[import_spec, modification_time]: modification_times) {
+        files.push_back(root_dir + "/" + import_spec);
+    }
+    return files;
+}
+
+void FileImportResolver::record_modification_time(const std::string &import_spec) {
+    modification_times.emplace(import_spec, modification_time_of(root_dir + "/" + import_spec));
+}
@@ -0,0 +1,59 @@
+//
+// Created by roel on 10/19/26.
+//
+
+
+#pragma once
+
+#include "ImportResolver.h"
+#include "StringSource.h"
+
+#include <list>
+#include <vector>
+#include <unordered_map>
+#include <filesystem>
+
+/*
+ * Resolves imports to files relative to a root directory. Every file is read
+ * once, every import gets a fresh source of its contents. The sources live
+ * until they are released, as the locations in the AST refer to them.
+ *
+ * Python units (.py files) are external objects, which the interpreter loads.
+ */
+class FileImportResolver : public ImportResolver {
+public:
+    explicit FileImportResolver(std::string root_dir);
+
+    Result resolve(const std::string &import_spec) override;
+
+    void release(const Source &source) override;
+
+    [[nodiscard]] const std::string &get_root_dir() const;
+
+    /*
+     * Whether any of the files resolved so far (including those that could
+     * not be read) was modified, created or removed since it was resolved.
+     */
+    [[nodiscard]] bool changed() const;
+
+    /*
+     * Forgets the files that were modified, created or removed since they were
+     * resolved, so that resolving them reads them again. Returns their import
+     * specs.
+     */
+    std::vector<std::string> refresh();
+
+    /*
+     * The paths of the files resolved so far, including those that could not
+     * be read.
+     */
+    [[nodiscard]] std::vector<std::string> get_files() const;
+
+private:
+    const std::string root_dir;
+    std::list<StringSource> sources;
+    std::unordered_map<std::string, std::string> contents_map;
+    std::unordered_map<std::string, std::filesystem::file_time_type> modification_times;
+
+    void record_modification_time(const std::string &import_spec);
+};
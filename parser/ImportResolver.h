@@ -48,4 +48,10 @@ public:
     };
 
     virtual Result resolve(const std::string &import_spec) = 0;
+
+    /*
+     * Tells the resolver that a source it returned is no longer used, so that
+     * it may free it. Does nothing by default.
+     */
+    virtual void release(const Source &) {}
 };
\ No newline at end of file
@@ -124,6 +124,11 @@ Token Lexer::next() {
         return {token_start_position, TokenType::ASSIGN};
     }
 
+    // PLUS
+    if (check('+')) {
+        return {token_start_position, TokenType::PLUS};
+    }
+
     throw UnexpectedCharacter(source.peek(), source.get_location());
 }
 
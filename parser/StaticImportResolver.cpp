@@ -5,13 +5,21 @@
 #include "StaticImportResolver.h"
 
 StaticImportResolver::StaticImportResolver() :
-        import_map() {}
+        import_map(),
+        external_specs() {}
 
 void StaticImportResolver::set(const std::string &import_spec, Source &source) {
     import_map.emplace(import_spec, source);
 }
 
+void StaticImportResolver::set_external(const std::string &import_spec) {
+    external_specs.insert(import_spec);
+}
+
 ImportResolver::Result StaticImportResolver::resolve(const std::string &import_spec) {
+    if (external_specs.contains(import_spec)) {
+        return Result(Result::Type::EXTERNAL_OBJECT);
+    }
     auto it = import_map.find(import_spec);
     if (it == import_map.end()) {
         return Result(Result::Type::ERROR);
@@ -7,6 +7,7 @@
 
 #include "ImportResolver.h"
 #include <unordered_map>
+#include <unordered_set>
 
 class StaticImportResolver : public ImportResolver {
 public:
@@ -14,10 +15,13 @@ public:
 
     void set(const std::string &import_spec, Source &source);
 
+    void set_external(const std::string &import_spec);
+
     Result resolve(const std::string &import_spec) override;
 
 private:
     std::unordered_map<std::string, Source &> import_map;
+    std::unordered_set<std::string> external_specs;
 };
 
 
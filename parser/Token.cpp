@@ -23,6 +23,8 @@ const char *to_str(TokenType t) {
             return "PAR_CLOSE";
         case TokenType::ASSIGN:
             return "ASSIGN";
+        case TokenType::PLUS:
+            return "PLUS";
         case TokenType::FOR:
             return "FOR";
         case TokenType::IN:
@@ -16,6 +16,7 @@ enum class TokenType {
     PAR_OPEN,
     PAR_CLOSE,
     ASSIGN,
+    PLUS,
     FOR,
     IN,
     EOS,
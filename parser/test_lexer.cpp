@@ -100,6 +100,15 @@ TEST(Lexer, test_multiple) {
     ASSERT_THAT(lex.next().type, Eq(TokenType::EOS));
 }
 
+TEST(Lexer, test_plus) {
+    StringSource s("a+b");
+    Lexer lex(s);
+    ASSERT_THAT(lex.next().type, Eq(TokenType::IDENTIFIER));
+    ASSERT_THAT(lex.next().type, Eq(TokenType::PLUS));
+    ASSERT_THAT(lex.next().type, Eq(TokenType::IDENTIFIER));
+    ASSERT_THAT(lex.next().type, Eq(TokenType::EOS));
+}
+
 TEST(Lexer, test_block_comment) {
     StringSource s("identifier1/* comment 1*1=1 */ identifier2");
     Lexer lex(s);
@@ -154,6 +154,20 @@ TEST(Parser, test_list_for) {
     );
 }
 
+TEST(Parser, test_add) {
+    EXPECT_THAT(
+            parse_str("x = a + b + c"),
+            Eq("PROGRAM ( ASSIGNMENT_STATEMENT ( VARIABLE:x ADD ( ADD ( OBJECT:a OBJECT:b ) OBJECT:c ) ) )")
+    );
+}
+
+TEST(Parser, test_add_in_call_args) {
+    EXPECT_THAT(
+            parse_str("x = f(a + g(b) c)"),
+            Eq("PROGRAM ( ASSIGNMENT_STATEMENT ( VARIABLE:x CALL_STATEMENT ( OBJECT:f ADD ( OBJECT:a CALL_STATEMENT ( OBJECT:g OBJECT:b ) ) OBJECT:c ) ) )")
+    );
+}
+
 TEST(Parser, test_import_statement) {
     StaticImportResolver import_resolver;
     StringSource s("a=\"a\"");
@@ -164,6 +178,15 @@ TEST(Parser, test_import_statement) {
     );
 }
 
+TEST(Parser, test_import_external_object) {
+    StaticImportResolver import_resolver;
+    import_resolver.set_external("tools.py");
+    EXPECT_THAT(
+            parse_str_with_import("x = import(\"tools.py\")", import_resolver),
+            Eq("PROGRAM ( ASSIGNMENT_STATEMENT ( VARIABLE:x EXTERNAL_OBJECT:tools.py ) )")
+    );
+}
+
 TEST(Parser, test_import_failure) {
     StaticImportResolver import_resolver;
     auto result = parse_with_import("x = import(\"unknown-file.mkr\")", import_resolver);
@@ -0,0 +1,34 @@
+//
+// Created by roel on 10/19/26.
+//
+
+#include "BinaryFile.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <unistd.h>
+
+bool read_bytes(const std::string &content, size_t &pos, void *out, size_t length) {
+    if (content.size() - pos < length) return false;
+    memcpy(out, content.data() + pos, length);
+    pos += length;
+    return true;
+}
+
+bool write_file_atomically(const std::string &path, std::string_view content) {
+    const std::string temp = path + ".tmp." + std::to_string(getpid());
+    {
+        std::ofstream stream(temp, std::ios::binary | std::ios::trunc);
+        stream.write(content.data(), static_cast<std::streamsize>(content.size()));
+        if (!stream.flush()) {
+            unlink(temp.c_str());
+            return false;
+        }
+    }
+    if (rename(temp.c_str(), path.c_str()) != 0) {
+        unlink(temp.c_str());
+        return false;
+    }
+    return true;
+}
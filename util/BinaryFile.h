@@ -0,0 +1,28 @@
+//
+// Created by roel on 10/19/26.
+//
+
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+/*
+ * Helpers for the binary files in which the build state is kept between runs.
+ * Integers in them are in the byte order of the machine, and written with
+ * append_u32() from Socket.h.
+ */
+
+/*
+ * Reads length bytes at pos, unless that runs past the end of the content.
+ */
+bool read_bytes(const std::string &content, size_t &pos, void *out, size_t length);
+
+/*
+ * Writes the content to a file next to the path and renames it in place, so
+ * that readers see either the old or the new file, never a partial one.
+ * Returns false if the file could not be written.
+ */
+bool write_file_atomically(const std::string &path, std::string_view content);
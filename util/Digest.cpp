@@ -0,0 +1,29 @@
+//
+// Created by roel on 10/19/26.
+//
+
+#include "Digest.h"
+
+#include <cstdio>
+
+Digest::Digest() :
+        hi(0),
+        lo(0) {}
+
+Digest::Digest(uint64_t hi_, uint64_t lo_) :
+        hi(hi_),
+        lo(lo_) {}
+
+std::string Digest::to_string() const {
+    char buf[33];
+    snprintf(buf, sizeof(buf), "%016llx%016llx",
+             static_cast<unsigned long long>(hi),
+             static_cast<unsigned long long>(lo));
+    return buf;
+}
+
+bool Digest::operator<(const Digest &rhs) const {
+    if (hi != rhs.hi) return hi < rhs.hi;
+    return lo < rhs.lo;
+}
+
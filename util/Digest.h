@@ -0,0 +1,42 @@
+//
+// Created by roel on 10/19/26.
+//
+
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <functional>
+
+/*
+ * Content fingerprint as produced by Hasher. Two digests compare equal if and
+ * only if the hashed content was (with overwhelming probability) identical.
+ */
+class Digest {
+public:
+    Digest();
+
+    Digest(uint64_t hi, uint64_t lo);
+
+    [[nodiscard]] uint64_t high() const { return hi; }
+
+    [[nodiscard]] uint64_t low() const { return lo; }
+
+    [[nodiscard]] std::string to_string() const;
+
+    bool operator==(const Digest &rhs) const = default;
+
+    bool operator<(const Digest &rhs) const;
+
+private:
+    uint64_t hi;
+    uint64_t lo;
+};
+
+template<>
+struct std::hash<Digest> {
+    size_t operator()(const Digest &digest) const noexcept {
+        return digest.low();
+    }
+};
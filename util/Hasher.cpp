@@ -0,0 +1,40 @@
+//
+// Created by roel on 10/19/26.
+//
+
+#include "Hasher.h"
+
+/*
+ * Hasher::*
+ */
+
+Hasher::Hasher() :
+        blake3() {}
+
+Hasher &Hasher::add(const void *data, size_t length) {
+    blake3.update(data, length);
+    return *this;
+}
+
+Hasher &Hasher::add(const std::string &str) {
+    add(static_cast<uint64_t>(str.size()));
+    return add(str.data(), str.size());
+}
+
+Hasher &Hasher::add(uint64_t value) {
+    uint8_t bytes[sizeof(value)];
+    for (uint8_t &byte: bytes) {
+        byte = static_cast<uint8_t>(value);
+        value >>= 8;
+    }
+    return add(bytes, sizeof(bytes));
+}
+
+Hasher &Hasher::add(const Digest &digest) {
+    add(digest.high());
+    return add(digest.low());
+}
+
+Digest Hasher::digest() const {
+    return blake3.digest();
+}
@@ -0,0 +1,37 @@
+//
+// Created by roel on 10/19/26.
+//
+
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+#include "Digest.h"
+#include "hash/Blake3.h"
+
+/*
+ * Incremental 128 bit hash (Blake3) used for content fingerprints.
+ *
+ * Variable length fields should be added with add(std::string) which
+ * prefixes the length, so that ("ab", "c") and ("a", "bc") hash differently.
+ */
+class Hasher {
+public:
+    Hasher();
+
+    Hasher &add(const void *data, size_t length);
+
+    Hasher &add(const std::string &str);
+
+    Hasher &add(uint64_t value);
+
+    Hasher &add(const Digest &digest);
+
+    [[nodiscard]] Digest digest() const;
+
+private:
+    Blake3 blake3;
+};
@@ -0,0 +1,325 @@
+//
+// Created by roel on 10/19/26.
+//
+
+
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <functional>
+#include <utility>
+#include <bit>
+#include <cstdint>
+
+/*
+ * Immutable hash array mapped trie.
+ *
+ * set() and erase() return a new map that shares all untouched nodes with the
+ * original, so deriving a map costs O(log n) time and memory independent of
+ * its size. Copying a map is O(1).
+ */
+template<typename K, typename V, typename Hash = std::hash<K>>
+class PersistentMap {
+public:
+    using value_type = std::pair<const K, V>;
+
+private:
+    static constexpr unsigned int bits_per_level = 5;
+    static constexpr unsigned int level_mask = (1u << bits_per_level) - 1;
+    static constexpr unsigned int hash_bits = 64;
+
+    struct Node;
+
+    using NodePtr = std::shared_ptr<const Node>;
+    using EntryPtr = std::shared_ptr<const value_type>;
+
+    /*
+     * A slot either holds a single entry or points to a child node.
+     */
+    struct Slot {
+        uint64_t hash;
+        EntryPtr entry;
+        NodePtr child;
+    };
+
+    /*
+     * Either a bitmap indexed node, or (once all hash bits are consumed) a
+     * collision node in which all slots are entries with the same hash.
+     */
+    struct Node {
+        uint32_t bitmap = 0;
+        bool collision = false;
+        std::vector<Slot> slots;
+    };
+
+public:
+    PersistentMap() :
+            root(),
+            _size(0) {}
+
+    template<typename Iterable>
+    explicit PersistentMap(const Iterable &entries) :
+            PersistentMap() {
+        for (const auto &entry: entries) {
+            *this = set(entry.first, entry.second);
+        }
+    }
+
+    [[nodiscard]] size_t size() const { return _size; }
+
+    [[nodiscard]] bool empty() const { return _size == 0; }
+
+    [[nodiscard]] const V *find(const K &key) const {
+        const uint64_t hash = hash_of(key);
+        const Node *node = root.get();
+        unsigned int shift = 0;
+
+        while (node) {
+            if (node->collision) {
+                for (const Slot &slot: node->slots) {
+                    if (slot.entry->first == key) return &slot.entry->second;
+                }
+                return nullptr;
+            }
+
+            const uint32_t bit = bit_for(hash, shift);
+            if (!(node->bitmap & bit)) return nullptr;
+
+            const Slot &slot = node->slots[position(node->bitmap, bit)];
+            if (slot.child) {
+                node = slot.child.get();
+                shift += bits_per_level;
+                continue;
+            }
+
+            if (slot.hash == hash && slot.entry->first == key) return &slot.entry->second;
+            return nullptr;
+        }
+        return nullptr;
+    }
+
+    [[nodiscard]] PersistentMap set(const K &key, V value) const {
+        const uint64_t hash = hash_of(key);
+        Slot leaf{hash, std::make_shared<const value_type>(key, std::move(value)), nullptr};
+        bool added = false;
+        NodePtr new_root = insert(root.get(), leaf, 0, added);
+        return {std::move(new_root), _size + (added ? 1 : 0)};
+    }
+
+    [[nodiscard]] PersistentMap erase(const K &key) const {
+        bool removed = false;
+        NodePtr new_root = remove(root, hash_of(key), key, 0, removed);
+        if (!removed) return *this;
+        return {std::move(new_root), _size - 1};
+    }
+
+    class const_iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = PersistentMap::value_type;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const value_type *;
+        using reference = const value_type &;
+
+        const_iterator() = default;
+
+        reference operator*() const { return *current().entry; }
+
+        pointer operator->() const { return current().entry.get(); }
+
+        const_iterator &operator++() {
+            stack.back().second++;
+            settle();
+            return *this;
+        }
+
+        const_iterator operator++(int) {
+            const_iterator tmp = *this;
+            ++(*this);
+            return tmp;
+        }
+
+        bool operator==(const const_iterator &rhs) const { return stack == rhs.stack; }
+
+    private:
+        friend PersistentMap;
+
+        explicit const_iterator(const Node *root_) {
+            if (root_) {
+                stack.emplace_back(root_, 0);
+                settle();
+            }
+        }
+
+        [[nodiscard]] const Slot &current() const {
+            return stack.back().first->slots[stack.back().second];
+        }
+
+        /*
+         * Moves the iterator forward until it points at an entry, or the
+         * stack is empty (end).
+         */
+        void settle() {
+            while (!stack.empty()) {
+                auto &[node, index] = stack.back();
+                if (index >= node->slots.size()) {
+                    stack.pop_back();
+                    if (!stack.empty()) stack.back().second++;
+                    continue;
+                }
+                const Slot &slot = node->slots[index];
+                if (slot.child) {
+                    stack.emplace_back(slot.child.get(), 0);
+                    continue;
+                }
+                return;
+            }
+        }
+
+        std::vector<std::pair<const Node *, size_t>> stack;
+    };
+
+    [[nodiscard]] const_iterator begin() const { return const_iterator(root.get()); }
+
+    [[nodiscard]] const_iterator end() const { return const_iterator(); }
+
+private:
+    NodePtr root;
+    size_t _size;
+
+    PersistentMap(NodePtr root_, size_t size_) :
+            root(std::move(root_)),
+            _size(size_) {}
+
+    static uint64_t hash_of(const K &key) {
+        return static_cast<uint64_t>(Hash()(key));
+    }
+
+    static uint32_t bit_for(uint64_t hash, unsigned int shift) {
+        return 1u << ((hash >> shift) & level_mask);
+    }
+
+    static size_t position(uint32_t bitmap, uint32_t bit) {
+        return std::popcount(bitmap & (bit - 1));
+    }
+
+    static NodePtr merge(const Slot &a, const Slot &b, unsigned int shift) {
+        auto node = std::make_shared<Node>();
+
+        if (shift >= hash_bits) {
+            node->collision = true;
+            node->slots = {a, b};
+            return node;
+        }
+
+        const uint32_t bit_a = bit_for(a.hash, shift);
+        const uint32_t bit_b = bit_for(b.hash, shift);
+        if (bit_a == bit_b) {
+            node->bitmap = bit_a;
+            node->slots.push_back({0, nullptr, merge(a, b, shift + bits_per_level)});
+        } else {
+            node->bitmap = bit_a | bit_b;
+            if (bit_a < bit_b) {
+                node->slots = {a, b};
+            } else {
+                node->slots = {b, a};
+            }
+        }
+        return node;
+    }
+
+    static NodePtr insert(const Node *node, const Slot &leaf, unsigned int shift, bool &added) {
+        if (!node) {
+            auto new_node = std::make_shared<Node>();
+            new_node->bitmap = bit_for(leaf.hash, shift);
+            new_node->slots.push_back(leaf);
+            added = true;
+            return new_node;
+        }
+
+        auto new_node = std::make_shared<Node>(*node);
+
+        if (node->collision) {
+            for (Slot &slot: new_node->slots) {
+                if (slot.entry->first == leaf.entry->first) {
+                    slot = leaf;
+                    return new_node;
+                }
+            }
+            new_node->slots.push_back(leaf);
+            added = true;
+            return new_node;
+        }
+
+        const uint32_t bit = bit_for(leaf.hash, shift);
+        const size_t pos = position(node->bitmap, bit);
+
+        if (!(node->bitmap & bit)) {
+            new_node->bitmap |= bit;
+            new_node->slots.insert(new_node->slots.begin() + static_cast<std::ptrdiff_t>(pos), leaf);
+            added = true;
+            return new_node;
+        }
+
+        Slot &slot = new_node->slots[pos];
+        if (slot.child) {
+            slot.child = insert(slot.child.get(), leaf, shift + bits_per_level, added);
+        } else if (slot.hash == leaf.hash && slot.entry->first == leaf.entry->first) {
+            slot = leaf;
+        } else {
+            slot = {0, nullptr, merge(slot, leaf, shift + bits_per_level)};
+            added = true;
+        }
+        return new_node;
+    }
+
+    static NodePtr remove(const NodePtr &node, uint64_t hash, const K &key, unsigned int shift, bool &removed) {
+        if (!node) return node;
+
+        if (node->collision) {
+            for (size_t i = 0; i < node->slots.size(); i++) {
+                if (node->slots[i].entry->first != key) continue;
+                removed = true;
+                if (node->slots.size() == 1) return nullptr;
+                auto new_node = std::make_shared<Node>(*node);
+                new_node->slots.erase(new_node->slots.begin() + static_cast<std::ptrdiff_t>(i));
+                return new_node;
+            }
+            return node;
+        }
+
+        const uint32_t bit = bit_for(hash, shift);
+        if (!(node->bitmap & bit)) return node;
+
+        const size_t pos = position(node->bitmap, bit);
+        const Slot &slot = node->slots[pos];
+
+        if (slot.child) {
+            NodePtr new_child = remove(slot.child, hash, key, shift + bits_per_level, removed);
+            if (!removed) return node;
+
+            auto new_node = std::make_shared<Node>(*node);
+            if (!new_child) {
+                new_node->bitmap &= ~bit;
+                new_node->slots.erase(new_node->slots.begin() + static_cast<std::ptrdiff_t>(pos));
+            } else if (new_child->slots.size() == 1 && !new_child->slots.front().child) {
+                // Pull a lone entry up so the trie stays as shallow as possible
+                new_node->slots[pos] = new_child->slots.front();
+            } else {
+                new_node->slots[pos].child = std::move(new_child);
+            }
+            if (new_node->slots.empty()) return nullptr;
+            return new_node;
+        }
+
+        if (slot.hash != hash || slot.entry->first != key) return node;
+
+        removed = true;
+        if (node->slots.size() == 1) return nullptr;
+        auto new_node = std::make_shared<Node>(*node);
+        new_node->bitmap &= ~bit;
+        new_node->slots.erase(new_node->slots.begin() + static_cast<std::ptrdiff_t>(pos));
+        return new_node;
+    }
+};
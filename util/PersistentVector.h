@@ -0,0 +1,325 @@
+//
+// Created by roel on 10/19/26.
+//
+
+
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <utility>
+#include <stdexcept>
+#include <algorithm>
+#include <cstddef>
+
+/*
+ * Immutable sequence stored as a height balanced (AVL) rope of chunks.
+ *
+ * Concatenation joins two ropes in O(log n), slicing shares the chunks of the
+ * original and appending extends the last chunk in place when no other rope
+ * has already extended it. All operations leave the original untouched, and
+ * copying a vector is O(1).
+ */
+template<typename T>
+class PersistentVector {
+public:
+    using value_type = T;
+
+private:
+    static constexpr size_t chunk_size = 64;
+
+    /*
+     * Chunks are allocated with a fixed capacity and never grow beyond it, so
+     * references to their elements stay valid while other ropes append to
+     * them.
+     */
+    using Chunk = std::vector<T>;
+
+    struct Node {
+        // leaf
+        std::shared_ptr<Chunk> chunk;
+        size_t offset = 0;
+
+        // concat
+        std::shared_ptr<const Node> left;
+        std::shared_ptr<const Node> right;
+
+        size_t size = 0;
+        int height = 0;
+
+        [[nodiscard]] bool is_leaf() const { return chunk != nullptr; }
+    };
+
+    using NodePtr = std::shared_ptr<const Node>;
+
+public:
+    PersistentVector() :
+            root() {}
+
+    template<typename Iterable>
+    explicit PersistentVector(const Iterable &values) :
+            PersistentVector() {
+        std::vector<NodePtr> leaves;
+        std::shared_ptr<Chunk> chunk;
+        for (const auto &value: values) {
+            if (!chunk || chunk->size() == chunk_size) {
+                if (chunk) leaves.push_back(make_leaf(chunk, 0, chunk->size()));
+                chunk = new_chunk();
+            }
+            chunk->push_back(value);
+        }
+        if (chunk) leaves.push_back(make_leaf(chunk, 0, chunk->size()));
+        root = build_balanced(leaves, 0, leaves.size());
+    }
+
+    [[nodiscard]] size_t size() const { return root ? root->size : 0; }
+
+    [[nodiscard]] bool empty() const { return size() == 0; }
+
+    [[nodiscard]] const T &at(size_t index) const {
+        if (index >= size()) {
+            throw std::out_of_range("PersistentVector index is out of range");
+        }
+        const Node *node = root.get();
+        while (!node->is_leaf()) {
+            if (index < node->left->size) {
+                node = node->left.get();
+            } else {
+                index -= node->left->size;
+                node = node->right.get();
+            }
+        }
+        return (*node->chunk)[node->offset + index];
+    }
+
+    [[nodiscard]] const T &operator[](size_t index) const { return at(index); }
+
+    [[nodiscard]] PersistentVector push_back(T value) const {
+        if (!root) {
+            auto chunk = new_chunk();
+            chunk->push_back(std::move(value));
+            return PersistentVector(make_leaf(chunk, 0, 1));
+        }
+
+        NodePtr extended = extend_last_chunk(root, value);
+        if (extended) return PersistentVector(std::move(extended));
+
+        auto chunk = new_chunk();
+        chunk->push_back(std::move(value));
+        return PersistentVector(join(root, make_leaf(chunk, 0, 1)));
+    }
+
+    [[nodiscard]] PersistentVector concat(const PersistentVector &rhs) const {
+        if (!root) return rhs;
+        if (!rhs.root) return *this;
+        return PersistentVector(join(root, rhs.root));
+    }
+
+    [[nodiscard]] PersistentVector slice(size_t begin, size_t end) const {
+        end = std::min(end, size());
+        if (begin >= end) return {};
+        return PersistentVector(slice(root, begin, end));
+    }
+
+    class const_iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const T *;
+        using reference = const T &;
+
+        const_iterator() = default;
+
+        reference operator*() const { return (*leaf->chunk)[leaf->offset + index]; }
+
+        pointer operator->() const { return &**this; }
+
+        const_iterator &operator++() {
+            if (++index >= leaf->size) {
+                index = 0;
+                next_leaf();
+            }
+            return *this;
+        }
+
+        const_iterator operator++(int) {
+            const_iterator tmp = *this;
+            ++(*this);
+            return tmp;
+        }
+
+        bool operator==(const const_iterator &rhs) const {
+            return leaf == rhs.leaf && index == rhs.index;
+        }
+
+    private:
+        friend PersistentVector;
+
+        explicit const_iterator(const Node *root_) {
+            if (root_) {
+                descend(root_);
+            }
+        }
+
+        void descend(const Node *node) {
+            while (!node->is_leaf()) {
+                stack.push_back(node->right.get());
+                node = node->left.get();
+            }
+            leaf = node;
+        }
+
+        void next_leaf() {
+            if (stack.empty()) {
+                leaf = nullptr;
+                return;
+            }
+            const Node *node = stack.back();
+            stack.pop_back();
+            descend(node);
+        }
+
+        std::vector<const Node *> stack;
+        const Node *leaf = nullptr;
+        size_t index = 0;
+    };
+
+    [[nodiscard]] const_iterator begin() const { return const_iterator(root.get()); }
+
+    [[nodiscard]] const_iterator end() const { return const_iterator(); }
+
+private:
+    NodePtr root;
+
+    explicit PersistentVector(NodePtr root_) :
+            root(std::move(root_)) {}
+
+    static std::shared_ptr<Chunk> new_chunk() {
+        auto chunk = std::make_shared<Chunk>();
+        chunk->reserve(chunk_size);
+        return chunk;
+    }
+
+    static NodePtr make_leaf(std::shared_ptr<Chunk> chunk, size_t offset, size_t size) {
+        auto node = std::make_shared<Node>();
+        node->chunk = std::move(chunk);
+        node->offset = offset;
+        node->size = size;
+        return node;
+    }
+
+    static int height(const NodePtr &node) {
+        return node->height;
+    }
+
+    static NodePtr make_node(NodePtr left, NodePtr right) {
+        auto node = std::make_shared<Node>();
+        node->size = left->size + right->size;
+        node->height = std::max(left->height, right->height) + 1;
+        node->left = std::move(left);
+        node->right = std::move(right);
+        return node;
+    }
+
+    static NodePtr build_balanced(const std::vector<NodePtr> &leaves, size_t begin, size_t end) {
+        if (begin == end) return nullptr;
+        if (end - begin == 1) return leaves[begin];
+        const size_t mid = begin + (end - begin) / 2;
+        return make_node(build_balanced(leaves, begin, mid), build_balanced(leaves, mid, end));
+    }
+
+    static NodePtr rotate_left(const NodePtr &node) {
+        const NodePtr &right = node->right;
+        return make_node(make_node(node->left, right->left), right->right);
+    }
+
+    static NodePtr rotate_right(const NodePtr &node) {
+        const NodePtr &left = node->left;
+        return make_node(left->left, make_node(left->right, node->right));
+    }
+
+    /*
+     * Concatenates two ropes while keeping the result height balanced, see
+     * "Just Join for Parallel Ordered Sets" (Blelloch et al.).
+     */
+    static NodePtr join(const NodePtr &left, const NodePtr &right) {
+        if (left->is_leaf() && right->is_leaf() && left->size + right->size <= chunk_size) {
+            return merge_leaves(left, right);
+        }
+        if (height(left) > height(right) + 1) return join_right(left, right);
+        if (height(right) > height(left) + 1) return join_left(left, right);
+        return make_node(left, right);
+    }
+
+    static NodePtr join_right(const NodePtr &left, const NodePtr &right) {
+        const NodePtr &l = left->left;
+        const NodePtr &c = left->right;
+        if (height(c) <= height(right) + 1) {
+            NodePtr t = make_node(c, right);
+            if (height(t) <= height(l) + 1) return make_node(l, t);
+            return rotate_left(make_node(l, rotate_right(t)));
+        }
+        NodePtr t = join_right(c, right);
+        NodePtr t2 = make_node(l, t);
+        if (height(t) <= height(l) + 1) return t2;
+        return rotate_left(t2);
+    }
+
+    static NodePtr join_left(const NodePtr &left, const NodePtr &right) {
+        const NodePtr &c = right->left;
+        const NodePtr &r = right->right;
+        if (height(c) <= height(left) + 1) {
+            NodePtr t = make_node(left, c);
+            if (height(t) <= height(r) + 1) return make_node(t, r);
+            return rotate_right(make_node(rotate_left(t), r));
+        }
+        NodePtr t = join_left(left, c);
+        NodePtr t2 = make_node(t, r);
+        if (height(t) <= height(r) + 1) return t2;
+        return rotate_right(t2);
+    }
+
+    static NodePtr merge_leaves(const NodePtr &left, const NodePtr &right) {
+        auto chunk = new_chunk();
+        chunk->insert(chunk->end(),
+                      left->chunk->begin() + static_cast<std::ptrdiff_t>(left->offset),
+                      left->chunk->begin() + static_cast<std::ptrdiff_t>(left->offset + left->size));
+        chunk->insert(chunk->end(),
+                      right->chunk->begin() + static_cast<std::ptrdiff_t>(right->offset),
+                      right->chunk->begin() + static_cast<std::ptrdiff_t>(right->offset + right->size));
+        return make_leaf(chunk, 0, chunk->size());
+    }
+
+    /*
+     * Appends value to the last chunk if this rope owns the end of that chunk
+     * and it has room left. Returns the new root, or nullptr if not possible.
+     */
+    static NodePtr extend_last_chunk(const NodePtr &node, const T &value) {
+        if (node->is_leaf()) {
+            Chunk &chunk = *node->chunk;
+            if (node->offset + node->size != chunk.size() || chunk.size() >= chunk_size) {
+                return nullptr;
+            }
+            chunk.push_back(value);
+            return make_leaf(node->chunk, node->offset, node->size + 1);
+        }
+
+        NodePtr right = extend_last_chunk(node->right, value);
+        if (!right) return nullptr;
+        return make_node(node->left, std::move(right));
+    }
+
+    static NodePtr slice(const NodePtr &node, size_t begin, size_t end) {
+        if (begin == 0 && end == node->size) return node;
+
+        if (node->is_leaf()) {
+            return make_leaf(node->chunk, node->offset + begin, end - begin);
+        }
+
+        const size_t left_size = node->left->size;
+        if (end <= left_size) return slice(node->left, begin, end);
+        if (begin >= left_size) return slice(node->right, begin - left_size, end - left_size);
+        return join(slice(node->left, begin, left_size), slice(node->right, 0, end - left_size));
+    }
+};
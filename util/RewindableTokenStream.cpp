@@ -7,27 +7,18 @@
 RewindableTokenStream::RewindableTokenStream(TokenStream &source_) :
         source(source_),
         buffer(),
-        buffer_pos(buffer.begin()),
-        buffer_start_index(0),
         buffer_current_index(0) {}
 
 const Token &RewindableTokenStream::peek() {
-    if (buffer_pos == buffer.end()) {
-        buffer_pos = buffer.emplace(buffer.end(), source.next());
+    if (buffer_current_index == buffer.size()) {
+        buffer.emplace_back(source.next());
     }
-    return *buffer_pos;
+    return buffer[buffer_current_index];
 }
 
 const Token &RewindableTokenStream::next() {
-    if (buffer_pos == buffer.end()) {
-        buffer_pos = buffer.emplace(buffer.end(), source.next());
-        buffer_current_index++;
-    } else {
-        buffer_current_index++;
-    }
-
-    const Token &t = *buffer_pos;
-    buffer_pos++;
+    const Token &t = peek();
+    buffer_current_index++;
     return t;
 }
 
@@ -39,13 +30,11 @@ RewindableTokenStream::Snapshot RewindableTokenStream::snapshot() {
 }
 
 void RewindableTokenStream::rewind(Snapshot snapshot) {
-    buffer_pos = buffer.begin();
     buffer_current_index = snapshot.index;
-    buffer_pos = std::next(buffer_pos, buffer_current_index - buffer_start_index);
 }
 
 void RewindableTokenStream::print() {
-    for (auto it = buffer.begin(); it != buffer.end(); it++) {
-        printf(" > %s %s \n", to_str(it->type), (it == buffer_pos) ? "<--" : "");
+    for (unsigned int i = 0; i < buffer.size(); i++) {
+        printf(" > %s %s \n", to_str(buffer[i].type), (i == buffer_current_index) ? "<--" : "");
     }
 }
@@ -5,7 +5,7 @@
 
 #pragma once
 
-#include <list>
+#include <deque>
 
 #include "parser/Token.h"
 
@@ -32,10 +32,11 @@ public:
 
 private:
     TokenStream &source;
-    std::list<Token> buffer;
-    std::list<Token>::iterator buffer_pos;
 
-    unsigned int buffer_start_index;
+    // A deque, so that rewinding is constant time and the tokens handed out
+    // stay where they are while the buffer grows
+    std::deque<Token> buffer;
+
     unsigned int buffer_current_index;
 
     void print();
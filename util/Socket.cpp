@@ -0,0 +1,36 @@
+//
+// Created by roel on 10/19/26.
+//
+
+#include "Socket.h"
+
+#include <cerrno>
+#include <sys/socket.h>
+
+bool send_all(int fd, const char *data, size_t size) {
+    while (size > 0) {
+        const ssize_t count = send(fd, data, size, MSG_NOSIGNAL);
+        if (count < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += count;
+        size -= static_cast<size_t>(count);
+    }
+    return true;
+}
+
+bool receive_all(int fd, char *data, size_t size) {
+    while (size > 0) {
+        const ssize_t count = recv(fd, data, size, 0);
+        if (count < 0 && errno == EINTR) continue;
+        if (count <= 0) return false;
+        data += count;
+        size -= static_cast<size_t>(count);
+    }
+    return true;
+}
+
+void append_u32(std::string &buffer, uint32_t value) {
+    buffer.append(reinterpret_cast<const char *>(&value), sizeof(value));
+}
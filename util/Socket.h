@@ -0,0 +1,33 @@
+//
+// Created by roel on 10/19/26.
+//
+
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/*
+ * Helpers for the framed protocols over sockets. Integers in frames are in
+ * the byte order of the machine.
+ */
+
+/*
+ * Sends all bytes, returns false if the connection failed. Never raises
+ * SIGPIPE.
+ */
+bool send_all(int fd, const char *data, size_t size);
+
+/*
+ * Receives exactly size bytes, returns false if the connection failed or was
+ * closed before.
+ */
+bool receive_all(int fd, char *data, size_t size);
+
+/*
+ * Appends the value in the byte order of the machine. Also used for the
+ * binary files of the build state (see BinaryFile.h).
+ */
+void append_u32(std::string &buffer, uint32_t value);
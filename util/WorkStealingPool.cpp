@@ -0,0 +1,121 @@
+//
+// Created by roel on 10/19/26.
+//
+
+#include "WorkStealingPool.h"
+
+/*
+ * The pool and queue index of the worker running on the current thread, if
+ * any.
+ */
+static thread_local const WorkStealingPool *current_pool = nullptr;
+static thread_local unsigned int current_index = 0;
+
+WorkStealingPool::WorkStealingPool(unsigned int workers) :
+        queues(),
+        threads(),
+        queued(0),
+        pending(0),
+        next_queue(0),
+        stopping(false) {
+    if (workers == 0) workers = 1;
+    for (unsigned int i = 0; i < workers; i++) {
+        queues.push_back(std::make_unique<Queue>());
+    }
+    for (unsigned int i = 0; i < workers; i++) {
+        threads.emplace_back(&WorkStealingPool::run_worker, this, i);
+    }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    work_available.notify_all();
+    for (std::thread &thread: threads) {
+        thread.join();
+    }
+}
+
+void WorkStealingPool::submit(Task task) {
+    unsigned int index;
+    if (current_pool == this) {
+        index = current_index;
+    } else {
+        std::lock_guard<std::mutex> lock(mutex);
+        index = next_queue++ % queues.size();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(queues[index]->mutex);
+        queues[index]->tasks.push_back(std::move(task));
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        queued++;
+        pending++;
+    }
+    work_available.notify_one();
+}
+
+void WorkStealingPool::wait() {
+    std::unique_lock<std::mutex> lock(mutex);
+    all_done.wait(lock, [this] { return pending == 0; });
+}
+
+unsigned int WorkStealingPool::size() const {
+    return static_cast<unsigned int>(queues.size());
+}
+
+void WorkStealingPool::run_worker(unsigned int index) {
+    current_pool = this;
+    current_index = index;
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            work_available.wait(lock, [this] { return queued > 0 || stopping; });
+            if (queued == 0) break;
+            queued--;
+        }
+
+        // A task has been reserved for this worker, but another worker may
+        // be about to take the one we see, so keep looking until we have one.
+        Task task;
+        while (!take(index, task)) {
+            std::this_thread::yield();
+        }
+
+        task();
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--pending == 0) {
+            all_done.notify_all();
+        }
+    }
+}
+
+bool WorkStealingPool::take(unsigned int index, Task &task) {
+    {
+        Queue &own = *queues[index];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            return true;
+        }
+    }
+
+    for (size_t i = 1; i < queues.size(); i++) {
+        Queue &victim = *queues[(index + i) % queues.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
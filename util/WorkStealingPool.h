@@ -0,0 +1,67 @@
+//
+// Created by roel on 10/19/26.
+//
+
+
+#pragma once
+
+#include <functional>
+#include <deque>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <memory>
+
+/*
+ * Fixed size thread pool in which every worker has a deque of its own.
+ *
+ * Tasks submitted from a worker go to the back of the deque of that worker,
+ * which it takes from the back again (so work that just became ready runs
+ * on the thread that made it ready). Idle workers steal from the front of
+ * the deques of the other workers. Tasks submitted from other threads are
+ * spread round robin.
+ */
+class WorkStealingPool {
+public:
+    using Task = std::function<void()>;
+
+    explicit WorkStealingPool(unsigned int workers);
+
+    WorkStealingPool(const WorkStealingPool &) = delete;
+
+    WorkStealingPool &operator=(const WorkStealingPool &) = delete;
+
+    ~WorkStealingPool();
+
+    void submit(Task task);
+
+    /*
+     * Blocks until all submitted tasks, including the tasks submitted by
+     * those tasks, are finished.
+     */
+    void wait();
+
+    [[nodiscard]] unsigned int size() const;
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> threads;
+
+    std::mutex mutex;
+    std::condition_variable work_available;
+    std::condition_variable all_done;
+    size_t queued;
+    size_t pending;
+    size_t next_queue;
+    bool stopping;
+
+    void run_worker(unsigned int index);
+
+    bool take(unsigned int index, Task &task);
+};
@@ -85,3 +85,156 @@ TEST(RewindableTokenStream, test_rewind_half_peek) {
     rts.next();
     EXPECT_THAT(rts.peek().type, Eq(TokenType::ASSIGN));
 }
+
+
+#include "util/PersistentMap.h"
+
+#include <map>
+
+TEST(PersistentMap, test_set_find) {
+    PersistentMap<std::string, int> map;
+    auto map2 = map.set("a", 1).set("b", 2);
+    EXPECT_THAT(map.size(), Eq(0u));
+    EXPECT_THAT(map2.size(), Eq(2u));
+    EXPECT_THAT(*map2.find("a"), Eq(1));
+    EXPECT_THAT(*map2.find("b"), Eq(2));
+    EXPECT_THAT(map2.find("c"), IsNull());
+}
+
+TEST(PersistentMap, test_derived_map_leaves_base_untouched) {
+    auto base = PersistentMap<std::string, int>().set("a", 1).set("b", 2);
+    auto derived = base.set("a", 3).erase("b").set("c", 4);
+    EXPECT_THAT(*base.find("a"), Eq(1));
+    EXPECT_THAT(*base.find("b"), Eq(2));
+    EXPECT_THAT(base.find("c"), IsNull());
+    EXPECT_THAT(*derived.find("a"), Eq(3));
+    EXPECT_THAT(derived.find("b"), IsNull());
+    EXPECT_THAT(*derived.find("c"), Eq(4));
+    EXPECT_THAT(derived.size(), Eq(2u));
+}
+
+TEST(PersistentMap, test_many_entries) {
+    PersistentMap<std::string, int> map;
+    for (int i = 0; i < 10000; i++) {
+        map = map.set(std::to_string(i), i);
+    }
+    for (int i = 0; i < 10000; i += 2) {
+        map = map.erase(std::to_string(i));
+    }
+    EXPECT_THAT(map.size(), Eq(5000u));
+
+    std::map<std::string, int> seen(map.begin(), map.end());
+    EXPECT_THAT(seen.size(), Eq(5000u));
+    for (int i = 0; i < 10000; i++) {
+        if (i % 2) {
+            EXPECT_THAT(*map.find(std::to_string(i)), Eq(i));
+        } else {
+            EXPECT_THAT(map.find(std::to_string(i)), IsNull());
+        }
+    }
+}
+
+struct ConstantHash {
+    size_t operator()(const std::string &) const { return 42; }
+};
+
+TEST(PersistentMap, test_hash_collisions) {
+    PersistentMap<std::string, int, ConstantHash> map;
+    map = map.set("a", 1).set("b", 2).set("c", 3).set("b", 4);
+    EXPECT_THAT(map.size(), Eq(3u));
+    EXPECT_THAT(*map.find("b"), Eq(4));
+    map = map.erase("a");
+    EXPECT_THAT(map.find("a"), IsNull());
+    EXPECT_THAT(*map.find("c"), Eq(3));
+    EXPECT_THAT(std::distance(map.begin(), map.end()), Eq(2));
+}
+
+
+#include "util/PersistentVector.h"
+
+static std::vector<int> to_vector(const PersistentVector<int> &v) {
+    return {v.begin(), v.end()};
+}
+
+static std::vector<int> range(int begin, int end) {
+    std::vector<int> result;
+    for (int i = begin; i < end; i++) result.push_back(i);
+    return result;
+}
+
+TEST(PersistentVector, test_construct_and_at) {
+    PersistentVector<int> v(range(0, 1000));
+    EXPECT_THAT(v.size(), Eq(1000u));
+    for (int i = 0; i < 1000; i++) {
+        EXPECT_THAT(v.at(i), Eq(i));
+    }
+    EXPECT_THAT(to_vector(v), Eq(range(0, 1000)));
+    EXPECT_THROW((void) v.at(1000), std::out_of_range);
+}
+
+TEST(PersistentVector, test_push_back_leaves_original_untouched) {
+    PersistentVector<int> a = PersistentVector<int>().push_back(1).push_back(2);
+    PersistentVector<int> b = a.push_back(3);
+    PersistentVector<int> c = a.push_back(4);
+    EXPECT_THAT(to_vector(a), ElementsAre(1, 2));
+    EXPECT_THAT(to_vector(b), ElementsAre(1, 2, 3));
+    EXPECT_THAT(to_vector(c), ElementsAre(1, 2, 4));
+}
+
+TEST(PersistentVector, test_repeated_push_back) {
+    PersistentVector<int> v;
+    for (int i = 0; i < 50000; i++) {
+        v = v.push_back(i);
+    }
+    EXPECT_THAT(to_vector(v), Eq(range(0, 50000)));
+    EXPECT_THAT(v.at(31337), Eq(31337));
+}
+
+TEST(PersistentVector, test_concat) {
+    PersistentVector<int> v;
+    for (int i = 0; i < 100; i++) {
+        v = v.concat(PersistentVector<int>(range(i * 100, (i + 1) * 100)));
+    }
+    EXPECT_THAT(to_vector(v), Eq(range(0, 10000)));
+    EXPECT_THAT(to_vector(PersistentVector<int>(range(0, 3)).concat(v)).size(), Eq(10003u));
+    EXPECT_THAT(to_vector(v.concat(PersistentVector<int>())), Eq(range(0, 10000)));
+}
+
+TEST(PersistentVector, test_slice) {
+    PersistentVector<int> v(range(0, 10000));
+    EXPECT_THAT(to_vector(v.slice(100, 9000)), Eq(range(100, 9000)));
+    EXPECT_THAT(to_vector(v.slice(5, 6)), ElementsAre(5));
+    EXPECT_THAT(v.slice(10, 10).size(), Eq(0u));
+    EXPECT_THAT(to_vector(v.slice(9990, 20000)), Eq(range(9990, 10000)));
+    EXPECT_THAT(to_vector(v.slice(10, 20).push_back(-1)), ElementsAre(10, 11, 12, 13, 14, 15, 16, 17, 18, 19, -1));
+    EXPECT_THAT(v.at(20), Eq(20));
+}
+
+#include "util/WorkStealingPool.h"
+
+#include <atomic>
+#include <functional>
+
+TEST(WorkStealingPool, test_runs_all_tasks) {
+    std::atomic<int> count = 0;
+    WorkStealingPool pool(4);
+    for (int i = 0; i < 1000; i++) {
+        pool.submit([&] { count++; });
+    }
+    pool.wait();
+    EXPECT_THAT(count.load(), Eq(1000));
+}
+
+TEST(WorkStealingPool, test_tasks_submitting_tasks) {
+    std::atomic<int> count = 0;
+    WorkStealingPool pool(3);
+    std::function<void(int)> spawn = [&](int depth) {
+        count++;
+        if (depth == 0) return;
+        pool.submit([&, depth] { spawn(depth - 1); });
+        pool.submit([&, depth] { spawn(depth - 1); });
+    };
+    pool.submit([&] { spawn(10); });
+    pool.wait();
+    EXPECT_THAT(count.load(), Eq(2047));
+}